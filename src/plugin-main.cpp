@@ -87,6 +87,8 @@ static obs_properties_t *vdoninja_service_properties(void *)
 	obs_property_list_add_int(codec, "H.264", 0);
 	obs_property_list_add_int(codec, "VP8", 1);
 	obs_property_list_add_int(codec, "VP9", 2);
+	obs_property_list_add_int(codec, "AV1", 3);
+	obs_property_list_add_int(codec, "H.265 (HEVC)", 4);
 
 	obs_properties_add_int(props, "max_viewers", tr("MaxViewers", "Max Viewers"), 1, 50, 1);
 
@@ -97,6 +99,43 @@ static obs_properties_t *vdoninja_service_properties(void *)
 	    advanced, "custom_ice_servers", tr("CustomICEServers", "Custom STUN/TURN Servers"), OBS_TEXT_MULTILINE);
 	obs_property_text_set_monospace(iceServers, true);
 	obs_properties_add_bool(advanced, "force_turn", tr("ForceTURN", "Force TURN Relay"));
+	obs_property_t *simulcast =
+	    obs_properties_add_list(advanced, "simulcast_layers", tr("SimulcastLayers", "Simulcast Layers"),
+	                            OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(simulcast, tr("Simulcast.Off", "Off"), 1);
+	obs_property_list_add_int(simulcast, tr("Simulcast.Two", "2 layers (full, half)"), 2);
+	obs_property_list_add_int(simulcast, tr("Simulcast.Three", "3 layers (full, half, quarter)"), 3);
+	obs_properties_add_bool(advanced, "svc_enabled", tr("SvcEnabled", "Scalable Video (VP9/AV1 SVC)"));
+	obs_properties_add_bool(advanced, "h264_fallback", tr("H264Fallback", "H.264 Fallback for H.265"));
+	obs_properties_add_int(advanced, "keyframe_request_window_ms",
+	                       tr("KeyframeRequestWindow", "Keyframe Request Window (ms)"), 0, 5000, 50);
+	obs_property_t *pacing = obs_properties_add_list(advanced, "pacing_percent", tr("Pacing", "Send Pacing"),
+	                                                 OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(pacing, tr("Pacing.Off", "Off"), 0);
+	obs_property_list_add_int(pacing, tr("Pacing.Low", "1.5x bitrate"), 150);
+	obs_property_list_add_int(pacing, tr("Pacing.Default", "2.5x bitrate"), 250);
+	obs_property_list_add_int(pacing, tr("Pacing.High", "4x bitrate"), 400);
+	obs_property_t *mtu = obs_properties_add_list(advanced, "rtp_mtu", tr("RtpMtu", "RTP Packet Size"),
+	                                              OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(mtu, tr("RtpMtu.Auto", "Auto (per viewer network path)"), 0);
+	obs_property_list_add_int(mtu, tr("RtpMtu.Small", "Small (VPN/relay, 1100 bytes)"), 1100);
+	obs_property_list_add_int(mtu, tr("RtpMtu.Default", "Default (1200 bytes)"), 1200);
+	obs_property_list_add_int(mtu, tr("RtpMtu.Large", "Large (LAN, 1400 bytes)"), 1400);
+	obs_properties_add_bool(advanced, "mtu_probing", tr("MtuProbing", "Probe Larger Packets"));
+	obs_properties_add_bool(advanced, "fec_enabled", tr("FecEnabled", "Forward Error Correction (FlexFEC)"));
+	obs_properties_add_bool(advanced, "audio_redundancy", tr("AudioRedundancy", "Audio Redundancy (Opus RED)"));
+	obs_properties_add_bool(advanced, "idle_when_no_viewers",
+	                        tr("IdleWhenNoViewers", "Pause Sending With No Viewers"));
+	obs_properties_add_int(advanced, "idle_grace_seconds", tr("IdleGraceSeconds", "Idle Grace Period (s)"), 0, 3600,
+	                       5);
+	obs_property_t *encoderProfile =
+	    obs_properties_add_list(advanced, "encoder_profile", tr("EncoderProfile", "Encoder Latency Check"),
+	                            OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(encoderProfile, tr("EncoderProfile.Warn", "Warn only"), 0);
+	obs_property_list_add_int(encoderProfile, tr("EncoderProfile.Apply", "Apply low-latency settings"), 1);
+	obs_property_list_add_int(encoderProfile, tr("EncoderProfile.Require", "Refuse high-latency settings"), 2);
+	obs_properties_add_bool(advanced, "suspend_on_tally_off",
+	                        tr("SuspendOnTallyOff", "Stop Video to Viewers Not Using It"));
 	obs_properties_add_group(props, "advanced", tr("AdvancedSettings", "Advanced Settings"), OBS_GROUP_NORMAL,
 	                         advanced);
 
@@ -114,6 +153,19 @@ static void vdoninja_service_defaults(obs_data_t *settings)
 	obs_data_set_default_int(settings, "video_codec", 0);
 	obs_data_set_default_int(settings, "max_viewers", 10);
 	obs_data_set_default_bool(settings, "force_turn", false);
+	obs_data_set_default_int(settings, "simulcast_layers", 1);
+	obs_data_set_default_bool(settings, "svc_enabled", false);
+	obs_data_set_default_bool(settings, "h264_fallback", true);
+	obs_data_set_default_int(settings, "keyframe_request_window_ms", 500);
+	obs_data_set_default_int(settings, "pacing_percent", 250);
+	obs_data_set_default_int(settings, "rtp_mtu", 0);
+	obs_data_set_default_bool(settings, "mtu_probing", false);
+	obs_data_set_default_bool(settings, "fec_enabled", false);
+	obs_data_set_default_bool(settings, "audio_redundancy", true);
+	obs_data_set_default_bool(settings, "idle_when_no_viewers", false);
+	obs_data_set_default_int(settings, "idle_grace_seconds", 30);
+	obs_data_set_default_int(settings, "encoder_profile", 0);
+	obs_data_set_default_bool(settings, "suspend_on_tally_off", false);
 }
 
 static const char *vdoninja_service_url(void *data)
@@ -0,0 +1,85 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Per-viewer bandwidth estimation implementation
+ */
+
+#include "vdoninja-bandwidth-estimator.h"
+
+#include <algorithm>
+
+namespace vdoninja
+{
+
+namespace
+{
+
+// GCC loss controller: increase below 2% loss, back off above 10%
+constexpr double kLowLoss = 0.02;
+constexpr double kHighLoss = 0.10;
+constexpr double kIncreaseFactor = 1.08;
+// Never let the loss-based side run far ahead of what the receiver reports
+constexpr double kRembHeadroom = 1.5;
+
+} // namespace
+
+BandwidthEstimator::BandwidthEstimator(int startBitrate, int minBitrate, int maxBitrate)
+    : minBitrate_(std::max(minBitrate, 1)), maxBitrate_(std::max(maxBitrate, minBitrate_)),
+      lossBased_(std::clamp(startBitrate, minBitrate_, maxBitrate_))
+{
+}
+
+void BandwidthEstimator::onRemb(uint64_t bitrate, int64_t nowMs)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	remb_ = static_cast<int>(std::min<uint64_t>(bitrate, static_cast<uint64_t>(maxBitrate_)));
+	rembAtMs_ = nowMs;
+	updatedAtMs_ = nowMs;
+}
+
+void BandwidthEstimator::onReceiverReport(uint8_t fractionLost, int64_t nowMs)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	fractionLost_ = fractionLost / 256.0;
+	if (fractionLost_ < kLowLoss) {
+		lossBased_ *= kIncreaseFactor;
+	} else if (fractionLost_ > kHighLoss) {
+		lossBased_ *= 1.0 - 0.5 * fractionLost_;
+	}
+
+	double ceiling = maxBitrate_;
+	if (remb_ > 0 && nowMs - rembAtMs_ <= REMB_TIMEOUT_MS) {
+		ceiling = std::min(ceiling, remb_ * kRembHeadroom);
+	}
+	lossBased_ = std::clamp(lossBased_, static_cast<double>(minBitrate_),
+	                        std::max(ceiling, static_cast<double>(minBitrate_)));
+	updatedAtMs_ = nowMs;
+}
+
+int BandwidthEstimator::combinedLocked(int64_t nowMs) const
+{
+	int estimate = static_cast<int>(lossBased_);
+	if (remb_ > 0 && nowMs - rembAtMs_ <= REMB_TIMEOUT_MS) {
+		estimate = std::min(estimate, remb_);
+	}
+	return std::clamp(estimate, minBitrate_, maxBitrate_);
+}
+
+int BandwidthEstimator::bitrate() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return combinedLocked(updatedAtMs_);
+}
+
+BandwidthEstimate BandwidthEstimator::snapshot() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	BandwidthEstimate estimate;
+	estimate.bitrate = combinedLocked(updatedAtMs_);
+	estimate.lossBasedBitrate = static_cast<int>(lossBased_);
+	estimate.rembBitrate = remb_;
+	estimate.fractionLost = fractionLost_;
+	estimate.updatedAtMs = updatedAtMs_;
+	return estimate;
+}
+
+} // namespace vdoninja
@@ -0,0 +1,57 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Per-viewer bandwidth estimation
+ *
+ * Combines the viewer's REMB (receiver-side delay-based estimate) with a
+ * loss-based controller driven by RTCP receiver reports, in the style of the
+ * GCC sender-side loss controller.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+namespace vdoninja
+{
+
+struct BandwidthEstimate {
+	int bitrate = 0;          // Combined estimate, bps
+	int lossBasedBitrate = 0; // bps
+	int rembBitrate = 0;      // Last REMB, bps (0 if none)
+	double fractionLost = 0.0;
+	int64_t updatedAtMs = 0;
+};
+
+class BandwidthEstimator
+{
+public:
+	static constexpr int DEFAULT_MIN_BITRATE = 100000;
+	static constexpr int DEFAULT_MAX_BITRATE = 50000000;
+	// REMB values older than this no longer cap the estimate
+	static constexpr int64_t REMB_TIMEOUT_MS = 5000;
+
+	explicit BandwidthEstimator(int startBitrate, int minBitrate = DEFAULT_MIN_BITRATE,
+	                            int maxBitrate = DEFAULT_MAX_BITRATE);
+
+	void onRemb(uint64_t bitrate, int64_t nowMs);
+	// fractionLost is the RTCP fixed-point value (lost / 256)
+	void onReceiverReport(uint8_t fractionLost, int64_t nowMs);
+
+	int bitrate() const;
+	BandwidthEstimate snapshot() const;
+
+private:
+	int combinedLocked(int64_t nowMs) const;
+
+	mutable std::mutex mutex_;
+	int minBitrate_;
+	int maxBitrate_;
+	double lossBased_;
+	int remb_ = 0;
+	int64_t rembAtMs_ = 0;
+	double fractionLost_ = 0.0;
+	int64_t updatedAtMs_ = 0;
+};
+
+} // namespace vdoninja
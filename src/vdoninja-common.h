@@ -63,13 +63,26 @@ struct IceServer {
 	std::string credential;
 };
 
+class BandwidthEstimator;
+class CongestionGate;
+class FecController;
+class MtuController;
+class OpusRedController;
+class ViewerMediaGate;
+class PacedStream;
+class RtpHistory;
+class RtpSequencer;
+class RtxStream;
+class SimulcastLayerSelector;
+class SvcLayerSelector;
+
 // Peer connection info
 struct PeerInfo {
 	std::string uuid;
 	std::string streamId;
 	std::string session;
 	ConnectionType type;
-	ConnectionState state = ConnectionState::New;
+	std::atomic<ConnectionState> state{ConnectionState::New};
 	bool hasDataChannel = false;
 	std::shared_ptr<rtc::PeerConnection> pc;
 	std::shared_ptr<rtc::DataChannel> dataChannel;
@@ -77,8 +90,59 @@ struct PeerInfo {
 	std::shared_ptr<rtc::Track> videoTrack;
 	std::shared_ptr<rtc::RtcpSrReporter> audioSrReporter;
 	std::shared_ptr<rtc::RtcpSrReporter> videoSrReporter;
-	bool useAudioPacketizer = false;
-	bool useVideoPacketizer = false;
+	std::shared_ptr<RtpSequencer> audioSequencer;
+	std::shared_ptr<RtpSequencer> videoSequencer;
+	std::shared_ptr<RtpHistory> videoHistory;
+	std::shared_ptr<RtxStream> videoRtx;
+	std::atomic<bool> rtxNegotiated{false};
+	// The viewer's answer lacked H.265, so it receives the H.264 fallback layer
+	std::atomic<bool> h264Fallback{false};
+	std::shared_ptr<FecController> fec;
+	std::shared_ptr<RtpSequencer> fecSequencer;
+	std::atomic<bool> fecNegotiated{false};
+	std::shared_ptr<OpusRedController> audioRed;
+	std::atomic<bool> redNegotiated{false};
+	std::shared_ptr<SimulcastLayerSelector> layerSelector;
+	std::shared_ptr<SvcLayerSelector> svc;
+	std::shared_ptr<BandwidthEstimator> bandwidth;
+	std::shared_ptr<CongestionGate> congestion;
+	std::shared_ptr<PacedStream> pacedStream;
+	std::shared_ptr<MtuController> mtu;
+	std::shared_ptr<ViewerMediaGate> mediaGate;
+	std::atomic<int64_t> deliveredKeyframeAtUs{0}; // Enqueue time of the last keyframe sent to the viewer
+	bool hasAudioRtcpChain = false;
+	bool hasVideoRtcpChain = false;
+};
+
+// Publication slot for an immutable, reference-counted snapshot. Readers never
+// contend on the writer's lock; writers replace the whole snapshot.
+template <typename T> class SnapshotSlot
+{
+public:
+	std::shared_ptr<const T> load() const
+	{
+#if defined(__cpp_lib_atomic_shared_ptr)
+		return value_.load(std::memory_order_acquire);
+#else
+		return std::atomic_load_explicit(&value_, std::memory_order_acquire);
+#endif
+	}
+
+	void store(std::shared_ptr<const T> value)
+	{
+#if defined(__cpp_lib_atomic_shared_ptr)
+		value_.store(std::move(value), std::memory_order_release);
+#else
+		std::atomic_store_explicit(&value_, std::move(value), std::memory_order_release);
+#endif
+	}
+
+private:
+#if defined(__cpp_lib_atomic_shared_ptr)
+	std::atomic<std::shared_ptr<const T>> value_;
+#else
+	std::shared_ptr<const T> value_;
+#endif
 };
 
 // Room information
@@ -116,7 +180,7 @@ using OnStreamRemovedCallback = std::function<void(const std::string &streamId,
 using OnDataCallback = std::function<void(const std::string &uuid, const std::string &data)>;
 
 // Video codec preferences
-enum class VideoCodec { H264, VP8, VP9, AV1 };
+enum class VideoCodec { H264, VP8, VP9, AV1, H265 };
 
 // Audio codec preferences
 enum class AudioCodec { Opus, PCMU, PCMA };
@@ -154,6 +218,19 @@ struct OutputSettings {
 	int maxViewers = 10; // Max simultaneous P2P connections
 	std::vector<IceServer> customIceServers;
 	bool forceTurn = false;
+	int simulcastLayers = 1; // 1 disables simulcast
+	bool svcEnabled = false; // Forward each viewer only the VP9/AV1 SVC layers its estimate allows
+	bool h264Fallback = true; // With H.265, send H.264 from a second encoder to viewers without H.265
+	int keyframeRequestWindowMs = 500;
+	int pacingPercent = 250; // Pacing rate as % of target bitrate, 0 disables
+	int rtpMtu = 0;          // RTP payload bytes, 0 picks per viewer from the ICE path
+	bool mtuProbing = false; // Try larger packets per viewer and keep them if loss stays low
+	bool fecEnabled = false; // Offer FlexFEC; sent only to viewers that accept it and report loss
+	bool audioRed = true;    // Offer Opus RED; sent only to viewers that accept it and report audio loss
+	bool idleWhenNoViewers = false; // Drop encoder packets on arrival while nobody is watching
+	int idleGraceSeconds = 30;     // Keep sending this long after the last viewer leaves
+	int encoderProfile = 0;        // EncoderProfileMode: warn, apply low-latency settings, or require them
+	bool tallySuspend = false;     // Stop video to viewers whose tally is neither program nor preview
 	AutoInboundSettings autoInbound;
 };
 
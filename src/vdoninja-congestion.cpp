@@ -0,0 +1,56 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Per-viewer congestion policy implementation
+ */
+
+#include "vdoninja-congestion.h"
+
+namespace vdoninja
+{
+
+CongestionGate::CongestionGate(CongestionThresholds thresholds) : thresholds_(thresholds) {}
+
+bool CongestionGate::admitVideo(bool keyframe, int64_t queueDelayUs, size_t bufferedBytes)
+{
+	// A keyframe restarts the reference chain, so it is always sent and ends a drop period
+	if (keyframe) {
+		dropping_ = false;
+		if (exempt_ > 0) {
+			exempt_--;
+		}
+		return true;
+	}
+
+	if (exempt_ > 0) {
+		exempt_--;
+		return true;
+	}
+
+	if (!dropping_ &&
+	    (queueDelayUs > thresholds_.maxQueueDelayUs || bufferedBytes > thresholds_.maxBufferedBytes)) {
+		dropping_ = true;
+		congestionEvents_++;
+	}
+
+	if (dropping_) {
+		droppedFrames_++;
+		return false;
+	}
+	return true;
+}
+
+void CongestionGate::exempt(size_t frames)
+{
+	exempt_ = frames;
+}
+
+CongestionStats CongestionGate::stats() const
+{
+	CongestionStats stats;
+	stats.droppedFrames = droppedFrames_;
+	stats.congestionEvents = congestionEvents_;
+	stats.dropping = dropping_;
+	return stats;
+}
+
+} // namespace vdoninja
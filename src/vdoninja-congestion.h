@@ -0,0 +1,57 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Per-viewer congestion policy
+ *
+ * When a viewer's send path backs up, delta frames would only arrive late and
+ * pile more latency onto that viewer. The gate skips video for the congested
+ * viewer and resumes at the next keyframe, so the decoder never sees a broken
+ * reference chain. Audio is never gated.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace vdoninja
+{
+
+struct CongestionThresholds {
+	// Time a frame waited in the viewer's send lane before delivery
+	int64_t maxQueueDelayUs = 200000;
+	// Bytes still buffered by the viewer's transport
+	size_t maxBufferedBytes = 512 * 1024;
+};
+
+struct CongestionStats {
+	uint64_t droppedFrames = 0;
+	uint64_t congestionEvents = 0;
+	bool dropping = false;
+};
+
+// Used from the viewer's send worker only; stats may be read from any thread.
+class CongestionGate
+{
+public:
+	explicit CongestionGate(CongestionThresholds thresholds = {});
+
+	// Decide whether a video frame is sent. Returns false if it must be skipped.
+	bool admitVideo(bool keyframe, int64_t queueDelayUs, size_t bufferedBytes);
+
+	// Exempt the next `frames` video frames, e.g. a cached GOP burst whose queue
+	// delay reflects its capture time rather than congestion.
+	void exempt(size_t frames);
+
+	CongestionStats stats() const;
+	const CongestionThresholds &thresholds() const { return thresholds_; }
+
+private:
+	CongestionThresholds thresholds_;
+	std::atomic<size_t> exempt_{0};
+	std::atomic<bool> dropping_{false};
+	std::atomic<uint64_t> droppedFrames_{0};
+	std::atomic<uint64_t> congestionEvents_{0};
+};
+
+} // namespace vdoninja
@@ -100,6 +100,12 @@ DataMessage VDONinjaDataChannel::parseMessage(const std::string &rawMessage)
 		} else if (json.hasKey("muted") || json.hasKey("audioMuted") || json.hasKey("videoMuted")) {
 			msg.type = DataMessageType::Mute;
 			msg.data = rawMessage;
+		} else if (json.hasKey("pauseVideo") || json.hasKey("pauseAudio")) {
+			msg.type = DataMessageType::Pause;
+			msg.data = rawMessage;
+		} else if (json.hasKey("visibility") || json.hasKey("obsState")) {
+			msg.type = DataMessageType::Visibility;
+			msg.data = rawMessage;
 		} else if (json.hasKey("stats")) {
 			msg.type = DataMessageType::Stats;
 			msg.data = json.getString("stats");
@@ -152,6 +158,18 @@ std::string VDONinjaDataChannel::createKeyframeRequest()
 	return builder.build();
 }
 
+std::string VDONinjaDataChannel::createPauseRequest(const PauseRequest &request)
+{
+	JsonBuilder builder;
+	if (request.audio) {
+		builder.add("pauseAudio", *request.audio);
+	}
+	if (request.video) {
+		builder.add("pauseVideo", *request.video);
+	}
+	return builder.build();
+}
+
 std::string VDONinjaDataChannel::createCustomMessage(const std::string &type, const std::string &data)
 {
 	JsonBuilder builder;
@@ -179,6 +197,12 @@ void VDONinjaDataChannel::handleMessage(const std::string &senderId, const std::
 		case DataMessageType::Mute:
 			parseMuteMessage(senderId, json);
 			break;
+		case DataMessageType::Pause:
+			parsePauseMessage(senderId, json);
+			break;
+		case DataMessageType::Visibility:
+			parseVisibilityMessage(senderId, json);
+			break;
 		case DataMessageType::RequestKeyframe:
 			if (onKeyframeRequest_) {
 				onKeyframeRequest_(senderId);
@@ -261,6 +285,49 @@ void VDONinjaDataChannel::parseMuteMessage(const std::string &senderId, const Js
 	}
 }
 
+void VDONinjaDataChannel::parsePauseMessage(const std::string &senderId, const JsonParser &json)
+{
+	PauseRequest request;
+	if (json.hasKey("pauseAudio")) {
+		request.audio = json.getBool("pauseAudio");
+	}
+	if (json.hasKey("pauseVideo")) {
+		request.video = json.getBool("pauseVideo");
+	}
+
+	logDebug("Pause request from %s: audio=%d, video=%d", senderId.c_str(), request.audio.value_or(false),
+	         request.video.value_or(false));
+
+	if (onPauseRequest_) {
+		onPauseRequest_(senderId, request);
+	}
+}
+
+void VDONinjaDataChannel::parseVisibilityMessage(const std::string &senderId, const JsonParser &json)
+{
+	// VDO.Ninja browser sources report scene visibility inside obsState
+	bool visible = true;
+	if (json.hasKey("visibility")) {
+		visible = json.getBool("visibility", true);
+	} else {
+		const std::string rawState = json.getObject("obsState");
+		if (rawState.empty()) {
+			return;
+		}
+		JsonParser obsState(rawState);
+		if (!obsState.hasKey("visibility")) {
+			return;
+		}
+		visible = obsState.getBool("visibility", true);
+	}
+
+	logDebug("Visibility from %s: %d", senderId.c_str(), visible);
+
+	if (onVisibilityChange_) {
+		onVisibilityChange_(senderId, visible);
+	}
+}
+
 void VDONinjaDataChannel::parseCustomMessage(const std::string &senderId, const JsonParser &json)
 {
 	std::string data = json.getString("data");
@@ -290,6 +357,14 @@ void VDONinjaDataChannel::setOnKeyframeRequest(OnKeyframeRequestCallback callbac
 {
 	onKeyframeRequest_ = callback;
 }
+void VDONinjaDataChannel::setOnPauseRequest(OnPauseRequestCallback callback)
+{
+	onPauseRequest_ = callback;
+}
+void VDONinjaDataChannel::setOnVisibilityChange(OnVisibilityChangeCallback callback)
+{
+	onVisibilityChange_ = callback;
+}
 
 void VDONinjaDataChannel::setLocalTally(const TallyState &state)
 {
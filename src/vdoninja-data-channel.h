@@ -14,6 +14,7 @@
 #include <functional>
 #include <map>
 #include <mutex>
+#include <optional>
 
 #include "vdoninja-common.h"
 #include "vdoninja-utils.h"
@@ -28,6 +29,8 @@ enum class DataMessageType {
 	Tally,           // Tally light state
 	RequestKeyframe, // Request keyframe from publisher
 	Mute,            // Mute state change
+	Pause,           // Viewer asks us to pause or resume audio/video
+	Visibility,      // Our feed was shown or hidden in the viewer's scene
 	Stats,           // Connection statistics
 	Custom           // Custom application data
 };
@@ -38,6 +41,12 @@ struct TallyState {
 	bool preview = false; // Preview (green)
 };
 
+// Explicit pause request; a kind without a value keeps its current state
+struct PauseRequest {
+	std::optional<bool> audio;
+	std::optional<bool> video;
+};
+
 // Data message structure
 struct DataMessage {
 	DataMessageType type = DataMessageType::Unknown;
@@ -52,6 +61,8 @@ using OnTallyChangeCallback = std::function<void(const std::string &streamId, co
 using OnMuteChangeCallback = std::function<void(const std::string &senderId, bool audioMuted, bool videoMuted)>;
 using OnCustomDataCallback = std::function<void(const std::string &senderId, const std::string &data)>;
 using OnKeyframeRequestCallback = std::function<void(const std::string &senderId)>;
+using OnPauseRequestCallback = std::function<void(const std::string &senderId, const PauseRequest &request)>;
+using OnVisibilityChangeCallback = std::function<void(const std::string &senderId, bool visible)>;
 
 class VDONinjaDataChannel
 {
@@ -67,6 +78,7 @@ public:
 	std::string createTallyMessage(const TallyState &state);
 	std::string createMuteMessage(bool audioMuted, bool videoMuted);
 	std::string createKeyframeRequest();
+	std::string createPauseRequest(const PauseRequest &request);
 	std::string createCustomMessage(const std::string &type, const std::string &data);
 
 	// Handle incoming message (dispatches to appropriate callback)
@@ -82,6 +94,8 @@ public:
 	void setOnMuteChange(OnMuteChangeCallback callback);
 	void setOnCustomData(OnCustomDataCallback callback);
 	void setOnKeyframeRequest(OnKeyframeRequestCallback callback);
+	void setOnPauseRequest(OnPauseRequestCallback callback);
+	void setOnVisibilityChange(OnVisibilityChangeCallback callback);
 
 	// Tally light management
 	void setLocalTally(const TallyState &state);
@@ -93,6 +107,8 @@ private:
 	void parseChatMessage(const std::string &senderId, const JsonParser &json);
 	void parseTallyMessage(const std::string &senderId, const JsonParser &json);
 	void parseMuteMessage(const std::string &senderId, const JsonParser &json);
+	void parsePauseMessage(const std::string &senderId, const JsonParser &json);
+	void parseVisibilityMessage(const std::string &senderId, const JsonParser &json);
 	void parseCustomMessage(const std::string &senderId, const JsonParser &json);
 
 	// Callbacks
@@ -101,6 +117,8 @@ private:
 	OnMuteChangeCallback onMuteChange_;
 	OnCustomDataCallback onCustomData_;
 	OnKeyframeRequestCallback onKeyframeRequest_;
+	OnPauseRequestCallback onPauseRequest_;
+	OnVisibilityChangeCallback onVisibilityChange_;
 
 	// State
 	TallyState localTally_;
@@ -0,0 +1,45 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Ref-counted encoded packet handle implementation
+ */
+
+#include "vdoninja-encoded-packet.h"
+
+namespace vdoninja
+{
+
+EncodedPacket::EncodedPacket(const uint8_t *data, size_t size, const EncodedPacketInfo &info)
+    : data_(data), size_(size), info_(info)
+{
+}
+
+EncodedPacket::~EncodedPacket()
+{
+	if (release_) {
+		release_();
+	}
+}
+
+EncodedPacketRef EncodedPacket::wrap(const uint8_t *data, size_t size, const EncodedPacketInfo &info,
+                                     Release release)
+{
+	std::shared_ptr<EncodedPacket> packet(new EncodedPacket(data, size, info));
+	packet->release_ = std::move(release);
+	return packet;
+}
+
+EncodedPacketRef EncodedPacket::copy(const uint8_t *data, size_t size, const EncodedPacketInfo &info)
+{
+	return adopt(data && size > 0 ? std::vector<uint8_t>(data, data + size) : std::vector<uint8_t>(), info);
+}
+
+EncodedPacketRef EncodedPacket::adopt(std::vector<uint8_t> bytes, const EncodedPacketInfo &info)
+{
+	std::shared_ptr<EncodedPacket> packet(new EncodedPacket(nullptr, 0, info));
+	packet->owned_ = std::move(bytes);
+	packet->data_ = packet->owned_.data();
+	packet->size_ = packet->owned_.size();
+	return packet;
+}
+
+} // namespace vdoninja
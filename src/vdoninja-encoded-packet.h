@@ -0,0 +1,66 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Ref-counted encoded packet handle
+ *
+ * Wraps an encoder packet's payload without copying it. The output takes an OBS
+ * reference (obs_encoder_packet_ref) on each packet and releases it when the
+ * last handle is dropped, so send queues, the GOP cache, retransmission history
+ * and any other stage can hold the same payload for as long as they need it.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace vdoninja
+{
+
+// Encoder timing and frame metadata, in the encoder's own timebase
+struct EncodedPacketInfo {
+	int64_t pts = 0;
+	int64_t dts = 0;
+	int32_t timebaseNum = 1;
+	int32_t timebaseDen = 1000;
+	bool keyframe = false;
+	size_t trackIndex = 0;
+};
+
+class EncodedPacket;
+using EncodedPacketRef = std::shared_ptr<const EncodedPacket>;
+
+class EncodedPacket
+{
+public:
+	using Release = std::function<void()>;
+
+	// Borrow `data`; `release` runs once the last handle is gone, on whichever thread drops it.
+	static EncodedPacketRef wrap(const uint8_t *data, size_t size, const EncodedPacketInfo &info, Release release);
+	// Own a copy of `data`, for callers that cannot keep the buffer alive.
+	static EncodedPacketRef copy(const uint8_t *data, size_t size, const EncodedPacketInfo &info = {});
+	// Take ownership of an already assembled payload.
+	static EncodedPacketRef adopt(std::vector<uint8_t> bytes, const EncodedPacketInfo &info = {});
+
+	~EncodedPacket();
+	EncodedPacket(const EncodedPacket &) = delete;
+	EncodedPacket &operator=(const EncodedPacket &) = delete;
+
+	const uint8_t *data() const { return data_; }
+	size_t size() const { return size_; }
+	const EncodedPacketInfo &info() const { return info_; }
+	bool keyframe() const { return info_.keyframe; }
+
+private:
+	EncodedPacket(const uint8_t *data, size_t size, const EncodedPacketInfo &info);
+
+	const uint8_t *data_ = nullptr;
+	size_t size_ = 0;
+	EncodedPacketInfo info_;
+	Release release_;
+	std::vector<uint8_t> owned_;
+};
+
+} // namespace vdoninja
@@ -0,0 +1,399 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Low-latency encoder profile
+ */
+
+#include "vdoninja-encoder-profile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+namespace vdoninja
+{
+
+namespace
+{
+
+// Frame-threaded x264 holds roughly this many frames in flight; the real number grows with the core count
+constexpr int X264_FRAME_THREAD_DELAY = 4;
+// NVENC picks its lookahead depth itself; this is a typical value
+constexpr int NVENC_LOOKAHEAD_FRAMES = 16;
+constexpr int APPLE_VT_REORDER_FRAMES = 2;
+
+std::string upper(std::string value)
+{
+	std::transform(value.begin(), value.end(), value.begin(),
+	               [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+	return value;
+}
+
+std::string stringValue(const EncoderSettingValues &values, const char *key)
+{
+	auto it = values.strings.find(key);
+	return it != values.strings.end() ? it->second : std::string();
+}
+
+bool hasInt(const EncoderSettingValues &values, const char *key)
+{
+	return values.ints.count(key) > 0;
+}
+
+int64_t intValue(const EncoderSettingValues &values, const char *key, int64_t fallback = 0)
+{
+	auto it = values.ints.find(key);
+	return it != values.ints.end() ? it->second : fallback;
+}
+
+bool boolValue(const EncoderSettingValues &values, const char *key)
+{
+	auto it = values.bools.find(key);
+	return it != values.bools.end() && it->second;
+}
+
+int x264PresetLookahead(const std::string &preset)
+{
+	static const std::map<std::string, int> kLookahead = {
+	    {"ultrafast", 0}, {"superfast", 0}, {"veryfast", 10}, {"faster", 20}, {"fast", 30},
+	    {"medium", 40},   {"slow", 50},     {"slower", 60},   {"veryslow", 60}, {"placebo", 60},
+	};
+	auto it = kLookahead.find(preset);
+	return it != kLookahead.end() ? it->second : 40;
+}
+
+// x264opts is a space- or colon-separated list of key=value options
+std::vector<std::string> splitX264Options(const std::string &options)
+{
+	std::vector<std::string> tokens;
+	std::string token;
+	for (char c : options) {
+		if (c == ' ' || c == ':') {
+			if (!token.empty()) {
+				tokens.push_back(token);
+				token.clear();
+			}
+		} else {
+			token += c;
+		}
+	}
+	if (!token.empty()) {
+		tokens.push_back(token);
+	}
+	return tokens;
+}
+
+bool parseX264Option(const std::string &token, const char *key, int &value)
+{
+	const std::string prefix = std::string(key) + "=";
+	if (token.compare(0, prefix.size(), prefix) != 0) {
+		return false;
+	}
+	value = std::atoi(token.c_str() + prefix.size());
+	return true;
+}
+
+std::string formatMs(double ms)
+{
+	return std::to_string(static_cast<long long>(std::lround(ms)));
+}
+
+} // namespace
+
+EncoderFamily encoderFamilyFromId(const std::string &encoderId)
+{
+	if (encoderId == "obs_x264") {
+		return EncoderFamily::X264;
+	}
+	if (encoderId.find("nvenc") != std::string::npos) {
+		return EncoderFamily::Nvenc;
+	}
+	if (encoderId.find("qsv") != std::string::npos) {
+		return EncoderFamily::Qsv;
+	}
+	if (encoderId.find("amf") != std::string::npos) {
+		return EncoderFamily::Amf;
+	}
+	if (encoderId.rfind("com.apple.videotoolbox", 0) == 0) {
+		return EncoderFamily::AppleVT;
+	}
+	return EncoderFamily::Other;
+}
+
+const char *encoderFamilyName(EncoderFamily family)
+{
+	switch (family) {
+	case EncoderFamily::X264:
+		return "x264";
+	case EncoderFamily::Nvenc:
+		return "NVENC";
+	case EncoderFamily::Qsv:
+		return "QuickSync";
+	case EncoderFamily::Amf:
+		return "AMF";
+	case EncoderFamily::AppleVT:
+		return "VideoToolbox";
+	case EncoderFamily::Other:
+		break;
+	}
+	return "other";
+}
+
+std::vector<std::string> h264EncoderCandidates(const std::string &hevcEncoderId)
+{
+	// Ids whose H.264 counterpart does not follow the codec name
+	static const std::map<std::string, std::string> kCounterparts = {
+	    {"jim_hevc_nvenc", "jim_nvenc"},
+	    {"ffmpeg_hevc_nvenc", "ffmpeg_nvenc"},
+	    {"obs_qsv11_hevc", "obs_qsv11_v2"},
+	    {"obs_qsv11_hevc_soft", "obs_qsv11_soft_v2"},
+	    {"com.apple.videotoolbox.videoencoder.ave.hevc", "com.apple.videotoolbox.videoencoder.ave.avc"},
+	};
+
+	std::vector<std::string> candidates;
+	auto add = [&candidates](const std::string &id) {
+		if (!id.empty() && std::find(candidates.begin(), candidates.end(), id) == candidates.end()) {
+			candidates.push_back(id);
+		}
+	};
+
+	auto known = kCounterparts.find(hevcEncoderId);
+	if (known != kCounterparts.end()) {
+		add(known->second);
+	}
+	// obs_nvenc_hevc_tex -> obs_nvenc_h264_tex, h265_texture_amf -> h264_texture_amf
+	for (const char *name : {"hevc", "h265"}) {
+		const size_t pos = hevcEncoderId.find(name);
+		if (pos != std::string::npos) {
+			add(std::string(hevcEncoderId).replace(pos, 4, "h264"));
+		}
+	}
+	add("obs_x264");
+	return candidates;
+}
+
+std::vector<EncoderSettingKey> encoderProfileKeys(EncoderFamily family)
+{
+	std::vector<EncoderSettingKey> keys = {
+	    {"keyint_sec", EncoderSettingType::Int},
+	    {"rate_control", EncoderSettingType::String},
+	    {"bitrate", EncoderSettingType::Int},
+	};
+	switch (family) {
+	case EncoderFamily::X264:
+		keys.push_back({"preset", EncoderSettingType::String});
+		keys.push_back({"tune", EncoderSettingType::String});
+		keys.push_back({"x264opts", EncoderSettingType::String});
+		break;
+	case EncoderFamily::Nvenc:
+		keys.push_back({"bf", EncoderSettingType::Int});
+		keys.push_back({"lookahead", EncoderSettingType::Bool});
+		keys.push_back({"tune", EncoderSettingType::String});
+		break;
+	case EncoderFamily::Qsv:
+		keys.push_back({"bframes", EncoderSettingType::Int});
+		keys.push_back({"latency", EncoderSettingType::String});
+		break;
+	case EncoderFamily::Amf:
+		keys.push_back({"bf", EncoderSettingType::Int});
+		break;
+	case EncoderFamily::AppleVT:
+		keys.push_back({"bframes", EncoderSettingType::Bool});
+		break;
+	case EncoderFamily::Other:
+		break;
+	}
+	return keys;
+}
+
+EncoderConfig parseEncoderConfig(EncoderFamily family, const EncoderSettingValues &values, double fps)
+{
+	EncoderConfig config;
+	config.family = family;
+	config.fps = fps > 0.0 ? fps : 30.0;
+	config.keyintSec = static_cast<int>(std::max<int64_t>(intValue(values, "keyint_sec"), 0));
+	config.rateControl = upper(stringValue(values, "rate_control"));
+
+	switch (family) {
+	case EncoderFamily::X264: {
+		std::string preset = stringValue(values, "preset");
+		if (preset.empty()) {
+			preset = "veryfast"; // obs-x264 default
+		}
+		const bool zeroLatency = stringValue(values, "tune").find("zerolatency") != std::string::npos;
+		config.bFramesKnown = true;
+		config.bFrames = zeroLatency || preset == "ultrafast" ? 0 : 3;
+		config.lookaheadFrames = zeroLatency ? 0 : x264PresetLookahead(preset);
+		config.threadDelayFrames = zeroLatency ? 0 : X264_FRAME_THREAD_DELAY;
+		// Options are applied after the tune, so they win
+		for (const std::string &token : splitX264Options(stringValue(values, "x264opts"))) {
+			int value = 0;
+			if (parseX264Option(token, "bframes", value)) {
+				config.bFrames = std::max(value, 0);
+			} else if (parseX264Option(token, "rc-lookahead", value)) {
+				config.lookaheadFrames = std::max(value, 0);
+			} else if (parseX264Option(token, "keyint", value) && value > 0) {
+				config.keyintSec = static_cast<int>(std::ceil(value / config.fps));
+			}
+		}
+		break;
+	}
+	case EncoderFamily::Nvenc:
+	case EncoderFamily::Amf:
+		config.bFramesKnown = hasInt(values, "bf");
+		config.bFrames = static_cast<int>(std::max<int64_t>(intValue(values, "bf"), 0));
+		config.lookaheadFrames = boolValue(values, "lookahead") ? NVENC_LOOKAHEAD_FRAMES : 0;
+		break;
+	case EncoderFamily::Qsv:
+		config.bFramesKnown = hasInt(values, "bframes");
+		config.bFrames = static_cast<int>(std::max<int64_t>(intValue(values, "bframes"), 0));
+		break;
+	case EncoderFamily::AppleVT:
+		config.bFramesKnown = values.bools.count("bframes") > 0;
+		config.bFrames = boolValue(values, "bframes") ? APPLE_VT_REORDER_FRAMES : 0;
+		break;
+	case EncoderFamily::Other:
+		break;
+	}
+	return config;
+}
+
+bool EncoderAssessment::blocking() const
+{
+	return std::any_of(issues.begin(), issues.end(),
+	                   [](const EncoderIssue &issue) { return issue.severity == EncoderIssueSeverity::Blocking; });
+}
+
+EncoderAssessment assessEncoderConfig(const EncoderConfig &config)
+{
+	EncoderAssessment assessment;
+	const double frameMs = 1000.0 / config.fps;
+	// One frame to encode, plus every frame the encoder holds back before emitting a packet
+	assessment.latencyMs = frameMs * (1 + config.bFrames + config.lookaheadFrames + config.threadDelayFrames);
+
+	auto add = [&assessment](EncoderIssueSeverity severity, const std::string &message) {
+		assessment.issues.push_back({severity, message});
+	};
+
+	if (config.bFrames > 0) {
+		add(EncoderIssueSeverity::Blocking, std::to_string(config.bFrames) +
+		                                        " B-frame(s) reorder video; WebRTC playback expects frames in order");
+	}
+	if (config.keyintSec > MAX_REALTIME_KEYINT_SEC) {
+		add(EncoderIssueSeverity::Blocking, "keyframe interval of " + std::to_string(config.keyintSec) +
+		                                        " s keeps new or recovering viewers waiting that long");
+	} else if (config.keyintSec == 0) {
+		add(EncoderIssueSeverity::Warning, "keyframe interval is left to the encoder and may be many seconds");
+	}
+	if (config.lookaheadFrames > 0) {
+		add(EncoderIssueSeverity::Warning,
+		    "lookahead holds " + std::to_string(config.lookaheadFrames) + " frame(s) before encoding");
+	}
+	if (config.threadDelayFrames > 0) {
+		add(EncoderIssueSeverity::Warning, "x264 without the zerolatency tune buffers frames across threads");
+	}
+	if (!config.rateControl.empty() && config.rateControl != "CBR") {
+		add(EncoderIssueSeverity::Warning, config.rateControl +
+		                                       " rate control lets keyframes and busy scenes burst above the bitrate");
+	}
+	if (assessment.latencyMs > ENCODER_LATENCY_WARN_MS) {
+		add(EncoderIssueSeverity::Warning, "encoder adds about " + formatMs(assessment.latencyMs) + " ms");
+	}
+	return assessment;
+}
+
+EncoderSettingValues lowLatencyOverrides(EncoderFamily family, const EncoderSettingValues &values,
+                                         const EncoderConfig &config)
+{
+	EncoderSettingValues overrides;
+
+	if (hasInt(values, "keyint_sec") && (config.keyintSec == 0 || config.keyintSec > LOW_LATENCY_KEYINT_SEC)) {
+		overrides.ints["keyint_sec"] = LOW_LATENCY_KEYINT_SEC;
+	}
+	// Only bitrate-driven encoders can switch to CBR. VideoToolbox offers CBR on some
+	// hardware only, so ABR (its portable bitrate mode) is kept there.
+	if (!config.rateControl.empty() && intValue(values, "bitrate") > 0) {
+		const bool appleBitrateMode = family == EncoderFamily::AppleVT && config.rateControl == "ABR";
+		if (config.rateControl != "CBR" && !appleBitrateMode) {
+			overrides.strings["rate_control"] = family == EncoderFamily::AppleVT ? "ABR" : "CBR";
+		}
+	}
+
+	switch (family) {
+	case EncoderFamily::X264: {
+		const std::string tune = stringValue(values, "tune");
+		if (tune.find("zerolatency") == std::string::npos) {
+			overrides.strings["tune"] = "zerolatency";
+		}
+		// Drop options that would undo the tune, and any keyint that overrides keyint_sec
+		const std::string options = stringValue(values, "x264opts");
+		std::ostringstream kept;
+		bool changed = false;
+		for (const std::string &token : splitX264Options(options)) {
+			int value = 0;
+			if (parseX264Option(token, "bframes", value) || parseX264Option(token, "rc-lookahead", value) ||
+			    parseX264Option(token, "keyint", value)) {
+				changed = true;
+				continue;
+			}
+			if (kept.tellp() > 0) {
+				kept << ' ';
+			}
+			kept << token;
+		}
+		if (changed) {
+			overrides.strings["x264opts"] = kept.str();
+		}
+		break;
+	}
+	case EncoderFamily::Nvenc:
+		if (config.bFrames > 0) {
+			overrides.ints["bf"] = 0;
+		}
+		if (boolValue(values, "lookahead")) {
+			overrides.bools["lookahead"] = false;
+		}
+		if (!stringValue(values, "tune").empty() && stringValue(values, "tune") != "ull") {
+			overrides.strings["tune"] = "ull";
+		}
+		break;
+	case EncoderFamily::Qsv:
+		if (config.bFrames > 0) {
+			overrides.ints["bframes"] = 0;
+		}
+		if (!stringValue(values, "latency").empty() && stringValue(values, "latency") != "ultra-low") {
+			overrides.strings["latency"] = "ultra-low";
+		}
+		break;
+	case EncoderFamily::Amf:
+		if (config.bFrames > 0) {
+			overrides.ints["bf"] = 0;
+		}
+		break;
+	case EncoderFamily::AppleVT:
+		if (boolValue(values, "bframes")) {
+			overrides.bools["bframes"] = false;
+		}
+		break;
+	case EncoderFamily::Other:
+		break;
+	}
+	return overrides;
+}
+
+EncoderSettingValues mergeEncoderSettings(EncoderSettingValues values, const EncoderSettingValues &overrides)
+{
+	for (const auto &entry : overrides.strings) {
+		values.strings[entry.first] = entry.second;
+	}
+	for (const auto &entry : overrides.ints) {
+		values.ints[entry.first] = entry.second;
+	}
+	for (const auto &entry : overrides.bools) {
+		values.bools[entry.first] = entry.second;
+	}
+	return values;
+}
+
+} // namespace vdoninja
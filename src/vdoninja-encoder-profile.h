@@ -0,0 +1,101 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Low-latency encoder profile
+ *
+ * Publishing with B-frames, lookahead, long keyframe intervals or quality-based
+ * rate control adds hundreds of ms of latency and does not suit WebRTC. This
+ * stage reads the attached video encoder's settings, estimates the latency the
+ * encoder itself adds, flags configurations that break real-time delivery and
+ * can compute low-latency overrides. The OBS glue lives in the output; this
+ * part only works on plain setting values, keyed by the encoder's own names.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace vdoninja
+{
+
+enum class EncoderProfileMode {
+	Warn = 0,    // Report latency and problems only
+	Apply = 1,   // Override the encoder with low-latency settings before it starts
+	Require = 2, // Refuse to start on settings that break real-time delivery
+};
+
+// Encoder implementations whose settings keys are understood
+enum class EncoderFamily { X264, Nvenc, Qsv, Amf, AppleVT, Other };
+
+EncoderFamily encoderFamilyFromId(const std::string &encoderId);
+const char *encoderFamilyName(EncoderFamily family);
+
+// H.264 encoder ids to try for the fallback of an H.265 encoder: the same hardware first,
+// x264 last. Ids may not be registered in this OBS build; callers check before creating.
+std::vector<std::string> h264EncoderCandidates(const std::string &hevcEncoderId);
+
+// Subset of an encoder's OBS settings, by key, that the profile stage reads or writes
+struct EncoderSettingValues {
+	std::map<std::string, std::string> strings;
+	std::map<std::string, int64_t> ints;
+	std::map<std::string, bool> bools;
+
+	bool empty() const { return strings.empty() && ints.empty() && bools.empty(); }
+};
+
+enum class EncoderSettingType { String, Int, Bool };
+
+struct EncoderSettingKey {
+	const char *name;
+	EncoderSettingType type;
+};
+
+// Setting keys the stage reads for this encoder family
+std::vector<EncoderSettingKey> encoderProfileKeys(EncoderFamily family);
+
+// Effective latency-relevant configuration, derived from the raw settings
+struct EncoderConfig {
+	EncoderFamily family = EncoderFamily::Other;
+	double fps = 30.0;
+	int bFrames = 0;
+	bool bFramesKnown = false;
+	int lookaheadFrames = 0;
+	int threadDelayFrames = 0; // x264 frame threads without zerolatency
+	int keyintSec = 0;         // 0 leaves the interval to the encoder
+	std::string rateControl;   // Upper-case mode name, empty if not exposed
+};
+
+EncoderConfig parseEncoderConfig(EncoderFamily family, const EncoderSettingValues &values, double fps);
+
+enum class EncoderIssueSeverity { Warning, Blocking };
+
+struct EncoderIssue {
+	EncoderIssueSeverity severity;
+	std::string message;
+};
+
+struct EncoderAssessment {
+	double latencyMs = 0.0; // Encoder-induced delay from frame capture to packet output
+	std::vector<EncoderIssue> issues;
+
+	bool blocking() const;
+};
+
+EncoderAssessment assessEncoderConfig(const EncoderConfig &config);
+
+// Settings to write so the encoder runs without B-frames or lookahead, with a bounded
+// keyframe interval and CBR. Empty when the encoder is already low-latency.
+EncoderSettingValues lowLatencyOverrides(EncoderFamily family, const EncoderSettingValues &values,
+                                         const EncoderConfig &config);
+
+// Apply overrides on top of values (for re-assessing the result)
+EncoderSettingValues mergeEncoderSettings(EncoderSettingValues values, const EncoderSettingValues &overrides);
+
+constexpr int LOW_LATENCY_KEYINT_SEC = 2;
+// Keyframe intervals above this keep new and recovering viewers waiting too long
+constexpr int MAX_REALTIME_KEYINT_SEC = 10;
+constexpr double ENCODER_LATENCY_WARN_MS = 100.0;
+
+} // namespace vdoninja
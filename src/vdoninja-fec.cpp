@@ -0,0 +1,316 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * FlexFEC (flexfec-03) forward error correction implementation
+ */
+
+#include "vdoninja-fec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace vdoninja
+{
+
+namespace
+{
+
+// Receiver reports arrive about once a second; weight recent ones without chasing single spikes
+constexpr double kLossSmoothing = 0.3;
+
+struct FecGroup {
+	size_t first = 0;  // Index of the first protected packet in the frame
+	size_t stride = 1; // Distance between protected packets
+	size_t count = 0;
+	size_t headerSize = 0;
+	size_t payloadSize = 0;
+};
+
+void xorInto(uint8_t *dst, const uint8_t *src, size_t size)
+{
+	for (size_t i = 0; i < size; ++i) {
+		dst[i] ^= src[i];
+	}
+}
+
+uint16_t readBe16(const uint8_t *p)
+{
+	return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t readBe32(const uint8_t *p)
+{
+	return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+	       (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void writeBe16(uint8_t *p, uint16_t value)
+{
+	p[0] = static_cast<uint8_t>(value >> 8);
+	p[1] = static_cast<uint8_t>(value);
+}
+
+void writeBe32(uint8_t *p, uint32_t value)
+{
+	p[0] = static_cast<uint8_t>(value >> 24);
+	p[1] = static_cast<uint8_t>(value >> 16);
+	p[2] = static_cast<uint8_t>(value >> 8);
+	p[3] = static_cast<uint8_t>(value);
+}
+
+// Packet offsets from the SN base covered by a FlexFEC packet; empty if malformed or unsupported
+std::vector<uint16_t> protectedOffsets(const uint8_t *header, size_t size, size_t &headerSize)
+{
+	std::vector<uint16_t> offsets;
+	if (size < FLEXFEC_HEADER_SIZE_SHORT) {
+		return offsets;
+	}
+	const uint16_t chunk0 = readBe16(header + 18);
+	for (uint16_t o = 0; o < 15; ++o) {
+		if (chunk0 & (1u << (14 - o))) {
+			offsets.push_back(o);
+		}
+	}
+	if (chunk0 & 0x8000) {
+		headerSize = FLEXFEC_HEADER_SIZE_SHORT;
+		return offsets;
+	}
+	if (size < FLEXFEC_HEADER_SIZE_LONG) {
+		return {};
+	}
+	const uint32_t chunk1 = readBe32(header + 20);
+	if (!(chunk1 & 0x80000000u)) {
+		// Masks beyond 46 packets are never produced by the encoder
+		return {};
+	}
+	for (uint16_t o = 15; o < 46; ++o) {
+		if (chunk1 & (1u << (30 - (o - 15)))) {
+			offsets.push_back(o);
+		}
+	}
+	headerSize = FLEXFEC_HEADER_SIZE_LONG;
+	return offsets;
+}
+
+} // namespace
+
+size_t flexfecPacketCount(size_t mediaPackets, double ratio, bool keyframe)
+{
+	if (mediaPackets == 0 || ratio <= 0.0) {
+		return 0;
+	}
+	size_t count = static_cast<size_t>(std::lround(static_cast<double>(mediaPackets) * std::min(ratio, 1.0)));
+	if (count == 0 && keyframe) {
+		count = 1;
+	}
+	return std::min(count, mediaPackets);
+}
+
+FlexfecEncoder::FlexfecEncoder(uint32_t ssrc, uint8_t payloadType, uint32_t protectedSsrc)
+    : ssrc_(ssrc), payloadType_(payloadType), protectedSsrc_(protectedSsrc)
+{
+}
+
+std::shared_ptr<const RtpFrame> FlexfecEncoder::protect(const RtpFrame &frame, uint16_t firstSequence,
+                                                        double ratio) const
+{
+	// Split the frame into blocks and each block into interleaved groups: packet i of a
+	// block belongs to group i % groups, so consecutive losses hit different groups.
+	std::vector<FecGroup> groups;
+	size_t totalBytes = 0;
+	for (size_t block = 0; block < frame.packetCount(); block += FLEXFEC_MAX_BLOCK_PACKETS) {
+		const size_t blockPackets = std::min(FLEXFEC_MAX_BLOCK_PACKETS, frame.packetCount() - block);
+		const size_t groupCount = flexfecPacketCount(blockPackets, ratio, frame.keyframe);
+		for (size_t g = 0; g < groupCount; ++g) {
+			FecGroup group;
+			group.first = block + g;
+			group.stride = groupCount;
+			group.count = (blockPackets - g + groupCount - 1) / groupCount;
+			const size_t span = (group.count - 1) * group.stride + 1;
+			group.headerSize = span <= 15 ? FLEXFEC_HEADER_SIZE_SHORT : FLEXFEC_HEADER_SIZE_LONG;
+			for (size_t k = 0; k < group.count; ++k) {
+				const size_t size = frame.packetSize(group.first + k * group.stride);
+				group.payloadSize = std::max(group.payloadSize, size > RTP_HEADER_SIZE ? size - RTP_HEADER_SIZE : 0);
+			}
+			totalBytes += RTP_HEADER_SIZE + group.headerSize + group.payloadSize;
+			groups.push_back(group);
+		}
+	}
+	if (groups.empty()) {
+		return nullptr;
+	}
+
+	auto out = std::make_shared<OwnedRtpFrame>();
+	out->storage.assign(totalBytes, 0);
+	out->timestamp = frame.timestamp;
+	out->keyframe = frame.keyframe;
+	out->packets.reserve(groups.size());
+
+	uint8_t *packet = out->storage.data();
+	for (const FecGroup &group : groups) {
+		writeRtpHeader(packet, payloadType_, false, 0, frame.timestamp, ssrc_);
+		uint8_t *header = packet + RTP_HEADER_SIZE;
+		uint8_t *payload = header + group.headerSize;
+
+		// Recovery fields: XOR of the protected packets' first header bytes (P, X, CC, M, PT),
+		// payload lengths and timestamps; the payload is the XOR of everything after the RTP header
+		uint16_t lengthRecovery = 0;
+		uint16_t chunk0 = 0;
+		uint32_t chunk1 = 0;
+		for (size_t k = 0; k < group.count; ++k) {
+			const size_t index = group.first + k * group.stride;
+			const uint8_t *media = frame.packetData(index);
+			const size_t size = frame.packetSize(index);
+			if (size < RTP_HEADER_SIZE) {
+				continue;
+			}
+			header[0] ^= media[0];
+			header[1] ^= media[1];
+			lengthRecovery ^= static_cast<uint16_t>(size - RTP_HEADER_SIZE);
+			xorInto(header + 4, media + 4, 4);
+			xorInto(payload, media + RTP_HEADER_SIZE, size - RTP_HEADER_SIZE);
+
+			const size_t offset = k * group.stride;
+			if (offset < 15) {
+				chunk0 |= static_cast<uint16_t>(1u << (14 - offset));
+			} else {
+				chunk1 |= 1u << (30 - (offset - 15));
+			}
+		}
+		header[0] &= 0x3F; // R and F bits clear: flexible mask
+		writeBe16(header + 2, lengthRecovery);
+		header[8] = 1; // One protected SSRC
+		writeBe32(header + 12, protectedSsrc_);
+		writeBe16(header + 16, static_cast<uint16_t>(firstSequence + group.first));
+		// The K bit marks the last mask chunk
+		if (group.headerSize == FLEXFEC_HEADER_SIZE_SHORT) {
+			chunk0 |= 0x8000;
+		} else {
+			chunk1 |= 0x80000000u;
+			writeBe32(header + 20, chunk1);
+		}
+		writeBe16(header + 18, chunk0);
+
+		const size_t packetSize = RTP_HEADER_SIZE + group.headerSize + group.payloadSize;
+		out->packets.push_back({packet, static_cast<uint32_t>(packetSize)});
+		packet += packetSize;
+	}
+	return out;
+}
+
+size_t recoverFlexfecPackets(std::map<uint16_t, std::vector<uint8_t>> &media,
+                             const std::vector<std::vector<uint8_t>> &fecPackets, uint32_t mediaSsrc)
+{
+	size_t recovered = 0;
+	bool progress = true;
+	while (progress) {
+		progress = false;
+		for (const auto &fec : fecPackets) {
+			if (fec.size() < RTP_HEADER_SIZE + FLEXFEC_HEADER_SIZE_SHORT) {
+				continue;
+			}
+			const uint8_t *header = fec.data() + RTP_HEADER_SIZE;
+			const size_t available = fec.size() - RTP_HEADER_SIZE;
+			if ((header[0] & 0xC0) != 0 || header[8] != 1 || readBe32(header + 12) != mediaSsrc) {
+				continue;
+			}
+			size_t headerSize = 0;
+			const std::vector<uint16_t> offsets = protectedOffsets(header, available, headerSize);
+			if (offsets.empty()) {
+				continue;
+			}
+
+			const uint16_t base = readBe16(header + 16);
+			size_t missingCount = 0;
+			uint16_t missing = 0;
+			for (uint16_t offset : offsets) {
+				const uint16_t sequence = static_cast<uint16_t>(base + offset);
+				if (media.find(sequence) == media.end()) {
+					missing = sequence;
+					missingCount++;
+				}
+			}
+			if (missingCount != 1) {
+				continue;
+			}
+
+			uint8_t fields[8];
+			std::memcpy(fields, header, sizeof(fields));
+			std::vector<uint8_t> payload(header + headerSize, fec.data() + fec.size());
+			for (uint16_t offset : offsets) {
+				const uint16_t sequence = static_cast<uint16_t>(base + offset);
+				if (sequence == missing) {
+					continue;
+				}
+				const std::vector<uint8_t> &packet = media[sequence];
+				if (packet.size() < RTP_HEADER_SIZE) {
+					continue;
+				}
+				const size_t length = packet.size() - RTP_HEADER_SIZE;
+				fields[0] ^= packet[0];
+				fields[1] ^= packet[1];
+				fields[2] ^= static_cast<uint8_t>(length >> 8);
+				fields[3] ^= static_cast<uint8_t>(length);
+				xorInto(fields + 4, packet.data() + 4, 4);
+				xorInto(payload.data(), packet.data() + RTP_HEADER_SIZE, std::min(length, payload.size()));
+			}
+
+			const size_t length = readBe16(fields + 2);
+			if (length > payload.size()) {
+				continue;
+			}
+			std::vector<uint8_t> rebuilt(RTP_HEADER_SIZE + length);
+			rebuilt[0] = static_cast<uint8_t>(0x80 | (fields[0] & 0x3F));
+			rebuilt[1] = fields[1];
+			writeBe16(rebuilt.data() + 2, missing);
+			std::memcpy(rebuilt.data() + 4, fields + 4, 4);
+			writeBe32(rebuilt.data() + 8, mediaSsrc);
+			std::memcpy(rebuilt.data() + RTP_HEADER_SIZE, payload.data(), length);
+			media[missing] = std::move(rebuilt);
+			recovered++;
+			progress = true;
+		}
+	}
+	return recovered;
+}
+
+bool FecController::onReceiverReport(uint8_t fractionLost)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	const double sample = static_cast<double>(fractionLost) / 256.0;
+	stats_.lossFraction = hasReport_ ? stats_.lossFraction + kLossSmoothing * (sample - stats_.lossFraction) : sample;
+	hasReport_ = true;
+
+	const bool wasActive = stats_.active;
+	if (!wasActive && stats_.lossFraction >= FEC_ENABLE_LOSS) {
+		stats_.active = true;
+		stats_.activations++;
+	} else if (wasActive && stats_.lossFraction < FEC_DISABLE_LOSS) {
+		stats_.active = false;
+	}
+	stats_.ratio =
+	    stats_.active ? std::clamp(stats_.lossFraction * FEC_RATIO_PER_LOSS, FEC_MIN_RATIO, FEC_MAX_RATIO) : 0.0;
+	return stats_.active != wasActive;
+}
+
+double FecController::protectionRatio() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_.ratio;
+}
+
+void FecController::countFrame(size_t mediaPackets, size_t fecPackets)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	stats_.protectedFrames++;
+	stats_.mediaPackets += mediaPackets;
+	stats_.fecPackets += fecPackets;
+}
+
+FecStats FecController::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+} // namespace vdoninja
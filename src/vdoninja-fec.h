@@ -0,0 +1,99 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * FlexFEC (flexfec-03) forward error correction
+ *
+ * On lossy links a NACK costs a full round trip before the viewer can decode.
+ * FlexFEC sends XOR parity packets on a separate SSRC so the receiver can rebuild
+ * a lost packet immediately. Each parity packet covers an interleaved group of a
+ * frame's packets, so a burst of consecutive losses lands in different groups.
+ * How much parity to send follows the viewer's reported loss, and a viewer on a
+ * clean link gets none.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "vdoninja-rtp-packetizer.h"
+
+namespace vdoninja
+{
+
+// FlexFEC header with one protected SSRC and a mask of up to 46 packets
+constexpr size_t FLEXFEC_HEADER_SIZE_SHORT = 20; // Mask covers 15 packets
+constexpr size_t FLEXFEC_HEADER_SIZE_LONG = 24;  // Mask covers 46 packets
+// Frames are protected in blocks of at most this many packets, so every mask fits the long header
+constexpr size_t FLEXFEC_MAX_BLOCK_PACKETS = 46;
+
+// Number of parity packets for a block of media packets at the given protection ratio.
+// Keyframes always get at least one.
+size_t flexfecPacketCount(size_t mediaPackets, double ratio, bool keyframe);
+
+// Builds FlexFEC packets for frames of the protected stream. Stateless apart from
+// the stream identifiers, so one encoder serves every viewer.
+class FlexfecEncoder
+{
+public:
+	FlexfecEncoder(uint32_t ssrc, uint8_t payloadType, uint32_t protectedSsrc);
+
+	// Parity packets for `frame`, whose packets the viewer receives as firstSequence,
+	// firstSequence + 1, ... The FEC packets' own sequence fields are left zero and are
+	// stamped per viewer like media. Returns null when the ratio yields no packets.
+	std::shared_ptr<const RtpFrame> protect(const RtpFrame &frame, uint16_t firstSequence, double ratio) const;
+
+	uint32_t ssrc() const { return ssrc_; }
+	uint8_t payloadType() const { return payloadType_; }
+
+private:
+	uint32_t ssrc_;
+	uint8_t payloadType_;
+	uint32_t protectedSsrc_;
+};
+
+// Receiver-side XOR recovery, used to verify the encoder. Rebuilds missing packets
+// of `media` (keyed by sequence number) from FlexFEC packets, repeating until no
+// further packet can be recovered, and returns how many were rebuilt.
+size_t recoverFlexfecPackets(std::map<uint16_t, std::vector<uint8_t>> &media,
+                             const std::vector<std::vector<uint8_t>> &fecPackets, uint32_t mediaSsrc);
+
+struct FecStats {
+	bool active = false;
+	double lossFraction = 0.0; // Smoothed loss reported by the viewer
+	double ratio = 0.0;        // Parity packets per media packet while active
+	uint64_t activations = 0;
+	uint64_t protectedFrames = 0;
+	uint64_t mediaPackets = 0;
+	uint64_t fecPackets = 0;
+};
+
+// Per-viewer protection level from RTCP receiver reports. FEC switches on once the
+// smoothed loss reaches FEC_ENABLE_LOSS and off again below FEC_DISABLE_LOSS.
+class FecController
+{
+public:
+	// fractionLost is the RTCP fixed-point value (lost / 256); returns true when FEC switched on or off
+	bool onReceiverReport(uint8_t fractionLost);
+	// 0 while inactive
+	double protectionRatio() const;
+	void countFrame(size_t mediaPackets, size_t fecPackets);
+
+	FecStats stats() const;
+
+private:
+	mutable std::mutex mutex_;
+	FecStats stats_;
+	bool hasReport_ = false;
+};
+
+constexpr double FEC_ENABLE_LOSS = 0.02;
+constexpr double FEC_DISABLE_LOSS = 0.005;
+constexpr double FEC_RATIO_PER_LOSS = 3.0;
+constexpr double FEC_MIN_RATIO = 0.1;
+constexpr double FEC_MAX_RATIO = 0.5;
+
+} // namespace vdoninja
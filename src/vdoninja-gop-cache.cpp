@@ -0,0 +1,66 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Publisher-side GOP cache implementation
+ */
+
+#include "vdoninja-gop-cache.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "vdoninja-utils.h"
+
+namespace vdoninja
+{
+
+GopCache::GopCache(size_t maxBytes, size_t maxFrames)
+    : maxBytes_(maxBytes), maxFrames_(std::max<size_t>(maxFrames, 1))
+{
+}
+
+size_t GopCache::framesForInterval(double fps, double keyintSec)
+{
+	if (fps <= 0 || keyintSec <= 0) {
+		return DEFAULT_MAX_FRAMES;
+	}
+	return static_cast<size_t>(std::ceil(fps * (keyintSec + 0.5)));
+}
+
+size_t GopCache::laneCapacityFor(size_t maxFrames)
+{
+	// Keep a burst within three quarters of the lane so it never trips overflow handling
+	return std::max(MediaSendPool::DEFAULT_LANE_CAPACITY, maxFrames * 4 / 3);
+}
+
+void GopCache::push(std::shared_ptr<const OutboundFrame> frame)
+{
+	if (!frame || frame->kind != MediaKind::Video) {
+		return;
+	}
+
+	if (frame->keyframe) {
+		clear();
+	} else if (frames_.empty()) {
+		// No keyframe to anchor this frame; nothing useful to cache until the next one.
+		return;
+	}
+
+	const size_t size = frame->size();
+	if (frames_.size() >= maxFrames_ || bytes_ + size > maxBytes_) {
+		logDebug("GOP cache limit reached (%zu frames, %zu bytes); caching resumes at next keyframe",
+		         frames_.size(), bytes_);
+		clear();
+		return;
+	}
+
+	bytes_ += size;
+	frames_.push_back(std::move(frame));
+}
+
+void GopCache::clear()
+{
+	frames_.clear();
+	bytes_ = 0;
+}
+
+} // namespace vdoninja
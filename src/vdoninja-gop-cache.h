@@ -0,0 +1,62 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Publisher-side GOP cache
+ *
+ * Retains the encoded video frames since the last keyframe so a viewer that
+ * connects mid-GOP can be primed immediately instead of waiting for the next
+ * keyframe. Frames are the same ref-counted objects handed to the send queues.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "vdoninja-send-queue.h"
+
+namespace vdoninja
+{
+
+using FrameList = std::vector<std::shared_ptr<const OutboundFrame>>;
+
+// Not thread-safe; the owner serializes access together with enqueueing live frames.
+class GopCache
+{
+public:
+	static constexpr size_t DEFAULT_MAX_BYTES = 16 * 1024 * 1024;
+	// One GOP at 60 fps with a 2 s keyframe interval, as framesForInterval(60, 2) sizes it.
+	static constexpr size_t DEFAULT_MAX_FRAMES = 150;
+
+	explicit GopCache(size_t maxBytes = DEFAULT_MAX_BYTES, size_t maxFrames = DEFAULT_MAX_FRAMES);
+
+	// Frame cap that holds a whole GOP at this frame rate and keyframe interval, with half a
+	// second of slack for encoders that place keyframes late.
+	static size_t framesForInterval(double fps, double keyintSec);
+	// Send lane capacity that takes a full burst of maxFrames and still has room for live frames
+	static size_t laneCapacityFor(size_t maxFrames);
+
+	// A keyframe starts a new GOP. Delta frames are appended to the current GOP
+	// unless it exceeded the caps, in which case caching resumes at the next keyframe.
+	void push(std::shared_ptr<const OutboundFrame> frame);
+
+	// Frames from the last keyframe onward, or empty if no usable GOP is cached.
+	FrameList snapshot() const { return frames_; }
+
+	void clear();
+
+	size_t frameCount() const { return frames_.size(); }
+	size_t byteCount() const { return bytes_; }
+	bool hasKeyframe() const { return !frames_.empty(); }
+	// When the cached keyframe was enqueued (MediaSendPool::nowUs), or 0 if none
+	int64_t keyframeEnqueuedAtUs() const { return frames_.empty() ? 0 : frames_.front()->enqueuedAtUs; }
+
+private:
+	size_t maxBytes_;
+	size_t maxFrames_;
+	FrameList frames_;
+	size_t bytes_ = 0;
+};
+
+} // namespace vdoninja
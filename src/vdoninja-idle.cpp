@@ -0,0 +1,158 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Zero-viewer idle mode
+ */
+
+#include "vdoninja-idle.h"
+
+#include <algorithm>
+
+namespace vdoninja
+{
+
+IdleController::IdleController(bool enabled, int64_t graceMs, int64_t nowMs)
+{
+	reset(enabled, graceMs, nowMs);
+}
+
+void IdleController::reset(bool enabled, int64_t graceMs, int64_t nowMs)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	enabled_ = enabled;
+	graceMs_ = std::max<int64_t>(graceMs, 0);
+	idle_ = false;
+	enteredIdle_ = false;
+	leftIdleForViewer_ = false;
+	awaitingKeyframe_ = 0;
+	lastViewerCount_ = 0;
+	lastDemandMs_ = nowMs;
+	stats_ = IdleStats{};
+	if (enabled_) {
+		enterIdleLocked(nowMs);
+		// Starting idle is the initial state, not a transition worth reporting
+		enteredIdle_ = false;
+	}
+}
+
+bool IdleController::onViewerRequested(int64_t nowMs)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	lastDemandMs_ = nowMs;
+	if (!idle_) {
+		return false;
+	}
+	leaveIdleLocked(nowMs);
+	return true;
+}
+
+bool IdleController::admit(int viewerCount, bool video, size_t layer, bool keyframe, size_t bytes, int64_t nowMs)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (!enabled_) {
+		return true;
+	}
+
+	lastViewerCount_ = viewerCount;
+	if (viewerCount > 0) {
+		lastDemandMs_ = nowMs;
+		// A viewer can finish connecting after the grace period re-idled the output, or recover
+		// from a disconnect without a new offer request; either way it is watching now.
+		if (idle_) {
+			leaveIdleLocked(nowMs);
+			leftIdleForViewer_ = true;
+		}
+	} else if (!idle_ && nowMs - lastDemandMs_ >= graceMs_) {
+		enterIdleLocked(nowMs);
+	}
+
+	bool accepted = !idle_;
+	if (accepted && video) {
+		const uint32_t bit = 1u << std::min<size_t>(layer, 31);
+		if (awaitingKeyframe_ & bit) {
+			if (keyframe) {
+				awaitingKeyframe_ &= ~bit;
+			} else {
+				accepted = false;
+			}
+		}
+	}
+	if (!accepted) {
+		stats_.skippedPackets++;
+		stats_.skippedBytes += bytes;
+	}
+	return accepted;
+}
+
+bool IdleController::takeEnteredIdle()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	const bool entered = enteredIdle_;
+	enteredIdle_ = false;
+	return entered;
+}
+
+bool IdleController::takeLeftIdle()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	const bool left = leftIdleForViewer_;
+	leftIdleForViewer_ = false;
+	return left;
+}
+
+bool IdleController::enabled() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return enabled_;
+}
+
+IdleState IdleController::state(int64_t nowMs) const
+{
+	return stats(nowMs).state;
+}
+
+IdleStats IdleController::stats(int64_t nowMs) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	IdleStats stats = stats_;
+	if (idle_) {
+		stats.state = IdleState::Idle;
+		stats.idleMs += nowMs - idleSinceMs_;
+	} else if (enabled_ && lastViewerCount_ == 0) {
+		stats.state = IdleState::Grace;
+	} else {
+		stats.state = IdleState::Active;
+	}
+	return stats;
+}
+
+void IdleController::enterIdleLocked(int64_t nowMs)
+{
+	idle_ = true;
+	enteredIdle_ = true;
+	idleSinceMs_ = nowMs;
+	awaitingKeyframe_ = 0;
+	stats_.idlePeriods++;
+}
+
+void IdleController::leaveIdleLocked(int64_t nowMs)
+{
+	idle_ = false;
+	stats_.idleMs += nowMs - idleSinceMs_;
+	stats_.wakeups++;
+	awaitingKeyframe_ = ~0u;
+}
+
+const char *idleStateName(IdleState state)
+{
+	switch (state) {
+	case IdleState::Active:
+		return "active";
+	case IdleState::Grace:
+		return "grace";
+	case IdleState::Idle:
+		return "idle";
+	}
+	return "unknown";
+}
+
+} // namespace vdoninja
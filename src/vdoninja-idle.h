@@ -0,0 +1,85 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Zero-viewer idle mode
+ *
+ * Often nobody is watching for hours. While the output is idle, encoder packets
+ * are dropped on arrival instead of being indexed, cached and queued. The first
+ * viewer's offer request wakes the pipeline; video then resumes at each layer's
+ * next keyframe, so the GOP cache that primes the viewer starts decodable. Once
+ * the last viewer leaves (or a requesting viewer never connects), the output goes
+ * idle again after a grace period. A connected viewer always wakes it, even one
+ * that finished connecting only after the output had gone idle again.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace vdoninja
+{
+
+enum class IdleState {
+	Active, // Viewers connected; every packet is sent
+	Grace,  // No viewers, still sending until the grace period ends
+	Idle    // Packets are dropped on arrival
+};
+
+struct IdleStats {
+	IdleState state = IdleState::Active;
+	uint64_t idlePeriods = 0;
+	uint64_t wakeups = 0;
+	int64_t idleMs = 0; // Total time idle, including the current period
+	uint64_t skippedPackets = 0;
+	uint64_t skippedBytes = 0;
+};
+
+class IdleController
+{
+public:
+	static constexpr int64_t DEFAULT_GRACE_MS = 30000;
+
+	// A disabled controller never goes idle. An enabled one starts idle: nobody is watching yet.
+	explicit IdleController(bool enabled = false, int64_t graceMs = DEFAULT_GRACE_MS, int64_t nowMs = 0);
+
+	// Restart for a new session
+	void reset(bool enabled, int64_t graceMs, int64_t nowMs);
+
+	// A viewer asked for the stream. Returns true if this woke the pipeline.
+	bool onViewerRequested(int64_t nowMs);
+
+	// Per packet: advances the grace timer from the current viewer count and decides whether the
+	// packet enters the send pipeline. Any connected viewer leaves Idle. After a wakeup, video on
+	// each layer waits for a keyframe.
+	bool admit(int viewerCount, bool video, size_t layer, bool keyframe, size_t bytes, int64_t nowMs);
+
+	// True on the packet that moved the controller into Idle; cleared by the call.
+	bool takeEnteredIdle();
+	// True on the packet that left Idle because a viewer was connected; cleared by the call.
+	bool takeLeftIdle();
+
+	bool enabled() const;
+	IdleState state(int64_t nowMs) const;
+	IdleStats stats(int64_t nowMs) const;
+
+private:
+	void enterIdleLocked(int64_t nowMs);
+	void leaveIdleLocked(int64_t nowMs);
+
+	mutable std::mutex mutex_;
+	bool enabled_ = false;
+	bool idle_ = false;
+	bool enteredIdle_ = false;
+	bool leftIdleForViewer_ = false;
+	int64_t graceMs_ = DEFAULT_GRACE_MS;
+	int64_t lastDemandMs_ = 0; // Last offer request or packet seen with viewers connected
+	int64_t idleSinceMs_ = 0;
+	int lastViewerCount_ = 0;
+	uint32_t awaitingKeyframe_ = 0; // Bit per simulcast layer
+	IdleStats stats_;
+};
+
+const char *idleStateName(IdleState state);
+
+} // namespace vdoninja
@@ -0,0 +1,96 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Keyframe request arbiter implementation
+ */
+
+#include "vdoninja-keyframe-arbiter.h"
+
+#include <algorithm>
+
+namespace vdoninja
+{
+
+KeyframeArbiter::KeyframeArbiter(int64_t windowMs, int64_t cacheMaxAgeMs)
+    : windowMs_(std::max<int64_t>(windowMs, 0)), cacheMaxAgeMs_(std::max<int64_t>(cacheMaxAgeMs, 0))
+{
+}
+
+KeyframeDecision KeyframeArbiter::onRequest(const std::string &viewer, KeyframeRequestSource, int64_t nowMs,
+                                            int64_t cachedKeyframeAtMs, bool viewerHasCachedGop)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	stats_.requests++;
+
+	// Repeated requests from one viewer (PLI retries, PLI + data channel) within the window
+	auto served = lastServedAtMs_.find(viewer);
+	if (served != lastServedAtMs_.end() && nowMs - served->second < windowMs_) {
+		stats_.coalesced++;
+		return KeyframeDecision::Coalesced;
+	}
+
+	// A fresh cached keyframe the viewer never got costs only this viewer's bandwidth. Replays keep
+	// their RTP timestamps and picture ids, so a viewer that already had the GOP would discard them.
+	if (!viewerHasCachedGop && cachedKeyframeAtMs > 0 && nowMs - cachedKeyframeAtMs <= cacheMaxAgeMs_) {
+		lastServedAtMs_[viewer] = nowMs;
+		stats_.servedFromCache++;
+		return KeyframeDecision::ServeCached;
+	}
+
+	lastServedAtMs_[viewer] = nowMs;
+	if (keyframeAwaited_ && nowMs - keyframeAwaitedSinceMs_ < windowMs_) {
+		stats_.coalesced++;
+		return KeyframeDecision::Coalesced;
+	}
+
+	keyframeAwaited_ = true;
+	keyframeAwaitedSinceMs_ = nowMs;
+	stats_.deferredToKeyframe++;
+	return KeyframeDecision::AwaitScheduledKeyframe;
+}
+
+void KeyframeArbiter::onEncoderKeyframe(int64_t)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	keyframeAwaited_ = false;
+}
+
+void KeyframeArbiter::removeViewer(const std::string &viewer)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	lastServedAtMs_.erase(viewer);
+}
+
+void KeyframeArbiter::setWindowMs(int64_t windowMs)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	windowMs_ = std::max<int64_t>(windowMs, 0);
+}
+
+int64_t KeyframeArbiter::windowMs() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return windowMs_;
+}
+
+KeyframeArbiterStats KeyframeArbiter::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+const char *keyframeRequestSourceName(KeyframeRequestSource source)
+{
+	switch (source) {
+	case KeyframeRequestSource::Pli:
+		return "PLI";
+	case KeyframeRequestSource::Fir:
+		return "FIR";
+	case KeyframeRequestSource::DataChannel:
+		return "data channel";
+	case KeyframeRequestSource::Resume:
+		return "video resume";
+	}
+	return "unknown";
+}
+
+} // namespace vdoninja
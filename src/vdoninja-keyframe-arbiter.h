@@ -0,0 +1,73 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Keyframe request arbiter
+ *
+ * Loss bursts make many viewers ask for a keyframe at once (RTCP PLI/FIR or a
+ * data-channel requestKeyframe). Requests are coalesced: a viewer that never
+ * received the cached GOP (joiner, resumed video) is served it while its
+ * keyframe is still fresh. Otherwise OBS offers no way to force an IDR, so
+ * the request is deferred to the encoder's next scheduled keyframe, counted
+ * once per window for all viewers.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace vdoninja
+{
+
+enum class KeyframeRequestSource { Pli, Fir, DataChannel, Resume };
+
+enum class KeyframeDecision {
+	Coalesced,             // Already being served by a recent or pending keyframe
+	ServeCached,           // Replay the cached GOP to the requesting viewer
+	AwaitScheduledKeyframe // Wait for the encoder's next scheduled keyframe
+};
+
+struct KeyframeArbiterStats {
+	uint64_t requests = 0;
+	uint64_t coalesced = 0;
+	uint64_t servedFromCache = 0;
+	uint64_t deferredToKeyframe = 0; // Left to the encoder's next scheduled keyframe
+};
+
+class KeyframeArbiter
+{
+public:
+	static constexpr int64_t DEFAULT_WINDOW_MS = 500;
+	// A cached keyframe older than this is not replayed; its GOP is too long to burst
+	static constexpr int64_t DEFAULT_CACHE_MAX_AGE_MS = 1000;
+
+	explicit KeyframeArbiter(int64_t windowMs = DEFAULT_WINDOW_MS, int64_t cacheMaxAgeMs = DEFAULT_CACHE_MAX_AGE_MS);
+
+	// cachedKeyframeAtMs is when the viewer's cached keyframe was produced, or 0 if none.
+	// viewerHasCachedGop is set when the viewer already received that keyframe: replaying
+	// frames it has decoded (or dropped as late) cannot help, so it waits for the next keyframe.
+	KeyframeDecision onRequest(const std::string &viewer, KeyframeRequestSource source, int64_t nowMs,
+	                           int64_t cachedKeyframeAtMs, bool viewerHasCachedGop = false);
+
+	// The encoder produced a keyframe; it satisfies any deferred request
+	void onEncoderKeyframe(int64_t nowMs);
+	void removeViewer(const std::string &viewer);
+
+	void setWindowMs(int64_t windowMs);
+	int64_t windowMs() const;
+	KeyframeArbiterStats stats() const;
+
+private:
+	mutable std::mutex mutex_;
+	int64_t windowMs_;
+	int64_t cacheMaxAgeMs_;
+	int64_t keyframeAwaitedSinceMs_ = 0;
+	bool keyframeAwaited_ = false;
+	std::map<std::string, int64_t> lastServedAtMs_;
+	KeyframeArbiterStats stats_;
+};
+
+const char *keyframeRequestSourceName(KeyframeRequestSource source);
+
+} // namespace vdoninja
@@ -0,0 +1,79 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Shared A/V media clock
+ */
+
+#include "vdoninja-media-clock.h"
+
+namespace vdoninja
+{
+
+int64_t rescaleToClock(int64_t ticks, int64_t num, int64_t den, uint32_t clockRate)
+{
+	if (num <= 0 || den <= 0) {
+		return 0;
+	}
+
+	// Split ticks into whole timebase periods and a remainder so only the
+	// remainder is multiplied by the full num * clockRate factor.
+	const int64_t scale = num * static_cast<int64_t>(clockRate);
+	int64_t whole = ticks / den;
+	int64_t rest = ticks % den;
+	if (rest < 0) {
+		rest += den;
+		--whole;
+	}
+	return whole * scale + (rest * scale + den / 2) / den;
+}
+
+void MediaClock::reset(uint32_t audioOffset, uint32_t videoOffset)
+{
+	audioOffset_.store(audioOffset, std::memory_order_relaxed);
+	videoOffset_.store(videoOffset, std::memory_order_relaxed);
+	anchorUs_.store(kUnanchored, std::memory_order_release);
+}
+
+uint32_t MediaClock::audioTimestamp(const EncodedPacketInfo &info, int64_t nowUs)
+{
+	return timestampFor(info, AUDIO_RTP_CLOCK_RATE, audioOffset(), nowUs);
+}
+
+uint32_t MediaClock::videoTimestamp(const EncodedPacketInfo &info, int64_t nowUs)
+{
+	return timestampFor(info, VIDEO_RTP_CLOCK_RATE, videoOffset(), nowUs);
+}
+
+uint32_t MediaClock::audioTimestampAt(int64_t nowUs) const
+{
+	return timestampAt(nowUs, AUDIO_RTP_CLOCK_RATE, audioOffset());
+}
+
+uint32_t MediaClock::videoTimestampAt(int64_t nowUs) const
+{
+	return timestampAt(nowUs, VIDEO_RTP_CLOCK_RATE, videoOffset());
+}
+
+uint32_t MediaClock::timestampFor(const EncodedPacketInfo &info, uint32_t clockRate, uint32_t offset, int64_t nowUs)
+{
+	if (!anchored()) {
+		// OBS stamps audio and video from the same start, so one anchor serves both
+		const int64_t mediaUs = rescaleToClock(info.pts, info.timebaseNum, info.timebaseDen, 1000000);
+		int64_t expected = kUnanchored;
+		anchorUs_.compare_exchange_strong(expected, nowUs - mediaUs, std::memory_order_acq_rel);
+	}
+	const int64_t ticks = rescaleToClock(info.pts, info.timebaseNum, info.timebaseDen, clockRate);
+	// RTP timestamps wrap modulo 2^32
+	return offset + static_cast<uint32_t>(static_cast<uint64_t>(ticks));
+}
+
+uint32_t MediaClock::timestampAt(int64_t nowUs, uint32_t clockRate, uint32_t offset) const
+{
+	const int64_t anchor = anchorUs();
+	if (anchor == kUnanchored) {
+		return offset;
+	}
+	const int64_t ticks = rescaleToClock(nowUs - anchor, 1, 1000000, clockRate);
+	return offset + static_cast<uint32_t>(static_cast<uint64_t>(ticks));
+}
+
+} // namespace vdoninja
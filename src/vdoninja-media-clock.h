@@ -0,0 +1,62 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Shared A/V media clock
+ *
+ * Converts encoder timestamps (any OBS timebase) to RTP clock ticks exactly and
+ * keeps audio and video on one timeline. The first packet of either stream
+ * anchors media time zero to the wall clock; both streams share that anchor, so
+ * sender reports built from it let receivers line audio and video up without
+ * padding their jitter buffers for drift.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+#include "vdoninja-encoded-packet.h"
+
+namespace vdoninja
+{
+
+constexpr uint32_t AUDIO_RTP_CLOCK_RATE = 48000;
+constexpr uint32_t VIDEO_RTP_CLOCK_RATE = 90000;
+
+// ticks * num / den seconds expressed in clockRate units, rounded to the nearest
+// tick. Exact for any timebase; intermediate products stay within 64 bits.
+int64_t rescaleToClock(int64_t ticks, int64_t num, int64_t den, uint32_t clockRate);
+
+class MediaClock
+{
+public:
+	// Start a new timeline; each stream's RTP timestamps begin at its offset.
+	void reset(uint32_t audioOffset, uint32_t videoOffset);
+
+	// RTP timestamp of a packet's presentation time; anchors the timeline on first use.
+	uint32_t audioTimestamp(const EncodedPacketInfo &info, int64_t nowUs);
+	uint32_t videoTimestamp(const EncodedPacketInfo &info, int64_t nowUs);
+
+	// RTP timestamp that corresponds to the wall-clock instant nowUs, for sender reports.
+	// Before the first packet this is the stream's offset.
+	uint32_t audioTimestampAt(int64_t nowUs) const;
+	uint32_t videoTimestampAt(int64_t nowUs) const;
+
+	uint32_t audioOffset() const { return audioOffset_.load(std::memory_order_relaxed); }
+	uint32_t videoOffset() const { return videoOffset_.load(std::memory_order_relaxed); }
+	bool anchored() const { return anchorUs_.load(std::memory_order_acquire) != kUnanchored; }
+	// Wall-clock time (microseconds) of media time zero
+	int64_t anchorUs() const { return anchorUs_.load(std::memory_order_acquire); }
+
+private:
+	static constexpr int64_t kUnanchored = std::numeric_limits<int64_t>::min();
+
+	uint32_t timestampFor(const EncodedPacketInfo &info, uint32_t clockRate, uint32_t offset, int64_t nowUs);
+	uint32_t timestampAt(int64_t nowUs, uint32_t clockRate, uint32_t offset) const;
+
+	std::atomic<int64_t> anchorUs_{kUnanchored};
+	std::atomic<uint32_t> audioOffset_{0};
+	std::atomic<uint32_t> videoOffset_{0};
+};
+
+} // namespace vdoninja
@@ -0,0 +1,103 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Per-viewer media send gate
+ */
+
+#include "vdoninja-media-gate.h"
+
+namespace vdoninja
+{
+
+ViewerMediaGate::ViewerMediaGate(bool tallyGating) : tallyGating_(tallyGating) {}
+
+MediaGateChange ViewerMediaGate::setAudioHold(MediaGateReason reason, bool held)
+{
+	return setHold(audioHolds_, reason, held, false);
+}
+
+MediaGateChange ViewerMediaGate::setVideoHold(MediaGateReason reason, bool held)
+{
+	return setHold(videoHolds_, reason, held, true);
+}
+
+MediaGateChange ViewerMediaGate::setTally(bool program, bool preview)
+{
+	if (!tallyGating_) {
+		return MediaGateChange::None;
+	}
+	return setVideoHold(MediaGateReason::TallyOff, !program && !preview);
+}
+
+MediaGateChange ViewerMediaGate::setHold(std::atomic<uint32_t> &holds, MediaGateReason reason, bool held, bool video)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	const uint32_t bit = static_cast<uint32_t>(reason);
+	const uint32_t before = holds.load(std::memory_order_relaxed);
+	const uint32_t after = held ? (before | bit) : (before & ~bit);
+	if (before == after) {
+		return MediaGateChange::None;
+	}
+	if (video && before != 0 && after == 0) {
+		// Set before the holds clear, so the send path never admits a delta frame in between
+		awaitingKeyframe_.store(true, std::memory_order_release);
+		videoResumes_.fetch_add(1, std::memory_order_relaxed);
+	}
+	holds.store(after, std::memory_order_release);
+	if (before == 0) {
+		return MediaGateChange::Suspended;
+	}
+	return after == 0 ? MediaGateChange::Resumed : MediaGateChange::None;
+}
+
+bool ViewerMediaGate::admitAudio()
+{
+	if (audioHolds_.load(std::memory_order_acquire) != 0) {
+		skippedAudioFrames_.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
+
+bool ViewerMediaGate::admitVideo(bool keyframe)
+{
+	if (videoHolds_.load(std::memory_order_acquire) != 0) {
+		skippedVideoFrames_.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	if (awaitingKeyframe_.load(std::memory_order_acquire)) {
+		if (!keyframe) {
+			skippedVideoFrames_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		awaitingKeyframe_.store(false, std::memory_order_release);
+	}
+	return true;
+}
+
+MediaGateStats ViewerMediaGate::stats() const
+{
+	MediaGateStats stats;
+	stats.audioSuspended = audioHolds_.load(std::memory_order_acquire) != 0;
+	stats.videoSuspended = videoHolds_.load(std::memory_order_acquire) != 0;
+	stats.skippedAudioFrames = skippedAudioFrames_.load(std::memory_order_relaxed);
+	stats.skippedVideoFrames = skippedVideoFrames_.load(std::memory_order_relaxed);
+	stats.videoResumes = videoResumes_.load(std::memory_order_relaxed);
+	return stats;
+}
+
+const char *mediaGateReasonName(MediaGateReason reason)
+{
+	switch (reason) {
+	case MediaGateReason::Paused:
+		return "pause request";
+	case MediaGateReason::Muted:
+		return "muted by viewer";
+	case MediaGateReason::Hidden:
+		return "hidden in viewer scene";
+	case MediaGateReason::TallyOff:
+		return "tally off";
+	}
+	return "unknown";
+}
+
+} // namespace vdoninja
@@ -0,0 +1,72 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Per-viewer media send gate
+ *
+ * Viewers often do not need our media: a scene that hides our feed, a guest who
+ * muted us, or an explicit pause request. Each reason holds audio and/or video
+ * for that viewer; while any hold is set, no RTP for that kind is sent to them.
+ * When the last video hold clears, video resumes at the next keyframe so the
+ * viewer's decoder restarts cleanly.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace vdoninja
+{
+
+// Why a viewer's media is held; each reason is tracked separately
+enum class MediaGateReason : uint32_t {
+	Paused = 1u << 0,  // Explicit pauseAudio/pauseVideo request
+	Muted = 1u << 1,   // The viewer muted our feed
+	Hidden = 1u << 2,  // Our feed is not visible in the viewer's scene
+	TallyOff = 1u << 3 // Neither on program nor preview (only with tally gating)
+};
+
+enum class MediaGateChange { None, Suspended, Resumed };
+
+struct MediaGateStats {
+	bool audioSuspended = false;
+	bool videoSuspended = false;
+	uint64_t skippedAudioFrames = 0;
+	uint64_t skippedVideoFrames = 0;
+	uint64_t videoResumes = 0;
+};
+
+class ViewerMediaGate
+{
+public:
+	explicit ViewerMediaGate(bool tallyGating = false);
+
+	// Set or clear one reason; returns whether the kind was suspended or resumed by it
+	MediaGateChange setAudioHold(MediaGateReason reason, bool held);
+	MediaGateChange setVideoHold(MediaGateReason reason, bool held);
+	// Tally only holds video, and only when tally gating is enabled
+	MediaGateChange setTally(bool program, bool preview);
+
+	// Per frame, from the viewer's send worker
+	bool admitAudio();
+	bool admitVideo(bool keyframe);
+
+	bool tallyGating() const { return tallyGating_; }
+	MediaGateStats stats() const;
+
+private:
+	MediaGateChange setHold(std::atomic<uint32_t> &holds, MediaGateReason reason, bool held, bool video);
+
+	const bool tallyGating_;
+	std::mutex mutex_; // Serializes hold changes; the send path only reads atomics
+	std::atomic<uint32_t> audioHolds_{0};
+	std::atomic<uint32_t> videoHolds_{0};
+	std::atomic<bool> awaitingKeyframe_{false};
+	std::atomic<uint64_t> skippedAudioFrames_{0};
+	std::atomic<uint64_t> skippedVideoFrames_{0};
+	std::atomic<uint64_t> videoResumes_{0};
+};
+
+const char *mediaGateReasonName(MediaGateReason reason);
+
+} // namespace vdoninja
@@ -0,0 +1,181 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Per-viewer RTP MTU selection implementation
+ */
+
+#include "vdoninja-mtu.h"
+
+#include <cstdlib>
+
+namespace vdoninja
+{
+
+size_t rtpPayloadForTier(RtpMtuTier tier)
+{
+	switch (tier) {
+	case RtpMtuTier::Relay:
+		return RTP_PAYLOAD_RELAY;
+	case RtpMtuTier::Lan:
+		return RTP_PAYLOAD_LAN;
+	case RtpMtuTier::Default:
+	default:
+		return RTP_PAYLOAD_DEFAULT;
+	}
+}
+
+RtpMtuTier rtpMtuTierForPayload(size_t payloadBytes)
+{
+	if (payloadBytes == 0) {
+		return RtpMtuTier::Default;
+	}
+	if (payloadBytes >= RTP_PAYLOAD_LAN) {
+		return RtpMtuTier::Lan;
+	}
+	if (payloadBytes >= RTP_PAYLOAD_DEFAULT) {
+		return RtpMtuTier::Default;
+	}
+	return RtpMtuTier::Relay;
+}
+
+const char *rtpMtuTierName(RtpMtuTier tier)
+{
+	switch (tier) {
+	case RtpMtuTier::Relay:
+		return "relay";
+	case RtpMtuTier::Lan:
+		return "lan";
+	case RtpMtuTier::Default:
+	default:
+		return "default";
+	}
+}
+
+bool isPrivateAddress(const std::string &address)
+{
+	if (address.find(':') != std::string::npos) {
+		// IPv6: unique local fc00::/7, link-local fe80::/10, loopback
+		const std::string lower = address.substr(0, 4);
+		if (address == "::1") {
+			return true;
+		}
+		if (lower.size() >= 2 && (lower[0] == 'f' || lower[0] == 'F')) {
+			const char second = static_cast<char>(lower[1] | 0x20);
+			if (second == 'c' || second == 'd') {
+				return true;
+			}
+			if (second == 'e' && lower.size() >= 3) {
+				const char third = static_cast<char>(lower[2] | 0x20);
+				return third == '8' || third == '9' || third == 'a' || third == 'b';
+			}
+		}
+		return false;
+	}
+
+	unsigned octets[4] = {0, 0, 0, 0};
+	const char *cursor = address.c_str();
+	for (int i = 0; i < 4; ++i) {
+		char *end = nullptr;
+		const unsigned long value = std::strtoul(cursor, &end, 10);
+		if (end == cursor || value > 255 || (i < 3 && *end != '.')) {
+			return false;
+		}
+		octets[i] = static_cast<unsigned>(value);
+		cursor = end + 1;
+	}
+	return octets[0] == 10 || octets[0] == 127 || (octets[0] == 172 && (octets[1] & 0xF0) == 16) ||
+	       (octets[0] == 192 && octets[1] == 168) || (octets[0] == 169 && octets[1] == 254) ||
+	       (octets[0] == 100 && (octets[1] & 0xC0) == 64); // CGNAT, common on overlay VPNs
+}
+
+RtpMtuTier rtpMtuTierForPath(const IceCandidateInfo &local, const IceCandidateInfo &remote)
+{
+	if (local.kind == IceCandidateKind::Relayed || remote.kind == IceCandidateKind::Relayed || local.tcp ||
+	    remote.tcp) {
+		return RtpMtuTier::Relay;
+	}
+
+	auto onLan = [](const IceCandidateInfo &candidate) {
+		return (candidate.kind == IceCandidateKind::Host || candidate.kind == IceCandidateKind::PeerReflexive) &&
+		       candidate.address && isPrivateAddress(*candidate.address);
+	};
+	if (onLan(local) && onLan(remote)) {
+		return RtpMtuTier::Lan;
+	}
+	return RtpMtuTier::Default;
+}
+
+MtuController::MtuController(RtpMtuTier tier, bool probing)
+    : tier_(tier), pathTier_(tier), confirmedTier_(tier), probingEnabled_(probing)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	startProbeLocked();
+}
+
+void MtuController::setPathTier(RtpMtuTier tier)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	pathTier_ = tier;
+	confirmedTier_ = tier;
+	probing_ = false;
+	tier_.store(tier, std::memory_order_release);
+	startProbeLocked();
+}
+
+void MtuController::startProbeLocked()
+{
+	if (!probingEnabled_ || confirmedTier_ == RtpMtuTier::Lan) {
+		probing_ = false;
+		return;
+	}
+	probing_ = true;
+	probeSent_ = 0;
+	probeNacked_ = 0;
+	probes_++;
+	tier_.store(static_cast<RtpMtuTier>(static_cast<uint8_t>(confirmedTier_) + 1), std::memory_order_release);
+}
+
+void MtuController::onPacketsSent(size_t packets)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (!probing_) {
+		return;
+	}
+	probeSent_ += packets;
+	if (probeSent_ < PROBE_PACKETS) {
+		return;
+	}
+
+	// Probe survived: keep the larger size and try the next one up
+	confirmedTier_ = tier_.load(std::memory_order_relaxed);
+	startProbeLocked();
+}
+
+void MtuController::onPacketsNacked(size_t packets)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (!probing_) {
+		return;
+	}
+	probeNacked_ += packets;
+	const uint64_t sent = probeSent_ > 0 ? probeSent_ : 1;
+	if (probeNacked_ >= 5 && static_cast<double>(probeNacked_) / static_cast<double>(sent) > PROBE_MAX_LOSS) {
+		// The larger packets do not fit the path; settle on the last size that did
+		probing_ = false;
+		probeFailures_++;
+		tier_.store(confirmedTier_, std::memory_order_release);
+	}
+}
+
+MtuStats MtuController::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	MtuStats stats;
+	stats.tier = tier_.load(std::memory_order_relaxed);
+	stats.pathTier = pathTier_;
+	stats.probing = probing_;
+	stats.probes = probes_;
+	stats.probeFailures = probeFailures_;
+	return stats;
+}
+
+} // namespace vdoninja
@@ -0,0 +1,96 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Per-viewer RTP MTU selection
+ *
+ * Each viewer is sent RTP packets sized for its network path: larger on a LAN,
+ * smaller through TURN relays and TCP. The path class comes from the selected
+ * ICE candidate pair and can optionally be raised by a loss-checked probe. Frames
+ * are packetized once per size tier, so viewers on the same tier share packets.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace vdoninja
+{
+
+enum class RtpMtuTier : uint8_t { Relay = 0, Default = 1, Lan = 2 };
+
+constexpr size_t RTP_MTU_TIER_COUNT = 3;
+
+// RTP payload bytes per tier. Lan keeps a 1500-byte Ethernet frame clear of IPv6,
+// UDP, RTP and SRTP overhead; Relay leaves room for TURN/TCP/VPN encapsulation.
+constexpr size_t RTP_PAYLOAD_RELAY = 1100;
+constexpr size_t RTP_PAYLOAD_DEFAULT = 1200;
+constexpr size_t RTP_PAYLOAD_LAN = 1400;
+
+size_t rtpPayloadForTier(RtpMtuTier tier);
+// Nearest tier not larger than `payloadBytes`; 0 means automatic and maps to Default
+RtpMtuTier rtpMtuTierForPayload(size_t payloadBytes);
+const char *rtpMtuTierName(RtpMtuTier tier);
+
+enum class IceCandidateKind { Unknown, Host, ServerReflexive, PeerReflexive, Relayed };
+
+// One side of the selected ICE candidate pair
+struct IceCandidateInfo {
+	IceCandidateKind kind = IceCandidateKind::Unknown;
+	bool tcp = false;
+	std::optional<std::string> address;
+};
+
+// Relay or TCP on either side gives Relay; two host/peer-reflexive candidates with
+// private or link-local addresses give Lan; anything else gives Default.
+RtpMtuTier rtpMtuTierForPath(const IceCandidateInfo &local, const IceCandidateInfo &remote);
+bool isPrivateAddress(const std::string &address);
+
+struct MtuStats {
+	RtpMtuTier tier = RtpMtuTier::Default;
+	RtpMtuTier pathTier = RtpMtuTier::Default;
+	bool probing = false;
+	uint64_t probes = 0;
+	uint64_t probeFailures = 0;
+};
+
+// Per-viewer tier. With probing enabled the next larger tier is tried for
+// PROBE_PACKETS packets and kept only if NACKed packets stay below the loss threshold.
+// Thread-safe: the send worker reports packets, the RTCP thread reports NACKs.
+class MtuController
+{
+public:
+	static constexpr uint64_t PROBE_PACKETS = 500;
+	static constexpr double PROBE_MAX_LOSS = 0.05;
+
+	explicit MtuController(RtpMtuTier tier = RtpMtuTier::Default, bool probing = false);
+
+	RtpMtuTier tier() const { return tier_.load(std::memory_order_acquire); }
+
+	// Sets the tier from the selected candidate pair and restarts probing above it.
+	void setPathTier(RtpMtuTier tier);
+
+	void onPacketsSent(size_t packets);
+	void onPacketsNacked(size_t packets);
+
+	MtuStats stats() const;
+
+private:
+	void startProbeLocked();
+
+	mutable std::mutex mutex_;
+	std::atomic<RtpMtuTier> tier_;
+	RtpMtuTier pathTier_;
+	RtpMtuTier confirmedTier_;
+	bool probingEnabled_;
+	bool probing_ = false;
+	uint64_t probeSent_ = 0;
+	uint64_t probeNacked_ = 0;
+	uint64_t probes_ = 0;
+	uint64_t probeFailures_ = 0;
+};
+
+} // namespace vdoninja
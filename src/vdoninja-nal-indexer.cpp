@@ -0,0 +1,248 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Single-pass H.264/H.265 NAL unit indexer implementation
+ */
+
+#include "vdoninja-nal-indexer.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define VDONINJA_NAL_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define VDONINJA_NAL_AVX2 1
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define VDONINJA_NAL_AVX2 1
+#define VDONINJA_NAL_AVX2_ALWAYS 1
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define VDONINJA_NAL_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace vdoninja
+{
+
+namespace
+{
+
+inline unsigned countTrailingZeros(uint64_t value)
+{
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanForward64(&index, value);
+	return static_cast<unsigned>(index);
+#else
+	return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+}
+
+#if VDONINJA_NAL_SSE2
+size_t findStartCodeSse2(const uint8_t *data, size_t size, size_t from)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi8(1);
+	size_t i = from;
+	// Compare 16 candidate positions at once: byte i, i+1 == 0 and i+2 == 1
+	while (i + 18 <= size) {
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 1));
+		const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 2));
+		const __m128i match =
+		    _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(a, zero), _mm_cmpeq_epi8(b, zero)), _mm_cmpeq_epi8(c, one));
+		const int bits = _mm_movemask_epi8(match);
+		if (bits != 0) {
+			return i + countTrailingZeros(static_cast<uint32_t>(bits));
+		}
+		i += 16;
+	}
+	return findStartCodeScalar(data, size, i);
+}
+#endif
+
+#if VDONINJA_NAL_AVX2
+#if !defined(VDONINJA_NAL_AVX2_ALWAYS)
+__attribute__((target("avx2")))
+#endif
+size_t findStartCodeAvx2(const uint8_t *data, size_t size, size_t from)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi8(1);
+	size_t i = from;
+	while (i + 34 <= size) {
+		const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+		const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 1));
+		const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 2));
+		const __m256i match = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(a, zero), _mm256_cmpeq_epi8(b, zero)),
+		                                       _mm256_cmpeq_epi8(c, one));
+		const uint32_t bits = static_cast<uint32_t>(_mm256_movemask_epi8(match));
+		if (bits != 0) {
+			return i + countTrailingZeros(bits);
+		}
+		i += 32;
+	}
+	return findStartCodeSse2(data, size, i);
+}
+
+bool cpuHasAvx2()
+{
+#if defined(VDONINJA_NAL_AVX2_ALWAYS)
+	return true;
+#else
+	static const bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+#endif
+}
+#endif
+
+#if VDONINJA_NAL_NEON
+size_t findStartCodeNeon(const uint8_t *data, size_t size, size_t from)
+{
+	const uint8x16_t zero = vdupq_n_u8(0);
+	const uint8x16_t one = vdupq_n_u8(1);
+	size_t i = from;
+	while (i + 18 <= size) {
+		const uint8x16_t a = vld1q_u8(data + i);
+		const uint8x16_t b = vld1q_u8(data + i + 1);
+		const uint8x16_t c = vld1q_u8(data + i + 2);
+		const uint8x16_t match = vandq_u8(vandq_u8(vceqq_u8(a, zero), vceqq_u8(b, zero)), vceqq_u8(c, one));
+		// Narrow each byte lane to a nibble to get a 64-bit mask
+		const uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(match), 4)), 0);
+		if (bits != 0) {
+			return i + (countTrailingZeros(bits) >> 2);
+		}
+		i += 16;
+	}
+	return findStartCodeScalar(data, size, i);
+}
+#endif
+
+using FindStartCode = size_t (*)(const uint8_t *, size_t, size_t);
+
+FindStartCode selectFindStartCode()
+{
+#if VDONINJA_NAL_AVX2
+	if (cpuHasAvx2()) {
+		return findStartCodeAvx2;
+	}
+#endif
+#if VDONINJA_NAL_SSE2
+	return findStartCodeSse2;
+#elif VDONINJA_NAL_NEON
+	return findStartCodeNeon;
+#else
+	return findStartCodeScalar;
+#endif
+}
+
+const FindStartCode kFindStartCode = selectFindStartCode();
+
+void buildIndex(const uint8_t *data, size_t size, NalIndex &out, FindStartCode find, NalFormat format)
+{
+	out.clear();
+	if (!data) {
+		return;
+	}
+
+	size_t start = find(data, size, 0);
+	while (start < size) {
+		const size_t payloadStart = start + 3;
+		const size_t next = find(data, size, payloadStart);
+		size_t end = next;
+		// Trailing zero belongs to a 4-byte start code of the next NAL unit.
+		while (end > payloadStart && data[end - 1] == 0 && next < size) {
+			--end;
+		}
+		if (end > payloadStart) {
+			NalSpan span;
+			span.type = nalUnitType(data + payloadStart, format);
+			span.offset = static_cast<uint32_t>(payloadStart);
+			span.length = static_cast<uint32_t>(end - payloadStart);
+			out.push_back(span);
+		}
+		start = next;
+	}
+}
+
+} // namespace
+
+size_t findStartCodeScalar(const uint8_t *data, size_t size, size_t from)
+{
+	for (size_t i = from; i + 2 < size; ++i) {
+		if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+			return i;
+		}
+	}
+	return size;
+}
+
+size_t findStartCode(const uint8_t *data, size_t size, size_t from)
+{
+	return kFindStartCode(data, size, from);
+}
+
+void indexNalUnits(const uint8_t *data, size_t size, NalIndex &out)
+{
+	buildIndex(data, size, out, kFindStartCode, NalFormat::H264);
+}
+
+void indexNalUnits(const uint8_t *data, size_t size, NalIndex &out, NalFormat format)
+{
+	buildIndex(data, size, out, kFindStartCode, format);
+}
+
+void indexNalUnitsScalar(const uint8_t *data, size_t size, NalIndex &out)
+{
+	buildIndex(data, size, out, findStartCodeScalar, NalFormat::H264);
+}
+
+uint8_t nalUnitType(const uint8_t *nal, NalFormat format)
+{
+	return format == NalFormat::H265 ? static_cast<uint8_t>((nal[0] >> 1) & 0x3F) : static_cast<uint8_t>(nal[0] & 0x1F);
+}
+
+bool nalIndexHasType(const NalIndex &nals, uint8_t type)
+{
+	for (const auto &nal : nals) {
+		if (nal.type == type) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool nalIndexHasKeyframe(const NalIndex &nals, NalFormat format)
+{
+	if (format == NalFormat::H264) {
+		return nalIndexHasType(nals, H264_NAL_IDR);
+	}
+	for (const auto &nal : nals) {
+		if (nal.type >= H265_NAL_IRAP_FIRST && nal.type <= H265_NAL_IRAP_LAST) {
+			return true;
+		}
+	}
+	return false;
+}
+
+const char *nalIndexerBackend()
+{
+#if VDONINJA_NAL_AVX2
+	if (cpuHasAvx2()) {
+		return "avx2";
+	}
+#endif
+#if VDONINJA_NAL_SSE2
+	return "sse2";
+#elif VDONINJA_NAL_NEON
+	return "neon";
+#else
+	return "scalar";
+#endif
+}
+
+} // namespace vdoninja
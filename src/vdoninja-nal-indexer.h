@@ -0,0 +1,62 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Single-pass H.264/H.265 NAL unit indexer
+ *
+ * Each Annex-B access unit is scanned for start codes once, when the encoder
+ * packet arrives. The resulting spans are carried with the frame and reused by
+ * keyframe detection and RTP packetization instead of rescanning the payload.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vdoninja
+{
+
+constexpr uint8_t H264_NAL_IDR = 5;
+constexpr uint8_t H264_NAL_SPS = 7;
+constexpr uint8_t H264_NAL_PPS = 8;
+
+// H.265 IRAP pictures (BLA, IDR, CRA) use types 16-21
+constexpr uint8_t H265_NAL_IRAP_FIRST = 16;
+constexpr uint8_t H265_NAL_IRAP_LAST = 21;
+constexpr uint8_t H265_NAL_VPS = 32;
+constexpr uint8_t H265_NAL_SPS = 33;
+constexpr uint8_t H265_NAL_PPS = 34;
+constexpr size_t H265_NAL_HEADER_SIZE = 2;
+
+// Which NAL header layout the nal_unit_type is read from
+enum class NalFormat { H264, H265 };
+
+// One NAL unit inside an Annex-B buffer; offset points at the NAL header byte and
+// length excludes start codes and the zero byte of a following 4-byte start code.
+struct NalSpan {
+	uint8_t type = 0; // nal_unit_type
+	uint32_t offset = 0;
+	uint32_t length = 0;
+};
+
+using NalIndex = std::vector<NalSpan>;
+
+// Index every non-empty NAL unit, using the fastest start-code search available.
+void indexNalUnits(const uint8_t *data, size_t size, NalIndex &out);
+void indexNalUnits(const uint8_t *data, size_t size, NalIndex &out, NalFormat format);
+// Byte-at-a-time reference implementation, kept for tests and benchmarks.
+void indexNalUnitsScalar(const uint8_t *data, size_t size, NalIndex &out);
+
+// Offset of the next 00 00 01 start code at or after `from`, or `size`.
+size_t findStartCode(const uint8_t *data, size_t size, size_t from);
+size_t findStartCodeScalar(const uint8_t *data, size_t size, size_t from);
+
+uint8_t nalUnitType(const uint8_t *nal, NalFormat format);
+bool nalIndexHasType(const NalIndex &nals, uint8_t type);
+// True if the access unit starts a decodable picture: an H.264 IDR or an H.265 IRAP
+bool nalIndexHasKeyframe(const NalIndex &nals, NalFormat format);
+
+// Name of the start-code search selected for this CPU ("avx2", "sse2", "neon" or "scalar")
+const char *nalIndexerBackend();
+
+} // namespace vdoninja
@@ -0,0 +1,139 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Opus RED (RFC 2198) audio redundancy implementation
+ */
+
+#include "vdoninja-opus-red.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vdoninja
+{
+
+namespace
+{
+
+constexpr double kLossSmoothing = 0.3;
+// Opus DTX frames are a TOC byte or two; repeating them protects nothing
+constexpr size_t kMinRedundantSize = 3;
+
+} // namespace
+
+OpusRedEncoder::OpusRedEncoder(uint32_t ssrc, uint8_t redPayloadType, uint8_t opusPayloadType)
+    : ssrc_(ssrc), redPayloadType_(redPayloadType), opusPayloadType_(opusPayloadType)
+{
+}
+
+OpusRedPackets OpusRedEncoder::encode(const uint8_t *payload, size_t size, uint32_t timestamp)
+{
+	OpusRedPackets packets;
+	if (!payload || size == 0) {
+		return packets;
+	}
+	for (size_t distance = 1; distance <= OPUS_RED_MAX_DISTANCE; ++distance) {
+		packets[distance - 1] = build(payload, size, timestamp, distance);
+	}
+
+	history_.push_back({std::vector<uint8_t>(payload, payload + size), timestamp});
+	while (history_.size() > OPUS_RED_MAX_DISTANCE) {
+		history_.pop_front();
+	}
+	return packets;
+}
+
+void OpusRedEncoder::reset()
+{
+	history_.clear();
+}
+
+std::shared_ptr<const RtpFrame> OpusRedEncoder::build(const uint8_t *payload, size_t size, uint32_t timestamp,
+                                                      size_t distance) const
+{
+	// Redundant blocks, oldest first
+	std::vector<const Previous *> blocks;
+	const size_t available = std::min(distance, history_.size());
+	for (size_t i = history_.size() - available; i < history_.size(); ++i) {
+		const Previous &previous = history_[i];
+		const uint32_t offset = timestamp - previous.timestamp;
+		if (offset == 0 || offset > OPUS_RED_MAX_TIMESTAMP_OFFSET || previous.payload.size() < kMinRedundantSize ||
+		    previous.payload.size() > OPUS_RED_MAX_BLOCK_SIZE) {
+			continue;
+		}
+		blocks.push_back(&previous);
+	}
+
+	size_t total = RTP_HEADER_SIZE + 4 * blocks.size() + 1 + size;
+	for (const Previous *block : blocks) {
+		total += block->payload.size();
+	}
+
+	auto frame = std::make_shared<OwnedRtpFrame>();
+	frame->storage.resize(total);
+	frame->timestamp = timestamp;
+	uint8_t *out = frame->storage.data();
+	writeRtpHeader(out, redPayloadType_, false, 0, timestamp, ssrc_);
+	uint8_t *p = out + RTP_HEADER_SIZE;
+	for (const Previous *block : blocks) {
+		// F=1, block PT, 14-bit timestamp offset, 10-bit length
+		const uint32_t offset = timestamp - block->timestamp;
+		const size_t length = block->payload.size();
+		*p++ = static_cast<uint8_t>(0x80 | (opusPayloadType_ & 0x7F));
+		*p++ = static_cast<uint8_t>(offset >> 6);
+		*p++ = static_cast<uint8_t>(((offset & 0x3F) << 2) | (length >> 8));
+		*p++ = static_cast<uint8_t>(length);
+	}
+	*p++ = static_cast<uint8_t>(opusPayloadType_ & 0x7F); // F=0: the primary block follows
+	for (const Previous *block : blocks) {
+		std::memcpy(p, block->payload.data(), block->payload.size());
+		p += block->payload.size();
+	}
+	std::memcpy(p, payload, size);
+	frame->packets.push_back({out, static_cast<uint32_t>(total)});
+	return frame;
+}
+
+bool OpusRedController::onReceiverReport(uint8_t fractionLost)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	const double sample = static_cast<double>(fractionLost) / 256.0;
+	stats_.lossFraction = hasReport_ ? stats_.lossFraction + kLossSmoothing * (sample - stats_.lossFraction) : sample;
+	hasReport_ = true;
+
+	const size_t before = stats_.distance;
+	const double loss = stats_.lossFraction;
+	if (loss >= OPUS_RED_DOUBLE_LOSS) {
+		stats_.distance = OPUS_RED_MAX_DISTANCE;
+	} else if (before > 1 && loss < OPUS_RED_DOUBLE_LOSS / 2) {
+		stats_.distance = 1;
+	} else if (before == 0 && loss >= OPUS_RED_ENABLE_LOSS) {
+		stats_.distance = 1;
+	}
+	if (stats_.distance > 0 && loss < OPUS_RED_DISABLE_LOSS) {
+		stats_.distance = 0;
+	}
+	if (before == 0 && stats_.distance > 0) {
+		stats_.activations++;
+	}
+	return stats_.distance != before;
+}
+
+size_t OpusRedController::distance() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_.distance;
+}
+
+void OpusRedController::countPacket()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	stats_.redPackets++;
+}
+
+OpusRedStats OpusRedController::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+} // namespace vdoninja
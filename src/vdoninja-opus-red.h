@@ -0,0 +1,91 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Opus RED (RFC 2198) audio redundancy
+ *
+ * A lost audio packet is audible long before a retransmission could arrive.
+ * RED repeats the previous one or two Opus frames in every packet, so a viewer
+ * that loses a packet decodes its audio from the next one. RED packets are built
+ * once per frame in encoder order and shared by every viewer; each viewer gets
+ * them only while it reports audio loss, and plain Opus otherwise.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "vdoninja-rtp-packetizer.h"
+
+namespace vdoninja
+{
+
+// Previous frames carried by a RED packet at most
+constexpr size_t OPUS_RED_MAX_DISTANCE = 2;
+// RFC 2198 block header limits: 14-bit timestamp offset and 10-bit length
+constexpr uint32_t OPUS_RED_MAX_TIMESTAMP_OFFSET = 0x3FFF;
+constexpr size_t OPUS_RED_MAX_BLOCK_SIZE = 0x3FF;
+
+// RED packets for one frame, indexed by redundancy distance - 1
+using OpusRedPackets = std::array<std::shared_ptr<const RtpFrame>, OPUS_RED_MAX_DISTANCE>;
+
+class OpusRedEncoder
+{
+public:
+	OpusRedEncoder(uint32_t ssrc, uint8_t redPayloadType, uint8_t opusPayloadType);
+
+	// RED packets carrying `payload` as the primary block plus 1..OPUS_RED_MAX_DISTANCE
+	// previous frames. Must be called in encoder order; the frame is remembered for the
+	// following ones. Previous frames that are too old, too large or DTX are left out.
+	OpusRedPackets encode(const uint8_t *payload, size_t size, uint32_t timestamp);
+	void reset();
+
+private:
+	struct Previous {
+		std::vector<uint8_t> payload;
+		uint32_t timestamp = 0;
+	};
+
+	std::shared_ptr<const RtpFrame> build(const uint8_t *payload, size_t size, uint32_t timestamp,
+	                                      size_t distance) const;
+
+	uint32_t ssrc_;
+	uint8_t redPayloadType_;
+	uint8_t opusPayloadType_;
+	std::deque<Previous> history_; // Oldest first
+};
+
+struct OpusRedStats {
+	size_t distance = 0;       // Previous frames sent per packet, 0 while off
+	double lossFraction = 0.0; // Smoothed audio loss reported by the viewer
+	uint64_t activations = 0;
+	uint64_t redPackets = 0;
+};
+
+// Per-viewer redundancy from RTCP receiver reports: one previous frame from
+// OPUS_RED_ENABLE_LOSS, two from OPUS_RED_DOUBLE_LOSS, off below OPUS_RED_DISABLE_LOSS.
+class OpusRedController
+{
+public:
+	// fractionLost is the RTCP fixed-point value (lost / 256); returns true when the distance changed
+	bool onReceiverReport(uint8_t fractionLost);
+	size_t distance() const;
+	void countPacket();
+
+	OpusRedStats stats() const;
+
+private:
+	mutable std::mutex mutex_;
+	OpusRedStats stats_;
+	bool hasReport_ = false;
+};
+
+constexpr double OPUS_RED_ENABLE_LOSS = 0.01;
+constexpr double OPUS_RED_DISABLE_LOSS = 0.0025;
+constexpr double OPUS_RED_DOUBLE_LOSS = 0.05;
+
+} // namespace vdoninja
@@ -5,6 +5,7 @@
 
 #include "vdoninja-output.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include <util/dstr.h>
@@ -36,12 +37,105 @@ std::string codecToUrlValue(VideoCodec codec)
 		return "vp9";
 	case VideoCodec::AV1:
 		return "av1";
+	case VideoCodec::H265:
+		return "h265";
 	case VideoCodec::H264:
 	default:
 		return "h264";
 	}
 }
 
+// Maps an OBS encoder codec id to the codec negotiated with viewers
+bool videoCodecFromEncoder(const char *codecId, VideoCodec &codec)
+{
+	if (!codecId) {
+		return false;
+	}
+	const std::string id = codecId;
+	if (id == "h264") {
+		codec = VideoCodec::H264;
+	} else if (id == "vp8") {
+		codec = VideoCodec::VP8;
+	} else if (id == "vp9") {
+		codec = VideoCodec::VP9;
+	} else if (id == "av1") {
+		codec = VideoCodec::AV1;
+	} else if (id == "hevc") {
+		codec = VideoCodec::H265;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+EncoderSettingValues readEncoderSettings(obs_data_t *settings, EncoderFamily family)
+{
+	EncoderSettingValues values;
+	for (const EncoderSettingKey &key : encoderProfileKeys(family)) {
+		switch (key.type) {
+		case EncoderSettingType::String: {
+			const char *value = obs_data_get_string(settings, key.name);
+			if (value && *value) {
+				values.strings[key.name] = value;
+			}
+			break;
+		}
+		case EncoderSettingType::Int:
+			values.ints[key.name] = obs_data_get_int(settings, key.name);
+			break;
+		case EncoderSettingType::Bool:
+			values.bools[key.name] = obs_data_get_bool(settings, key.name);
+			break;
+		}
+	}
+	return values;
+}
+
+void writeEncoderSettings(obs_encoder_t *encoder, const EncoderSettingValues &values)
+{
+	obs_data_t *update = obs_data_create();
+	for (const auto &entry : values.strings) {
+		obs_data_set_string(update, entry.first.c_str(), entry.second.c_str());
+	}
+	for (const auto &entry : values.ints) {
+		obs_data_set_int(update, entry.first.c_str(), entry.second);
+	}
+	for (const auto &entry : values.bools) {
+		obs_data_set_bool(update, entry.first.c_str(), entry.second);
+	}
+	obs_encoder_update(encoder, update);
+	obs_data_release(update);
+}
+
+double outputFps()
+{
+	obs_video_info videoInfo = {};
+	if (obs_get_video_info(&videoInfo) && videoInfo.fps_den > 0) {
+		return static_cast<double>(videoInfo.fps_num) / videoInfo.fps_den;
+	}
+	return 30.0;
+}
+
+// Take an OBS reference on the packet instead of copying its payload; the reference is
+// released when the last stage (send lane, GOP cache, NACK history) drops the frame.
+EncodedPacketRef refEncoderPacket(encoder_packet *packet)
+{
+	auto *ref = new encoder_packet{};
+	obs_encoder_packet_ref(ref, packet);
+
+	EncodedPacketInfo info;
+	info.pts = ref->pts;
+	info.dts = ref->dts;
+	info.timebaseNum = ref->timebase_num;
+	info.timebaseDen = ref->timebase_den;
+	info.keyframe = ref->keyframe;
+	info.trackIndex = ref->track_idx;
+	return EncodedPacket::wrap(ref->data, ref->size, info, [ref]() {
+		obs_encoder_packet_release(ref);
+		delete ref;
+	});
+}
+
 constexpr const char *kPluginInfoVersion = "1.1.0";
 
 } // namespace
@@ -81,6 +175,12 @@ static void vdoninja_output_stop(void *data, uint64_t)
 	vdo->stop();
 }
 
+static void vdoninja_output_deactivated(void *data, calldata_t *)
+{
+	auto *vdo = static_cast<VDONinjaOutput *>(data);
+	vdo->deactivated();
+}
+
 static void vdoninja_output_data(void *data, encoder_packet *packet)
 {
 	auto *vdo = static_cast<VDONinjaOutput *>(data);
@@ -106,6 +206,8 @@ static obs_properties_t *vdoninja_output_properties(void *)
 	obs_property_list_add_int(codec, "H.264", static_cast<int>(VideoCodec::H264));
 	obs_property_list_add_int(codec, "VP8", static_cast<int>(VideoCodec::VP8));
 	obs_property_list_add_int(codec, "VP9", static_cast<int>(VideoCodec::VP9));
+	obs_property_list_add_int(codec, "AV1", static_cast<int>(VideoCodec::AV1));
+	obs_property_list_add_int(codec, "H.265 (HEVC)", static_cast<int>(VideoCodec::H265));
 
 	obs_properties_add_int(props, "bitrate", tr("Bitrate", "Bitrate (kbps)"), 500, 50000, 100);
 	obs_properties_add_int(props, "max_viewers", tr("MaxViewers", "Max Viewers"), 1, 50, 1);
@@ -119,6 +221,43 @@ static obs_properties_t *vdoninja_output_properties(void *)
 	    advanced, "custom_ice_servers", tr("CustomICEServers", "Custom STUN/TURN Servers"), OBS_TEXT_MULTILINE);
 	obs_property_text_set_monospace(iceServers, true);
 	obs_properties_add_bool(advanced, "force_turn", tr("ForceTURN", "Force TURN Relay"));
+	obs_property_t *simulcast =
+	    obs_properties_add_list(advanced, "simulcast_layers", tr("SimulcastLayers", "Simulcast Layers"),
+	                            OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(simulcast, tr("Simulcast.Off", "Off"), 1);
+	obs_property_list_add_int(simulcast, tr("Simulcast.Two", "2 layers (full, half)"), 2);
+	obs_property_list_add_int(simulcast, tr("Simulcast.Three", "3 layers (full, half, quarter)"), 3);
+	obs_properties_add_bool(advanced, "svc_enabled", tr("SvcEnabled", "Scalable Video (VP9/AV1 SVC)"));
+	obs_properties_add_bool(advanced, "h264_fallback", tr("H264Fallback", "H.264 Fallback for H.265"));
+	obs_properties_add_int(advanced, "keyframe_request_window_ms",
+	                       tr("KeyframeRequestWindow", "Keyframe Request Window (ms)"), 0, 5000, 50);
+	obs_property_t *pacing = obs_properties_add_list(advanced, "pacing_percent", tr("Pacing", "Send Pacing"),
+	                                                 OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(pacing, tr("Pacing.Off", "Off"), 0);
+	obs_property_list_add_int(pacing, tr("Pacing.Low", "1.5x bitrate"), 150);
+	obs_property_list_add_int(pacing, tr("Pacing.Default", "2.5x bitrate"), 250);
+	obs_property_list_add_int(pacing, tr("Pacing.High", "4x bitrate"), 400);
+	obs_property_t *mtu = obs_properties_add_list(advanced, "rtp_mtu", tr("RtpMtu", "RTP Packet Size"),
+	                                              OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(mtu, tr("RtpMtu.Auto", "Auto (per viewer network path)"), 0);
+	obs_property_list_add_int(mtu, tr("RtpMtu.Small", "Small (VPN/relay, 1100 bytes)"), 1100);
+	obs_property_list_add_int(mtu, tr("RtpMtu.Default", "Default (1200 bytes)"), 1200);
+	obs_property_list_add_int(mtu, tr("RtpMtu.Large", "Large (LAN, 1400 bytes)"), 1400);
+	obs_properties_add_bool(advanced, "mtu_probing", tr("MtuProbing", "Probe Larger Packets"));
+	obs_properties_add_bool(advanced, "fec_enabled", tr("FecEnabled", "Forward Error Correction (FlexFEC)"));
+	obs_properties_add_bool(advanced, "audio_redundancy", tr("AudioRedundancy", "Audio Redundancy (Opus RED)"));
+	obs_properties_add_bool(advanced, "idle_when_no_viewers",
+	                        tr("IdleWhenNoViewers", "Pause Sending With No Viewers"));
+	obs_properties_add_int(advanced, "idle_grace_seconds", tr("IdleGraceSeconds", "Idle Grace Period (s)"), 0, 3600,
+	                       5);
+	obs_property_t *encoderProfile =
+	    obs_properties_add_list(advanced, "encoder_profile", tr("EncoderProfile", "Encoder Latency Check"),
+	                            OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(encoderProfile, tr("EncoderProfile.Warn", "Warn only"), 0);
+	obs_property_list_add_int(encoderProfile, tr("EncoderProfile.Apply", "Apply low-latency settings"), 1);
+	obs_property_list_add_int(encoderProfile, tr("EncoderProfile.Require", "Refuse high-latency settings"), 2);
+	obs_properties_add_bool(advanced, "suspend_on_tally_off",
+	                        tr("SuspendOnTallyOff", "Stop Video to Viewers Not Using It"));
 	obs_properties_add_group(props, "advanced", tr("AdvancedSettings", "Advanced Settings"), OBS_GROUP_NORMAL,
 	                         advanced);
 
@@ -166,6 +305,19 @@ static void vdoninja_output_defaults(obs_data_t *settings)
 	obs_data_set_default_bool(settings, "enable_data_channel", true);
 	obs_data_set_default_bool(settings, "auto_reconnect", true);
 	obs_data_set_default_bool(settings, "force_turn", false);
+	obs_data_set_default_int(settings, "simulcast_layers", 1);
+	obs_data_set_default_bool(settings, "svc_enabled", false);
+	obs_data_set_default_bool(settings, "h264_fallback", true);
+	obs_data_set_default_int(settings, "keyframe_request_window_ms", 500);
+	obs_data_set_default_int(settings, "pacing_percent", RtpPacer::DEFAULT_RATE_PERCENT);
+	obs_data_set_default_int(settings, "rtp_mtu", 0);
+	obs_data_set_default_bool(settings, "mtu_probing", false);
+	obs_data_set_default_bool(settings, "fec_enabled", false);
+	obs_data_set_default_bool(settings, "audio_redundancy", true);
+	obs_data_set_default_bool(settings, "idle_when_no_viewers", false);
+	obs_data_set_default_int(settings, "idle_grace_seconds", 30);
+	obs_data_set_default_int(settings, "encoder_profile", 0);
+	obs_data_set_default_bool(settings, "suspend_on_tally_off", false);
 	obs_data_set_default_bool(settings, "auto_inbound_enabled", false);
 	obs_data_set_default_string(settings, "auto_inbound_room_id", "");
 	obs_data_set_default_string(settings, "auto_inbound_password", "");
@@ -191,10 +343,18 @@ static int vdoninja_output_connect_time(void *data)
 	return vdo->getConnectTime();
 }
 
+// Simulcast attaches extra video encoders, which needs multi-track video support (OBS 30+)
+#ifdef OBS_OUTPUT_MULTI_TRACK_VIDEO
+constexpr uint32_t kOutputFlags =
+    OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_SERVICE | OBS_OUTPUT_MULTI_TRACK_VIDEO;
+#else
+constexpr uint32_t kOutputFlags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_SERVICE;
+#endif
+
 // Output info structure
 obs_output_info vdoninja_output_info = {
     .id = "vdoninja_output",
-    .flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_SERVICE,
+    .flags = kOutputFlags,
     .get_name = vdoninja_output_getname,
     .create = vdoninja_output_create,
     .destroy = vdoninja_output_destroy,
@@ -206,7 +366,7 @@ obs_output_info vdoninja_output_info = {
     .get_properties = vdoninja_output_properties,
     .get_total_bytes = vdoninja_output_total_bytes,
     .get_connect_time_ms = vdoninja_output_connect_time,
-    .encoded_video_codecs = "h264",
+    .encoded_video_codecs = "h264;vp8;vp9;av1;hevc",
     .encoded_audio_codecs = "opus",
     .protocols = "VDO.Ninja",
 };
@@ -221,12 +381,23 @@ VDONinjaOutput::VDONinjaOutput(obs_data_t *settings, obs_output_t *output) : out
 	peerManager_ = std::make_unique<VDONinjaPeerManager>();
 	autoSceneManager_ = std::make_unique<VDOAutoSceneManager>();
 
+	if (output_) {
+		signal_handler_connect(obs_output_get_signal_handler(output_), "deactivate", vdoninja_output_deactivated,
+		                       this);
+	}
+
 	logInfo("VDO.Ninja output created");
 }
 
 VDONinjaOutput::~VDONinjaOutput()
 {
 	stop(false);
+	if (output_) {
+		signal_handler_disconnect(obs_output_get_signal_handler(output_), "deactivate", vdoninja_output_deactivated,
+		                          this);
+	}
+	// Last chance for a restore the deactivate signal could not complete
+	restoreEncoderProfile();
 	logInfo("VDO.Ninja output destroyed");
 }
 
@@ -309,6 +480,19 @@ void VDONinjaOutput::loadSettings(obs_data_t *settings)
 	settings_.enableDataChannel = getBoolSetting("enable_data_channel", true);
 	settings_.autoReconnect = getBoolSetting("auto_reconnect", true);
 	settings_.forceTurn = getBoolSetting("force_turn", false);
+	settings_.simulcastLayers = std::clamp(getIntSetting("simulcast_layers", 1), 1, MAX_SIMULCAST_LAYERS);
+	settings_.svcEnabled = getBoolSetting("svc_enabled", false);
+	settings_.h264Fallback = getBoolSetting("h264_fallback", true);
+	settings_.keyframeRequestWindowMs = std::clamp(getIntSetting("keyframe_request_window_ms", 500), 0, 5000);
+	settings_.pacingPercent = std::max(getIntSetting("pacing_percent", RtpPacer::DEFAULT_RATE_PERCENT), 0);
+	settings_.rtpMtu = std::max(getIntSetting("rtp_mtu", 0), 0);
+	settings_.mtuProbing = getBoolSetting("mtu_probing", false);
+	settings_.fecEnabled = getBoolSetting("fec_enabled", false);
+	settings_.audioRed = getBoolSetting("audio_redundancy", true);
+	settings_.idleWhenNoViewers = getBoolSetting("idle_when_no_viewers", false);
+	settings_.idleGraceSeconds = std::clamp(getIntSetting("idle_grace_seconds", 30), 0, 3600);
+	settings_.encoderProfile = std::clamp(getIntSetting("encoder_profile", 0), 0, 2);
+	settings_.tallySuspend = getBoolSetting("suspend_on_tally_off", false);
 
 	settings_.autoInbound.enabled = getBoolSetting("auto_inbound_enabled", false);
 	settings_.autoInbound.roomId = getStringSetting("auto_inbound_room_id");
@@ -417,12 +601,34 @@ bool VDONinjaOutput::start()
 		return false;
 	}
 
+	// Before simulcast encoders copy the primary's settings, so every layer gets the same profile
+	if (!applyEncoderProfile()) {
+		obs_output_signal_stop(output_, OBS_OUTPUT_ERROR);
+		return false;
+	}
+
+	attachSimulcastEncoders();
+	attachH264Fallback();
+
 	if (!obs_output_initialize_encoders(output_, 0)) {
 		logError("Failed to initialize output encoders");
+		releaseH264Fallback();
+		releaseSimulcastEncoders();
+		restoreEncoderProfile();
 		obs_output_signal_stop(output_, OBS_OUTPUT_ERROR);
 		return false;
 	}
 
+	// The bitstream is whatever the attached encoder produces, so negotiate that codec.
+	VideoCodec encoderCodec = settings_.videoCodec;
+	obs_encoder_t *videoEncoder = obs_output_get_video_encoder(output_);
+	if (videoEncoder && videoCodecFromEncoder(obs_encoder_get_codec(videoEncoder), encoderCodec) &&
+	    encoderCodec != settings_.videoCodec) {
+		logWarning("Video codec setting (%s) does not match the encoder (%s); using the encoder codec",
+		           codecToUrlValue(settings_.videoCodec).c_str(), codecToUrlValue(encoderCodec).c_str());
+		settings_.videoCodec = encoderCodec;
+	}
+
 	running_ = true;
 	startTimeMs_ = currentTimeMs();
 	capturing_ = false;
@@ -443,8 +649,22 @@ void VDONinjaOutput::startThread()
 	// Initialize peer manager
 	peerManager_->initialize(signaling_.get());
 	peerManager_->setVideoCodec(settings_.videoCodec);
+	if (settings_.videoCodec == VideoCodec::H264 || settings_.videoCodec == VideoCodec::H265) {
+		logDebug("NAL indexer using %s start-code search", nalIndexerBackend());
+	}
 	peerManager_->setAudioCodec(settings_.audioCodec);
 	peerManager_->setBitrate(settings_.quality.bitrate);
+	peerManager_->setSimulcastLayers(simulcastLayers_);
+	// An encoder-chosen interval is unknown; size for the longest one the encoder check accepts
+	peerManager_->setGopLength(outputFps(), videoKeyintSec_ > 0 ? videoKeyintSec_ : MAX_REALTIME_KEYINT_SEC);
+	peerManager_->setSvcEnabled(settings_.svcEnabled);
+	peerManager_->setH264Fallback(settings_.h264Fallback && h264FallbackEncoder_ != nullptr);
+	peerManager_->setKeyframeRequestWindow(settings_.keyframeRequestWindowMs);
+	peerManager_->setTallyGating(settings_.tallySuspend);
+	peerManager_->setPacingRate(settings_.pacingPercent);
+	peerManager_->setRtpMtu(settings_.rtpMtu, settings_.mtuProbing);
+	peerManager_->setFecEnabled(settings_.fecEnabled);
+	peerManager_->setAudioRedundancy(settings_.audioRed);
 	peerManager_->setEnableDataChannel(settings_.enableDataChannel);
 	peerManager_->setIceServers(settings_.customIceServers);
 	peerManager_->setForceTurn(settings_.forceTurn);
@@ -483,6 +703,11 @@ void VDONinjaOutput::startThread()
 		connectTimeMs_ = currentTimeMs() - startTimeMs_;
 
 		if (!capturing_) {
+			extraDataLoaded_.assign(simulcastEncoders_.size() + (h264FallbackEncoder_ ? 2 : 1), false);
+			idle_.reset(settings_.idleWhenNoViewers, settings_.idleGraceSeconds * 1000LL, currentTimeMs());
+			if (settings_.idleWhenNoViewers) {
+				logInfo("No viewers yet; media is not sent until the first viewer requests the stream");
+			}
 			if (obs_output_begin_data_capture(output_, 0)) {
 				capturing_ = true;
 			} else {
@@ -534,7 +759,47 @@ void VDONinjaOutput::startThread()
 	peerManager_->setOnDataChannel(
 	    [this](const std::string &uuid, std::shared_ptr<rtc::DataChannel>) { sendInitialPeerInfo(uuid); });
 
+	// Data-channel keyframe requests go through the same arbiter as RTCP PLI/FIR
+	dataChannel_.setOnKeyframeRequest([this](const std::string &uuid) {
+		peerManager_->requestKeyframe(uuid, KeyframeRequestSource::DataChannel);
+	});
+
+	// Viewer-side signals that our media is not being watched hold it per viewer; resuming video
+	// requests a keyframe through the arbiter
+	dataChannel_.setOnMuteChange([this](const std::string &uuid, bool audioMuted, bool videoMuted) {
+		peerManager_->setViewerMediaHold(uuid, MediaGateReason::Muted, audioMuted, videoMuted);
+	});
+	dataChannel_.setOnPauseRequest([this](const std::string &uuid, const PauseRequest &request) {
+		peerManager_->setViewerMediaHold(uuid, MediaGateReason::Paused, request.audio, request.video);
+	});
+	dataChannel_.setOnVisibilityChange([this](const std::string &uuid, bool visible) {
+		peerManager_->setViewerMediaHold(uuid, MediaGateReason::Hidden, std::nullopt, !visible);
+	});
+	dataChannel_.setOnTallyChange([this](const std::string &uuid, const TallyState &state) {
+		peerManager_->setViewerTally(uuid, state.program, state.preview);
+	});
+
+	// OBS has no public API to force an IDR from a running encoder, so a coalesced encoder
+	// request is served by the encoder's next scheduled keyframe.
+	peerManager_->setOnKeyframeNeeded([this]() {
+		if (!keyframeRequestLogged_.exchange(true)) {
+			logInfo("Viewers requested a keyframe; it will be sent at the encoder's next keyframe interval");
+		}
+	});
+
+	// The first viewer wakes an idle output. OBS cannot force an IDR, so video resumes at each
+	// layer's next keyframe; the viewer's connection setup usually covers most of that wait.
+	peerManager_->setOnViewerRequested([this](const std::string &uuid) {
+		const int64_t idleMs = idle_.stats(currentTimeMs()).idleMs;
+		if (idle_.onViewerRequested(currentTimeMs())) {
+			logInfo("Viewer %s requested the stream; leaving idle mode (idle %lld s total), video resumes at the "
+			        "next keyframe",
+			        uuid.c_str(), static_cast<long long>(idleMs / 1000));
+		}
+	});
+
 	peerManager_->setOnDataChannelMessage([this](const std::string &uuid, const std::string &message) {
+		dataChannel_.handleMessage(uuid, message);
 		if (autoSceneManager_ && settings_.autoInbound.enabled) {
 			const std::string whepUrl = dataChannel_.extractWhepPlaybackUrl(message);
 			if (!whepUrl.empty()) {
@@ -575,6 +840,44 @@ void VDONinjaOutput::stop(bool signal)
 		autoSceneManager_->stop();
 	}
 
+	const SendQueueStats queueStats = peerManager_->getSendQueueStats();
+	if (queueStats.enqueuedFrames > 0) {
+		logInfo("Send queues: %llu frames queued, %llu dropped, %llu batched, avg delay %lld us, max delay %lld us, "
+		        "max enqueue %lld us",
+		        static_cast<unsigned long long>(queueStats.enqueuedFrames),
+		        static_cast<unsigned long long>(queueStats.droppedFrames),
+		        static_cast<unsigned long long>(queueStats.batches), static_cast<long long>(queueStats.avgQueueDelayUs),
+		        static_cast<long long>(queueStats.maxQueueDelayUs), static_cast<long long>(queueStats.maxEnqueueUs));
+	}
+
+	const PacerStats pacerStats = peerManager_->getPacerStats();
+	if (pacerStats.sentPackets > 0) {
+		logInfo("Pacer: %llu packets sent, video delay avg %lld us / max %lld us, audio delay avg %lld us / "
+		        "max %lld us",
+		        static_cast<unsigned long long>(pacerStats.sentPackets),
+		        static_cast<long long>(pacerStats.avgVideoDelayUs), static_cast<long long>(pacerStats.maxVideoDelayUs),
+		        static_cast<long long>(pacerStats.avgAudioDelayUs), static_cast<long long>(pacerStats.maxAudioDelayUs));
+	}
+
+	const IdleStats idleStats = idle_.stats(currentTimeMs());
+	if (idle_.enabled()) {
+		logInfo("Idle mode: %llu idle period(s), %llu wakeup(s), %lld s idle, %llu packets (%llu KB) not sent",
+		        static_cast<unsigned long long>(idleStats.idlePeriods),
+		        static_cast<unsigned long long>(idleStats.wakeups), static_cast<long long>(idleStats.idleMs / 1000),
+		        static_cast<unsigned long long>(idleStats.skippedPackets),
+		        static_cast<unsigned long long>(idleStats.skippedBytes / 1024));
+	}
+
+	const KeyframeArbiterStats keyframeStats = peerManager_->getKeyframeStats();
+	if (keyframeStats.requests > 0) {
+		logInfo("Keyframe requests: %llu received, %llu coalesced, %llu served from cache, %llu deferred to "
+		        "the next scheduled keyframe",
+		        static_cast<unsigned long long>(keyframeStats.requests),
+		        static_cast<unsigned long long>(keyframeStats.coalesced),
+		        static_cast<unsigned long long>(keyframeStats.servedFromCache),
+		        static_cast<unsigned long long>(keyframeStats.deferredToKeyframe));
+	}
+
 	// Stop publishing
 	peerManager_->stopPublishing();
 
@@ -596,11 +899,15 @@ void VDONinjaOutput::stop(bool signal)
 		startStopThread_.join();
 	}
 
-	// End data capture
+	// End data capture; encoders stop asynchronously, so their settings are restored on deactivate
 	if (capturing_) {
 		obs_output_end_data_capture(output_);
 		capturing_ = false;
+	} else {
+		restoreEncoderProfile();
 	}
+	releaseH264Fallback();
+	releaseSimulcastEncoders();
 
 	if (signal) {
 		obs_output_signal_stop(output_, OBS_OUTPUT_SUCCESS);
@@ -614,7 +921,23 @@ void VDONinjaOutput::data(encoder_packet *packet)
 	if (!running_ || !connected_)
 		return;
 
-	if (packet->type == OBS_ENCODER_VIDEO) {
+	const bool video = packet->type == OBS_ENCODER_VIDEO;
+	const size_t layer = video ? videoLayerOf(packet) : 0;
+	const bool admitted =
+	    idle_.admit(peerManager_->getViewerCount(), video, layer, packet->keyframe, packet->size, currentTimeMs());
+	if (idle_.takeLeftIdle()) {
+		logInfo("Viewer connected while idle; leaving idle mode, video resumes at the next keyframe");
+	}
+	if (!admitted) {
+		if (idle_.takeEnteredIdle()) {
+			logInfo("No viewers for %d s; entering idle mode until a viewer requests the stream",
+			        settings_.idleGraceSeconds);
+			peerManager_->releaseCachedMedia();
+		}
+		return;
+	}
+
+	if (video) {
 		processVideoPacket(packet);
 	} else if (packet->type == OBS_ENCODER_AUDIO) {
 		processAudioPacket(packet);
@@ -623,19 +946,319 @@ void VDONinjaOutput::data(encoder_packet *packet)
 	totalBytes_ += packet->size;
 }
 
+bool VDONinjaOutput::applyEncoderProfile()
+{
+	obs_encoder_t *encoder = obs_output_get_video_encoder(output_);
+	obs_data_t *encoderSettings = encoder ? obs_encoder_get_settings(encoder) : nullptr;
+	videoKeyintSec_ = 0;
+	if (!encoderSettings) {
+		return true;
+	}
+
+	const EncoderFamily family = encoderFamilyFromId(obs_encoder_get_id(encoder));
+	EncoderSettingValues values = readEncoderSettings(encoderSettings, family);
+	obs_data_release(encoderSettings);
+
+	const double fps = outputFps();
+	const auto mode = static_cast<EncoderProfileMode>(settings_.encoderProfile);
+	EncoderConfig config = parseEncoderConfig(family, values, fps);
+	EncoderAssessment assessment = assessEncoderConfig(config);
+
+	if (mode == EncoderProfileMode::Apply) {
+		const EncoderSettingValues overrides = lowLatencyOverrides(family, values, config);
+		if (!overrides.empty() && obs_encoder_active(encoder)) {
+			// Changing a running encoder would also change the stream or recording sharing it
+			logWarning("Video encoder is already in use by another output; low-latency settings not applied");
+		} else if (!overrides.empty()) {
+			const double beforeMs = assessment.latencyMs;
+			EncoderSettingValues previous;
+			for (const auto &entry : overrides.strings) {
+				previous.strings[entry.first] = values.strings[entry.first];
+			}
+			for (const auto &entry : overrides.ints) {
+				previous.ints[entry.first] = values.ints[entry.first];
+			}
+			for (const auto &entry : overrides.bools) {
+				previous.bools[entry.first] = values.bools[entry.first];
+			}
+			writeEncoderSettings(encoder, overrides);
+			// A restore still pending from the last run holds the user's own values, not ours
+			encoderSettingsBeforeProfile_ = mergeEncoderSettings(previous, encoderSettingsBeforeProfile_);
+
+			values = mergeEncoderSettings(values, overrides);
+			config = parseEncoderConfig(family, values, fps);
+			assessment = assessEncoderConfig(config);
+			logInfo("Applied low-latency settings to the %s encoder (%.0f ms -> %.0f ms); restored when the output "
+			        "stops",
+			        encoderFamilyName(family), beforeMs, assessment.latencyMs);
+		}
+	}
+
+	videoKeyintSec_ = config.keyintSec;
+	const std::string keyint = config.keyintSec > 0 ? std::to_string(config.keyintSec) + " s" : "encoder default";
+	logInfo("Video encoder (%s, %s): about %.0f ms encoder latency, %d B-frame(s)%s, keyframe every %s",
+	        obs_encoder_get_id(encoder), encoderFamilyName(family), assessment.latencyMs, config.bFrames,
+	        config.bFramesKnown ? "" : " (not reported)", keyint.c_str());
+	const bool refuse = mode == EncoderProfileMode::Require && assessment.blocking();
+	for (const EncoderIssue &issue : assessment.issues) {
+		if (refuse && issue.severity == EncoderIssueSeverity::Blocking) {
+			logError("Video encoder: %s", issue.message.c_str());
+		} else {
+			logWarning("Video encoder: %s", issue.message.c_str());
+		}
+	}
+
+	if (refuse) {
+		obs_output_set_last_error(output_, tr("EncoderProfile.Refused",
+		                                      "The video encoder settings are not suitable for real-time "
+		                                      "streaming (B-frames or a very long keyframe interval)."));
+		return false;
+	}
+	return true;
+}
+
+void VDONinjaOutput::restoreEncoderProfile()
+{
+	if (encoderSettingsBeforeProfile_.empty()) {
+		return;
+	}
+	obs_encoder_t *encoder = obs_output_get_video_encoder(output_);
+	if (!encoder) {
+		logWarning("Video encoder was detached; its low-latency settings could not be restored");
+		encoderSettingsBeforeProfile_ = EncoderSettingValues{};
+		return;
+	}
+	if (obs_encoder_active(encoder)) {
+		// Kept for the next deactivate, start or teardown to retry
+		logWarning("Video encoder is still in use; its low-latency settings will be restored once it stops");
+		return;
+	}
+	writeEncoderSettings(encoder, encoderSettingsBeforeProfile_);
+	encoderSettingsBeforeProfile_ = EncoderSettingValues{};
+	logInfo("Restored the video encoder settings replaced by the low-latency profile");
+}
+
+void VDONinjaOutput::deactivated()
+{
+	restoreEncoderProfile();
+}
+
+void VDONinjaOutput::attachSimulcastEncoders()
+{
+	releaseSimulcastEncoders();
+	if (settings_.simulcastLayers <= 1) {
+		return;
+	}
+
+#ifdef OBS_OUTPUT_MULTI_TRACK_VIDEO
+	obs_encoder_t *primary = obs_output_get_video_encoder(output_);
+	if (!primary) {
+		logWarning("Simulcast needs a video encoder; publishing a single layer");
+		return;
+	}
+
+	obs_data_t *primarySettings = obs_encoder_get_settings(primary);
+	int bitrate = primarySettings ? static_cast<int>(obs_data_get_int(primarySettings, "bitrate")) * 1000 : 0;
+	if (bitrate <= 0) {
+		bitrate = settings_.quality.bitrate;
+	}
+
+	// Extra layers reuse the primary encoder type and settings at a lower size and bitrate
+	std::vector<SimulcastLayer> layers =
+	    buildSimulcastLadder(static_cast<int>(obs_encoder_get_width(primary)),
+	                         static_cast<int>(obs_encoder_get_height(primary)), bitrate, settings_.simulcastLayers);
+	for (size_t i = 1; i < layers.size(); ++i) {
+		obs_data_t *layerSettings = obs_data_create();
+		if (primarySettings) {
+			obs_data_apply(layerSettings, primarySettings);
+		}
+		obs_data_set_int(layerSettings, "bitrate", layers[i].bitrate / 1000);
+
+		const std::string name = "vdoninja-simulcast-" + layers[i].rid;
+		obs_encoder_t *encoder =
+		    obs_video_encoder_create(obs_encoder_get_id(primary), name.c_str(), layerSettings, nullptr);
+		obs_data_release(layerSettings);
+		if (!encoder) {
+			logWarning("Failed to create simulcast encoder for layer %s", layers[i].rid.c_str());
+			break;
+		}
+
+		obs_encoder_set_video(encoder, obs_get_video());
+		obs_encoder_set_scaled_size(encoder, static_cast<uint32_t>(layers[i].width),
+		                            static_cast<uint32_t>(layers[i].height));
+		obs_output_set_video_encoder2(output_, encoder, i);
+		simulcastEncoders_.push_back(encoder);
+	}
+	if (primarySettings) {
+		obs_data_release(primarySettings);
+	}
+
+	layers.resize(simulcastEncoders_.size() + 1);
+	if (layers.size() > 1) {
+		simulcastLayers_ = layers;
+		for (const auto &layer : simulcastLayers_) {
+			logInfo("Simulcast layer %s: %dx%d @ %d kbps", layer.rid.c_str(), layer.width, layer.height,
+			        layer.bitrate / 1000);
+		}
+	}
+#else
+	logWarning("Simulcast needs multi-track video support (OBS 30 or newer); publishing a single layer");
+#endif
+}
+
+void VDONinjaOutput::releaseSimulcastEncoders()
+{
+#ifdef OBS_OUTPUT_MULTI_TRACK_VIDEO
+	for (size_t i = 0; i < simulcastEncoders_.size(); ++i) {
+		obs_output_set_video_encoder2(output_, nullptr, i + 1);
+		obs_encoder_release(simulcastEncoders_[i]);
+	}
+#endif
+	simulcastEncoders_.clear();
+	simulcastLayers_.clear();
+}
+
+void VDONinjaOutput::attachH264Fallback()
+{
+	releaseH264Fallback();
+	obs_encoder_t *primary = obs_output_get_video_encoder(output_);
+	const char *primaryCodec = primary ? obs_encoder_get_codec(primary) : nullptr;
+	if (!settings_.h264Fallback || !primaryCodec || std::strcmp(primaryCodec, "hevc") != 0) {
+		return;
+	}
+
+#ifdef OBS_OUTPUT_MULTI_TRACK_VIDEO
+	const std::string primaryId = obs_encoder_get_id(primary);
+	obs_data_t *primarySettings = obs_encoder_get_settings(primary);
+	int bitrate = primarySettings ? static_cast<int>(obs_data_get_int(primarySettings, "bitrate")) * 1000 : 0;
+	if (bitrate <= 0) {
+		bitrate = settings_.quality.bitrate;
+	}
+
+	// Same size and bitrate as the H.265 stream, on the same hardware when it has an H.264 encoder
+	for (const std::string &id : h264EncoderCandidates(primaryId)) {
+		const char *codec = obs_get_encoder_codec(id.c_str());
+		if (!codec || std::strcmp(codec, "h264") != 0) {
+			continue;
+		}
+		const EncoderFamily family = encoderFamilyFromId(id);
+		obs_data_t *fallbackSettings = obs_data_create();
+		if (primarySettings && family == encoderFamilyFromId(primaryId)) {
+			obs_data_apply(fallbackSettings, primarySettings);
+			// H.265 profile names (main10) are not H.264 ones
+			obs_data_erase(fallbackSettings, "profile");
+		}
+		obs_data_set_int(fallbackSettings, "bitrate", bitrate / 1000);
+		obs_encoder_t *encoder =
+		    obs_video_encoder_create(id.c_str(), "vdoninja-h264-fallback", fallbackSettings, nullptr);
+		obs_data_release(fallbackSettings);
+		if (!encoder) {
+			continue;
+		}
+
+		// Only WebRTC viewers use this encoder, so it always gets the low-latency profile
+		obs_data_t *created = obs_encoder_get_settings(encoder);
+		if (created) {
+			const EncoderSettingValues values = readEncoderSettings(created, family);
+			obs_data_release(created);
+			const EncoderSettingValues overrides =
+			    lowLatencyOverrides(family, values, parseEncoderConfig(family, values, outputFps()));
+			if (!overrides.empty()) {
+				writeEncoderSettings(encoder, overrides);
+			}
+		}
+
+		obs_encoder_set_video(encoder, obs_get_video());
+		obs_encoder_set_scaled_size(encoder, obs_encoder_get_width(primary), obs_encoder_get_height(primary));
+		obs_output_set_video_encoder2(output_, encoder, simulcastEncoders_.size() + 1);
+		h264FallbackEncoder_ = encoder;
+		logInfo("H.264 fallback for viewers without H.265: %s @ %d kbps", id.c_str(), bitrate / 1000);
+		break;
+	}
+	if (primarySettings) {
+		obs_data_release(primarySettings);
+	}
+	if (!h264FallbackEncoder_) {
+		logWarning("No H.264 encoder available; viewers without H.265 will not receive video");
+	}
+#else
+	logWarning("The H.264 fallback needs multi-track video support (OBS 30 or newer); viewers without H.265 "
+	           "will not receive video");
+#endif
+}
+
+void VDONinjaOutput::releaseH264Fallback()
+{
+	if (!h264FallbackEncoder_) {
+		return;
+	}
+#ifdef OBS_OUTPUT_MULTI_TRACK_VIDEO
+	obs_output_set_video_encoder2(output_, nullptr, simulcastEncoders_.size() + 1);
+#endif
+	obs_encoder_release(h264FallbackEncoder_);
+	h264FallbackEncoder_ = nullptr;
+}
+
+size_t VDONinjaOutput::videoLayerOf(const encoder_packet *packet) const
+{
+	// Video track index matches the encoder slot: the simulcast layers, then the H.264 fallback
+	return simulcastEncoders_.empty() && !h264FallbackEncoder_ ? 0 : packet->track_idx;
+}
+
 void VDONinjaOutput::processVideoPacket(encoder_packet *packet)
 {
 	bool keyframe = packet->keyframe;
-	uint32_t timestamp = static_cast<uint32_t>(packet->pts * 90); // Convert to 90kHz clock
+	const size_t layer = videoLayerOf(packet);
+	const bool fallback = h264FallbackEncoder_ && layer == simulcastEncoders_.size() + 1;
+	const VideoCodec codec = fallback ? VideoCodec::H264 : settings_.videoCodec;
 
-	peerManager_->sendVideoFrame(packet->data, packet->size, timestamp, keyframe);
+	if (codec != VideoCodec::H264 && codec != VideoCodec::H265) {
+		peerManager_->sendVideoFrame(refEncoderPacket(packet), keyframe, layer);
+		return;
+	}
+
+	// Scan the access unit once; keyframe detection and packetization share the spans
+	const NalFormat format = codec == VideoCodec::H265 ? NalFormat::H265 : NalFormat::H264;
+	indexNalUnits(packet->data, packet->size, nalIndex_, format);
+	keyframe = keyframe || nalIndexHasKeyframe(nalIndex_, format);
+	if (keyframe) {
+		loadVideoExtraData(layer);
+	}
+	peerManager_->sendVideoFrame(refEncoderPacket(packet), keyframe, layer, &nalIndex_);
+}
+
+void VDONinjaOutput::loadVideoExtraData(size_t layer)
+{
+	if (layer >= extraDataLoaded_.size()) {
+		extraDataLoaded_.resize(layer + 1, false);
+	}
+	if (extraDataLoaded_[layer]) {
+		return;
+	}
+	extraDataLoaded_[layer] = true;
+
+	obs_encoder_t *encoder = obs_output_get_video_encoder(output_);
+	if (layer > simulcastEncoders_.size()) {
+		encoder = h264FallbackEncoder_;
+	} else if (layer > 0) {
+		encoder = simulcastEncoders_[layer - 1];
+	}
+	uint8_t *extraData = nullptr;
+	size_t extraSize = 0;
+	if (encoder && obs_encoder_get_extra_data(encoder, &extraData, &extraSize)) {
+		peerManager_->setVideoExtraData(layer, extraData, extraSize);
+	}
 }
 
 void VDONinjaOutput::processAudioPacket(encoder_packet *packet)
 {
-	uint32_t timestamp = static_cast<uint32_t>(packet->pts * 48); // Convert to 48kHz clock
+	// The peer manager's media clock maps pts to the RTP clock from the packet's own timebase
+	peerManager_->sendAudioFrame(refEncoderPacket(packet));
+}
 
-	peerManager_->sendAudioFrame(packet->data, packet->size, timestamp);
+IdleStats VDONinjaOutput::getIdleStats() const
+{
+	return idle_.stats(currentTimeMs());
 }
 
 uint64_t VDONinjaOutput::getTotalBytes() const
@@ -12,10 +12,13 @@
 
 #include <atomic>
 #include <thread>
+#include <vector>
 
 #include "vdoninja-auto-scene-manager.h"
 #include "vdoninja-common.h"
 #include "vdoninja-data-channel.h"
+#include "vdoninja-encoder-profile.h"
+#include "vdoninja-idle.h"
 #include "vdoninja-peer-manager.h"
 #include "vdoninja-signaling.h"
 
@@ -32,11 +35,14 @@ public:
 	bool start();
 	void stop(bool signal = true);
 	void data(encoder_packet *packet);
+	// Data capture has ended and the encoders are stopped
+	void deactivated();
 
 	// Get statistics
 	uint64_t getTotalBytes() const;
 	int getConnectTime() const;
 	int getViewerCount() const;
+	IdleStats getIdleStats() const;
 
 	// Update settings
 	void update(obs_data_t *settings);
@@ -49,9 +55,23 @@ private:
 	void startThread();
 	void stopThread();
 
+	// Extra encoders for simulcast layers 1..n (layer 0 is the encoder OBS attached)
+	void attachSimulcastEncoders();
+	void releaseSimulcastEncoders();
+	// With an H.265 encoder, a second H.264 encoder for viewers that cannot decode H.265
+	void attachH264Fallback();
+	void releaseH264Fallback();
+	size_t videoLayerOf(const encoder_packet *packet) const;
+
+	// Inspect (and in Apply mode, override) the video encoder's latency settings; false refuses to start
+	bool applyEncoderProfile();
+	void restoreEncoderProfile();
+
 	// Handle encoding
 	void processAudioPacket(encoder_packet *packet);
 	void processVideoPacket(encoder_packet *packet);
+	// Feed the layer encoder's parameter-set extra data to the peer manager once per start
+	void loadVideoExtraData(size_t layer);
 	void sendInitialPeerInfo(const std::string &uuid);
 	std::string buildInitialInfoMessage() const;
 
@@ -71,6 +91,8 @@ private:
 	std::atomic<bool> running_{false};
 	std::atomic<bool> connected_{false};
 	std::atomic<bool> capturing_{false};
+	std::atomic<bool> keyframeRequestLogged_{false};
+	IdleController idle_;
 	std::thread startStopThread_;
 
 	// Statistics
@@ -83,6 +105,13 @@ private:
 	audio_t *audio_ = nullptr;
 	const char *videoCodecName_ = nullptr;
 	const char *audioCodecName_ = nullptr;
+	std::vector<obs_encoder_t *> simulcastEncoders_;
+	std::vector<SimulcastLayer> simulcastLayers_;
+	obs_encoder_t *h264FallbackEncoder_ = nullptr; // Video track after the simulcast layers
+	NalIndex nalIndex_; // Reused per video packet, encoder thread only
+	std::vector<bool> extraDataLoaded_;
+	EncoderSettingValues encoderSettingsBeforeProfile_; // Values replaced by the low-latency profile
+	int videoKeyintSec_ = 0; // Keyframe interval read from the video encoder, 0 if encoder-chosen
 };
 
 // OBS output info registration
@@ -0,0 +1,381 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Send-side RTP pacer implementation
+ */
+
+#include "vdoninja-pacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "vdoninja-utils.h"
+
+namespace vdoninja
+{
+
+namespace
+{
+
+size_t defaultThreadCount()
+{
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	return std::clamp<size_t>(hardwareThreads / 2, 1, 4);
+}
+
+void updateMax(std::atomic<int64_t> &target, int64_t value)
+{
+	int64_t current = target.load(std::memory_order_relaxed);
+	while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+	}
+}
+
+} // namespace
+
+LeakyBucket::LeakyBucket(int64_t bitsPerSecond, int64_t burstUs)
+    : bitsPerSecond_(std::max<int64_t>(bitsPerSecond, 0)), burstUs_(std::max<int64_t>(burstUs, 1))
+{
+}
+
+void LeakyBucket::setRate(int64_t bitsPerSecond)
+{
+	bitsPerSecond_ = std::max<int64_t>(bitsPerSecond, 0);
+}
+
+bool LeakyBucket::canSend(int64_t nowUs)
+{
+	if (bitsPerSecond_ == 0) {
+		return true;
+	}
+
+	const double burstBytes =
+	    std::max<double>(MIN_BURST_BYTES, static_cast<double>(bitsPerSecond_) * burstUs_ / 8e6);
+	if (lastUs_ == 0) {
+		budgetBytes_ = burstBytes;
+	} else if (nowUs > lastUs_) {
+		budgetBytes_ += static_cast<double>(nowUs - lastUs_) * bitsPerSecond_ / 8e6;
+		budgetBytes_ = std::min(budgetBytes_, burstBytes);
+	}
+	lastUs_ = std::max(lastUs_, nowUs);
+	return budgetBytes_ > 0.0;
+}
+
+void LeakyBucket::consume(size_t bytes)
+{
+	if (bitsPerSecond_ > 0) {
+		budgetBytes_ -= static_cast<double>(bytes);
+	}
+}
+
+int64_t LeakyBucket::nextSendUs(int64_t nowUs) const
+{
+	if (bitsPerSecond_ == 0 || budgetBytes_ > 0.0) {
+		return nowUs;
+	}
+	const double debtUs = -budgetBytes_ * 8e6 / static_cast<double>(bitsPerSecond_);
+	return std::max(nowUs, lastUs_) + static_cast<int64_t>(std::ceil(debtUs)) + 1;
+}
+
+PacedStream::PacedStream(PacedPacketSink sink, int64_t bitsPerSecond)
+    : sink_(std::move(sink)), bucket_(bitsPerSecond)
+{
+}
+
+void PacedStream::push(MediaKind kind, std::shared_ptr<const RtpFrame> frame, uint16_t firstSequence)
+{
+	if (!frame || frame->packetCount() == 0) {
+		return;
+	}
+
+	std::function<void()> wake;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!wake_) {
+			return; // Not attached to a running pacer
+		}
+		for (size_t i = 0; i < frame->packetCount(); ++i) {
+			queuedBytes_ += frame->packetSize(i);
+		}
+		queuedPackets_ += frame->packetCount();
+
+		Entry entry;
+		entry.frame = std::move(frame);
+		entry.firstSequence = firstSequence;
+		entry.queuedAtUs = MediaSendPool::nowUs();
+		(kind == MediaKind::Audio ? audio_ : video_).push_back(std::move(entry));
+		wake = wake_;
+	}
+	wake();
+}
+
+void PacedStream::setRate(int64_t bitsPerSecond)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	bucket_.setRate(bitsPerSecond);
+}
+
+void PacedStream::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	audio_.clear();
+	video_.clear();
+	queuedBytes_ = 0;
+	queuedPackets_ = 0;
+}
+
+size_t PacedStream::queuedBytes() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return queuedBytes_;
+}
+
+size_t PacedStream::queuedPackets() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return queuedPackets_;
+}
+
+RtpPacer::RtpPacer(size_t threadCount)
+{
+	const size_t count = threadCount > 0 ? threadCount : defaultThreadCount();
+	shards_.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		shards_.push_back(std::make_unique<Shard>());
+	}
+}
+
+RtpPacer::~RtpPacer()
+{
+	stop();
+}
+
+void RtpPacer::start()
+{
+	std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+	if (running_) {
+		return;
+	}
+
+	for (auto &shard : shards_) {
+		{
+			std::lock_guard<std::mutex> lock(shard->mutex);
+			shard->stopping = false;
+		}
+		Shard *raw = shard.get();
+		shard->thread = std::thread([this, raw]() { shardLoop(*raw); });
+	}
+	running_ = true;
+
+	logInfo("RTP pacer started with %zu thread(s)", shards_.size());
+}
+
+void RtpPacer::stop()
+{
+	std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+	if (!running_) {
+		return;
+	}
+	running_ = false;
+
+	for (auto &shard : shards_) {
+		{
+			std::lock_guard<std::mutex> lock(shard->mutex);
+			shard->stopping = true;
+		}
+		shard->cv.notify_all();
+	}
+	for (auto &shard : shards_) {
+		if (shard->thread.joinable()) {
+			shard->thread.join();
+		}
+	}
+
+	for (auto &shard : shards_) {
+		std::vector<std::shared_ptr<PacedStream>> streams;
+		{
+			std::lock_guard<std::mutex> lock(shard->mutex);
+			streams.swap(shard->streams);
+		}
+		for (auto &stream : streams) {
+			{
+				std::lock_guard<std::mutex> lock(stream->mutex_);
+				stream->wake_ = nullptr;
+			}
+			stream->clear();
+		}
+	}
+	logInfo("RTP pacer stopped");
+}
+
+bool RtpPacer::isRunning() const
+{
+	return running_;
+}
+
+void RtpPacer::addStream(const std::shared_ptr<PacedStream> &stream)
+{
+	if (!stream) {
+		return;
+	}
+	removeStream(stream);
+
+	Shard *target = nullptr;
+	size_t fewest = 0;
+	for (auto &shard : shards_) {
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		if (!target || shard->streams.size() < fewest) {
+			target = shard.get();
+			fewest = shard->streams.size();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(stream->mutex_);
+		stream->wake_ = [target]() {
+			{
+				std::lock_guard<std::mutex> shardLock(target->mutex);
+				target->signaled = true;
+			}
+			target->cv.notify_one();
+		};
+	}
+	std::lock_guard<std::mutex> lock(target->mutex);
+	target->streams.push_back(stream);
+}
+
+void RtpPacer::removeStream(const std::shared_ptr<PacedStream> &stream)
+{
+	if (!stream) {
+		return;
+	}
+
+	for (auto &shard : shards_) {
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		auto &streams = shard->streams;
+		streams.erase(std::remove(streams.begin(), streams.end(), stream), streams.end());
+	}
+	{
+		std::lock_guard<std::mutex> lock(stream->mutex_);
+		stream->wake_ = nullptr;
+	}
+	stream->clear();
+}
+
+void RtpPacer::shardLoop(Shard &shard)
+{
+	std::vector<std::shared_ptr<PacedStream>> streams;
+	std::vector<uint8_t> scratch;
+
+	std::unique_lock<std::mutex> lock(shard.mutex);
+	while (!shard.stopping) {
+		shard.signaled = false;
+		streams.assign(shard.streams.begin(), shard.streams.end());
+		lock.unlock();
+
+		int64_t wakeUs = std::numeric_limits<int64_t>::max();
+		const int64_t nowUs = MediaSendPool::nowUs();
+		for (const auto &stream : streams) {
+			service(*stream, nowUs, wakeUs, scratch);
+		}
+		streams.clear();
+
+		lock.lock();
+		auto ready = [&shard]() { return shard.signaled || shard.stopping; };
+		if (wakeUs == std::numeric_limits<int64_t>::max()) {
+			shard.cv.wait(lock, ready);
+		} else {
+			const std::chrono::steady_clock::time_point deadline{std::chrono::microseconds(wakeUs)};
+			shard.cv.wait_until(lock, deadline, ready);
+		}
+	}
+}
+
+void RtpPacer::service(PacedStream &stream, int64_t nowUs, int64_t &wakeUs, std::vector<uint8_t> &scratch)
+{
+	while (true) {
+		std::shared_ptr<const RtpFrame> frame;
+		size_t index = 0;
+		uint16_t sequence = 0;
+		int64_t queuedAtUs = 0;
+		MediaKind kind = MediaKind::Audio;
+		{
+			std::lock_guard<std::mutex> lock(stream.mutex_);
+			const bool allowed = stream.bucket_.canSend(nowUs);
+			std::deque<PacedStream::Entry> *queue = nullptr;
+			if (!stream.audio_.empty()) {
+				// Audio is small and latency sensitive: it is charged to the bucket but never waits on it
+				queue = &stream.audio_;
+			} else if (!stream.video_.empty()) {
+				if (!allowed) {
+					wakeUs = std::min(wakeUs, stream.bucket_.nextSendUs(nowUs));
+					return;
+				}
+				queue = &stream.video_;
+				kind = MediaKind::Video;
+			} else {
+				return;
+			}
+
+			PacedStream::Entry &entry = queue->front();
+			frame = entry.frame;
+			index = entry.next++;
+			sequence = static_cast<uint16_t>(entry.firstSequence + index);
+			queuedAtUs = entry.queuedAtUs;
+			if (entry.next >= frame->packetCount()) {
+				queue->pop_front();
+			}
+
+			const size_t size = frame->packetSize(index);
+			stream.bucket_.consume(size);
+			stream.queuedBytes_ -= std::min(stream.queuedBytes_, size);
+			stream.queuedPackets_ -= std::min<size_t>(stream.queuedPackets_, 1);
+		}
+
+		const size_t size = frame->packetSize(index);
+		scratch.assign(frame->packetData(index), frame->packetData(index) + size);
+		scratch[2] = static_cast<uint8_t>(sequence >> 8);
+		scratch[3] = static_cast<uint8_t>(sequence & 0xFF);
+		try {
+			stream.sink_(kind, scratch.data(), size);
+		} catch (const std::exception &e) {
+			logError("Paced send failed: %s", e.what());
+		}
+
+		const int64_t delayUs = MediaSendPool::nowUs() - queuedAtUs;
+		sentPackets_++;
+		if (kind == MediaKind::Audio) {
+			audioPackets_++;
+			totalAudioDelayUs_ += delayUs;
+			updateMax(maxAudioDelayUs_, delayUs);
+		} else {
+			videoPackets_++;
+			totalVideoDelayUs_ += delayUs;
+			updateMax(maxVideoDelayUs_, delayUs);
+		}
+	}
+}
+
+PacerStats RtpPacer::getStats() const
+{
+	PacerStats stats;
+	stats.threads = shards_.size();
+	for (const auto &shard : shards_) {
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		stats.streams += shard->streams.size();
+		for (const auto &stream : shard->streams) {
+			stats.queuedPackets += stream->queuedPackets();
+		}
+	}
+
+	stats.sentPackets = sentPackets_;
+	const uint64_t video = videoPackets_;
+	const uint64_t audio = audioPackets_;
+	stats.avgVideoDelayUs = video > 0 ? totalVideoDelayUs_ / static_cast<int64_t>(video) : 0;
+	stats.maxVideoDelayUs = maxVideoDelayUs_;
+	stats.avgAudioDelayUs = audio > 0 ? totalAudioDelayUs_ / static_cast<int64_t>(audio) : 0;
+	stats.maxAudioDelayUs = maxAudioDelayUs_;
+	return stats;
+}
+
+} // namespace vdoninja
@@ -0,0 +1,152 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Send-side RTP pacer
+ *
+ * A keyframe can be hundreds of RTP packets; sending them back-to-back to every
+ * viewer produces a microburst that overflows the publisher's uplink queue and
+ * causes the loss that triggers more keyframe requests. Each viewer gets a
+ * leaky bucket draining at a multiple of its target bitrate. Audio is sent ahead
+ * of video and is never held back by the bucket.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vdoninja-rtp-packetizer.h"
+#include "vdoninja-send-queue.h"
+
+namespace vdoninja
+{
+
+// Token bucket in bytes. The budget may go negative so a packet always fits once
+// the bucket is non-empty; the debt delays the next send.
+class LeakyBucket
+{
+public:
+	static constexpr int64_t DEFAULT_BURST_US = 5000;
+	// Always allow at least one full-size packet per burst
+	static constexpr int64_t MIN_BURST_BYTES = 1500;
+
+	explicit LeakyBucket(int64_t bitsPerSecond = 0, int64_t burstUs = DEFAULT_BURST_US);
+
+	void setRate(int64_t bitsPerSecond);
+	int64_t rate() const { return bitsPerSecond_; }
+
+	// Refills the bucket up to nowUs and reports whether a packet may go out
+	bool canSend(int64_t nowUs);
+	void consume(size_t bytes);
+	// Earliest time canSend() can succeed
+	int64_t nextSendUs(int64_t nowUs) const;
+
+private:
+	int64_t bitsPerSecond_ = 0;
+	int64_t burstUs_;
+	double budgetBytes_ = 0.0;
+	int64_t lastUs_ = 0;
+};
+
+using PacedPacketSink = std::function<void(MediaKind kind, const uint8_t *data, size_t size)>;
+
+// One viewer's paced packets. Frames are queued with sequence numbers assigned
+// up front and are stamped as each packet leaves.
+class PacedStream
+{
+public:
+	explicit PacedStream(PacedPacketSink sink, int64_t bitsPerSecond = 0);
+
+	void push(MediaKind kind, std::shared_ptr<const RtpFrame> frame, uint16_t firstSequence);
+	void setRate(int64_t bitsPerSecond);
+	void clear();
+
+	size_t queuedBytes() const;
+	size_t queuedPackets() const;
+
+private:
+	friend class RtpPacer;
+
+	struct Entry {
+		std::shared_ptr<const RtpFrame> frame;
+		uint16_t firstSequence = 0;
+		size_t next = 0;
+		int64_t queuedAtUs = 0;
+	};
+
+	PacedPacketSink sink_;
+	mutable std::mutex mutex_;
+	std::deque<Entry> audio_;
+	std::deque<Entry> video_;
+	LeakyBucket bucket_;
+	size_t queuedBytes_ = 0;
+	size_t queuedPackets_ = 0;
+	std::function<void()> wake_;
+};
+
+struct PacerStats {
+	size_t threads = 0;
+	size_t streams = 0;
+	size_t queuedPackets = 0;
+	uint64_t sentPackets = 0;
+	int64_t avgVideoDelayUs = 0;
+	int64_t maxVideoDelayUs = 0;
+	int64_t avgAudioDelayUs = 0;
+	int64_t maxAudioDelayUs = 0;
+};
+
+class RtpPacer
+{
+public:
+	// Pacing rate as a multiple of the target bitrate, in percent
+	static constexpr int DEFAULT_RATE_PERCENT = 250;
+
+	// threadCount 0 picks a count from the available hardware threads.
+	explicit RtpPacer(size_t threadCount = 0);
+	~RtpPacer();
+
+	void start();
+	void stop();
+	bool isRunning() const;
+
+	// Streams are pinned to the thread with the fewest streams
+	void addStream(const std::shared_ptr<PacedStream> &stream);
+	void removeStream(const std::shared_ptr<PacedStream> &stream);
+
+	PacerStats getStats() const;
+
+private:
+	struct Shard {
+		std::thread thread;
+		mutable std::mutex mutex;
+		std::condition_variable cv;
+		std::vector<std::shared_ptr<PacedStream>> streams;
+		bool signaled = false;
+		bool stopping = false;
+	};
+
+	void shardLoop(Shard &shard);
+	// Send what the stream's bucket allows; lowers wakeUs to when it can send again
+	void service(PacedStream &stream, int64_t nowUs, int64_t &wakeUs, std::vector<uint8_t> &scratch);
+
+	std::vector<std::unique_ptr<Shard>> shards_;
+	std::atomic<bool> running_{false};
+	std::mutex lifecycleMutex_;
+
+	std::atomic<uint64_t> sentPackets_{0};
+	std::atomic<uint64_t> videoPackets_{0};
+	std::atomic<int64_t> totalVideoDelayUs_{0};
+	std::atomic<int64_t> maxVideoDelayUs_{0};
+	std::atomic<uint64_t> audioPackets_{0};
+	std::atomic<int64_t> totalAudioDelayUs_{0};
+	std::atomic<int64_t> maxAudioDelayUs_{0};
+};
+
+} // namespace vdoninja
@@ -0,0 +1,319 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * H.264/H.265 parameter-set cache implementation
+ */
+
+#include "vdoninja-parameter-sets.h"
+
+#include <algorithm>
+
+namespace vdoninja
+{
+
+namespace
+{
+
+constexpr uint32_t MAX_SPS_ID = 31;
+constexpr uint32_t MAX_PPS_ID = 255;
+// SPS header byte plus profile_idc, constraint flags and level_idc precede the id
+constexpr size_t SPS_ID_OFFSET = 4;
+constexpr size_t PPS_ID_OFFSET = 1;
+
+constexpr uint32_t MAX_HEVC_VPS_ID = 15;
+constexpr uint32_t MAX_HEVC_SPS_ID = 15;
+constexpr uint32_t MAX_HEVC_PPS_ID = 63;
+// General profile_tier_level fields before the sub-layer flags, and per sub-layer sizes
+constexpr int HEVC_GENERAL_PTL_BITS = 96;
+constexpr int HEVC_SUB_LAYER_PROFILE_BITS = 88;
+constexpr int HEVC_SUB_LAYER_LEVEL_BITS = 8;
+constexpr size_t HEVC_CONFIG_HEADER_SIZE = 22;
+
+// Exp-Golomb reader over RBSP bytes, skipping emulation prevention bytes.
+class BitReader
+{
+public:
+	BitReader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+	bool readBit(uint32_t &bit)
+	{
+		if (bitPos_ == 0) {
+			if (pos_ >= size_) {
+				return false;
+			}
+			if (zeros_ >= 2 && data_[pos_] == 0x03) {
+				zeros_ = 0;
+				if (++pos_ >= size_) {
+					return false;
+				}
+			}
+			current_ = data_[pos_++];
+			zeros_ = current_ == 0 ? zeros_ + 1 : 0;
+		}
+		bit = (current_ >> (7 - bitPos_)) & 1;
+		bitPos_ = (bitPos_ + 1) & 7;
+		return true;
+	}
+
+	bool readBits(int count, uint32_t &value)
+	{
+		value = 0;
+		uint32_t bit = 0;
+		for (int i = 0; i < count; ++i) {
+			if (!readBit(bit)) {
+				return false;
+			}
+			value = (value << 1) | bit;
+		}
+		return true;
+	}
+
+	bool skipBits(int count)
+	{
+		uint32_t bit = 0;
+		for (int i = 0; i < count; ++i) {
+			if (!readBit(bit)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool readUe(uint32_t &value)
+	{
+		int leadingZeros = 0;
+		uint32_t bit = 0;
+		while (readBit(bit) && bit == 0) {
+			if (++leadingZeros > 31) {
+				return false;
+			}
+		}
+		if (bit == 0) {
+			return false;
+		}
+		uint32_t suffix = 0;
+		for (int i = 0; i < leadingZeros; ++i) {
+			if (!readBit(bit)) {
+				return false;
+			}
+			suffix = (suffix << 1) | bit;
+		}
+		value = (1u << leadingZeros) - 1 + suffix;
+		return true;
+	}
+
+private:
+	const uint8_t *data_;
+	size_t size_;
+	size_t pos_ = 0;
+	int bitPos_ = 0;
+	int zeros_ = 0;
+	uint8_t current_ = 0;
+};
+
+bool readParameterSetId(const uint8_t *nal, size_t size, size_t offset, uint32_t maxId, uint32_t &id)
+{
+	if (size <= offset) {
+		return false;
+	}
+	BitReader reader(nal + offset, size - offset);
+	return reader.readUe(id) && id <= maxId;
+}
+
+// sps_seq_parameter_set_id follows the variable-length profile_tier_level (H.265 7.3.2.2)
+bool readHevcSpsId(const uint8_t *nal, size_t size, uint32_t &id)
+{
+	if (size <= H265_NAL_HEADER_SIZE) {
+		return false;
+	}
+	BitReader reader(nal + H265_NAL_HEADER_SIZE, size - H265_NAL_HEADER_SIZE);
+	uint32_t maxSubLayersMinus1 = 0;
+	if (!reader.skipBits(4) || !reader.readBits(3, maxSubLayersMinus1) || !reader.skipBits(1) ||
+	    !reader.skipBits(HEVC_GENERAL_PTL_BITS)) {
+		return false;
+	}
+	bool profilePresent[8] = {};
+	bool levelPresent[8] = {};
+	uint32_t flag = 0;
+	for (uint32_t i = 0; i < maxSubLayersMinus1; ++i) {
+		if (!reader.readBits(1, flag)) {
+			return false;
+		}
+		profilePresent[i] = flag != 0;
+		if (!reader.readBits(1, flag)) {
+			return false;
+		}
+		levelPresent[i] = flag != 0;
+	}
+	if (maxSubLayersMinus1 > 0 && !reader.skipBits(2 * (8 - static_cast<int>(maxSubLayersMinus1)))) {
+		return false;
+	}
+	for (uint32_t i = 0; i < maxSubLayersMinus1; ++i) {
+		if ((profilePresent[i] && !reader.skipBits(HEVC_SUB_LAYER_PROFILE_BITS)) ||
+		    (levelPresent[i] && !reader.skipBits(HEVC_SUB_LAYER_LEVEL_BITS))) {
+			return false;
+		}
+	}
+	return reader.readUe(id) && id <= MAX_HEVC_SPS_ID;
+}
+
+void appendUnit(const std::vector<uint8_t> &nal, NalFormat format, std::vector<uint8_t> &out, NalIndex &outNals)
+{
+	out.insert(out.end(), {0x00, 0x00, 0x00, 0x01});
+	NalSpan span;
+	span.type = nalUnitType(nal.data(), format);
+	span.offset = static_cast<uint32_t>(out.size());
+	span.length = static_cast<uint32_t>(nal.size());
+	out.insert(out.end(), nal.begin(), nal.end());
+	outNals.push_back(span);
+}
+
+} // namespace
+
+bool ParameterSetCache::isParameterSet(uint8_t type) const
+{
+	if (format_ == NalFormat::H265) {
+		return type == H265_NAL_VPS || type == H265_NAL_SPS || type == H265_NAL_PPS;
+	}
+	return type == H264_NAL_SPS || type == H264_NAL_PPS;
+}
+
+bool ParameterSetCache::store(const uint8_t *nal, size_t size)
+{
+	const uint8_t type = nalUnitType(nal, format_);
+	std::map<uint32_t, std::vector<uint8_t>> *sets = nullptr;
+	uint32_t id = 0;
+	if (format_ == NalFormat::H265) {
+		if (type == H265_NAL_VPS && size > H265_NAL_HEADER_SIZE) {
+			id = nal[H265_NAL_HEADER_SIZE] >> 4;
+			sets = id <= MAX_HEVC_VPS_ID ? &vps_ : nullptr;
+		} else if (type == H265_NAL_SPS && readHevcSpsId(nal, size, id)) {
+			sets = &sps_;
+		} else if (type == H265_NAL_PPS &&
+		           readParameterSetId(nal, size, H265_NAL_HEADER_SIZE, MAX_HEVC_PPS_ID, id)) {
+			sets = &pps_;
+		}
+	} else if (type == H264_NAL_SPS && readParameterSetId(nal, size, SPS_ID_OFFSET, MAX_SPS_ID, id)) {
+		sets = &sps_;
+	} else if (type == H264_NAL_PPS && readParameterSetId(nal, size, PPS_ID_OFFSET, MAX_PPS_ID, id)) {
+		sets = &pps_;
+	}
+	if (!sets) {
+		return false;
+	}
+
+	std::vector<uint8_t> &stored = (*sets)[id];
+	if (stored.size() == size && std::equal(stored.begin(), stored.end(), nal)) {
+		return false;
+	}
+	stored.assign(nal, nal + size);
+	return true;
+}
+
+bool ParameterSetCache::update(const uint8_t *data, size_t size, const NalIndex &nals)
+{
+	bool changed = false;
+	for (const auto &span : nals) {
+		if (!isParameterSet(span.type) || static_cast<size_t>(span.offset) + span.length > size) {
+			continue;
+		}
+		changed = store(data + span.offset, span.length) || changed;
+	}
+	return changed;
+}
+
+bool ParameterSetCache::updateFromExtraData(const uint8_t *data, size_t size)
+{
+	if (!data || size == 0) {
+		return false;
+	}
+
+	// Configuration records start with version 1; Annex-B starts with a zero byte
+	if (data[0] == 1) {
+		return format_ == NalFormat::H265 ? updateFromHevcConfig(data, size) : updateFromAvcConfig(data, size);
+	}
+
+	NalIndex nals;
+	indexNalUnits(data, size, nals, format_);
+	return update(data, size, nals);
+}
+
+bool ParameterSetCache::updateFromAvcConfig(const uint8_t *data, size_t size)
+{
+	// avcC (ISO/IEC 14496-15): version 1, then 16-bit length-prefixed SPS and PPS lists
+	if (size < 7) {
+		return false;
+	}
+	bool changed = false;
+	size_t pos = 5;
+	for (int list = 0; list < 2 && pos < size; ++list) {
+		const size_t count = list == 0 ? (data[pos] & 0x1F) : data[pos];
+		++pos;
+		for (size_t i = 0; i < count && pos + 2 <= size; ++i) {
+			const size_t length = (static_cast<size_t>(data[pos]) << 8) | data[pos + 1];
+			pos += 2;
+			if (length == 0 || pos + length > size) {
+				return changed;
+			}
+			changed = store(data + pos, length) || changed;
+			pos += length;
+		}
+	}
+	return changed;
+}
+
+bool ParameterSetCache::updateFromHevcConfig(const uint8_t *data, size_t size)
+{
+	// hvcC (ISO/IEC 14496-15 8.3.3): 22-byte header, then arrays of one NAL unit type each,
+	// with a 16-bit count and 16-bit length-prefixed units
+	if (size <= HEVC_CONFIG_HEADER_SIZE) {
+		return false;
+	}
+	bool changed = false;
+	size_t pos = HEVC_CONFIG_HEADER_SIZE;
+	const size_t arrays = data[pos++];
+	for (size_t a = 0; a < arrays && pos + 3 <= size; ++a) {
+		const size_t count = (static_cast<size_t>(data[pos + 1]) << 8) | data[pos + 2];
+		pos += 3;
+		for (size_t i = 0; i < count && pos + 2 <= size; ++i) {
+			const size_t length = (static_cast<size_t>(data[pos]) << 8) | data[pos + 1];
+			pos += 2;
+			if (length == 0 || pos + length > size) {
+				return changed;
+			}
+			changed = store(data + pos, length) || changed;
+			pos += length;
+		}
+	}
+	return changed;
+}
+
+size_t ParameterSetCache::appendMissing(const NalIndex &nals, std::vector<uint8_t> &out, NalIndex &outNals) const
+{
+	const size_t before = out.size();
+	const bool hevc = format_ == NalFormat::H265;
+	if (hevc && !nalIndexHasType(nals, H265_NAL_VPS)) {
+		for (const auto &vps : vps_) {
+			appendUnit(vps.second, format_, out, outNals);
+		}
+	}
+	if (!nalIndexHasType(nals, hevc ? H265_NAL_SPS : H264_NAL_SPS)) {
+		for (const auto &sps : sps_) {
+			appendUnit(sps.second, format_, out, outNals);
+		}
+	}
+	if (!nalIndexHasType(nals, hevc ? H265_NAL_PPS : H264_NAL_PPS)) {
+		for (const auto &pps : pps_) {
+			appendUnit(pps.second, format_, out, outNals);
+		}
+	}
+	return out.size() - before;
+}
+
+void ParameterSetCache::clear()
+{
+	vps_.clear();
+	sps_.clear();
+	pps_.clear();
+}
+
+} // namespace vdoninja
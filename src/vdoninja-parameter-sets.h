@@ -0,0 +1,58 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * H.264/H.265 parameter-set cache
+ *
+ * Keeps the latest video, sequence and picture parameter sets seen in-band or in the
+ * encoder's extra data, so keyframes that start a viewer's stream (GOP-cache
+ * primes, keyframe-request replays) can be made decodable on their own.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "vdoninja-nal-indexer.h"
+
+namespace vdoninja
+{
+
+// Not thread-safe; owned by the encoder-thread send path.
+class ParameterSetCache
+{
+public:
+	explicit ParameterSetCache(NalFormat format = NalFormat::H264) : format_(format) {}
+
+	NalFormat format() const { return format_; }
+
+	// Store VPS/SPS/PPS units found in an indexed Annex-B access unit; returns true if any changed.
+	bool update(const uint8_t *data, size_t size, const NalIndex &nals);
+	// Encoder extra data: Annex-B, or an avcC (H.264) / hvcC (H.265) configuration record.
+	bool updateFromExtraData(const uint8_t *data, size_t size);
+
+	// Append Annex-B copies of the parameter sets the access unit lacks to `out`, and their
+	// spans (offsets relative to the start of `out`) to `outNals`. Returns bytes appended.
+	size_t appendMissing(const NalIndex &nals, std::vector<uint8_t> &out, NalIndex &outNals) const;
+
+	bool complete() const { return (format_ == NalFormat::H264 || !vps_.empty()) && !sps_.empty() && !pps_.empty(); }
+	size_t vpsCount() const { return vps_.size(); }
+	size_t spsCount() const { return sps_.size(); }
+	size_t ppsCount() const { return pps_.size(); }
+	void clear();
+
+private:
+	bool store(const uint8_t *nal, size_t size);
+	bool updateFromAvcConfig(const uint8_t *data, size_t size);
+	bool updateFromHevcConfig(const uint8_t *data, size_t size);
+	bool isParameterSet(uint8_t type) const;
+
+	NalFormat format_;
+	// Keyed by video/seq/pic_parameter_set_id; VPS are H.265 only
+	std::map<uint32_t, std::vector<uint8_t>> vps_;
+	std::map<uint32_t, std::vector<uint8_t>> sps_;
+	std::map<uint32_t, std::vector<uint8_t>> pps_;
+};
+
+} // namespace vdoninja
@@ -5,11 +5,188 @@
 
 #include "vdoninja-peer-manager.h"
 
+#include <algorithm>
 #include <random>
 
 namespace vdoninja
 {
 
+namespace
+{
+
+constexpr uint8_t kVideoPayloadType = 96;
+constexpr uint8_t kOpusPayloadType = 111;
+constexpr uint8_t kRtxPayloadType = 97;
+constexpr uint8_t kFlexfecPayloadType = 98;
+constexpr uint8_t kRedPayloadType = 63;
+// H.264 offered next to H.265 for viewers that cannot decode it, with its own RTX mapping
+constexpr uint8_t kFallbackVideoPayloadType = 102;
+constexpr uint8_t kFallbackRtxPayloadType = 103;
+// Main profile, main tier, level 5.1: enough for 2160p60
+constexpr const char *kH265Fmtp = "profile-id=1;tier-flag=0;level-id=153;tx-mode=SRST";
+// libdatachannel's default Opus parameters, plus DTX so receivers expect silence suppression
+constexpr const char *kOpusFmtp = "minptime=10;maxaveragebitrate=96000;stereo=1;sprop-stereo=1;useinbandfec=1;usedtx=1";
+// H.264, H.265, VP8, VP9 and AV1 all use a 90 kHz RTP clock
+constexpr uint32_t kVideoClockRate = 90000;
+
+uint32_t randomRtpField(uint32_t max)
+{
+	static std::mt19937 gen(std::random_device{}());
+	static std::mutex genMutex;
+	std::lock_guard<std::mutex> lock(genMutex);
+	return std::uniform_int_distribution<uint32_t>(0, max)(gen);
+}
+
+uint16_t randomRtpSequence()
+{
+	return static_cast<uint16_t>(randomRtpField(0xFFFF));
+}
+
+uint32_t randomRtpTimestamp()
+{
+	return randomRtpField(0xFFFFFFFF);
+}
+
+// Hands viewer RTCP (REMB, receiver reports, NACK, PLI/FIR) to the peer manager.
+// Messages are passed on unchanged to the rest of the chain. Packets given to
+// `send` go straight to the transport, bypassing the sender report counters.
+class RtcpFeedbackHandler final : public rtc::MediaHandler
+{
+public:
+	using Callback = std::function<void(const RtcpFeedback &feedback, const rtc::message_callback &send)>;
+
+	explicit RtcpFeedbackHandler(Callback callback) : callback_(std::move(callback)) {}
+
+	void incoming(rtc::message_vector &messages, const rtc::message_callback &send) override
+	{
+		for (const auto &message : messages) {
+			if (!message || message->type != rtc::Message::Control) {
+				continue;
+			}
+			RtcpFeedback feedback;
+			if (parseRtcp(reinterpret_cast<const uint8_t *>(message->data()), message->size(), feedback) &&
+			    !feedback.empty()) {
+				callback_(feedback, send);
+			}
+		}
+	}
+
+private:
+	Callback callback_;
+};
+
+RtpPayloadFormat videoPayloadFormat(VideoCodec codec)
+{
+	switch (codec) {
+	case VideoCodec::VP8:
+		return RtpPayloadFormat::VP8;
+	case VideoCodec::VP9:
+		return RtpPayloadFormat::VP9;
+	case VideoCodec::AV1:
+		return RtpPayloadFormat::AV1;
+	case VideoCodec::H265:
+		return RtpPayloadFormat::H265;
+	case VideoCodec::H264:
+		break;
+	}
+	return RtpPayloadFormat::H264;
+}
+
+NalFormat nalFormat(VideoCodec codec)
+{
+	return codec == VideoCodec::H265 ? NalFormat::H265 : NalFormat::H264;
+}
+
+// Summarize what a departed viewer's per-viewer controllers did while it was connected
+void logDepartedViewerStats(const PeerInfo &peer)
+{
+	if (peer.congestion) {
+		const CongestionStats stats = peer.congestion->stats();
+		if (stats.droppedFrames > 0) {
+			logInfo("Viewer %s left after %llu congestion episode(s), %llu video frame(s) dropped",
+			        peer.uuid.c_str(), static_cast<unsigned long long>(stats.congestionEvents),
+			        static_cast<unsigned long long>(stats.droppedFrames));
+		}
+	}
+	if (peer.videoRtx) {
+		const RtxStats stats = peer.videoRtx->stats();
+		if (stats.requestedPackets > 0) {
+			logInfo("Viewer %s NACKed %llu packet(s); %llu retransmitted, %llu no longer in history",
+			        peer.uuid.c_str(), static_cast<unsigned long long>(stats.requestedPackets),
+			        static_cast<unsigned long long>(stats.retransmittedPackets),
+			        static_cast<unsigned long long>(stats.missedPackets));
+		}
+	}
+	if (peer.audioRed) {
+		const OpusRedStats stats = peer.audioRed->stats();
+		if (stats.redPackets > 0) {
+			logInfo("Viewer %s audio RED: %llu activation(s), %llu packet(s) sent with redundancy",
+			        peer.uuid.c_str(), static_cast<unsigned long long>(stats.activations),
+			        static_cast<unsigned long long>(stats.redPackets));
+		}
+	}
+	if (peer.fec) {
+		const FecStats stats = peer.fec->stats();
+		if (stats.protectedFrames > 0) {
+			logInfo("Viewer %s FlexFEC: %llu activation(s), %llu frame(s) protected, %llu parity "
+			        "packet(s) for %llu media packet(s)",
+			        peer.uuid.c_str(), static_cast<unsigned long long>(stats.activations),
+			        static_cast<unsigned long long>(stats.protectedFrames),
+			        static_cast<unsigned long long>(stats.fecPackets),
+			        static_cast<unsigned long long>(stats.mediaPackets));
+		}
+	}
+	if (peer.svc) {
+		const SvcStats stats = peer.svc->stats();
+		if (stats.droppedFrames + stats.reducedFrames > 0) {
+			logInfo("Viewer %s SVC: %llu frame(s) skipped, %llu sent without upper spatial layers",
+			        peer.uuid.c_str(), static_cast<unsigned long long>(stats.droppedFrames),
+			        static_cast<unsigned long long>(stats.reducedFrames));
+		}
+	}
+	if (peer.mediaGate) {
+		const MediaGateStats stats = peer.mediaGate->stats();
+		if (stats.skippedAudioFrames + stats.skippedVideoFrames > 0) {
+			logInfo("Viewer %s left after %llu audio and %llu video frame(s) held back, %llu video "
+			        "resume(s)",
+			        peer.uuid.c_str(), static_cast<unsigned long long>(stats.skippedAudioFrames),
+			        static_cast<unsigned long long>(stats.skippedVideoFrames),
+			        static_cast<unsigned long long>(stats.videoResumes));
+		}
+	}
+	if (peer.mtu) {
+		const MtuStats stats = peer.mtu->stats();
+		if (stats.probes > 0) {
+			logInfo("Viewer %s MTU probing: %llu probe(s), %llu failed, settled on %zu-byte payloads",
+			        peer.uuid.c_str(), static_cast<unsigned long long>(stats.probes),
+			        static_cast<unsigned long long>(stats.probeFailures), rtpPayloadForTier(stats.tier));
+		}
+	}
+}
+
+// Detach callbacks first so a closing connection cannot call back into the manager;
+// callers must not hold peersMutex_, since close() can fire callbacks synchronously.
+void closePeerConnections(const std::vector<std::shared_ptr<PeerInfo>> &peers)
+{
+	for (const auto &peer : peers) {
+		if (peer->dataChannel) {
+			peer->dataChannel->resetCallbacks();
+		}
+		if (peer->audioTrack) {
+			peer->audioTrack->resetCallbacks();
+		}
+		if (peer->videoTrack) {
+			peer->videoTrack->resetCallbacks();
+		}
+		if (peer->pc) {
+			peer->pc->resetCallbacks();
+			peer->pc->close();
+		}
+	}
+}
+
+} // namespace
+
 VDONinjaPeerManager::VDONinjaPeerManager()
 {
 	// Generate random SSRCs for audio/video
@@ -19,6 +196,13 @@ VDONinjaPeerManager::VDONinjaPeerManager()
 
 	audioSsrc_ = dis(gen);
 	videoSsrc_ = dis(gen);
+	rtxSsrc_ = dis(gen);
+	fecSsrc_ = dis(gen);
+
+	audioPacketizer_ = std::make_unique<RtpPacketizer>(RtpPayloadFormat::Opus, audioSsrc_, kOpusPayloadType);
+	flexfec_ = std::make_unique<FlexfecEncoder>(fecSsrc_, kFlexfecPayloadType, videoSsrc_);
+	opusRed_ = std::make_unique<OpusRedEncoder>(audioSsrc_, kRedPayloadType, kOpusPayloadType);
+	rebuildVideoLayers();
 
 	logInfo("Peer manager created with audio SSRC: %u, video SSRC: %u", audioSsrc_, videoSsrc_);
 }
@@ -28,13 +212,16 @@ VDONinjaPeerManager::~VDONinjaPeerManager()
 	stopPublishing();
 
 	// Close all peer connections
-	std::lock_guard<std::mutex> lock(peersMutex_);
-	for (auto &pair : peers_) {
-		if (pair.second->pc) {
-			pair.second->pc->close();
+	std::vector<std::shared_ptr<PeerInfo>> closing;
+	{
+		std::lock_guard<std::mutex> lock(peersMutex_);
+		for (auto &pair : peers_) {
+			closing.push_back(pair.second);
 		}
+		peers_.clear();
+		refreshActiveViewersLocked();
 	}
-	peers_.clear();
+	closePeerConnections(closing);
 }
 
 void VDONinjaPeerManager::initialize(VDONinjaSignaling *signaling)
@@ -105,6 +292,22 @@ bool VDONinjaPeerManager::startPublishing(int maxViewers)
 	}
 
 	maxViewers_ = maxViewers;
+	// Workers are idle here, so packetizers and caches can follow this session's codec and layers.
+	rebuildVideoLayers();
+	// Random starting timestamps per stream; both follow one anchor from the first packet
+	mediaClock_.reset(randomRtpTimestamp(), randomRtpTimestamp());
+	opusRed_->reset();
+	const bool layeredCodec = videoCodec_ == VideoCodec::VP9 || videoCodec_ == VideoCodec::AV1;
+	svcActive_ = svcEnabled_ && layeredCodec && primaryLayerCount_ == 1;
+	if (svcEnabled_ && !svcActive_) {
+		logWarning(layeredCodec ? "SVC is not combined with simulcast; sending simulcast layers"
+		                        : "SVC needs VP9 or AV1; sending every frame to every viewer");
+	}
+	svcSpatialLayers_.store(1, std::memory_order_relaxed);
+	svcTemporalLayers_.store(1, std::memory_order_relaxed);
+	sendPool_.setLaneCapacity(GopCache::laneCapacityFor(gopMaxFrames_));
+	sendPool_.start();
+	pacer_.start();
 	publishing_ = true;
 
 	logInfo("Started publishing, max viewers: %d", maxViewers);
@@ -118,18 +321,35 @@ void VDONinjaPeerManager::stopPublishing()
 
 	publishing_ = false;
 
+	// Drain workers before tearing down the tracks they send on
+	sendPool_.stop();
+	pacer_.stop();
+	{
+		std::lock_guard<std::mutex> lock(gopMutex_);
+		for (auto &layer : videoLayers_) {
+			layer->gopCache.clear();
+		}
+	}
+
 	// Close all viewer connections
-	std::lock_guard<std::mutex> lock(peersMutex_);
-	auto it = peers_.begin();
-	while (it != peers_.end()) {
-		if (it->second->type == ConnectionType::Publisher) {
-			if (it->second->pc) {
-				it->second->pc->close();
+	std::vector<std::shared_ptr<PeerInfo>> closing;
+	std::vector<std::shared_ptr<PeerInfo>> departed;
+	{
+		std::lock_guard<std::mutex> lock(peersMutex_);
+		auto it = peers_.begin();
+		while (it != peers_.end()) {
+			if (it->second->type == ConnectionType::Publisher) {
+				closing.push_back(it->second);
+				it = peers_.erase(it);
+			} else {
+				++it;
 			}
-			it = peers_.erase(it);
-		} else {
-			++it;
 		}
+		departed = refreshActiveViewersLocked();
+	}
+	closePeerConnections(closing);
+	for (const auto &peer : departed) {
+		logDepartedViewerStats(*peer);
 	}
 
 	logInfo("Stopped publishing");
@@ -142,14 +362,8 @@ bool VDONinjaPeerManager::isPublishing() const
 
 int VDONinjaPeerManager::getViewerCount() const
 {
-	std::lock_guard<std::mutex> lock(peersMutex_);
-	int count = 0;
-	for (const auto &pair : peers_) {
-		if (pair.second->type == ConnectionType::Publisher && pair.second->state == ConnectionState::Connected) {
-			count++;
-		}
-	}
-	return count;
+	auto viewers = activeViewers_.load();
+	return viewers ? static_cast<int>(viewers->size()) : 0;
 }
 
 int VDONinjaPeerManager::getPublisherSlotCount() const
@@ -167,6 +381,100 @@ int VDONinjaPeerManager::getPublisherSlotCount() const
 	return count;
 }
 
+void VDONinjaPeerManager::refreshActiveViewers()
+{
+	std::vector<std::shared_ptr<PeerInfo>> departed;
+	{
+		std::lock_guard<std::mutex> lock(peersMutex_);
+		departed = refreshActiveViewersLocked();
+	}
+	for (const auto &peer : departed) {
+		logDepartedViewerStats(*peer);
+	}
+}
+
+std::vector<std::shared_ptr<PeerInfo>> VDONinjaPeerManager::refreshActiveViewersLocked()
+{
+	std::vector<std::shared_ptr<PeerInfo>> departed;
+	auto previous = activeViewers_.load();
+	auto viewers = std::make_shared<ViewerSet>();
+	viewers->reserve(peers_.size());
+	for (const auto &pair : peers_) {
+		if (pair.second->type == ConnectionType::Publisher && pair.second->state == ConnectionState::Connected) {
+			viewers->push_back(pair.second);
+		}
+	}
+
+	// Keep one send lane per active viewer; retire lanes of peers that left before adding new ones,
+	// so a reconnecting UUID gets a lane bound to its new PeerInfo.
+	if (previous) {
+		for (const auto &peer : *previous) {
+			if (std::find(viewers->begin(), viewers->end(), peer) == viewers->end()) {
+				sendPool_.removeLane(peer->uuid);
+				pacer_.removeStream(peer->pacedStream);
+				keyframeArbiter_.removeViewer(peer->uuid);
+				departed.push_back(peer);
+			}
+		}
+	}
+	for (const auto &peer : *viewers) {
+		if (!sendPool_.hasLane(peer->uuid)) {
+			std::weak_ptr<PeerInfo> weakPeer = peer;
+			const SendPath path = selectSendPath(*peer);
+			auto sink = [this, weakPeer, path](const OutboundFrame &frame) {
+				if (auto target = weakPeer.lock()) {
+					deliverFrame(*target, frame, frame.kind == MediaKind::Audio ? path.audio : path.video);
+				}
+			};
+
+			if (pacingPercent_ > 0) {
+				if (!peer->pacedStream) {
+					auto packetSink = [this, weakPeer](MediaKind kind, const uint8_t *data, size_t size) {
+						auto target = weakPeer.lock();
+						if (!target || target->state.load(std::memory_order_acquire) != ConnectionState::Connected) {
+							return;
+						}
+						auto track = kind == MediaKind::Audio ? target->audioTrack : target->videoTrack;
+						if (track) {
+							stampSenderReportClock(*target, kind);
+							track->send(reinterpret_cast<const std::byte *>(data), size);
+						}
+					};
+					peer->pacedStream =
+					    std::make_shared<PacedStream>(std::move(packetSink), pacingRateFor(videoLayerFor(*peer)));
+				}
+				pacer_.addStream(peer->pacedStream);
+			}
+
+			// Only the viewer's selected simulcast layer, or the H.264 fallback, enters its lane
+			OutboundFrameFilter filter;
+			auto selector = peer->layerSelector;
+			if (selector && primaryLayerCount_ > 1 && !peer->h264Fallback) {
+				filter = [selector](const OutboundFrame &frame) { return selector->accept(frame); };
+			} else if (videoLayers_.size() > 1) {
+				filter = [layer = videoLayerFor(*peer)](const OutboundFrame &frame) {
+					return frame.kind != MediaKind::Video || frame.layer == layer;
+				};
+			}
+
+			// New viewers start with the cached GOP so they can decode right away.
+			// Holding gopMutex_ keeps the burst and the live stream free of gaps.
+			std::lock_guard<std::mutex> gopLock(gopMutex_);
+			const FrameList primer = videoLayers_[videoLayerFor(*peer)]->gopCache.snapshot();
+			if (peer->congestion) {
+				peer->congestion->exempt(primer.size());
+			}
+			sendPool_.addLane(peer->uuid, std::move(sink), primer, std::move(filter), path.group);
+			if (!primer.empty()) {
+				logInfo("Primed %s with %zu cached GOP frame(s)", peer->uuid.c_str(), primer.size());
+			}
+		}
+	}
+
+	activeViewers_.store(std::move(viewers));
+	return departed;
+}
+
 std::shared_ptr<PeerInfo> VDONinjaPeerManager::createPublisherConnection(const std::string &uuid)
 {
 	auto config = getRtcConfig();
@@ -232,6 +540,10 @@ void VDONinjaPeerManager::setupPeerConnectionCallbacks(std::shared_ptr<PeerInfo>
 			break;
 		case rtc::PeerConnection::State::Connected:
 			peer->state = ConnectionState::Connected;
+			if (peer->type == ConnectionType::Publisher) {
+				applyPathMtu(*peer);
+			}
+			refreshActiveViewers();
 			logInfo("Peer %s connected", uuid.c_str());
 			if (onPeerConnected_) {
 				onPeerConnected_(uuid);
@@ -239,6 +551,7 @@ void VDONinjaPeerManager::setupPeerConnectionCallbacks(std::shared_ptr<PeerInfo>
 			break;
 		case rtc::PeerConnection::State::Disconnected:
 			peer->state = ConnectionState::Disconnected;
+			refreshActiveViewers();
 			logInfo("Peer %s disconnected", uuid.c_str());
 			if (onPeerDisconnected_) {
 				onPeerDisconnected_(uuid);
@@ -246,6 +559,7 @@ void VDONinjaPeerManager::setupPeerConnectionCallbacks(std::shared_ptr<PeerInfo>
 			break;
 		case rtc::PeerConnection::State::Failed:
 			peer->state = ConnectionState::Failed;
+			refreshActiveViewers();
 			logError("Peer %s connection failed", uuid.c_str());
 			if (onPeerDisconnected_) {
 				onPeerDisconnected_(uuid);
@@ -253,6 +567,7 @@ void VDONinjaPeerManager::setupPeerConnectionCallbacks(std::shared_ptr<PeerInfo>
 			break;
 		case rtc::PeerConnection::State::Closed:
 			peer->state = ConnectionState::Closed;
+			refreshActiveViewers();
 			logInfo("Peer %s closed", uuid.c_str());
 			break;
 		}
@@ -337,61 +652,143 @@ void VDONinjaPeerManager::setupPublisherTracks(std::shared_ptr<PeerInfo> peer)
 	// Configure based on selected codec
 	switch (videoCodec_) {
 	case VideoCodec::H264:
-		videoDesc.addH264Codec(96);
+		videoDesc.addH264Codec(kVideoPayloadType);
 		break;
 	case VideoCodec::VP8:
-		videoDesc.addVP8Codec(96);
+		videoDesc.addVP8Codec(kVideoPayloadType);
 		break;
 	case VideoCodec::VP9:
-		videoDesc.addVP9Codec(96);
+		videoDesc.addVP9Codec(kVideoPayloadType);
 		break;
 	case VideoCodec::AV1:
-		// AV1 support depends on libdatachannel version
-		videoDesc.addH264Codec(96); // Fallback
+		videoDesc.addAV1Codec(kVideoPayloadType);
 		break;
+	case VideoCodec::H265:
+		videoDesc.addH265Codec(kVideoPayloadType, std::string(kH265Fmtp));
+		break;
+	}
+	const bool offerFallback = videoLayers_.size() > primaryLayerCount_;
+	if (offerFallback) {
+		videoDesc.addH264Codec(kFallbackVideoPayloadType);
+	}
+
+	// RTX (RFC 4588) retransmission stream paired with the video SSRC
+	rtc::Description::Media::RtpMap rtxMap(kRtxPayloadType);
+	rtxMap.format = "rtx";
+	rtxMap.clockRate = kVideoClockRate;
+	rtxMap.addParameter("apt=" + std::to_string(kVideoPayloadType));
+	videoDesc.addRtpMap(rtxMap);
+	if (offerFallback) {
+		rtc::Description::Media::RtpMap fallbackRtxMap(kFallbackRtxPayloadType);
+		fallbackRtxMap.format = "rtx";
+		fallbackRtxMap.clockRate = kVideoClockRate;
+		fallbackRtxMap.addParameter("apt=" + std::to_string(kFallbackVideoPayloadType));
+		videoDesc.addRtpMap(fallbackRtxMap);
+	}
+	videoDesc.addAttribute("ssrc-group:FID " + std::to_string(videoSsrc_) + " " + std::to_string(rtxSsrc_));
+
+	// FlexFEC stream protecting the video SSRC, offered only when enabled
+	if (fecEnabled_) {
+		rtc::Description::Media::RtpMap fecMap(kFlexfecPayloadType);
+		fecMap.format = "flexfec-03";
+		fecMap.clockRate = kVideoClockRate;
+		fecMap.addParameter("repair-window=10000000");
+		videoDesc.addRtpMap(fecMap);
+		videoDesc.addAttribute("ssrc-group:FEC-FR " + std::to_string(videoSsrc_) + " " + std::to_string(fecSsrc_));
 	}
 
 	videoDesc.addSSRC(videoSsrc_, "video-stream");
+	videoDesc.addSSRC(rtxSsrc_, "video-stream");
+	if (fecEnabled_) {
+		videoDesc.addSSRC(fecSsrc_, "video-stream");
+	}
 	peer->videoTrack = peer->pc->addTrack(videoDesc);
 
 	// Set up audio track
 	rtc::Description::Audio audioDesc("audio", rtc::Description::Direction::SendOnly);
-	audioDesc.addOpusCodec(111);
+	audioDesc.addOpusCodec(kOpusPayloadType, std::string(kOpusFmtp));
+	// RFC 2198 redundancy with Opus blocks, sent instead of plain Opus while the viewer reports loss
+	if (audioRedEnabled_) {
+		rtc::Description::Media::RtpMap redMap(kRedPayloadType);
+		redMap.format = "red";
+		redMap.clockRate = rtc::OpusRtpPacketizer::DefaultClockRate;
+		redMap.encParams = "2";
+		redMap.addParameter(std::to_string(kOpusPayloadType) + "/" + std::to_string(kOpusPayloadType));
+		audioDesc.addRtpMap(redMap);
+	}
 	audioDesc.addSSRC(audioSsrc_, "audio-stream");
 	peer->audioTrack = peer->pc->addTrack(audioDesc);
 
-	// Prefer libdatachannel packetizers when available, with fallback to manual RTP.
+	peer->audioSequencer = std::make_shared<RtpSequencer>(randomRtpSequence());
+	peer->videoSequencer = std::make_shared<RtpSequencer>(randomRtpSequence());
+	peer->videoHistory = std::make_shared<RtpHistory>();
+	peer->videoRtx = std::make_shared<RtxStream>(rtxSsrc_, kRtxPayloadType, randomRtpSequence());
+	if (audioRedEnabled_) {
+		peer->audioRed = std::make_shared<OpusRedController>();
+	}
+	if (fecEnabled_) {
+		peer->fec = std::make_shared<FecController>();
+		peer->fecSequencer = std::make_shared<RtpSequencer>(randomRtpSequence());
+	}
+
+	std::vector<int> layerBitrates;
+	for (size_t i = 0; i < primaryLayerCount_; ++i) {
+		layerBitrates.push_back(videoLayers_[i]->config.bitrate);
+	}
+	peer->layerSelector = std::make_shared<SimulcastLayerSelector>(std::move(layerBitrates));
+	if (svcActive_) {
+		peer->svc = std::make_shared<SvcLayerSelector>();
+	}
+	peer->bandwidth = std::make_shared<BandwidthEstimator>(bitrate_);
+	peer->congestion = std::make_shared<CongestionGate>(congestionThresholds_);
+	peer->mediaGate = std::make_shared<ViewerMediaGate>(tallyGating_);
+	// A fixed size applies as-is; automatic sizing starts at the default and follows the ICE path once connected
+	peer->mtu = std::make_shared<MtuController>(rtpMtuTierForPayload(static_cast<size_t>(rtpMtu_)),
+	                                            rtpMtu_ == 0 && rtpMtuProbing_);
+
+	// Media is packetized once by the shared stage; each track only runs the RTCP
+	// handlers and stamps its own sequence numbers. Without the RTCP chain the same
+	// packets are sent as-is, just without sender reports or retransmission.
 	try {
-		auto audioConfig = std::make_shared<rtc::RtpPacketizationConfig>(audioSsrc_, "vdoninja", 111,
+		auto audioConfig = std::make_shared<rtc::RtpPacketizationConfig>(audioSsrc_, "vdoninja", kOpusPayloadType,
 		                                                                 rtc::OpusRtpPacketizer::DefaultClockRate);
-		auto audioPacketizer = std::make_shared<rtc::OpusRtpPacketizer>(audioConfig);
+		audioConfig->startTimestamp = mediaClock_.audioOffset();
+		audioConfig->timestamp = mediaClock_.audioTimestampAt(MediaSendPool::nowUs());
 		peer->audioSrReporter = std::make_shared<rtc::RtcpSrReporter>(audioConfig);
-		audioPacketizer->addToChain(peer->audioSrReporter);
-		audioPacketizer->addToChain(std::make_shared<rtc::RtcpNackResponder>());
-		peer->audioTrack->setMediaHandler(audioPacketizer);
-		peer->useAudioPacketizer = true;
+		peer->audioSrReporter->addToChain(std::make_shared<rtc::RtcpNackResponder>());
+		std::weak_ptr<PeerInfo> weakPeer = peer;
+		peer->audioSrReporter->addToChain(std::make_shared<RtcpFeedbackHandler>(
+		    [this, weakPeer](const RtcpFeedback &feedback, const rtc::message_callback &) {
+			    if (auto target = weakPeer.lock()) {
+				    onAudioFeedback(*target, feedback);
+			    }
+		    }));
+		peer->audioTrack->setMediaHandler(peer->audioSrReporter);
+		peer->hasAudioRtcpChain = true;
 	} catch (const std::exception &ex) {
-		logWarning("Audio packetizer unavailable; using manual RTP for %s: %s", peer->uuid.c_str(), ex.what());
-		peer->useAudioPacketizer = false;
+		logWarning("Audio RTCP chain unavailable; sending without RTCP for %s: %s", peer->uuid.c_str(), ex.what());
+		peer->hasAudioRtcpChain = false;
 	}
 
-	if (videoCodec_ == VideoCodec::H264) {
-		try {
-			auto videoConfig = std::make_shared<rtc::RtpPacketizationConfig>(videoSsrc_, "vdoninja", 96,
-			                                                                 rtc::H264RtpPacketizer::defaultClockRate);
-			auto videoPacketizer = std::make_shared<rtc::H264RtpPacketizer>(
-			    rtc::H264RtpPacketizer::Separator::StartSequence, videoConfig, 1200);
-			peer->videoSrReporter = std::make_shared<rtc::RtcpSrReporter>(videoConfig);
-			videoPacketizer->addToChain(peer->videoSrReporter);
-			videoPacketizer->addToChain(std::make_shared<rtc::RtcpNackResponder>(4000));
-			peer->videoTrack->setMediaHandler(videoPacketizer);
-			peer->useVideoPacketizer = true;
-		} catch (const std::exception &ex) {
-			logWarning("Video packetizer unavailable; using manual RTP for %s: %s", peer->uuid.c_str(), ex.what());
-			peer->useVideoPacketizer = false;
-		}
-	} else {
-		peer->useVideoPacketizer = false;
+	try {
+		auto videoConfig =
+		    std::make_shared<rtc::RtpPacketizationConfig>(videoSsrc_, "vdoninja", kVideoPayloadType, kVideoClockRate);
+		videoConfig->startTimestamp = mediaClock_.videoOffset();
+		videoConfig->timestamp = mediaClock_.videoTimestampAt(MediaSendPool::nowUs());
+		peer->videoSrReporter = std::make_shared<rtc::RtcpSrReporter>(videoConfig);
+		// NACKs are answered from the shared retransmission history by the feedback handler
+		std::weak_ptr<PeerInfo> weakPeer = peer;
+		peer->videoSrReporter->addToChain(std::make_shared<RtcpFeedbackHandler>(
+		    [this, weakPeer](const RtcpFeedback &feedback, const rtc::message_callback &send) {
+			    if (auto target = weakPeer.lock()) {
+				    onViewerFeedback(*target, feedback, send);
+			    }
+		    }));
+		peer->videoTrack->setMediaHandler(peer->videoSrReporter);
+		peer->hasVideoRtcpChain = true;
+	} catch (const std::exception &ex) {
+		logWarning("Video RTCP chain unavailable; sending without RTCP for %s: %s", peer->uuid.c_str(), ex.what());
+		peer->hasVideoRtcpChain = false;
 	}
 
 	// Create data channel if enabled
@@ -477,9 +874,29 @@ void VDONinjaPeerManager::onSignalingAnswer(const std::string &uuid, const std::
 		return;
 	}
 
+	// A viewer that cannot decode H.265 gets the H.264 fallback layer, with retransmissions
+	// on its RTX payload type. Decided before the connection comes up and its lane is created.
+	uint8_t rtxPayloadType = kRtxPayloadType;
+	if (videoCodec_ == VideoCodec::H265 && !sdpHasPayloadFormat(sdp, kVideoPayloadType, "H265")) {
+		if (videoLayers_.size() > primaryLayerCount_ && sdpHasPayloadFormat(sdp, kFallbackVideoPayloadType, "H264")) {
+			rtxPayloadType = kFallbackRtxPayloadType;
+			peer->videoRtx = std::make_shared<RtxStream>(rtxSsrc_, rtxPayloadType, randomRtpSequence());
+			peer->h264Fallback = true;
+			logInfo("Viewer %s cannot receive H.265; sending the H.264 fallback", uuid.c_str());
+		} else {
+			logWarning("Viewer %s accepted neither H.265 nor an H.264 fallback; it will not get video",
+			           uuid.c_str());
+		}
+	}
+
 	// Set remote description (the answer)
 	peer->pc->setRemoteDescription(rtc::Description(sdp, rtc::Description::Type::Answer));
-	logInfo("Set remote answer for %s", uuid.c_str());
+	peer->rtxNegotiated = sdpHasRtxPayload(sdp, rtxPayloadType);
+	peer->fecNegotiated = peer->fec && sdpHasPayloadFormat(sdp, kFlexfecPayloadType, "flexfec-03");
+	peer->redNegotiated = peer->audioRed && sdpHasPayloadFormat(sdp, kRedPayloadType, "red");
+	logInfo("Set remote answer for %s (RTX %s, FlexFEC %s, audio RED %s)", uuid.c_str(),
+	        peer->rtxNegotiated ? "on" : "off", peer->fecNegotiated ? "on" : "off",
+	        peer->redNegotiated ? "on" : "off");
 }
 
 void VDONinjaPeerManager::onSignalingOfferRequest(const std::string &uuid, const std::string &session)
@@ -508,6 +925,9 @@ void VDONinjaPeerManager::onSignalingOfferRequest(const std::string &uuid, const
 			logWarning("Rejecting offer request from %s - max viewers reached (%d)", uuid.c_str(), maxViewers_);
 			return;
 		}
+		if (onViewerRequested_) {
+			onViewerRequested_(uuid);
+		}
 		peer = createPublisherConnection(uuid);
 	}
 
@@ -577,128 +997,775 @@ void VDONinjaPeerManager::bundleAndSendCandidates(const std::string &uuid)
 	logDebug("Sent %zu bundled ICE candidates to %s", bundle.candidates.size(), uuid.c_str());
 }
 
+void VDONinjaPeerManager::sendRtpFrame(rtc::Track &track, RtpSequencer &sequencer, const RtpFrame &frame)
+{
+	for (size_t i = 0; i < frame.packetCount(); ++i) {
+		size_t packetSize = 0;
+		const uint8_t *packet = sequencer.stamp(frame, i, packetSize);
+		track.send(reinterpret_cast<const std::byte *>(packet), packetSize);
+	}
+}
+
+std::shared_ptr<const RtpFrame> VDONinjaPeerManager::protectFrame(PeerInfo &peer, const RtpFrame &frame,
+                                                                 uint16_t firstSequence)
+{
+	auto fec = peer.fec;
+	if (!fec || !peer.fecSequencer || !peer.fecNegotiated.load(std::memory_order_relaxed)) {
+		return nullptr;
+	}
+	const double ratio = fec->protectionRatio();
+	if (ratio <= 0.0) {
+		return nullptr;
+	}
+	auto repair = flexfec_->protect(frame, firstSequence, ratio);
+	fec->countFrame(frame.packetCount(), repair ? repair->packetCount() : 0);
+	return repair;
+}
+
+void VDONinjaPeerManager::stampSenderReportClock(PeerInfo &peer, MediaKind kind) const
+{
+	// Sender reports pair the current wall clock with the config timestamp, so it must be
+	// the RTP time of "now" on the shared timeline rather than the last frame's capture time.
+	if (kind == MediaKind::Audio) {
+		if (peer.hasAudioRtcpChain && peer.audioSrReporter) {
+			peer.audioSrReporter->rtpConfig->timestamp = mediaClock_.audioTimestampAt(MediaSendPool::nowUs());
+		}
+	} else if (peer.hasVideoRtcpChain && peer.videoSrReporter) {
+		peer.videoSrReporter->rtpConfig->timestamp = mediaClock_.videoTimestampAt(MediaSendPool::nowUs());
+	}
+}
+
 void VDONinjaPeerManager::sendAudioFrame(const uint8_t *data, size_t size, uint32_t timestamp)
 {
-	if (!publishing_)
+	if (!publishing_ || !data || size == 0)
 		return;
 
-	std::lock_guard<std::mutex> lock(peersMutex_);
+	uint32_t ts = timestamp ? timestamp : audioTimestamp_;
+	audioTimestamp_ = ts + 960; // 48kHz, 20ms frames
+	enqueueAudioFrame(EncodedPacket::copy(data, size), ts);
+}
 
-	for (auto &pair : peers_) {
-		auto &peer = pair.second;
-		if (peer->type != ConnectionType::Publisher || peer->state != ConnectionState::Connected) {
-			continue;
-		}
+void VDONinjaPeerManager::sendAudioFrame(EncodedPacketRef packet)
+{
+	if (!publishing_ || !packet || packet->size() == 0)
+		return;
+	const uint32_t ts = mediaClock_.audioTimestamp(packet->info(), MediaSendPool::nowUs());
+	enqueueAudioFrame(std::move(packet), ts);
+}
 
-		// Get the audio track and send data
-		// The actual RTP packetization would be more complex
-		// This is a simplified version
-		try {
-			auto track = peer->audioTrack;
-			if (!track) {
-				continue;
+void VDONinjaPeerManager::enqueueAudioFrame(EncodedPacketRef packet, uint32_t ts)
+{
+	auto viewers = activeViewers_.load();
+	if (!viewers || viewers->empty())
+		return;
+
+	auto frame = std::make_shared<OutboundFrame>();
+	frame->kind = MediaKind::Audio;
+	frame->packet = std::move(packet);
+	frame->timestamp = ts;
+	if (audioRedEnabled_) {
+		frame->red = opusRed_->encode(frame->data(), frame->size(), ts);
+	}
+	frame->enqueuedAtUs = MediaSendPool::nowUs();
+	sendPool_.enqueue(std::move(frame));
+}
+
+void VDONinjaPeerManager::sendVideoFrame(const uint8_t *data, size_t size, uint32_t timestamp, bool keyframe,
+                                         size_t layer, const NalIndex *nals)
+{
+	if (!publishing_ || !data || size == 0 || layer >= videoLayers_.size())
+		return;
+
+	VideoLayer &videoLayer = *videoLayers_[layer];
+	uint32_t ts = timestamp ? timestamp : videoLayer.nextTimestamp;
+	videoLayer.nextTimestamp = ts + 3000; // 90kHz clock, ~30fps
+	enqueueVideoFrame(EncodedPacket::copy(data, size), ts, keyframe, layer, nals);
+}
+
+void VDONinjaPeerManager::sendVideoFrame(EncodedPacketRef packet, bool keyframe, size_t layer, const NalIndex *nals)
+{
+	if (!publishing_ || !packet || packet->size() == 0 || layer >= videoLayers_.size())
+		return;
+	// Every simulcast layer encodes the same frames, so they share one clock
+	const uint32_t ts = mediaClock_.videoTimestamp(packet->info(), MediaSendPool::nowUs());
+	enqueueVideoFrame(std::move(packet), ts, keyframe, layer, nals);
+}
+
+void VDONinjaPeerManager::enqueueVideoFrame(EncodedPacketRef packet, uint32_t ts, bool keyframe, size_t layer,
+                                            const NalIndex *nals)
+{
+	VideoLayer &videoLayer = *videoLayers_[layer];
+	auto frame = std::make_shared<OutboundFrame>();
+	frame->kind = MediaKind::Video;
+	if (nals) {
+		const uint8_t *data = packet->data();
+		const size_t size = packet->size();
+		// IDR/IRAP pictures without in-band parameter sets get the cached copies prepended, so
+		// GOP-cache starts and replayed keyframes are decodable on their own. Only those are copied.
+		videoLayer.parameterSets.update(data, size, *nals);
+		std::vector<uint8_t> prefixed;
+		if (nalIndexHasKeyframe(*nals, videoLayer.parameterSets.format()) &&
+		    videoLayer.parameterSets.appendMissing(*nals, prefixed, frame->nals) > 0) {
+			if (!videoLayer.injectingParameterSets) {
+				videoLayer.injectingParameterSets = true;
+				logInfo("Video layer %zu keyframes lack in-band parameter sets; prepending cached copies", layer);
+			}
+			const uint32_t shift = static_cast<uint32_t>(prefixed.size());
+			prefixed.insert(prefixed.end(), data, data + size);
+			packet = EncodedPacket::adopt(std::move(prefixed), packet->info());
+			for (NalSpan span : *nals) {
+				span.offset += shift;
+				frame->nals.push_back(span);
 			}
+		} else {
+			frame->nals = *nals;
+		}
+	}
+	frame->packet = std::move(packet);
+	frame->timestamp = ts;
+	frame->keyframe = keyframe;
+	frame->pictureId = videoLayer.pictureId++;
+	frame->layer = static_cast<uint8_t>(layer);
+	if (svcActive_ && parseSvcFrame(videoPayloadFormat(videoCodec_), frame->data(), frame->size(), frame->svc)) {
+		// The structure only grows within a session, so a layer that pauses keeps its bitrate share
+		const uint8_t spatial = frame->svc.spatialLayers;
+		const uint8_t temporal =
+		    static_cast<uint8_t>(std::min<size_t>(frame->svc.temporalId + 1u, SVC_MAX_TEMPORAL_LAYERS));
+		const uint8_t knownSpatial = svcSpatialLayers_.load(std::memory_order_relaxed);
+		const uint8_t knownTemporal = svcTemporalLayers_.load(std::memory_order_relaxed);
+		if (spatial > knownSpatial || temporal > knownTemporal) {
+			svcSpatialLayers_.store(std::max(spatial, knownSpatial), std::memory_order_relaxed);
+			svcTemporalLayers_.store(std::max(temporal, knownTemporal), std::memory_order_relaxed);
+			logInfo("SVC stream has %u spatial and %u temporal layer(s)", std::max(spatial, knownSpatial),
+			        std::max(temporal, knownTemporal));
+		}
+	}
+	frame->enqueuedAtUs = MediaSendPool::nowUs();
 
-			if (peer->useAudioPacketizer) {
-				track->send(reinterpret_cast<const std::byte *>(data), size);
-				continue;
+	if (keyframe && layer == 0) {
+		keyframeArbiter_.onEncoderKeyframe(frame->enqueuedAtUs / 1000);
+	}
+
+	// Cache even with no viewers so the first one can start without waiting for a keyframe
+	std::lock_guard<std::mutex> lock(gopMutex_);
+	videoLayer.gopCache.push(frame);
+	sendPool_.enqueue(std::move(frame));
+}
+
+void VDONinjaPeerManager::setVideoExtraData(size_t layer, const uint8_t *data, size_t size)
+{
+	if (layer >= videoLayers_.size() || !data || size == 0) {
+		return;
+	}
+	VideoLayer &videoLayer = *videoLayers_[layer];
+	videoLayer.parameterSets.updateFromExtraData(data, size);
+	logDebug("Video layer %zu parameter sets from encoder: %zu VPS, %zu SPS, %zu PPS", layer,
+	         videoLayer.parameterSets.vpsCount(), videoLayer.parameterSets.spsCount(),
+	         videoLayer.parameterSets.ppsCount());
+}
+
+bool VDONinjaPeerManager::setViewerBandwidthEstimate(const std::string &uuid, int bitrate)
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	return peer && applyBandwidthEstimate(*peer, bitrate);
+}
+
+bool VDONinjaPeerManager::applyBandwidthEstimate(PeerInfo &peer, int bitrate)
+{
+	if (auto svc = peer.svc) {
+		const SvcLayers structure{svcSpatialLayers_.load(std::memory_order_relaxed),
+		                          svcTemporalLayers_.load(std::memory_order_relaxed)};
+		if (!svc->onBandwidthEstimate(bitrate, bitrate_, structure)) {
+			return false;
+		}
+		const SvcLayers target = svc->stats().target;
+		logInfo("Viewer %s moving to SVC layers S%uT%u of S%uT%u (estimate %d kbps)", peer.uuid.c_str(),
+		        target.spatial, target.temporal, structure.spatial, structure.temporal, bitrate / 1000);
+		return true;
+	}
+
+	// The H.264 fallback is a single layer; there is nothing to switch to
+	auto selector = peer.layerSelector;
+	if (peer.h264Fallback || !selector || !selector->onBandwidthEstimate(bitrate)) {
+		return false;
+	}
+
+	const size_t target = selector->targetLayer();
+	if (auto paced = peer.pacedStream) {
+		paced->setRate(pacingRateFor(target));
+	}
+	logInfo("Viewer %s moving to simulcast layer %s (estimate %d kbps)", peer.uuid.c_str(),
+	        videoLayers_[target]->config.rid.c_str(), bitrate / 1000);
+	return true;
+}
+
+int64_t VDONinjaPeerManager::pacingRateFor(size_t layer) const
+{
+	const int bitrate = layer < videoLayers_.size() ? videoLayers_[layer]->config.bitrate : bitrate_;
+	return static_cast<int64_t>(bitrate) * pacingPercent_ / 100;
+}
+
+void VDONinjaPeerManager::onViewerFeedback(PeerInfo &peer, const RtcpFeedback &feedback,
+                                           const rtc::message_callback &send)
+{
+	for (const auto &nack : feedback.nacks) {
+		if (nack.mediaSsrc == videoSsrc_) {
+			if (peer.mtu) {
+				peer.mtu->onPacketsNacked(nack.sequences.size());
 			}
+			retransmit(peer, nack, send);
+		}
+	}
+	if (std::find(feedback.firSsrcs.begin(), feedback.firSsrcs.end(), videoSsrc_) != feedback.firSsrcs.end()) {
+		onKeyframeRequest(peer, KeyframeRequestSource::Fir);
+	} else if (std::find(feedback.pliSsrcs.begin(), feedback.pliSsrcs.end(), videoSsrc_) !=
+	           feedback.pliSsrcs.end()) {
+		onKeyframeRequest(peer, KeyframeRequestSource::Pli);
+	}
 
-			// Create RTP packet (simplified)
-			std::vector<uint8_t> rtpPacket;
-			rtpPacket.reserve(12 + size);
-
-			// RTP header
-			rtpPacket.push_back(0x80); // V=2, P=0, X=0, CC=0
-			rtpPacket.push_back(111);  // PT=111 (Opus), M=0
-			rtpPacket.push_back((audioSeq_ >> 8) & 0xFF);
-			rtpPacket.push_back(audioSeq_ & 0xFF);
-			audioSeq_++;
-
-			// Timestamp
-			uint32_t ts = timestamp ? timestamp : audioTimestamp_;
-			rtpPacket.push_back((ts >> 24) & 0xFF);
-			rtpPacket.push_back((ts >> 16) & 0xFF);
-			rtpPacket.push_back((ts >> 8) & 0xFF);
-			rtpPacket.push_back(ts & 0xFF);
-			audioTimestamp_ = ts + 960; // 48kHz, 20ms frames
-
-			// SSRC
-			rtpPacket.push_back((audioSsrc_ >> 24) & 0xFF);
-			rtpPacket.push_back((audioSsrc_ >> 16) & 0xFF);
-			rtpPacket.push_back((audioSsrc_ >> 8) & 0xFF);
-			rtpPacket.push_back(audioSsrc_ & 0xFF);
-
-			// Payload
-			rtpPacket.insert(rtpPacket.end(), data, data + size);
-
-			track->send(reinterpret_cast<const std::byte *>(rtpPacket.data()), rtpPacket.size());
-		} catch (const std::exception &e) {
-			logError("Failed to send audio to %s: %s", pair.first.c_str(), e.what());
+	auto bandwidth = peer.bandwidth;
+	if (!bandwidth) {
+		return;
+	}
+
+	const int64_t nowMs = currentTimeMs();
+	bool updated = false;
+	if (feedback.rembBitrate) {
+		bandwidth->onRemb(*feedback.rembBitrate, nowMs);
+		updated = true;
+	}
+	auto fec = peer.fecNegotiated.load(std::memory_order_relaxed) ? peer.fec : nullptr;
+	for (const auto &report : feedback.reports) {
+		if (report.ssrc == videoSsrc_) {
+			bandwidth->onReceiverReport(report.fractionLost, nowMs);
+			updated = true;
+			if (fec && fec->onReceiverReport(report.fractionLost)) {
+				const FecStats stats = fec->stats();
+				if (stats.active) {
+					logInfo("Viewer %s reports %.1f%% loss; sending FlexFEC at %.0f%% overhead", peer.uuid.c_str(),
+					        stats.lossFraction * 100.0, stats.ratio * 100.0);
+				} else {
+					logInfo("Viewer %s loss down to %.1f%%; FlexFEC off", peer.uuid.c_str(),
+					        stats.lossFraction * 100.0);
+				}
+			}
 		}
 	}
+
+	if (updated) {
+		// Parity packets share the viewer's link, so layers are chosen from what remains for media
+		const double ratio = fec ? fec->protectionRatio() : 0.0;
+		applyBandwidthEstimate(peer, static_cast<int>(bandwidth->bitrate() / (1.0 + ratio)));
+	}
 }
 
-void VDONinjaPeerManager::sendVideoFrame(const uint8_t *data, size_t size, uint32_t timestamp, bool keyframe)
+void VDONinjaPeerManager::onAudioFeedback(PeerInfo &peer, const RtcpFeedback &feedback)
 {
-	if (!publishing_)
+	auto red = peer.redNegotiated.load(std::memory_order_relaxed) ? peer.audioRed : nullptr;
+	if (!red) {
 		return;
+	}
+	for (const auto &report : feedback.reports) {
+		if (report.ssrc != audioSsrc_ || !red->onReceiverReport(report.fractionLost)) {
+			continue;
+		}
+		const OpusRedStats stats = red->stats();
+		if (stats.distance > 0) {
+			logInfo("Viewer %s reports %.1f%% audio loss; sending RED with %zu previous frame(s)", peer.uuid.c_str(),
+			        stats.lossFraction * 100.0, stats.distance);
+		} else {
+			logInfo("Viewer %s audio loss down to %.1f%%; RED off", peer.uuid.c_str(), stats.lossFraction * 100.0);
+		}
+	}
+}
 
-	std::lock_guard<std::mutex> lock(peersMutex_);
+void VDONinjaPeerManager::retransmit(PeerInfo &peer, const RtcpNack &nack, const rtc::message_callback &send)
+{
+	auto history = peer.videoHistory;
+	auto rtx = peer.videoRtx;
+	if (!history || !rtx) {
+		return;
+	}
 
-	for (auto &pair : peers_) {
-		auto &peer = pair.second;
-		if (peer->type != ConnectionType::Publisher || peer->state != ConnectionState::Connected) {
+	const bool useRtx = peer.rtxNegotiated.load(std::memory_order_relaxed);
+	std::vector<uint8_t> packet;
+	for (uint16_t sequence : nack.sequences) {
+		size_t index = 0;
+		auto frame = history->find(sequence, index);
+		rtx->countRequest(frame != nullptr);
+		if (!frame) {
 			continue;
 		}
 
-		try {
-			auto track = peer->videoTrack;
-			if (!track) {
+		const uint8_t *original = frame->packetData(index);
+		const size_t size = frame->packetSize(index);
+		if (useRtx) {
+			if (!rtx->wrap(original, size, sequence, packet)) {
 				continue;
 			}
+		} else {
+			// Viewer did not accept RTX: resend the original packet with its sequence number
+			packet.assign(original, original + size);
+			packet[2] = static_cast<uint8_t>(sequence >> 8);
+			packet[3] = static_cast<uint8_t>(sequence);
+		}
+		send(rtc::make_message(packet.begin(), packet.end()));
+	}
+}
 
-			if (peer->useVideoPacketizer) {
-				track->send(reinterpret_cast<const std::byte *>(data), size);
-				continue;
+BandwidthEstimate VDONinjaPeerManager::getViewerBandwidthEstimate(const std::string &uuid) const
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	if (!peer || !peer->bandwidth) {
+		return {};
+	}
+	return peer->bandwidth->snapshot();
+}
+
+void VDONinjaPeerManager::setCongestionThresholds(const CongestionThresholds &thresholds)
+{
+	congestionThresholds_ = thresholds;
+}
+
+CongestionStats VDONinjaPeerManager::getViewerCongestionStats(const std::string &uuid) const
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	if (!peer || !peer->congestion) {
+		return {};
+	}
+	return peer->congestion->stats();
+}
+
+std::shared_ptr<PeerInfo> VDONinjaPeerManager::findPeer(const std::string &uuid) const
+{
+	std::lock_guard<std::mutex> lock(peersMutex_);
+	auto it = peers_.find(uuid);
+	return it != peers_.end() ? it->second : nullptr;
+}
+
+void VDONinjaPeerManager::requestKeyframe(const std::string &uuid, KeyframeRequestSource source)
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	if (peer) {
+		onKeyframeRequest(*peer, source);
+	}
+}
+
+void VDONinjaPeerManager::onKeyframeRequest(PeerInfo &peer, KeyframeRequestSource source)
+{
+	if (!publishing_ || peer.type != ConnectionType::Publisher ||
+	    peer.state.load(std::memory_order_acquire) != ConnectionState::Connected) {
+		return;
+	}
+
+	KeyframeDecision decision;
+	{
+		// Decide and replay under gopMutex_ so the replayed GOP and the live stream join without a gap
+		std::lock_guard<std::mutex> gopLock(gopMutex_);
+		const GopCache &cache = videoLayers_[videoLayerFor(peer)]->gopCache;
+		const int64_t cachedKeyframeAtUs = cache.keyframeEnqueuedAtUs();
+		const int64_t deliveredKeyframeAtUs = peer.deliveredKeyframeAtUs.load(std::memory_order_relaxed);
+		const bool hasCachedGop = cachedKeyframeAtUs > 0 && deliveredKeyframeAtUs == cachedKeyframeAtUs;
+		decision = keyframeArbiter_.onRequest(peer.uuid, source, MediaSendPool::nowUs() / 1000,
+		                                      cachedKeyframeAtUs / 1000, hasCachedGop);
+		if (decision == KeyframeDecision::ServeCached) {
+			const FrameList frames = cache.snapshot();
+			if (peer.congestion) {
+				peer.congestion->exempt(frames.size());
 			}
+			sendPool_.primeLane(peer.uuid, frames);
+			logDebug("Keyframe request (%s) from %s served from cache (%zu frame(s))",
+			         keyframeRequestSourceName(source), peer.uuid.c_str(), frames.size());
+		}
+	}
 
-			// Create RTP packet (simplified - real impl needs fragmentation for large
-			// frames)
-			std::vector<uint8_t> rtpPacket;
-			rtpPacket.reserve(12 + size);
-
-			// RTP header
-			rtpPacket.push_back(0x80);                        // V=2, P=0, X=0, CC=0
-			rtpPacket.push_back(keyframe ? (96 | 0x80) : 96); // PT=96, M=1 for keyframe
-			rtpPacket.push_back((videoSeq_ >> 8) & 0xFF);
-			rtpPacket.push_back(videoSeq_ & 0xFF);
-			videoSeq_++;
-
-			// Timestamp
-			uint32_t ts = timestamp ? timestamp : videoTimestamp_;
-			rtpPacket.push_back((ts >> 24) & 0xFF);
-			rtpPacket.push_back((ts >> 16) & 0xFF);
-			rtpPacket.push_back((ts >> 8) & 0xFF);
-			rtpPacket.push_back(ts & 0xFF);
-			videoTimestamp_ = ts + 3000; // 90kHz clock, ~30fps
-
-			// SSRC
-			rtpPacket.push_back((videoSsrc_ >> 24) & 0xFF);
-			rtpPacket.push_back((videoSsrc_ >> 16) & 0xFF);
-			rtpPacket.push_back((videoSsrc_ >> 8) & 0xFF);
-			rtpPacket.push_back(videoSsrc_ & 0xFF);
-
-			// Payload
-			rtpPacket.insert(rtpPacket.end(), data, data + size);
-
-			track->send(reinterpret_cast<const std::byte *>(rtpPacket.data()), rtpPacket.size());
-		} catch (const std::exception &e) {
-			logError("Failed to send video to %s: %s", pair.first.c_str(), e.what());
+	if (decision == KeyframeDecision::AwaitScheduledKeyframe) {
+		logDebug("Keyframe request (%s) from %s deferred to the next scheduled keyframe",
+		         keyframeRequestSourceName(source), peer.uuid.c_str());
+		if (onKeyframeNeeded_) {
+			onKeyframeNeeded_();
 		}
 	}
 }
 
+void VDONinjaPeerManager::setViewerMediaHold(const std::string &uuid, MediaGateReason reason,
+                                             std::optional<bool> audio, std::optional<bool> video)
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	if (!peer || !peer->mediaGate) {
+		return;
+	}
+	if (audio) {
+		onMediaGateChange(*peer, MediaKind::Audio, peer->mediaGate->setAudioHold(reason, *audio), reason);
+	}
+	if (video) {
+		onMediaGateChange(*peer, MediaKind::Video, peer->mediaGate->setVideoHold(reason, *video), reason);
+	}
+}
+
+void VDONinjaPeerManager::setViewerTally(const std::string &uuid, bool program, bool preview)
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	if (!peer || !peer->mediaGate) {
+		return;
+	}
+	onMediaGateChange(*peer, MediaKind::Video, peer->mediaGate->setTally(program, preview),
+	                  MediaGateReason::TallyOff);
+}
+
+void VDONinjaPeerManager::setTallyGating(bool enabled)
+{
+	tallyGating_ = enabled;
+}
+
+MediaGateStats VDONinjaPeerManager::getViewerMediaGateStats(const std::string &uuid) const
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	if (!peer || !peer->mediaGate) {
+		return {};
+	}
+	return peer->mediaGate->stats();
+}
+
+void VDONinjaPeerManager::onMediaGateChange(PeerInfo &peer, MediaKind kind, MediaGateChange change,
+                                            MediaGateReason reason)
+{
+	const char *kindName = kind == MediaKind::Audio ? "audio" : "video";
+	if (change == MediaGateChange::Suspended) {
+		logInfo("Viewer %s: %s suspended (%s)", peer.uuid.c_str(), kindName, mediaGateReasonName(reason));
+	} else if (change == MediaGateChange::Resumed) {
+		logInfo("Viewer %s: %s resumed (%s cleared)", peer.uuid.c_str(), kindName, mediaGateReasonName(reason));
+		// The gate holds video until a keyframe; ask for one (or replay the cached GOP)
+		if (kind == MediaKind::Video) {
+			onKeyframeRequest(peer, KeyframeRequestSource::Resume);
+		}
+	}
+}
+
+void VDONinjaPeerManager::setKeyframeRequestWindow(int windowMs)
+{
+	keyframeArbiter_.setWindowMs(windowMs);
+}
+
+KeyframeArbiterStats VDONinjaPeerManager::getKeyframeStats() const
+{
+	return keyframeArbiter_.stats();
+}
+
+OpusRedStats VDONinjaPeerManager::getViewerAudioRedStats(const std::string &uuid) const
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	if (!peer || !peer->audioRed) {
+		return {};
+	}
+	return peer->audioRed->stats();
+}
+
+SvcStats VDONinjaPeerManager::getViewerSvcStats(const std::string &uuid) const
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	if (!peer || !peer->svc) {
+		return {};
+	}
+	return peer->svc->stats();
+}
+
+FecStats VDONinjaPeerManager::getViewerFecStats(const std::string &uuid) const
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	if (!peer || !peer->fec) {
+		return {};
+	}
+	return peer->fec->stats();
+}
+
+MtuStats VDONinjaPeerManager::getViewerMtuStats(const std::string &uuid) const
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	if (!peer || !peer->mtu) {
+		return {};
+	}
+	return peer->mtu->stats();
+}
+
+void VDONinjaPeerManager::applyPathMtu(PeerInfo &peer)
+{
+	if (!peer.mtu || !peer.pc || rtpMtu_ != 0) {
+		return;
+	}
+
+	rtc::Candidate local;
+	rtc::Candidate remote;
+	try {
+		if (!peer.pc->getSelectedCandidatePair(&local, &remote)) {
+			return;
+		}
+	} catch (const std::exception &e) {
+		logDebug("No selected candidate pair for %s: %s", peer.uuid.c_str(), e.what());
+		return;
+	}
+
+	auto describe = [](const rtc::Candidate &candidate) {
+		IceCandidateInfo info;
+		switch (candidate.type()) {
+		case rtc::Candidate::Type::Host:
+			info.kind = IceCandidateKind::Host;
+			break;
+		case rtc::Candidate::Type::ServerReflexive:
+			info.kind = IceCandidateKind::ServerReflexive;
+			break;
+		case rtc::Candidate::Type::PeerReflexive:
+			info.kind = IceCandidateKind::PeerReflexive;
+			break;
+		case rtc::Candidate::Type::Relayed:
+			info.kind = IceCandidateKind::Relayed;
+			break;
+		default:
+			break;
+		}
+		const auto transport = candidate.transportType();
+		info.tcp = transport != rtc::Candidate::TransportType::Udp &&
+		           transport != rtc::Candidate::TransportType::Unknown;
+		info.address = candidate.address();
+		return info;
+	};
+
+	const RtpMtuTier tier = rtpMtuTierForPath(describe(local), describe(remote));
+	peer.mtu->setPathTier(tier);
+	logInfo("Viewer %s is on a %s path; sending %zu-byte RTP payloads", peer.uuid.c_str(), rtpMtuTierName(tier),
+	        rtpPayloadForTier(tier));
+}
+
+RtxStats VDONinjaPeerManager::getViewerRtxStats(const std::string &uuid) const
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	if (!peer || !peer->videoRtx) {
+		return {};
+	}
+	return peer->videoRtx->stats();
+}
+
+int VDONinjaPeerManager::getViewerVideoLayer(const std::string &uuid) const
+{
+	std::shared_ptr<PeerInfo> peer = findPeer(uuid);
+	if (!peer || !peer->layerSelector) {
+		return -1;
+	}
+	return static_cast<int>(videoLayerFor(*peer));
+}
+
+size_t VDONinjaPeerManager::videoLayerFor(const PeerInfo &peer) const
+{
+	if (peer.h264Fallback && videoLayers_.size() > primaryLayerCount_) {
+		return primaryLayerCount_;
+	}
+	auto selector = peer.layerSelector;
+	return selector ? std::min(selector->currentLayer(), primaryLayerCount_ - 1) : 0;
+}
+
+void VDONinjaPeerManager::rebuildVideoLayers()
+{
+	const std::vector<SimulcastLayer> layers =
+	    simulcastLayers_.empty() ? buildSimulcastLadder(0, 0, bitrate_, 1) : simulcastLayers_;
+
+	videoLayers_.clear();
+	auto addLayer = [this](const SimulcastLayer &config, VideoCodec codec, uint8_t payloadType) {
+		auto layer = std::make_unique<VideoLayer>();
+		layer->config = config;
+		layer->parameterSets = ParameterSetCache(nalFormat(codec));
+		layer->gopCache = GopCache(GopCache::DEFAULT_MAX_BYTES, gopMaxFrames_);
+		// Layers share the negotiated SSRC; each viewer receives exactly one of them.
+		for (size_t tier = 0; tier < RTP_MTU_TIER_COUNT; ++tier) {
+			layer->packetizers[tier] =
+			    std::make_unique<RtpPacketizer>(videoPayloadFormat(codec), videoSsrc_, payloadType,
+			                                    rtpPayloadForTier(static_cast<RtpMtuTier>(tier)));
+		}
+		videoLayers_.push_back(std::move(layer));
+	};
+	for (const auto &config : layers) {
+		addLayer(config, videoCodec_, kVideoPayloadType);
+	}
+	primaryLayerCount_ = videoLayers_.size();
+
+	// The H.264 fallback mirrors the full-size layer and follows the simulcast layers
+	if (videoCodec_ == VideoCodec::H265 && h264Fallback_) {
+		SimulcastLayer fallback = layers.front();
+		fallback.rid = "h264";
+		addLayer(fallback, VideoCodec::H264, kFallbackVideoPayloadType);
+	}
+}
+
+VDONinjaPeerManager::SendPath VDONinjaPeerManager::selectSendPath(const PeerInfo &peer) const
+{
+	// Track setup fixes whether the RTCP chain is present, so the branch is taken once here
+	// instead of for every frame.
+	SendPath path;
+	path.audio = peer.hasAudioRtcpChain ? &VDONinjaPeerManager::deliverAudio<true>
+	                                    : &VDONinjaPeerManager::deliverAudio<false>;
+	path.video = peer.hasVideoRtcpChain ? &VDONinjaPeerManager::deliverVideo<true>
+	                                    : &VDONinjaPeerManager::deliverVideo<false>;
+	path.group = 1 + (peer.hasAudioRtcpChain ? 1u : 0u) + (peer.hasVideoRtcpChain ? 2u : 0u);
+	return path;
+}
+
+void VDONinjaPeerManager::deliverFrame(PeerInfo &peer, const OutboundFrame &frame, DeliverFn deliver)
+{
+	if (peer.state.load(std::memory_order_acquire) != ConnectionState::Connected) {
+		return;
+	}
+
+	try {
+		(this->*deliver)(peer, frame);
+	} catch (const std::exception &e) {
+		logError("Failed to send %s to %s: %s", frame.kind == MediaKind::Audio ? "audio" : "video",
+		         peer.uuid.c_str(), e.what());
+	}
+}
+
+template <bool Reported> void VDONinjaPeerManager::deliverAudio(PeerInfo &peer, const OutboundFrame &frame)
+{
+	auto track = peer.audioTrack;
+	if (!track || !peer.audioSequencer) {
+		return;
+	}
+	auto gate = peer.mediaGate;
+	if (gate && !gate->admitAudio()) {
+		return;
+	}
+
+	// RED and plain Opus share the viewer's sequence numbers; the payload type tells them apart
+	auto red = peer.audioRed;
+	const size_t distance = red && peer.redNegotiated.load(std::memory_order_relaxed) ? red->distance() : 0;
+	std::shared_ptr<const RtpFrame> redFrame = distance > 0 ? frame.red[distance - 1] : nullptr;
+	if (redFrame) {
+		red->countPacket();
+	}
+	const RtpFrame &rtpFrame = redFrame ? *redFrame : frame.rtp([this](const OutboundFrame &f) {
+		return audioPacketizer_->packetize(f.data(), f.size(), f.timestamp, false);
+	});
+	auto paced = peer.pacedStream;
+	if (paced && pacer_.isRunning()) {
+		paced->push(MediaKind::Audio, redFrame ? redFrame : frame.sharedRtp(),
+		            peer.audioSequencer->reserve(rtpFrame.packetCount()));
+	} else {
+		if constexpr (Reported) {
+			stampSenderReportClock(peer, MediaKind::Audio);
+		}
+		sendRtpFrame(*track, *peer.audioSequencer, rtpFrame);
+	}
+}
+
+template <bool Reported> void VDONinjaPeerManager::deliverVideo(PeerInfo &peer, const OutboundFrame &frame)
+{
+	auto track = peer.videoTrack;
+	if (!track || !peer.videoSequencer) {
+		return;
+	}
+
+	// Suspended viewers get no video at all, so held frames never count as congestion drops
+	auto gate = peer.mediaGate;
+	if (gate && !gate->admitVideo(frame.keyframe)) {
+		return;
+	}
+
+	auto paced = peer.pacedStream;
+	const bool pacing = paced && pacer_.isRunning();
+
+	auto congestion = peer.congestion;
+	if (congestion) {
+		const bool wasDropping = congestion->stats().dropping;
+		const int64_t queueDelayUs = MediaSendPool::nowUs() - frame.enqueuedAtUs;
+		const size_t bufferedBytes = track->bufferedAmount() + (pacing ? paced->queuedBytes() : 0);
+		const bool admitted = congestion->admitVideo(frame.keyframe, queueDelayUs, bufferedBytes);
+		if (!admitted && !wasDropping) {
+			logWarning("Viewer %s is congested (queue delay %lld ms); skipping video until the next keyframe",
+			           peer.uuid.c_str(), static_cast<long long>(queueDelayUs / 1000));
+		} else if (admitted && wasDropping) {
+			logInfo("Viewer %s resumed video at a keyframe", peer.uuid.c_str());
+		}
+		if (!admitted) {
+			return;
+		}
+	}
+
+	// SVC viewers skip temporal layers above their target and get upper spatial layers cut off
+	size_t spatialLayers = frame.svc.spatialLayers;
+	if (auto svc = peer.svc) {
+		spatialLayers = svc->select(frame.svc, frame.keyframe);
+		if (spatialLayers == 0) {
+			return;
+		}
+	}
+
+	// Identifies the GOP the viewer is decoding, so keyframe requests know whether a replay helps
+	if (frame.keyframe) {
+		peer.deliveredKeyframeAtUs.store(frame.enqueuedAtUs, std::memory_order_relaxed);
+	}
+
+	// The tier is read once per frame, so a probe or path change never splits a frame
+	auto mtu = peer.mtu;
+	const RtpMtuTier tier = mtu ? mtu->tier() : RtpMtuTier::Default;
+	const RtpFrame &rtpFrame = frame.rtp(tier, spatialLayers, [this, tier, spatialLayers](const OutboundFrame &f) {
+		const RtpPacketizer &packetizer = *videoLayers_[f.layer]->packetizers[static_cast<size_t>(tier)];
+		if (spatialLayers < f.svc.spatialLayers) {
+			const std::vector<uint8_t> reduced =
+			    keepSvcSpatialLayers(packetizer.format(), f.data(), f.size(), spatialLayers);
+			return packetizer.packetize(reduced.data(), reduced.size(), f.timestamp, f.keyframe, f.pictureId);
+		}
+		return packetizer.packetize(f.data(), f.size(), f.timestamp, f.keyframe, f.pictureId,
+		                            f.nals.empty() ? nullptr : &f.nals);
+	});
+	if (mtu) {
+		mtu->onPacketsSent(rtpFrame.packetCount());
+	}
+	if constexpr (Reported) {
+		// Only the RTCP chain answers NACKs, so only it needs the retransmission history
+		if (peer.videoHistory) {
+			peer.videoHistory->recordFrame(peer.videoSequencer->nextSequence(), frame.sharedRtp(tier, spatialLayers));
+		}
+	}
+	// Parity follows the packets it protects, on its own SSRC and sequence numbers
+	if (pacing) {
+		const uint16_t firstSequence = peer.videoSequencer->reserve(rtpFrame.packetCount());
+		paced->push(MediaKind::Video, frame.sharedRtp(tier, spatialLayers), firstSequence);
+		if (auto repair = protectFrame(peer, rtpFrame, firstSequence)) {
+			paced->push(MediaKind::Video, repair, peer.fecSequencer->reserve(repair->packetCount()));
+		}
+	} else {
+		if constexpr (Reported) {
+			stampSenderReportClock(peer, MediaKind::Video);
+		}
+		const uint16_t firstSequence = peer.videoSequencer->nextSequence();
+		sendRtpFrame(*track, *peer.videoSequencer, rtpFrame);
+		if (auto repair = protectFrame(peer, rtpFrame, firstSequence)) {
+			sendRtpFrame(*track, *peer.fecSequencer, *repair);
+		}
+	}
+}
+
+SendQueueStats VDONinjaPeerManager::getSendQueueStats() const
+{
+	return sendPool_.getStats();
+}
+
+void VDONinjaPeerManager::releaseCachedMedia()
+{
+	std::lock_guard<std::mutex> lock(gopMutex_);
+	for (auto &layer : videoLayers_) {
+		layer->gopCache.clear();
+	}
+}
+
+PacerStats VDONinjaPeerManager::getPacerStats() const
+{
+	return pacer_.getStats();
+}
+
+size_t VDONinjaPeerManager::getViewerQueueDepth(const std::string &uuid) const
+{
+	return sendPool_.laneDepth(uuid);
+}
+
 bool VDONinjaPeerManager::startViewing(const std::string &streamId)
 {
 	// Request to view stream through signaling
@@ -710,18 +1777,20 @@ bool VDONinjaPeerManager::startViewing(const std::string &streamId)
 void VDONinjaPeerManager::stopViewing(const std::string &streamId)
 {
 	// Find and close connections associated with this stream
-	std::lock_guard<std::mutex> lock(peersMutex_);
-	auto it = peers_.begin();
-	while (it != peers_.end()) {
-		if (it->second->type == ConnectionType::Viewer && it->second->streamId == streamId) {
-			if (it->second->pc) {
-				it->second->pc->close();
+	std::vector<std::shared_ptr<PeerInfo>> closing;
+	{
+		std::lock_guard<std::mutex> lock(peersMutex_);
+		auto it = peers_.begin();
+		while (it != peers_.end()) {
+			if (it->second->type == ConnectionType::Viewer && it->second->streamId == streamId) {
+				closing.push_back(it->second);
+				it = peers_.erase(it);
+			} else {
+				++it;
 			}
-			it = peers_.erase(it);
-		} else {
-			++it;
 		}
 	}
+	closePeerConnections(closing);
 	logInfo("Stopped viewing stream: %s", streamId.c_str());
 }
 
@@ -772,6 +1841,14 @@ void VDONinjaPeerManager::setOnDataChannelMessage(OnDataChannelMessageCallback c
 {
 	onDataChannelMessage_ = callback;
 }
+void VDONinjaPeerManager::setOnKeyframeNeeded(OnKeyframeNeededCallback callback)
+{
+	onKeyframeNeeded_ = callback;
+}
+void VDONinjaPeerManager::setOnViewerRequested(OnViewerRequestedCallback callback)
+{
+	onViewerRequested_ = callback;
+}
 
 std::vector<std::string> VDONinjaPeerManager::getConnectedPeers() const
 {
@@ -807,6 +1884,47 @@ void VDONinjaPeerManager::setBitrate(int bitrate)
 {
 	bitrate_ = bitrate;
 }
+
+void VDONinjaPeerManager::setPacingRate(int percent)
+{
+	pacingPercent_ = std::max(percent, 0);
+}
+
+void VDONinjaPeerManager::setRtpMtu(int payloadBytes, bool probing)
+{
+	rtpMtu_ = std::max(payloadBytes, 0);
+	rtpMtuProbing_ = probing;
+}
+
+void VDONinjaPeerManager::setFecEnabled(bool enabled)
+{
+	fecEnabled_ = enabled;
+}
+
+void VDONinjaPeerManager::setAudioRedundancy(bool enabled)
+{
+	audioRedEnabled_ = enabled;
+}
+
+void VDONinjaPeerManager::setSvcEnabled(bool enabled)
+{
+	svcEnabled_ = enabled;
+}
+
+void VDONinjaPeerManager::setH264Fallback(bool enabled)
+{
+	h264Fallback_ = enabled;
+}
+
+void VDONinjaPeerManager::setGopLength(double fps, int keyintSec)
+{
+	gopMaxFrames_ = keyintSec > 0 ? GopCache::framesForInterval(fps, keyintSec) : GopCache::DEFAULT_MAX_FRAMES;
+}
+
+void VDONinjaPeerManager::setSimulcastLayers(const std::vector<SimulcastLayer> &layers)
+{
+	simulcastLayers_ = layers;
+}
 void VDONinjaPeerManager::setEnableDataChannel(bool enable)
 {
 	enableDataChannel_ = enable;
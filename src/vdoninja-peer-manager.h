@@ -13,9 +13,27 @@
 #include <functional>
 #include <map>
 #include <mutex>
+#include <optional>
 
+#include "vdoninja-bandwidth-estimator.h"
 #include "vdoninja-common.h"
+#include "vdoninja-congestion.h"
+#include "vdoninja-fec.h"
+#include "vdoninja-gop-cache.h"
+#include "vdoninja-keyframe-arbiter.h"
+#include "vdoninja-media-clock.h"
+#include "vdoninja-media-gate.h"
+#include "vdoninja-mtu.h"
+#include "vdoninja-opus-red.h"
+#include "vdoninja-pacer.h"
+#include "vdoninja-parameter-sets.h"
+#include "vdoninja-rtcp.h"
+#include "vdoninja-rtp-packetizer.h"
+#include "vdoninja-rtx.h"
+#include "vdoninja-send-queue.h"
 #include "vdoninja-signaling.h"
+#include "vdoninja-simulcast.h"
+#include "vdoninja-svc.h"
 
 namespace vdoninja
 {
@@ -39,6 +57,8 @@ using OnPeerDisconnectedCallback = std::function<void(const std::string &uuid)>;
 using OnTrackCallback = std::function<void(const std::string &uuid, TrackType type, std::shared_ptr<rtc::Track> track)>;
 using OnDataChannelCallback = std::function<void(const std::string &uuid, std::shared_ptr<rtc::DataChannel> dc)>;
 using OnDataChannelMessageCallback = std::function<void(const std::string &uuid, const std::string &message)>;
+using OnKeyframeNeededCallback = std::function<void()>;
+using OnViewerRequestedCallback = std::function<void(const std::string &uuid)>;
 
 class VDONinjaPeerManager
 {
@@ -59,9 +79,71 @@ public:
 	bool isPublishing() const;
 	int getViewerCount() const;
 
-	// Send media to all connected peers (viewers)
+	// Queue media for all connected peers (viewers); returns without waiting for any send.
+	// `layer` is the simulcast layer index of the encoder that produced the frame; with H.265 the
+	// H.264 fallback encoder, when there is one, follows the simulcast layers.
+	// `nals` is an optional H.264/H.265 NAL index of data, carried with the frame to the packetizer.
+	// The EncodedPacketRef overloads share the payload with every stage and take the RTP timestamp
+	// from the packet's pts through the shared media clock. The others copy the payload once and
+	// use the given RTP timestamp, or advance by one nominal frame when it is zero.
 	void sendAudioFrame(const uint8_t *data, size_t size, uint32_t timestamp);
-	void sendVideoFrame(const uint8_t *data, size_t size, uint32_t timestamp, bool keyframe);
+	void sendAudioFrame(EncodedPacketRef packet);
+	void sendVideoFrame(const uint8_t *data, size_t size, uint32_t timestamp, bool keyframe, size_t layer = 0,
+	                    const NalIndex *nals = nullptr);
+	void sendVideoFrame(EncodedPacketRef packet, bool keyframe, size_t layer = 0, const NalIndex *nals = nullptr);
+	// Parameter sets from the layer's encoder extra data (Annex-B, avcC or hvcC); call from the encoder thread.
+	void setVideoExtraData(size_t layer, const uint8_t *data, size_t size);
+
+	// Per-viewer bandwidth estimate from REMB and receiver reports; zero bitrate if unknown
+	BandwidthEstimate getViewerBandwidthEstimate(const std::string &uuid) const;
+
+	// Per-viewer simulcast layer selection, driven by that viewer's bandwidth estimate (bps).
+	// Estimates are applied automatically from RTCP; this allows an external override.
+	bool setViewerBandwidthEstimate(const std::string &uuid, int bitrate);
+	int getViewerVideoLayer(const std::string &uuid) const;
+
+	// Congested viewers skip video until the next keyframe; thresholds apply to viewers connecting afterwards.
+	void setCongestionThresholds(const CongestionThresholds &thresholds);
+	CongestionStats getViewerCongestionStats(const std::string &uuid) const;
+
+	// Per-viewer send gates from data-channel signals (pause requests, mute, scene visibility, tally).
+	// A suspended kind gets no RTP; video resumes at a keyframe, which is requested on resume.
+	void setViewerMediaHold(const std::string &uuid, MediaGateReason reason, std::optional<bool> audio,
+	                        std::optional<bool> video);
+	void setViewerTally(const std::string &uuid, bool program, bool preview);
+	// Tally-off holds video only when enabled; applies to viewers connecting afterwards.
+	void setTallyGating(bool enabled);
+	MediaGateStats getViewerMediaGateStats(const std::string &uuid) const;
+
+	// NACK-driven retransmissions served from the shared history
+	RtxStats getViewerRtxStats(const std::string &uuid) const;
+
+	// FlexFEC protection level, adapted to the viewer's reported loss
+	FecStats getViewerFecStats(const std::string &uuid) const;
+
+	// Opus RED redundancy, adapted to the viewer's reported audio loss
+	OpusRedStats getViewerAudioRedStats(const std::string &uuid) const;
+
+	// SVC layers forwarded to the viewer, chosen from its bandwidth estimate
+	SvcStats getViewerSvcStats(const std::string &uuid) const;
+
+	// RTP packet size tier chosen for the viewer's network path
+	MtuStats getViewerMtuStats(const std::string &uuid) const;
+
+	// Keyframe requests (RTCP PLI/FIR are handled internally) are coalesced across viewers
+	// within the window: a fresh cached GOP is replayed to the viewer, otherwise the request waits
+	// for the encoder's next scheduled keyframe and OnKeyframeNeeded is raised once per window.
+	void requestKeyframe(const std::string &uuid, KeyframeRequestSource source);
+	void setKeyframeRequestWindow(int windowMs);
+	KeyframeArbiterStats getKeyframeStats() const;
+
+	// Send queue metrics
+	SendQueueStats getSendQueueStats() const;
+	PacerStats getPacerStats() const;
+	size_t getViewerQueueDepth(const std::string &uuid) const;
+
+	// Drop cached media (GOP caches) while the output is idle so encoder packets are released
+	void releaseCachedMedia();
 
 	// Viewing mode - receive media from publishers
 	bool startViewing(const std::string &streamId);
@@ -77,6 +159,9 @@ public:
 	void setOnTrack(OnTrackCallback callback);
 	void setOnDataChannel(OnDataChannelCallback callback);
 	void setOnDataChannelMessage(OnDataChannelMessageCallback callback);
+	void setOnKeyframeNeeded(OnKeyframeNeededCallback callback);
+	// A viewer's offer request was accepted; fires before its connection is set up
+	void setOnViewerRequested(OnViewerRequestedCallback callback);
 
 	// Get peer info
 	std::vector<std::string> getConnectedPeers() const;
@@ -86,7 +171,27 @@ public:
 	void setVideoCodec(VideoCodec codec);
 	void setAudioCodec(AudioCodec codec);
 	void setBitrate(int bitrate);
+	// Video renditions published to viewers; applied on the next startPublishing().
+	void setSimulcastLayers(const std::vector<SimulcastLayer> &layers);
 	void setEnableDataChannel(bool enable);
+	// Frame rate and keyframe interval (0 if the encoder chooses) of the published video; the GOP
+	// cache and send lanes are sized to hold a whole GOP. Applied on the next startPublishing().
+	void setGopLength(double fps, int keyintSec);
+	// Pacing rate as a percentage of each viewer's target bitrate; 0 sends packets unpaced.
+	// Applies to viewers connecting afterwards.
+	void setPacingRate(int percent);
+	// RTP payload size; 0 sizes each viewer's packets from its selected ICE candidate pair,
+	// optionally probing larger sizes. Applies to viewers connecting afterwards.
+	void setRtpMtu(int payloadBytes, bool probing);
+	// Offer a FlexFEC stream; applies to viewers connecting afterwards.
+	void setFecEnabled(bool enabled);
+	// Offer Opus RED alongside plain Opus; applies to viewers connecting afterwards.
+	void setAudioRedundancy(bool enabled);
+	// Forward VP9/AV1 SVC layers per viewer; takes effect at the next startPublishing.
+	void setSvcEnabled(bool enabled);
+	// With H.265, also offer H.264 from a second encoder to viewers that cannot decode H.265;
+	// takes effect at the next startPublishing.
+	void setH264Fallback(bool enabled);
 
 private:
 	// Create a new peer connection for a viewer (we send media to them)
@@ -108,6 +213,42 @@ private:
 	// Setup tracks for publishing
 	void setupPublisherTracks(std::shared_ptr<PeerInfo> peer);
 
+	// Per-viewer send step, run on a send pool worker. The deliver functions are specialised
+	// on whether the track has the RTCP reporter chain; a viewer's pair is picked once when
+	// its lane is created, and viewers with the same pair share a send group.
+	using DeliverFn = void (VDONinjaPeerManager::*)(PeerInfo &, const OutboundFrame &);
+	struct SendPath {
+		DeliverFn audio = nullptr;
+		DeliverFn video = nullptr;
+		uint32_t group = 0;
+	};
+	SendPath selectSendPath(const PeerInfo &peer) const;
+	void deliverFrame(PeerInfo &peer, const OutboundFrame &frame, DeliverFn deliver);
+	template <bool Reported> void deliverAudio(PeerInfo &peer, const OutboundFrame &frame);
+	template <bool Reported> void deliverVideo(PeerInfo &peer, const OutboundFrame &frame);
+
+	// RTCP from a viewer's video track, run on the libdatachannel thread
+	void onViewerFeedback(PeerInfo &peer, const RtcpFeedback &feedback, const rtc::message_callback &send);
+	void onAudioFeedback(PeerInfo &peer, const RtcpFeedback &feedback);
+	void retransmit(PeerInfo &peer, const RtcpNack &nack, const rtc::message_callback &send);
+	bool applyBandwidthEstimate(PeerInfo &peer, int bitrate);
+	int64_t pacingRateFor(size_t layer) const;
+	// Index into videoLayers_ of the layer the viewer currently receives
+	size_t videoLayerFor(const PeerInfo &peer) const;
+	void onKeyframeRequest(PeerInfo &peer, KeyframeRequestSource source);
+	std::shared_ptr<PeerInfo> findPeer(const std::string &uuid) const;
+	void onMediaGateChange(PeerInfo &peer, MediaKind kind, MediaGateChange change, MediaGateReason reason);
+	void applyPathMtu(PeerInfo &peer);
+
+	// Send a shared packetized frame to one viewer with its own sequence numbers
+	void sendRtpFrame(rtc::Track &track, RtpSequencer &sequencer, const RtpFrame &frame);
+	// FlexFEC packets for a video frame the viewer receives from firstSequence on; null when unprotected
+	std::shared_ptr<const RtpFrame> protectFrame(PeerInfo &peer, const RtpFrame &frame, uint16_t firstSequence);
+	// Point the viewer's sender report at the shared media clock just before its packets go out
+	void stampSenderReportClock(PeerInfo &peer, MediaKind kind) const;
+	void enqueueAudioFrame(EncodedPacketRef packet, uint32_t ts);
+	void enqueueVideoFrame(EncodedPacketRef packet, uint32_t ts, bool keyframe, size_t layer, const NalIndex *nals);
+
 	// ICE candidate bundling
 	void bundleAndSendCandidates(const std::string &uuid);
 
@@ -117,6 +258,11 @@ private:
 	// Count publisher peers that should consume viewer slots.
 	int getPublisherSlotCount() const;
 
+	// Republish the active viewer snapshot after a peer changes state or is removed.
+	void refreshActiveViewers();
+	// Caller holds peersMutex_; returns the viewers that left so their stats are logged after unlocking
+	std::vector<std::shared_ptr<PeerInfo>> refreshActiveViewersLocked();
+
 	// Signaling client (not owned)
 	VDONinjaSignaling *signaling_ = nullptr;
 
@@ -124,6 +270,10 @@ private:
 	std::map<std::string, std::shared_ptr<PeerInfo>> peers_;
 	mutable std::mutex peersMutex_;
 
+	// Connected publisher peers, read without peersMutex_ by the media send path
+	using ViewerSet = std::vector<std::shared_ptr<PeerInfo>>;
+	SnapshotSlot<ViewerSet> activeViewers_;
+
 	// ICE configuration
 	std::vector<IceServer> iceServers_;
 	bool forceTurn_ = false;
@@ -136,15 +286,71 @@ private:
 	VideoCodec videoCodec_ = VideoCodec::H264;
 	AudioCodec audioCodec_ = AudioCodec::Opus;
 	int bitrate_ = 4000000;
+	CongestionThresholds congestionThresholds_;
+	bool tallyGating_ = false;
 	bool enableDataChannel_ = true;
 
 	// Audio/Video SSRC for outgoing media
 	uint32_t audioSsrc_ = 0;
 	uint32_t videoSsrc_ = 0;
-	uint16_t audioSeq_ = 0;
-	uint16_t videoSeq_ = 0;
+	uint32_t rtxSsrc_ = 0;
+	uint32_t fecSsrc_ = 0;
 	uint32_t audioTimestamp_ = 0;
-	uint32_t videoTimestamp_ = 0;
+	// Encoder pts to RTP for both streams, anchored to one wall-clock origin per session
+	MediaClock mediaClock_;
+
+	// One encoded video rendition; there is a single layer unless simulcast is enabled.
+	// Each layer is packetized once for all viewers and keeps its own GOP cache.
+	struct VideoLayer {
+		SimulcastLayer config;
+		// One packetizer per MTU tier; a frame is packetized only for the tiers viewers use
+		std::unique_ptr<RtpPacketizer> packetizers[RTP_MTU_TIER_COUNT];
+		GopCache gopCache;
+		ParameterSetCache parameterSets;
+		bool injectingParameterSets = false;
+		uint32_t nextTimestamp = 0;
+		uint16_t pictureId = 0;
+	};
+	void rebuildVideoLayers();
+
+	// Shared packetization stage: each frame is packetized once for all viewers
+	std::unique_ptr<RtpPacketizer> audioPacketizer_;
+	std::vector<std::unique_ptr<VideoLayer>> videoLayers_;
+	std::vector<SimulcastLayer> simulcastLayers_;
+	// Layers in the negotiated codec; an H.264 fallback layer, if any, is at this index
+	size_t primaryLayerCount_ = 1;
+	bool h264Fallback_ = true;
+	size_t gopMaxFrames_ = GopCache::DEFAULT_MAX_FRAMES;
+
+	// Per-viewer send queues drained by worker threads
+	MediaSendPool sendPool_;
+
+	// Spreads each viewer's packets at a multiple of its target bitrate
+	RtpPacer pacer_;
+	int pacingPercent_ = RtpPacer::DEFAULT_RATE_PERCENT;
+
+	int rtpMtu_ = 0;
+	bool rtpMtuProbing_ = false;
+
+	// Parity packets are built per viewer, since they cover that viewer's sequence numbers
+	bool fecEnabled_ = false;
+	std::unique_ptr<FlexfecEncoder> flexfec_;
+
+	// RED packets repeat earlier frames, so they are built once per frame on the enqueue path
+	bool audioRedEnabled_ = true;
+	std::unique_ptr<OpusRedEncoder> opusRed_;
+
+	// One layered encoder serves every viewer; the structure is learned from the frames
+	bool svcEnabled_ = false;
+	bool svcActive_ = false;
+	std::atomic<uint8_t> svcSpatialLayers_{1};
+	std::atomic<uint8_t> svcTemporalLayers_{1};
+
+	// Serializes video enqueueing and GOP caching against lane creation, so a new
+	// viewer's cached burst and the live stream join without a gap.
+	std::mutex gopMutex_;
+
+	KeyframeArbiter keyframeArbiter_;
 
 	// ICE candidate bundling
 	struct CandidateBundle {
@@ -161,6 +367,8 @@ private:
 	OnTrackCallback onTrack_;
 	OnDataChannelCallback onDataChannel_;
 	OnDataChannelMessageCallback onDataChannelMessage_;
+	OnKeyframeNeededCallback onKeyframeNeeded_;
+	OnViewerRequestedCallback onViewerRequested_;
 };
 
 } // namespace vdoninja
@@ -0,0 +1,159 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * RTCP feedback parsing implementation
+ */
+
+#include "vdoninja-rtcp.h"
+
+namespace vdoninja
+{
+
+namespace
+{
+
+constexpr uint8_t RTCP_SR = 200;
+constexpr uint8_t RTCP_RR = 201;
+constexpr uint8_t RTCP_RTPFB = 205;
+constexpr uint8_t RTCP_PSFB = 206;
+
+constexpr uint8_t RTPFB_NACK = 1;
+constexpr uint8_t PSFB_PLI = 1;
+constexpr uint8_t PSFB_FIR = 4;
+constexpr uint8_t PSFB_AFB = 15;
+
+constexpr size_t RTCP_HEADER_SIZE = 4;
+constexpr size_t REPORT_BLOCK_SIZE = 24;
+constexpr size_t SENDER_INFO_SIZE = 20;
+
+uint16_t read16(const uint8_t *p)
+{
+	return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t read32(const uint8_t *p)
+{
+	return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+	       (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+void parseReportBlocks(const uint8_t *body, size_t size, uint8_t count, RtcpFeedback &feedback)
+{
+	for (uint8_t i = 0; i < count && (i + 1) * REPORT_BLOCK_SIZE <= size; ++i) {
+		const uint8_t *block = body + i * REPORT_BLOCK_SIZE;
+		RtcpReportBlock report;
+		report.ssrc = read32(block);
+		report.fractionLost = block[4];
+		// 24-bit signed cumulative loss
+		int32_t lost = (block[5] << 16) | (block[6] << 8) | block[7];
+		if (lost & 0x800000) {
+			lost -= 0x1000000;
+		}
+		report.cumulativeLost = lost;
+		report.highestSequence = read32(block + 8);
+		report.jitter = read32(block + 12);
+		report.lastSenderReport = read32(block + 16);
+		report.delaySinceLastSenderReport = read32(block + 20);
+		feedback.reports.push_back(report);
+	}
+}
+
+void parseNack(const uint8_t *body, size_t size, RtcpFeedback &feedback)
+{
+	// Sender SSRC, media SSRC, then PID/BLP pairs
+	if (size < 8) {
+		return;
+	}
+	RtcpNack nack;
+	nack.mediaSsrc = read32(body + 4);
+	for (size_t offset = 8; offset + 4 <= size; offset += 4) {
+		const uint16_t pid = read16(body + offset);
+		const uint16_t blp = read16(body + offset + 2);
+		nack.sequences.push_back(pid);
+		for (uint16_t bit = 0; bit < 16; ++bit) {
+			if (blp & (1u << bit)) {
+				nack.sequences.push_back(static_cast<uint16_t>(pid + bit + 1));
+			}
+		}
+	}
+	if (!nack.sequences.empty()) {
+		feedback.nacks.push_back(std::move(nack));
+	}
+}
+
+void parseRemb(const uint8_t *body, size_t size, RtcpFeedback &feedback)
+{
+	// Sender SSRC, media SSRC (0), "REMB", num SSRC, BR exp/mantissa, SSRC list
+	if (size < 16 || body[8] != 'R' || body[9] != 'E' || body[10] != 'M' || body[11] != 'B') {
+		return;
+	}
+	const uint8_t ssrcCount = body[12];
+	const uint8_t exponent = body[13] >> 2;
+	const uint32_t mantissa = (static_cast<uint32_t>(body[13] & 0x03) << 16) | (body[14] << 8) | body[15];
+	feedback.rembBitrate = exponent < 46 ? static_cast<uint64_t>(mantissa) << exponent : UINT64_MAX;
+
+	feedback.rembSsrcs.clear();
+	for (uint8_t i = 0; i < ssrcCount && 16 + (i + 1) * 4u <= size; ++i) {
+		feedback.rembSsrcs.push_back(read32(body + 16 + i * 4));
+	}
+}
+
+} // namespace
+
+bool parseRtcp(const uint8_t *data, size_t size, RtcpFeedback &feedback)
+{
+	if (!data || size < RTCP_HEADER_SIZE) {
+		return false;
+	}
+
+	size_t offset = 0;
+	while (offset + RTCP_HEADER_SIZE <= size) {
+		const uint8_t *header = data + offset;
+		if ((header[0] >> 6) != 2) {
+			return false;
+		}
+		const uint8_t count = header[0] & 0x1F;
+		const uint8_t type = header[1];
+		const size_t length = (static_cast<size_t>(read16(header + 2)) + 1) * 4;
+		if (offset + length > size) {
+			return false;
+		}
+
+		const uint8_t *body = header + RTCP_HEADER_SIZE;
+		const size_t bodySize = length - RTCP_HEADER_SIZE;
+		switch (type) {
+		case RTCP_SR:
+			if (bodySize >= 4 + SENDER_INFO_SIZE) {
+				parseReportBlocks(body + 4 + SENDER_INFO_SIZE, bodySize - 4 - SENDER_INFO_SIZE, count, feedback);
+			}
+			break;
+		case RTCP_RR:
+			if (bodySize >= 4) {
+				parseReportBlocks(body + 4, bodySize - 4, count, feedback);
+			}
+			break;
+		case RTCP_RTPFB:
+			if (count == RTPFB_NACK) {
+				parseNack(body, bodySize, feedback);
+			}
+			break;
+		case RTCP_PSFB:
+			if (count == PSFB_PLI && bodySize >= 8) {
+				feedback.pliSsrcs.push_back(read32(body + 4));
+			} else if (count == PSFB_FIR) {
+				// FCI entries: SSRC, command sequence number, reserved
+				for (size_t fci = 8; fci + 8 <= bodySize; fci += 8) {
+					feedback.firSsrcs.push_back(read32(body + fci));
+				}
+			} else if (count == PSFB_AFB) {
+				parseRemb(body, bodySize, feedback);
+			}
+			break;
+		default:
+			break;
+		}
+		offset += length;
+	}
+	return true;
+}
+
+} // namespace vdoninja
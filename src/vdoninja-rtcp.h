@@ -0,0 +1,54 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * RTCP feedback parsing
+ *
+ * Decodes the compound RTCP packets viewers send back: receiver reports,
+ * generic NACKs, PLI/FIR keyframe requests and REMB bandwidth estimates.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace vdoninja
+{
+
+// One reception report block from an SR or RR (RFC 3550 section 6.4)
+struct RtcpReportBlock {
+	uint32_t ssrc = 0;
+	uint8_t fractionLost = 0; // Fixed point, lost fraction * 256
+	int32_t cumulativeLost = 0;
+	uint32_t highestSequence = 0;
+	uint32_t jitter = 0;
+	uint32_t lastSenderReport = 0;
+	uint32_t delaySinceLastSenderReport = 0;
+};
+
+// Generic NACK (RFC 4585 section 6.2.1), expanded to individual sequence numbers
+struct RtcpNack {
+	uint32_t mediaSsrc = 0;
+	std::vector<uint16_t> sequences;
+};
+
+struct RtcpFeedback {
+	std::vector<RtcpReportBlock> reports;
+	std::vector<RtcpNack> nacks;
+	std::vector<uint32_t> pliSsrcs;
+	std::vector<uint32_t> firSsrcs;
+	std::optional<uint64_t> rembBitrate;
+	std::vector<uint32_t> rembSsrcs;
+
+	bool empty() const
+	{
+		return reports.empty() && nacks.empty() && pliSsrcs.empty() && firSsrcs.empty() && !rembBitrate;
+	}
+};
+
+// Parses a (compound) RTCP packet. Unknown packet types are skipped; returns
+// false if the buffer is not well-formed RTCP.
+bool parseRtcp(const uint8_t *data, size_t size, RtcpFeedback &feedback);
+
+} // namespace vdoninja
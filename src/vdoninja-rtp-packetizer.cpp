@@ -0,0 +1,517 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Shared RTP packetization stage implementation
+ */
+
+#include "vdoninja-rtp-packetizer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vdoninja
+{
+
+namespace
+{
+
+constexpr uint8_t H264_NAL_FU_A = 28;
+constexpr size_t FU_A_HEADER_SIZE = 2;
+constexpr uint8_t H265_NAL_FU = 49;
+constexpr size_t H265_FU_HEADER_SIZE = 3;
+constexpr size_t VP8_DESCRIPTOR_SIZE = 4;
+constexpr size_t VP9_DESCRIPTOR_SIZE = 3;
+constexpr size_t AV1_AGGREGATION_HEADER_SIZE = 1;
+
+// AV1 OBU types that are never sent over RTP
+constexpr uint8_t AV1_OBU_TEMPORAL_DELIMITER = 2;
+constexpr uint8_t AV1_OBU_TILE_LIST = 8;
+constexpr uint8_t AV1_OBU_PADDING = 15;
+
+size_t leb128Size(size_t value)
+{
+	size_t bytes = 1;
+	while (value >= 0x80) {
+		value >>= 7;
+		++bytes;
+	}
+	return bytes;
+}
+
+size_t writeLeb128(uint8_t *out, size_t value)
+{
+	size_t written = 0;
+	do {
+		uint8_t byte = static_cast<uint8_t>(value & 0x7F);
+		value >>= 7;
+		if (value > 0) {
+			byte |= 0x80;
+		}
+		out[written++] = byte;
+	} while (value > 0);
+	return written;
+}
+
+bool readLeb128(const uint8_t *data, size_t size, size_t &offset, size_t &value)
+{
+	value = 0;
+	for (size_t i = 0; i < 8 && offset < size; ++i) {
+		const uint8_t byte = data[offset++];
+		value |= static_cast<size_t>(byte & 0x7F) << (7 * i);
+		if ((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// One OBU from a low-overhead (Section 5) AV1 bitstream. Over RTP the size field is
+// dropped, so the element is the rewritten header followed by the payload.
+struct Av1Obu {
+	uint8_t header[2] = {0, 0};
+	size_t headerSize = 0;
+	const uint8_t *payload = nullptr;
+	size_t payloadSize = 0;
+
+	size_t size() const { return headerSize + payloadSize; }
+	void copy(uint8_t *out, size_t from, size_t count) const
+	{
+		while (count > 0 && from < headerSize) {
+			*out++ = header[from++];
+			--count;
+		}
+		if (count > 0) {
+			std::memcpy(out, payload + (from - headerSize), count);
+		}
+	}
+};
+
+// Reads the next OBU at `offset` that should be transmitted. Returns false at the
+// end of the frame or on a malformed OBU.
+bool nextAv1Obu(const uint8_t *data, size_t size, size_t &offset, Av1Obu &obu)
+{
+	while (offset < size) {
+		const uint8_t header = data[offset];
+		const bool hasExtension = (header & 0x04) != 0;
+		const bool hasSizeField = (header & 0x02) != 0;
+		const uint8_t type = static_cast<uint8_t>((header >> 3) & 0x0F);
+
+		size_t cursor = offset + 1 + (hasExtension ? 1 : 0);
+		if (cursor > size) {
+			return false;
+		}
+		size_t payloadSize = size - cursor;
+		if (hasSizeField && (!readLeb128(data, size, cursor, payloadSize) || payloadSize > size - cursor)) {
+			return false;
+		}
+
+		obu.header[0] = static_cast<uint8_t>(header & ~0x02);
+		obu.header[1] = hasExtension ? data[offset + 1] : 0;
+		obu.headerSize = hasExtension ? 2 : 1;
+		obu.payload = data + cursor;
+		obu.payloadSize = payloadSize;
+		offset = cursor + payloadSize;
+
+		if (type != AV1_OBU_TEMPORAL_DELIMITER && type != AV1_OBU_TILE_LIST && type != AV1_OBU_PADDING) {
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace
+
+void writeRtpHeader(uint8_t *out, uint8_t payloadType, bool marker, uint16_t sequence, uint32_t timestamp,
+                    uint32_t ssrc)
+{
+	out[0] = 0x80; // V=2, P=0, X=0, CC=0
+	out[1] = static_cast<uint8_t>((marker ? 0x80 : 0x00) | (payloadType & 0x7F));
+	out[2] = static_cast<uint8_t>(sequence >> 8);
+	out[3] = static_cast<uint8_t>(sequence & 0xFF);
+	out[4] = static_cast<uint8_t>(timestamp >> 24);
+	out[5] = static_cast<uint8_t>(timestamp >> 16);
+	out[6] = static_cast<uint8_t>(timestamp >> 8);
+	out[7] = static_cast<uint8_t>(timestamp & 0xFF);
+	out[8] = static_cast<uint8_t>(ssrc >> 24);
+	out[9] = static_cast<uint8_t>(ssrc >> 16);
+	out[10] = static_cast<uint8_t>(ssrc >> 8);
+	out[11] = static_cast<uint8_t>(ssrc & 0xFF);
+}
+
+uint16_t readRtpSequence(const uint8_t *packet)
+{
+	return static_cast<uint16_t>((packet[2] << 8) | packet[3]);
+}
+
+uint32_t readRtpTimestamp(const uint8_t *packet)
+{
+	return (static_cast<uint32_t>(packet[4]) << 24) | (static_cast<uint32_t>(packet[5]) << 16) |
+	       (static_cast<uint32_t>(packet[6]) << 8) | static_cast<uint32_t>(packet[7]);
+}
+
+uint32_t readRtpSsrc(const uint8_t *packet)
+{
+	return (static_cast<uint32_t>(packet[8]) << 24) | (static_cast<uint32_t>(packet[9]) << 16) |
+	       (static_cast<uint32_t>(packet[10]) << 8) | static_cast<uint32_t>(packet[11]);
+}
+
+bool readRtpMarker(const uint8_t *packet)
+{
+	return (packet[1] & 0x80) != 0;
+}
+
+RtpPacketArena::RtpPacketArena(size_t slotSize, size_t slotsPerBlock)
+    : slotSize_(slotSize), slotsPerBlock_(std::max<size_t>(slotsPerBlock, 1))
+{
+}
+
+void RtpPacketArena::growLocked()
+{
+	blocks_.push_back(std::make_unique<uint8_t[]>(slotSize_ * slotsPerBlock_));
+	uint8_t *block = blocks_.back().get();
+	freeSlots_.reserve(blocks_.size() * slotsPerBlock_);
+	for (size_t i = 0; i < slotsPerBlock_; ++i) {
+		freeSlots_.push_back(block + i * slotSize_);
+	}
+}
+
+uint8_t *RtpPacketArena::acquireSlot()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (freeSlots_.empty()) {
+		growLocked();
+	}
+	uint8_t *slot = freeSlots_.back();
+	freeSlots_.pop_back();
+	return slot;
+}
+
+RtpFrame *RtpPacketArena::acquireFrame()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!freeFrames_.empty()) {
+			RtpFrame *frame = freeFrames_.back().release();
+			freeFrames_.pop_back();
+			return frame;
+		}
+	}
+	return new RtpFrame();
+}
+
+void RtpPacketArena::recycleFrame(RtpFrame *frame)
+{
+	std::unique_ptr<RtpFrame> owned(frame);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	// freeSlots_ always has room for every slot ever allocated, so this never reallocates.
+	for (const auto &packet : owned->packets) {
+		freeSlots_.push_back(packet.data);
+	}
+	owned->packets.clear();
+	owned->timestamp = 0;
+	owned->keyframe = false;
+
+	if (freeFrames_.size() < MAX_RECYCLED_FRAMES) {
+		freeFrames_.push_back(std::move(owned));
+	}
+}
+
+size_t RtpPacketArena::slotCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return blocks_.size() * slotsPerBlock_;
+}
+
+size_t RtpPacketArena::freeSlotCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return freeSlots_.size();
+}
+
+RtpPacketizer::RtpPacketizer(RtpPayloadFormat format, uint32_t ssrc, uint8_t payloadType, size_t maxPayload)
+    : format_(format), ssrc_(ssrc), payloadType_(payloadType), maxPayload_(std::max<size_t>(maxPayload, 64))
+{
+	// Opus packets cannot be fragmented, so the slot must hold the largest legal packet.
+	if (format_ == RtpPayloadFormat::Opus) {
+		maxPayload_ = std::max(maxPayload_, OPUS_MAX_PACKET_SIZE);
+	}
+	arena_ = std::make_shared<RtpPacketArena>(RTP_HEADER_SIZE + maxPayload_);
+
+	// The format never changes, so pick the specialised path once instead of per frame
+	switch (format_) {
+	case RtpPayloadFormat::H264:
+		packetizeFn_ = &RtpPacketizer::packetizeAs<RtpPayloadFormat::H264>;
+		break;
+	case RtpPayloadFormat::H265:
+		packetizeFn_ = &RtpPacketizer::packetizeAs<RtpPayloadFormat::H265>;
+		break;
+	case RtpPayloadFormat::VP8:
+		packetizeFn_ = &RtpPacketizer::packetizeAs<RtpPayloadFormat::VP8>;
+		break;
+	case RtpPayloadFormat::VP9:
+		packetizeFn_ = &RtpPacketizer::packetizeAs<RtpPayloadFormat::VP9>;
+		break;
+	case RtpPayloadFormat::AV1:
+		packetizeFn_ = &RtpPacketizer::packetizeAs<RtpPayloadFormat::AV1>;
+		break;
+	case RtpPayloadFormat::Opus:
+		packetizeFn_ = &RtpPacketizer::packetizeAs<RtpPayloadFormat::Opus>;
+		break;
+	}
+}
+
+template <RtpPayloadFormat Format>
+void RtpPacketizer::packetizeAs(RtpFrame &frame, const uint8_t *data, size_t size, uint16_t pictureId,
+                                const NalIndex *nals) const
+{
+	if constexpr (Format == RtpPayloadFormat::H264) {
+		packetizeH264(frame, data, size, nals);
+	} else if constexpr (Format == RtpPayloadFormat::H265) {
+		packetizeH265(frame, data, size, nals);
+	} else if constexpr (Format == RtpPayloadFormat::VP8) {
+		packetizeVp8(frame, data, size, pictureId);
+	} else if constexpr (Format == RtpPayloadFormat::VP9) {
+		packetizeVp9(frame, data, size, pictureId);
+	} else if constexpr (Format == RtpPayloadFormat::AV1) {
+		packetizeAv1(frame, data, size);
+	} else if (size <= maxPayload_) {
+		// Opus packets are sent whole
+		appendPacket(frame, nullptr, 0, data, size, false);
+	}
+}
+
+std::shared_ptr<const RtpFrame> RtpPacketizer::packetize(const uint8_t *data, size_t size, uint32_t timestamp,
+                                                         bool keyframe, uint16_t pictureId,
+                                                         const NalIndex *nals) const
+{
+	// Recycled frames keep their packet list capacity, so steady state needs no per-packet allocation.
+	std::shared_ptr<RtpFrame> frame(arena_->acquireFrame(),
+	                                [arena = arena_](RtpFrame *recycled) { arena->recycleFrame(recycled); });
+	frame->timestamp = timestamp;
+	frame->keyframe = keyframe;
+
+	if (!data || size == 0) {
+		return frame;
+	}
+
+	(this->*packetizeFn_)(*frame, data, size, pictureId, nals);
+
+	return frame;
+}
+
+void RtpPacketizer::packetizeH264(RtpFrame &frame, const uint8_t *data, size_t size, const NalIndex *nals) const
+{
+	// Frames from the output arrive pre-indexed; others are indexed into a per-thread scratch.
+	if (!nals) {
+		thread_local NalIndex scratch;
+		indexNalUnits(data, size, scratch);
+		nals = &scratch;
+	}
+
+	for (size_t n = 0; n < nals->size(); ++n) {
+		const NalSpan &span = (*nals)[n];
+		if (span.length == 0 || static_cast<size_t>(span.offset) + span.length > size) {
+			continue;
+		}
+		const uint8_t *nal = data + span.offset;
+		const size_t currentSize = span.length;
+		// The last packet of the access unit carries the marker bit.
+		const bool lastNal = n + 1 == nals->size();
+
+		if (currentSize <= maxPayload_) {
+			appendPacket(frame, nullptr, 0, nal, currentSize, lastNal);
+			continue;
+		}
+
+		// FU-A fragmentation (RFC 6184 section 5.8); the NAL header is carried in the FU header.
+		const uint8_t nalHeader = nal[0];
+		const size_t fragmentSize = maxPayload_ - FU_A_HEADER_SIZE;
+		size_t offset = 1;
+		while (offset < currentSize) {
+			const size_t chunk = std::min(fragmentSize, currentSize - offset);
+			const bool first = offset == 1;
+			const bool last = offset + chunk == currentSize;
+
+			uint8_t fuHeader[FU_A_HEADER_SIZE];
+			fuHeader[0] = static_cast<uint8_t>((nalHeader & 0xE0) | H264_NAL_FU_A);
+			fuHeader[1] = static_cast<uint8_t>((first ? 0x80 : 0x00) | (last ? 0x40 : 0x00) | (nalHeader & 0x1F));
+			appendPacket(frame, fuHeader, FU_A_HEADER_SIZE, nal + offset, chunk, lastNal && last);
+			offset += chunk;
+		}
+	}
+}
+
+void RtpPacketizer::packetizeH265(RtpFrame &frame, const uint8_t *data, size_t size, const NalIndex *nals) const
+{
+	if (!nals) {
+		thread_local NalIndex scratch;
+		indexNalUnits(data, size, scratch, NalFormat::H265);
+		nals = &scratch;
+	}
+
+	for (size_t n = 0; n < nals->size(); ++n) {
+		const NalSpan &span = (*nals)[n];
+		if (span.length < H265_NAL_HEADER_SIZE || static_cast<size_t>(span.offset) + span.length > size) {
+			continue;
+		}
+		const uint8_t *nal = data + span.offset;
+		const size_t currentSize = span.length;
+		const bool lastNal = n + 1 == nals->size();
+
+		if (currentSize <= maxPayload_) {
+			appendPacket(frame, nullptr, 0, nal, currentSize, lastNal);
+			continue;
+		}
+
+		// Fragmentation units (RFC 7798 section 4.4.3): a two-byte payload header with type 49
+		// keeps the F bit, layer id and TID of the NAL unit; the FU header carries its type.
+		const uint8_t nalType = nalUnitType(nal, NalFormat::H265);
+		const size_t fragmentSize = maxPayload_ - H265_FU_HEADER_SIZE;
+		size_t offset = H265_NAL_HEADER_SIZE;
+		while (offset < currentSize) {
+			const size_t chunk = std::min(fragmentSize, currentSize - offset);
+			const bool first = offset == H265_NAL_HEADER_SIZE;
+			const bool last = offset + chunk == currentSize;
+
+			uint8_t fuHeader[H265_FU_HEADER_SIZE];
+			fuHeader[0] = static_cast<uint8_t>((nal[0] & 0x81) | (H265_NAL_FU << 1));
+			fuHeader[1] = nal[1];
+			fuHeader[2] = static_cast<uint8_t>((first ? 0x80 : 0x00) | (last ? 0x40 : 0x00) | nalType);
+			appendPacket(frame, fuHeader, H265_FU_HEADER_SIZE, nal + offset, chunk, lastNal && last);
+			offset += chunk;
+		}
+	}
+}
+
+void RtpPacketizer::packetizeVp8(RtpFrame &frame, const uint8_t *data, size_t size, uint16_t pictureId) const
+{
+	// RFC 7741 payload descriptor with a 15-bit PictureID; S marks the start of the frame.
+	const size_t fragmentSize = maxPayload_ - VP8_DESCRIPTOR_SIZE;
+	size_t offset = 0;
+	while (offset < size) {
+		const size_t chunk = std::min(fragmentSize, size - offset);
+		const bool last = offset + chunk == size;
+
+		uint8_t descriptor[VP8_DESCRIPTOR_SIZE];
+		descriptor[0] = static_cast<uint8_t>(0x80 | (offset == 0 ? 0x10 : 0x00)); // X, S, PID=0
+		descriptor[1] = 0x80;                                                       // I
+		descriptor[2] = static_cast<uint8_t>(0x80 | ((pictureId >> 8) & 0x7F));    // M + PictureID
+		descriptor[3] = static_cast<uint8_t>(pictureId & 0xFF);
+		appendPacket(frame, descriptor, VP8_DESCRIPTOR_SIZE, data + offset, chunk, last);
+		offset += chunk;
+	}
+}
+
+void RtpPacketizer::packetizeVp9(RtpFrame &frame, const uint8_t *data, size_t size, uint16_t pictureId) const
+{
+	// RFC 9628 non-flexible descriptor with a 15-bit PictureID. B and E mark the first
+	// and last packet of the frame; P is set for inter-predicted frames.
+	const size_t fragmentSize = maxPayload_ - VP9_DESCRIPTOR_SIZE;
+	size_t offset = 0;
+	while (offset < size) {
+		const size_t chunk = std::min(fragmentSize, size - offset);
+		const bool last = offset + chunk == size;
+
+		uint8_t descriptor[VP9_DESCRIPTOR_SIZE];
+		descriptor[0] = static_cast<uint8_t>(0x80 | (frame.keyframe ? 0x00 : 0x40) | (offset == 0 ? 0x08 : 0x00) |
+		                                     (last ? 0x04 : 0x00));
+		descriptor[1] = static_cast<uint8_t>(0x80 | ((pictureId >> 8) & 0x7F));
+		descriptor[2] = static_cast<uint8_t>(pictureId & 0xFF);
+		appendPacket(frame, descriptor, VP9_DESCRIPTOR_SIZE, data + offset, chunk, last);
+		offset += chunk;
+	}
+}
+
+void RtpPacketizer::packetizeAv1(RtpFrame &frame, const uint8_t *data, size_t size) const
+{
+	// AV1 RTP payload format: an aggregation header followed by length-prefixed OBU
+	// elements (W=0). OBUs that do not fit are split across packets using the Z/Y bits.
+	const size_t capacity = RTP_HEADER_SIZE + maxPayload_;
+	RtpPacketSpan *packet = nullptr;
+
+	auto startPacket = [&](bool continuation) {
+		RtpPacketSpan span;
+		span.data = arena_->acquireSlot();
+		span.size = static_cast<uint32_t>(RTP_HEADER_SIZE + AV1_AGGREGATION_HEADER_SIZE);
+		writeRtpHeader(span.data, payloadType_, false, 0, frame.timestamp, ssrc_);
+		uint8_t aggregation = continuation ? 0x80 : 0x00;
+		if (frame.keyframe && frame.packets.empty()) {
+			aggregation |= 0x08; // N: first packet of a coded video sequence
+		}
+		span.data[RTP_HEADER_SIZE] = aggregation;
+		frame.packets.push_back(span);
+		packet = &frame.packets.back();
+	};
+
+	size_t offset = 0;
+	Av1Obu obu;
+	while (nextAv1Obu(data, size, offset, obu)) {
+		const size_t total = obu.size();
+		size_t written = 0;
+		while (written < total) {
+			// Need room for at least a one-byte length and one byte of data
+			if (!packet || capacity - packet->size < 2) {
+				if (packet && written > 0) {
+					packet->data[RTP_HEADER_SIZE] |= 0x40; // Y: last element continues
+				}
+				startPacket(written > 0);
+			}
+
+			const size_t room = capacity - packet->size;
+			size_t chunk = std::min(total - written, room - leb128Size(room));
+			chunk = std::min(chunk, room - leb128Size(chunk));
+
+			uint8_t *out = packet->data + packet->size;
+			const size_t lengthBytes = writeLeb128(out, chunk);
+			obu.copy(out + lengthBytes, written, chunk);
+			packet->size += static_cast<uint32_t>(lengthBytes + chunk);
+			written += chunk;
+		}
+	}
+
+	if (!frame.packets.empty()) {
+		frame.packets.back().data[1] |= 0x80;
+	}
+}
+
+void RtpPacketizer::appendPacket(RtpFrame &frame, const uint8_t *prefix, size_t prefixSize, const uint8_t *payload,
+                                 size_t payloadSize, bool marker) const
+{
+	RtpPacketSpan span;
+	span.data = arena_->acquireSlot();
+	span.size = static_cast<uint32_t>(RTP_HEADER_SIZE + prefixSize + payloadSize);
+
+	writeRtpHeader(span.data, payloadType_, marker, 0, frame.timestamp, ssrc_);
+	if (prefixSize > 0) {
+		std::memcpy(span.data + RTP_HEADER_SIZE, prefix, prefixSize);
+	}
+	std::memcpy(span.data + RTP_HEADER_SIZE + prefixSize, payload, payloadSize);
+
+	frame.packets.push_back(span);
+}
+
+RtpSequencer::RtpSequencer(uint16_t initialSequence) : sequence_(initialSequence) {}
+
+const uint8_t *RtpSequencer::stamp(const RtpFrame &frame, size_t index, size_t &size)
+{
+	size = frame.packetSize(index);
+	if (scratch_.size() < size) {
+		scratch_.resize(size);
+	}
+
+	std::memcpy(scratch_.data(), frame.packetData(index), size);
+	scratch_[2] = static_cast<uint8_t>(sequence_ >> 8);
+	scratch_[3] = static_cast<uint8_t>(sequence_ & 0xFF);
+	++sequence_;
+
+	return scratch_.data();
+}
+
+uint16_t RtpSequencer::reserve(size_t count)
+{
+	const uint16_t first = sequence_;
+	sequence_ = static_cast<uint16_t>(sequence_ + count);
+	return first;
+}
+
+} // namespace vdoninja
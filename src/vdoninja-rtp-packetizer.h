@@ -0,0 +1,153 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Shared RTP packetization stage
+ *
+ * Each encoded frame is split into RTP packets once and shared by every viewer.
+ * Viewers only stamp their own sequence number onto a copy of each packet.
+ * Packets are written into fixed-size slots from a pooled arena, so steady-state
+ * packetization does not touch the heap.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "vdoninja-nal-indexer.h"
+
+namespace vdoninja
+{
+
+constexpr size_t RTP_HEADER_SIZE = 12;
+constexpr size_t DEFAULT_RTP_MAX_PAYLOAD = 1200;
+constexpr size_t OPUS_MAX_PACKET_SIZE = 1275;
+
+// Payload formats understood by the shared packetizer
+enum class RtpPayloadFormat { H264, H265, VP8, VP9, AV1, Opus };
+
+// A single RTP packet (header + payload) stored in an arena slot
+struct RtpPacketSpan {
+	uint8_t *data = nullptr;
+	uint32_t size = 0;
+};
+
+// An encoded frame split into complete RTP packets. The sequence number field
+// is left zero and is stamped per viewer.
+struct RtpFrame {
+	std::vector<RtpPacketSpan> packets;
+	uint32_t timestamp = 0;
+	bool keyframe = false;
+
+	size_t packetCount() const { return packets.size(); }
+	const uint8_t *packetData(size_t index) const { return packets[index].data; }
+	size_t packetSize(size_t index) const { return packets[index].size; }
+};
+
+// Frame whose packets point into its own storage rather than the arena, for packets
+// built outside the packetizer (FEC parity, RED)
+struct OwnedRtpFrame : RtpFrame {
+	std::vector<uint8_t> storage;
+};
+
+// Pool of fixed-size packet slots and recycled RtpFrame objects. Grows in
+// blocks on demand and never shrinks while frames are alive.
+class RtpPacketArena
+{
+public:
+	explicit RtpPacketArena(size_t slotSize, size_t slotsPerBlock = 128);
+
+	uint8_t *acquireSlot();
+	RtpFrame *acquireFrame();
+	// Returns the frame's slots to the pool and keeps the frame for reuse.
+	void recycleFrame(RtpFrame *frame);
+
+	size_t slotSize() const { return slotSize_; }
+	size_t slotCount() const;
+	size_t freeSlotCount() const;
+
+private:
+	void growLocked();
+
+	static constexpr size_t MAX_RECYCLED_FRAMES = 64;
+
+	mutable std::mutex mutex_;
+	size_t slotSize_;
+	size_t slotsPerBlock_;
+	std::vector<std::unique_ptr<uint8_t[]>> blocks_;
+	std::vector<uint8_t *> freeSlots_;
+	std::vector<std::unique_ptr<RtpFrame>> freeFrames_;
+};
+
+class RtpPacketizer
+{
+public:
+	RtpPacketizer(RtpPayloadFormat format, uint32_t ssrc, uint8_t payloadType,
+	              size_t maxPayload = DEFAULT_RTP_MAX_PAYLOAD);
+
+	// Packetize one encoded frame. H.264/H.265 input is Annex-B; VP8/VP9 input is one
+	// encoded frame; AV1 input is a temporal unit of size-delimited OBUs; Opus
+	// input is one packet. pictureId feeds the VP8/VP9
+	// payload descriptors and must increase by one per video frame. nals may carry
+	// a precomputed H.264/H.265 index of data so the payload is not scanned again.
+	std::shared_ptr<const RtpFrame> packetize(const uint8_t *data, size_t size, uint32_t timestamp, bool keyframe,
+	                                          uint16_t pictureId = 0, const NalIndex *nals = nullptr) const;
+
+	RtpPayloadFormat format() const { return format_; }
+	uint32_t ssrc() const { return ssrc_; }
+	uint8_t payloadType() const { return payloadType_; }
+	size_t maxPayload() const { return maxPayload_; }
+	const RtpPacketArena &arena() const { return *arena_; }
+
+private:
+	using PacketizeFn = void (RtpPacketizer::*)(RtpFrame &, const uint8_t *, size_t, uint16_t, const NalIndex *) const;
+	template <RtpPayloadFormat Format>
+	void packetizeAs(RtpFrame &frame, const uint8_t *data, size_t size, uint16_t pictureId,
+	                 const NalIndex *nals) const;
+	void packetizeH264(RtpFrame &frame, const uint8_t *data, size_t size, const NalIndex *nals) const;
+	void packetizeH265(RtpFrame &frame, const uint8_t *data, size_t size, const NalIndex *nals) const;
+	void packetizeVp8(RtpFrame &frame, const uint8_t *data, size_t size, uint16_t pictureId) const;
+	void packetizeVp9(RtpFrame &frame, const uint8_t *data, size_t size, uint16_t pictureId) const;
+	void packetizeAv1(RtpFrame &frame, const uint8_t *data, size_t size) const;
+	void appendPacket(RtpFrame &frame, const uint8_t *prefix, size_t prefixSize, const uint8_t *payload,
+	                  size_t payloadSize, bool marker) const;
+
+	RtpPayloadFormat format_;
+	uint32_t ssrc_;
+	uint8_t payloadType_;
+	size_t maxPayload_;
+	std::shared_ptr<RtpPacketArena> arena_;
+	PacketizeFn packetizeFn_ = nullptr;
+};
+
+// Per-viewer RTP sequence state. Copies shared packets into a reusable scratch
+// buffer and writes this viewer's sequence number into the copy.
+class RtpSequencer
+{
+public:
+	explicit RtpSequencer(uint16_t initialSequence = 0);
+
+	// Returns a pointer to the stamped copy, valid until the next call.
+	const uint8_t *stamp(const RtpFrame &frame, size_t index, size_t &size);
+
+	// Claim sequence numbers for packets sent later (e.g. by the pacer); returns the first one.
+	uint16_t reserve(size_t count);
+
+	uint16_t nextSequence() const { return sequence_; }
+
+private:
+	uint16_t sequence_;
+	std::vector<uint8_t> scratch_;
+};
+
+// Helpers for fixed RTP header fields
+void writeRtpHeader(uint8_t *out, uint8_t payloadType, bool marker, uint16_t sequence, uint32_t timestamp,
+                    uint32_t ssrc);
+uint16_t readRtpSequence(const uint8_t *packet);
+uint32_t readRtpTimestamp(const uint8_t *packet);
+uint32_t readRtpSsrc(const uint8_t *packet);
+bool readRtpMarker(const uint8_t *packet);
+
+} // namespace vdoninja
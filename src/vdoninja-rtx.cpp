@@ -0,0 +1,145 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Shared retransmission history and RTX stream implementation
+ */
+
+#include "vdoninja-rtx.h"
+
+#include <cstring>
+
+namespace vdoninja
+{
+
+namespace
+{
+
+size_t roundUpPowerOfTwo(size_t value)
+{
+	size_t result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+} // namespace
+
+RtpHistory::RtpHistory(size_t capacity)
+    : entries_(roundUpPowerOfTwo(capacity > 0 ? capacity : 1)), mask_(entries_.size() - 1)
+{
+}
+
+void RtpHistory::recordFrame(uint16_t firstSequence, const std::shared_ptr<const RtpFrame> &frame)
+{
+	if (!frame) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (size_t i = 0; i < frame->packetCount(); ++i) {
+		const uint16_t sequence = static_cast<uint16_t>(firstSequence + i);
+		Entry &entry = entries_[sequence & mask_];
+		entry.frame = frame;
+		entry.index = static_cast<uint32_t>(i);
+		entry.sequence = sequence;
+	}
+}
+
+std::shared_ptr<const RtpFrame> RtpHistory::find(uint16_t sequence, size_t &index) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	const Entry &entry = entries_[sequence & mask_];
+	if (!entry.frame || entry.sequence != sequence) {
+		return nullptr;
+	}
+	index = entry.index;
+	return entry.frame;
+}
+
+RtxStream::RtxStream(uint32_t ssrc, uint8_t payloadType, uint16_t initialSequence)
+    : ssrc_(ssrc), payloadType_(payloadType), sequence_(initialSequence)
+{
+}
+
+bool RtxStream::wrap(const uint8_t *packet, size_t size, uint16_t originalSequence, std::vector<uint8_t> &out)
+{
+	const size_t headerLength = rtpHeaderLength(packet, size);
+	if (headerLength == 0) {
+		return false;
+	}
+
+	// RFC 4588: same header with the RTX payload type, SSRC and sequence, then the
+	// original sequence number ahead of the original payload
+	out.resize(size + 2);
+	std::memcpy(out.data(), packet, headerLength);
+	out[1] = static_cast<uint8_t>((packet[1] & 0x80) | (payloadType_ & 0x7F));
+	const uint16_t sequence = sequence_.fetch_add(1, std::memory_order_relaxed);
+	out[2] = static_cast<uint8_t>(sequence >> 8);
+	out[3] = static_cast<uint8_t>(sequence);
+	out[8] = static_cast<uint8_t>(ssrc_ >> 24);
+	out[9] = static_cast<uint8_t>(ssrc_ >> 16);
+	out[10] = static_cast<uint8_t>(ssrc_ >> 8);
+	out[11] = static_cast<uint8_t>(ssrc_);
+	out[headerLength] = static_cast<uint8_t>(originalSequence >> 8);
+	out[headerLength + 1] = static_cast<uint8_t>(originalSequence);
+	std::memcpy(out.data() + headerLength + 2, packet + headerLength, size - headerLength);
+	return true;
+}
+
+void RtxStream::countRequest(bool found)
+{
+	requested_++;
+	if (found) {
+		retransmitted_++;
+	} else {
+		missed_++;
+	}
+}
+
+RtxStats RtxStream::stats() const
+{
+	RtxStats stats;
+	stats.requestedPackets = requested_;
+	stats.retransmittedPackets = retransmitted_;
+	stats.missedPackets = missed_;
+	return stats;
+}
+
+size_t rtpHeaderLength(const uint8_t *packet, size_t size)
+{
+	if (!packet || size < RTP_HEADER_SIZE || (packet[0] >> 6) != 2) {
+		return 0;
+	}
+
+	size_t length = RTP_HEADER_SIZE + 4 * (packet[0] & 0x0F);
+	if (packet[0] & 0x10) {
+		if (size < length + 4) {
+			return 0;
+		}
+		const size_t words = (static_cast<size_t>(packet[length + 2]) << 8) | packet[length + 3];
+		length += 4 + 4 * words;
+	}
+	return length <= size ? length : 0;
+}
+
+bool sdpHasPayloadFormat(const std::string &sdp, int payloadType, const std::string &format)
+{
+	const std::string prefix = "a=rtpmap:" + std::to_string(payloadType) + " ";
+	const std::string encoding = format + "/";
+	size_t pos = sdp.find(prefix);
+	while (pos != std::string::npos) {
+		if (pos == 0 || sdp[pos - 1] == '\n') {
+			const size_t codec = pos + prefix.size();
+			return sdp.compare(codec, encoding.size(), encoding) == 0;
+		}
+		pos = sdp.find(prefix, pos + 1);
+	}
+	return false;
+}
+
+bool sdpHasRtxPayload(const std::string &sdp, int payloadType)
+{
+	return sdpHasPayloadFormat(sdp, payloadType, "rtx");
+}
+
+} // namespace vdoninja
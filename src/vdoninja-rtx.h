@@ -0,0 +1,95 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Shared retransmission history and RTX (RFC 4588) stream
+ *
+ * Every viewer receives the same packetized frames with its own sequence
+ * numbers, so the history only maps each viewer's sequence numbers onto the
+ * shared, ref-counted frames instead of keeping a private copy of every packet.
+ * Retransmissions go out on a separate RTX SSRC so they do not disturb the
+ * primary stream's sequence numbers or statistics.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vdoninja-rtp-packetizer.h"
+
+namespace vdoninja
+{
+
+// Per-viewer index from sent sequence numbers to packets of shared frames
+class RtpHistory
+{
+public:
+	static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+	// Capacity is rounded up to a power of two
+	explicit RtpHistory(size_t capacity = DEFAULT_CAPACITY);
+
+	// Record a frame whose packets were sent as firstSequence, firstSequence + 1, ...
+	void recordFrame(uint16_t firstSequence, const std::shared_ptr<const RtpFrame> &frame);
+
+	// Returns the frame holding the packet sent as `sequence`, or null if it has left the history
+	std::shared_ptr<const RtpFrame> find(uint16_t sequence, size_t &index) const;
+
+	size_t capacity() const { return entries_.size(); }
+
+private:
+	struct Entry {
+		std::shared_ptr<const RtpFrame> frame;
+		uint32_t index = 0;
+		uint16_t sequence = 0;
+	};
+
+	mutable std::mutex mutex_;
+	std::vector<Entry> entries_;
+	size_t mask_;
+};
+
+struct RtxStats {
+	uint64_t requestedPackets = 0;
+	uint64_t retransmittedPackets = 0;
+	uint64_t missedPackets = 0;
+};
+
+// Wraps original packets into RTX packets with their own SSRC and sequence numbers
+class RtxStream
+{
+public:
+	RtxStream(uint32_t ssrc, uint8_t payloadType, uint16_t initialSequence);
+
+	// Build the retransmission of `packet` (an original with its sequence field unset),
+	// which the viewer received as originalSequence. Returns false for malformed input.
+	bool wrap(const uint8_t *packet, size_t size, uint16_t originalSequence, std::vector<uint8_t> &out);
+
+	void countRequest(bool found);
+	RtxStats stats() const;
+
+	uint32_t ssrc() const { return ssrc_; }
+	uint8_t payloadType() const { return payloadType_; }
+
+private:
+	uint32_t ssrc_;
+	uint8_t payloadType_;
+	std::atomic<uint16_t> sequence_;
+	std::atomic<uint64_t> requested_{0};
+	std::atomic<uint64_t> retransmitted_{0};
+	std::atomic<uint64_t> missed_{0};
+};
+
+// Length of the RTP header including CSRCs and header extension, or 0 if malformed
+size_t rtpHeaderLength(const uint8_t *packet, size_t size);
+
+// True if the SDP maps `payloadType` to the given encoding name (e.g. "rtx"), i.e. the
+// remote side accepted the stream we offered with it
+bool sdpHasPayloadFormat(const std::string &sdp, int payloadType, const std::string &format);
+bool sdpHasRtxPayload(const std::string &sdp, int payloadType);
+
+} // namespace vdoninja
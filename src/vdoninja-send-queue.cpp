@@ -0,0 +1,411 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Asynchronous per-viewer media send queues implementation
+ */
+
+#include "vdoninja-send-queue.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "vdoninja-utils.h"
+
+namespace vdoninja
+{
+
+namespace
+{
+
+size_t defaultWorkerCount()
+{
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	return std::clamp<size_t>(hardwareThreads / 2, 1, 4);
+}
+
+void updateMax(std::atomic<int64_t> &target, int64_t value)
+{
+	int64_t current = target.load(std::memory_order_relaxed);
+	while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+	}
+}
+
+} // namespace
+
+MediaSendPool::MediaSendPool(size_t workerCount, size_t laneCapacity)
+    : laneCapacity_(std::max<size_t>(laneCapacity, 1))
+{
+	const size_t count = workerCount > 0 ? workerCount : defaultWorkerCount();
+	workers_.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		workers_.push_back(std::make_unique<Worker>());
+	}
+}
+
+MediaSendPool::~MediaSendPool()
+{
+	stop();
+}
+
+int64_t MediaSendPool::nowUs()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+	           std::chrono::steady_clock::now().time_since_epoch())
+	    .count();
+}
+
+void MediaSendPool::start()
+{
+	std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+	if (running_) {
+		return;
+	}
+
+	for (auto &worker : workers_) {
+		{
+			std::lock_guard<std::mutex> lock(worker->mutex);
+			worker->stopping = false;
+		}
+		Worker *raw = worker.get();
+		worker->thread = std::thread([this, raw]() { workerLoop(*raw); });
+	}
+	running_ = true;
+
+	logInfo("Media send pool started with %zu worker(s)", workers_.size());
+}
+
+void MediaSendPool::setLaneCapacity(size_t capacity)
+{
+	std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+	if (!running_) {
+		laneCapacity_ = std::max<size_t>(capacity, 1);
+	}
+}
+
+void MediaSendPool::stop()
+{
+	std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+	if (!running_) {
+		return;
+	}
+	running_ = false;
+
+	for (auto &worker : workers_) {
+		{
+			std::lock_guard<std::mutex> lock(worker->mutex);
+			worker->stopping = true;
+		}
+		worker->cv.notify_all();
+	}
+	for (auto &worker : workers_) {
+		if (worker->thread.joinable()) {
+			worker->thread.join();
+		}
+	}
+
+	clearLanes();
+	logInfo("Media send pool stopped");
+}
+
+bool MediaSendPool::isRunning() const
+{
+	return running_;
+}
+
+void MediaSendPool::addLane(const std::string &key, OutboundFrameSink sink,
+                            const std::vector<std::shared_ptr<const OutboundFrame>> &primer,
+                            OutboundFrameFilter filter, uint32_t sendGroup)
+{
+	if (hasLane(key)) {
+		return;
+	}
+
+	// Pin the lane to the worker with the fewest viewers
+	Worker *target = nullptr;
+	size_t fewest = 0;
+	for (auto &worker : workers_) {
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		if (!target || worker->lanes.size() < fewest) {
+			target = worker.get();
+			fewest = worker->lanes.size();
+		}
+	}
+
+	auto lane = std::make_shared<Lane>();
+	lane->key = key;
+	lane->sink = std::move(sink);
+	lane->filter = std::move(filter);
+	lane->sendGroup = sendGroup;
+	for (const auto &frame : primer) {
+		if (lane->queue.size() >= laneCapacity_) {
+			break;
+		}
+		lane->queue.push_back(frame);
+	}
+	const bool primed = !lane->queue.empty();
+
+	{
+		std::lock_guard<std::mutex> lock(target->mutex);
+		target->lanes.push_back(std::move(lane));
+	}
+	if (primed) {
+		target->cv.notify_one();
+	}
+}
+
+void MediaSendPool::removeLane(const std::string &key)
+{
+	for (auto &worker : workers_) {
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		auto &lanes = worker->lanes;
+		lanes.erase(std::remove_if(lanes.begin(), lanes.end(),
+		                           [&key](const std::shared_ptr<Lane> &lane) { return lane->key == key; }),
+		            lanes.end());
+	}
+}
+
+bool MediaSendPool::primeLane(const std::string &key, const std::vector<std::shared_ptr<const OutboundFrame>> &frames)
+{
+	if (frames.empty()) {
+		return false;
+	}
+
+	for (auto &worker : workers_) {
+		bool primed = false;
+		{
+			std::lock_guard<std::mutex> lock(worker->mutex);
+			for (auto &lane : worker->lanes) {
+				if (lane->key != key) {
+					continue;
+				}
+				auto &queue = lane->queue;
+				queue.erase(std::remove_if(queue.begin(), queue.end(),
+				                           [&frames](const std::shared_ptr<const OutboundFrame> &queued) {
+					                           return std::find(frames.begin(), frames.end(), queued) !=
+					                                  frames.end();
+				                           }),
+				            queue.end());
+				queue.insert(queue.begin(), frames.begin(), frames.end());
+				// The replay starts with a keyframe; if the tail had to go, wait for the next one
+				lane->waitingForKeyframe = false;
+				while (queue.size() > laneCapacity_) {
+					queue.pop_back();
+					droppedFrames_++;
+					lane->waitingForKeyframe = true;
+				}
+				primed = true;
+				break;
+			}
+		}
+		if (primed) {
+			worker->cv.notify_one();
+			return true;
+		}
+	}
+	return false;
+}
+
+void MediaSendPool::clearLanes()
+{
+	for (auto &worker : workers_) {
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		worker->lanes.clear();
+		worker->nextLane = 0;
+	}
+}
+
+bool MediaSendPool::hasLane(const std::string &key) const
+{
+	for (const auto &worker : workers_) {
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		for (const auto &lane : worker->lanes) {
+			if (lane->key == key) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void MediaSendPool::enqueue(std::shared_ptr<const OutboundFrame> frame)
+{
+	if (!frame || !running_) {
+		return;
+	}
+
+	const int64_t startUs = nowUs();
+
+	for (auto &worker : workers_) {
+		bool queued = false;
+		{
+			std::lock_guard<std::mutex> lock(worker->mutex);
+			for (auto &lane : worker->lanes) {
+				pushToLane(*lane, frame);
+				queued = true;
+			}
+		}
+		if (queued) {
+			worker->cv.notify_one();
+		}
+	}
+
+	enqueuedFrames_++;
+	const int64_t elapsedUs = nowUs() - startUs;
+	lastEnqueueUs_ = elapsedUs;
+	updateMax(maxEnqueueUs_, elapsedUs);
+}
+
+void MediaSendPool::pushToLane(Lane &lane, const std::shared_ptr<const OutboundFrame> &frame)
+{
+	if (lane.filter && !lane.filter(*frame)) {
+		return;
+	}
+
+	const bool video = frame->kind == MediaKind::Video;
+
+	// After an overflow, video resumes only at a keyframe so the decoder never sees a broken reference chain.
+	if (video && lane.waitingForKeyframe) {
+		if (!frame->keyframe) {
+			droppedFrames_++;
+			return;
+		}
+		lane.waitingForKeyframe = false;
+	}
+
+	if (lane.queue.size() >= laneCapacity_) {
+		const size_t before = lane.queue.size();
+		lane.queue.erase(std::remove_if(lane.queue.begin(), lane.queue.end(),
+		                                [](const std::shared_ptr<const OutboundFrame> &queued) {
+			                                return queued->kind == MediaKind::Video;
+		                                }),
+		                 lane.queue.end());
+		const size_t flushed = before - lane.queue.size();
+		droppedFrames_ += flushed;
+		if (flushed > 0) {
+			logWarning("Send queue for %s overflowed; dropped %zu queued video frame(s)", lane.key.c_str(),
+			           flushed);
+			if (video && !frame->keyframe) {
+				lane.waitingForKeyframe = true;
+				droppedFrames_++;
+				return;
+			}
+		}
+		while (lane.queue.size() >= laneCapacity_) {
+			lane.queue.pop_front();
+			droppedFrames_++;
+		}
+	}
+
+	lane.queue.push_back(frame);
+}
+
+void MediaSendPool::workerLoop(Worker &worker)
+{
+	std::vector<std::shared_ptr<Lane>> batch;
+	std::unique_lock<std::mutex> lock(worker.mutex);
+	while (true) {
+		worker.cv.wait(lock, [&worker]() {
+			if (worker.stopping) {
+				return true;
+			}
+			for (const auto &lane : worker.lanes) {
+				if (!lane->queue.empty()) {
+					return true;
+				}
+			}
+			return false;
+		});
+		if (worker.stopping) {
+			break;
+		}
+
+		// Round-robin across this worker's lanes so one busy viewer cannot starve the others
+		std::shared_ptr<Lane> lane;
+		const size_t laneCount = worker.lanes.size();
+		for (size_t i = 0; i < laneCount; ++i) {
+			const size_t index = (worker.nextLane + i) % laneCount;
+			if (!worker.lanes[index]->queue.empty()) {
+				lane = worker.lanes[index];
+				worker.nextLane = (index + 1) % laneCount;
+				break;
+			}
+		}
+		if (!lane) {
+			continue;
+		}
+
+		auto frame = std::move(lane->queue.front());
+		lane->queue.pop_front();
+
+		// Serve the same frame to the rest of the lane's send group in one pass, so one
+		// specialised path runs back to back while the shared packets are still in cache.
+		batch.clear();
+		batch.push_back(lane);
+		if (lane->sendGroup != 0) {
+			for (const auto &other : worker.lanes) {
+				if (other != lane && other->sendGroup == lane->sendGroup && !other->queue.empty() &&
+				    other->queue.front() == frame) {
+					other->queue.pop_front();
+					batch.push_back(other);
+				}
+			}
+		}
+		lock.unlock();
+
+		const int64_t delayUs = nowUs() - frame->enqueuedAtUs;
+		dequeuedFrames_ += batch.size();
+		totalQueueDelayUs_ += delayUs * static_cast<int64_t>(batch.size());
+		updateMax(maxQueueDelayUs_, delayUs);
+		if (batch.size() > 1) {
+			batches_++;
+		}
+
+		for (const auto &target : batch) {
+			try {
+				target->sink(*frame);
+			} catch (const std::exception &e) {
+				logError("Send worker failed for %s: %s", target->key.c_str(), e.what());
+			}
+		}
+
+		lock.lock();
+	}
+}
+
+size_t MediaSendPool::laneDepth(const std::string &key) const
+{
+	for (const auto &worker : workers_) {
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		for (const auto &lane : worker->lanes) {
+			if (lane->key == key) {
+				return lane->queue.size();
+			}
+		}
+	}
+	return 0;
+}
+
+SendQueueStats MediaSendPool::getStats() const
+{
+	SendQueueStats stats;
+	stats.workers = workers_.size();
+	for (const auto &worker : workers_) {
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		stats.lanes += worker->lanes.size();
+		for (const auto &lane : worker->lanes) {
+			stats.queuedFrames += lane->queue.size();
+			stats.maxLaneDepth = std::max(stats.maxLaneDepth, lane->queue.size());
+		}
+	}
+
+	stats.enqueuedFrames = enqueuedFrames_;
+	stats.droppedFrames = droppedFrames_;
+	stats.batches = batches_;
+	stats.lastEnqueueUs = lastEnqueueUs_;
+	stats.maxEnqueueUs = maxEnqueueUs_;
+	const uint64_t dequeued = dequeuedFrames_;
+	stats.avgQueueDelayUs = dequeued > 0 ? totalQueueDelayUs_ / static_cast<int64_t>(dequeued) : 0;
+	stats.maxQueueDelayUs = maxQueueDelayUs_;
+	return stats;
+}
+
+} // namespace vdoninja
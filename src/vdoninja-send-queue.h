@@ -0,0 +1,194 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Asynchronous per-viewer media send queues
+ *
+ * The OBS encoder thread hands each encoded frame to the pool once. Every viewer
+ * has a bounded queue ("lane") that is drained by one of a small set of worker
+ * threads, so a slow viewer only delays itself and never the encoder callback.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "vdoninja-encoded-packet.h"
+#include "vdoninja-mtu.h"
+#include "vdoninja-opus-red.h"
+#include "vdoninja-rtp-packetizer.h"
+#include "vdoninja-svc.h"
+
+namespace vdoninja
+{
+
+enum class MediaKind { Audio, Video };
+
+// Encoded frame shared by every viewer lane. The RTP packetization is computed
+// at most once per MTU tier and SVC spatial layer count, by whichever worker
+// reaches the frame first.
+class OutboundFrame
+{
+public:
+	MediaKind kind = MediaKind::Video;
+	EncodedPacketRef packet; // Encoder payload, shared rather than copied
+	uint32_t timestamp = 0;
+	bool keyframe = false;
+	uint16_t pictureId = 0; // VP8/VP9 picture ID, assigned in encoder order
+	uint8_t layer = 0;      // Simulcast layer index, 0 = full quality
+	NalIndex nals;          // H.264 NAL spans within the payload, empty if not indexed
+	OpusRedPackets red;     // Audio RED variants, built at enqueue since they depend on earlier frames
+	SvcFrameInfo svc;       // SVC layers, parsed at enqueue when SVC is enabled
+	int64_t enqueuedAtUs = 0;
+
+	const uint8_t *data() const { return packet ? packet->data() : nullptr; }
+	size_t size() const { return packet ? packet->size() : 0; }
+
+	template <typename Packetize> const RtpFrame &rtp(Packetize &&packetize) const
+	{
+		return rtp(RtpMtuTier::Default, std::forward<Packetize>(packetize));
+	}
+
+	template <typename Packetize> const RtpFrame &rtp(RtpMtuTier tier, Packetize &&packetize) const
+	{
+		return rtp(tier, svc.spatialLayers, std::forward<Packetize>(packetize));
+	}
+
+	// Packetization of the lowest `spatialLayers` SVC spatial layers; all of them for
+	// frames without upper layers to leave out.
+	template <typename Packetize>
+	const RtpFrame &rtp(RtpMtuTier tier, size_t spatialLayers, Packetize &&packetize) const
+	{
+		const size_t index = variantIndex(tier, spatialLayers);
+		std::call_once(rtpOnce_[index], [&]() { rtp_[index] = packetize(*this); });
+		return *rtp_[index];
+	}
+
+	// The packetized frame once rtp() has run for the tier, kept alive by retransmission history
+	std::shared_ptr<const RtpFrame> sharedRtp(RtpMtuTier tier = RtpMtuTier::Default) const
+	{
+		return sharedRtp(tier, svc.spatialLayers);
+	}
+
+	std::shared_ptr<const RtpFrame> sharedRtp(RtpMtuTier tier, size_t spatialLayers) const
+	{
+		return rtp_[variantIndex(tier, spatialLayers)];
+	}
+
+private:
+	static constexpr size_t VARIANT_COUNT = RTP_MTU_TIER_COUNT * SVC_MAX_SPATIAL_LAYERS;
+
+	size_t variantIndex(RtpMtuTier tier, size_t spatialLayers) const
+	{
+		// The complete frame always uses the last slot of its tier
+		const size_t layers = spatialLayers < svc.spatialLayers ? spatialLayers : SVC_MAX_SPATIAL_LAYERS;
+		return static_cast<size_t>(tier) * SVC_MAX_SPATIAL_LAYERS + (layers > 0 ? layers - 1 : 0);
+	}
+
+	mutable std::once_flag rtpOnce_[VARIANT_COUNT];
+	mutable std::shared_ptr<const RtpFrame> rtp_[VARIANT_COUNT];
+};
+
+using OutboundFrameSink = std::function<void(const OutboundFrame &frame)>;
+// Runs on the enqueue path, in frame order; returning false skips the frame for that lane.
+using OutboundFrameFilter = std::function<bool(const OutboundFrame &frame)>;
+
+// Aggregate queue metrics
+struct SendQueueStats {
+	size_t workers = 0;
+	size_t lanes = 0;
+	size_t queuedFrames = 0;
+	size_t maxLaneDepth = 0;
+	uint64_t enqueuedFrames = 0;
+	uint64_t droppedFrames = 0;
+	uint64_t batches = 0; // Worker wake-ups that served a frame to two or more lanes of one send group
+	int64_t lastEnqueueUs = 0;
+	int64_t maxEnqueueUs = 0;
+	int64_t avgQueueDelayUs = 0;
+	int64_t maxQueueDelayUs = 0;
+};
+
+class MediaSendPool
+{
+public:
+	static constexpr size_t DEFAULT_LANE_CAPACITY = 200;
+
+	// workerCount 0 picks a count from the available hardware threads.
+	explicit MediaSendPool(size_t workerCount = 0, size_t laneCapacity = DEFAULT_LANE_CAPACITY);
+	~MediaSendPool();
+
+	void start();
+	void stop();
+	bool isRunning() const;
+	// Frames a lane can hold, e.g. to fit a longer cached GOP. Only changed while stopped.
+	void setLaneCapacity(size_t capacity);
+
+	// Register or remove a viewer lane. Lanes are pinned to the least loaded worker.
+	// Primer frames (e.g. a cached GOP) are queued ahead of any live frame.
+	// Lanes sharing a non-zero sendGroup use the same send path; a worker hands a frame
+	// to all of its lanes in that group whose next frame it is as one batch.
+	void addLane(const std::string &key, OutboundFrameSink sink,
+	             const std::vector<std::shared_ptr<const OutboundFrame>> &primer = {},
+	             OutboundFrameFilter filter = nullptr, uint32_t sendGroup = 0);
+	void removeLane(const std::string &key);
+	// Queue frames ahead of a lane's pending frames, e.g. a cached GOP replayed for a
+	// keyframe request. Pending video frames already contained in `frames` are not sent twice.
+	bool primeLane(const std::string &key, const std::vector<std::shared_ptr<const OutboundFrame>> &frames);
+	void clearLanes();
+	bool hasLane(const std::string &key) const;
+
+	// Queue a frame for every lane. Never blocks on a sink.
+	void enqueue(std::shared_ptr<const OutboundFrame> frame);
+
+	size_t workerCount() const { return workers_.size(); }
+	size_t laneDepth(const std::string &key) const;
+	SendQueueStats getStats() const;
+
+	static int64_t nowUs();
+
+private:
+	struct Lane {
+		std::string key;
+		OutboundFrameSink sink;
+		OutboundFrameFilter filter;
+		uint32_t sendGroup = 0;
+		std::deque<std::shared_ptr<const OutboundFrame>> queue;
+		bool waitingForKeyframe = false;
+	};
+
+	struct Worker {
+		std::thread thread;
+		mutable std::mutex mutex;
+		std::condition_variable cv;
+		std::vector<std::shared_ptr<Lane>> lanes;
+		size_t nextLane = 0;
+		bool stopping = false;
+	};
+
+	void workerLoop(Worker &worker);
+	void pushToLane(Lane &lane, const std::shared_ptr<const OutboundFrame> &frame);
+
+	std::vector<std::unique_ptr<Worker>> workers_;
+	size_t laneCapacity_;
+	std::atomic<bool> running_{false};
+	std::mutex lifecycleMutex_;
+
+	std::atomic<uint64_t> enqueuedFrames_{0};
+	std::atomic<uint64_t> droppedFrames_{0};
+	std::atomic<int64_t> lastEnqueueUs_{0};
+	std::atomic<int64_t> maxEnqueueUs_{0};
+	std::atomic<uint64_t> dequeuedFrames_{0};
+	std::atomic<uint64_t> batches_{0};
+	std::atomic<int64_t> totalQueueDelayUs_{0};
+	std::atomic<int64_t> maxQueueDelayUs_{0};
+};
+
+} // namespace vdoninja
@@ -0,0 +1,112 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Simulcast layers and per-viewer layer selection implementation
+ */
+
+#include "vdoninja-simulcast.h"
+
+#include <algorithm>
+
+namespace vdoninja
+{
+
+namespace
+{
+
+struct LadderStep {
+	const char *rid;
+	int scaleDivisor;
+	int bitrateDivisor;
+};
+
+constexpr LadderStep kLadder[MAX_SIMULCAST_LAYERS] = {{"f", 1, 1}, {"h", 2, 4}, {"q", 4, 12}};
+constexpr int kMinLayerBitrate = 150000;
+
+// Share of the estimate a layer may use before switching down, and the stricter
+// share required before switching back up.
+constexpr double kDownswitchShare = 0.85;
+constexpr double kUpswitchShare = 0.7;
+
+int evenDimension(int value)
+{
+	return value > 0 ? std::max(2, value & ~1) : 0;
+}
+
+} // namespace
+
+std::vector<SimulcastLayer> buildSimulcastLadder(int width, int height, int bitrate, int layerCount)
+{
+	std::vector<SimulcastLayer> layers;
+	const int count = std::clamp(layerCount, 1, MAX_SIMULCAST_LAYERS);
+	for (int i = 0; i < count; ++i) {
+		SimulcastLayer layer;
+		layer.rid = kLadder[i].rid;
+		layer.width = evenDimension(width / kLadder[i].scaleDivisor);
+		layer.height = evenDimension(height / kLadder[i].scaleDivisor);
+		layer.bitrate = i == 0 ? bitrate : std::max(kMinLayerBitrate, bitrate / kLadder[i].bitrateDivisor);
+		layers.push_back(layer);
+	}
+	return layers;
+}
+
+SimulcastLayerSelector::SimulcastLayerSelector(std::vector<int> layerBitrates) : bitrates_(std::move(layerBitrates))
+{
+	if (bitrates_.empty()) {
+		bitrates_.push_back(0);
+	}
+}
+
+size_t SimulcastLayerSelector::highestLayerWithin(double budget) const
+{
+	for (size_t i = 0; i < bitrates_.size(); ++i) {
+		if (bitrates_[i] <= budget) {
+			return i;
+		}
+	}
+	return bitrates_.size() - 1;
+}
+
+bool SimulcastLayerSelector::onBandwidthEstimate(int bitrate)
+{
+	if (bitrate <= 0) {
+		return false;
+	}
+
+	const size_t target = targetLayer();
+	const size_t down = highestLayerWithin(bitrate * kDownswitchShare);
+	const size_t up = highestLayerWithin(bitrate * kUpswitchShare);
+
+	size_t next = target;
+	if (down > target) {
+		next = down;
+	} else if (up < target) {
+		next = up;
+	}
+	if (next == target) {
+		return false;
+	}
+	target_.store(next, std::memory_order_relaxed);
+	return true;
+}
+
+void SimulcastLayerSelector::setTargetLayer(size_t layer)
+{
+	target_.store(std::min(layer, bitrates_.size() - 1), std::memory_order_relaxed);
+}
+
+bool SimulcastLayerSelector::accept(const OutboundFrame &frame)
+{
+	if (frame.kind != MediaKind::Video) {
+		return true;
+	}
+
+	const size_t current = currentLayer();
+	const size_t target = targetLayer();
+	if (frame.layer == target && frame.keyframe) {
+		current_.store(target, std::memory_order_relaxed);
+		return true;
+	}
+	return frame.layer == current;
+}
+
+} // namespace vdoninja
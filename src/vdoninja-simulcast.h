@@ -0,0 +1,62 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Simulcast layers and per-viewer layer selection
+ *
+ * The output can attach extra OBS encoders at lower resolutions and bitrates.
+ * Every viewer still negotiates a single video stream; a per-viewer selector
+ * decides which layer feeds it and switches only at keyframes so the decoder
+ * never sees a broken reference chain.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "vdoninja-send-queue.h"
+
+namespace vdoninja
+{
+
+constexpr int MAX_SIMULCAST_LAYERS = 3;
+
+// One rendition. Layer 0 is the full-quality encoder attached by OBS.
+struct SimulcastLayer {
+	std::string rid;
+	int width = 0;
+	int height = 0;
+	int bitrate = 0; // bps
+};
+
+// Default ladder: full, half and quarter resolution at roughly 1, 1/4 and 1/12 of the bitrate.
+std::vector<SimulcastLayer> buildSimulcastLadder(int width, int height, int bitrate, int layerCount);
+
+class SimulcastLayerSelector
+{
+public:
+	explicit SimulcastLayerSelector(std::vector<int> layerBitrates);
+
+	// Retargets from a bandwidth estimate (bps), with hysteresis between
+	// switching down and up. Returns true if the target layer changed.
+	bool onBandwidthEstimate(int bitrate);
+	void setTargetLayer(size_t layer);
+
+	size_t targetLayer() const { return target_.load(std::memory_order_relaxed); }
+	size_t currentLayer() const { return current_.load(std::memory_order_relaxed); }
+	size_t layerCount() const { return bitrates_.size(); }
+
+	// Called in frame order for one viewer. Passes audio and frames of the
+	// current layer; moves to the target layer at its next keyframe.
+	bool accept(const OutboundFrame &frame);
+
+private:
+	size_t highestLayerWithin(double budget) const;
+
+	std::vector<int> bitrates_;
+	std::atomic<size_t> target_{0};
+	std::atomic<size_t> current_{0};
+};
+
+} // namespace vdoninja
@@ -0,0 +1,344 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Scalable video coding (VP9/AV1 SVC) and per-viewer layer selection implementation
+ */
+
+#include "vdoninja-svc.h"
+
+#include <algorithm>
+
+namespace vdoninja
+{
+
+namespace
+{
+
+// Cumulative bitrate share of the lowest layers, indexed by layer count - 1. Spatial
+// layers follow the simulcast ladder; temporal splits follow the usual libvpx defaults.
+constexpr double kSpatialShare[SVC_MAX_SPATIAL_LAYERS][SVC_MAX_SPATIAL_LAYERS] = {
+    {1.0, 1.0, 1.0}, {0.25, 1.0, 1.0}, {1.0 / 12.0, 1.0 / 3.0, 1.0}};
+constexpr double kTemporalShare[SVC_MAX_TEMPORAL_LAYERS][SVC_MAX_TEMPORAL_LAYERS] = {
+    {1.0, 1.0, 1.0}, {0.6, 1.0, 1.0}, {0.4, 0.6, 1.0}};
+
+// Same hysteresis as the simulcast selector
+constexpr double kDownswitchShare = 0.85;
+constexpr double kUpswitchShare = 0.7;
+
+struct Av1Obu {
+	size_t offset = 0; // Start of the OBU header
+	size_t end = 0;
+	bool hasExtension = false;
+	uint8_t extension = 0;
+};
+
+bool readLeb128(const uint8_t *data, size_t size, size_t &offset, size_t &value)
+{
+	value = 0;
+	for (size_t i = 0; i < 8 && offset < size; ++i) {
+		const uint8_t byte = data[offset++];
+		value |= static_cast<size_t>(byte & 0x7F) << (7 * i);
+		if ((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool nextAv1Obu(const uint8_t *data, size_t size, size_t &offset, Av1Obu &obu)
+{
+	if (offset >= size || (data[offset] & 0x80)) {
+		return false;
+	}
+	const uint8_t header = data[offset];
+	obu.offset = offset;
+	obu.hasExtension = (header & 0x04) != 0;
+	size_t cursor = offset + (obu.hasExtension ? 2 : 1);
+	if (cursor > size) {
+		return false;
+	}
+	obu.extension = obu.hasExtension ? data[offset + 1] : 0;
+	size_t payloadSize = size - cursor;
+	if ((header & 0x02) && (!readLeb128(data, size, cursor, payloadSize) || payloadSize > size - cursor)) {
+		return false;
+	}
+	obu.end = cursor + payloadSize;
+	offset = obu.end;
+	return true;
+}
+
+uint8_t av1TemporalId(const Av1Obu &obu)
+{
+	return static_cast<uint8_t>(obu.extension >> 5);
+}
+
+uint8_t av1SpatialId(const Av1Obu &obu)
+{
+	return static_cast<uint8_t>((obu.extension >> 3) & 0x03);
+}
+
+bool parseAv1(const uint8_t *data, size_t size, SvcFrameInfo &info)
+{
+	size_t offset = 0;
+	Av1Obu obu;
+	uint8_t spatialLayers = 1;
+	while (nextAv1Obu(data, size, offset, obu)) {
+		if (!obu.hasExtension) {
+			continue;
+		}
+		info.layered = true;
+		info.temporalId = std::max(info.temporalId, av1TemporalId(obu));
+		spatialLayers = std::max(spatialLayers, static_cast<uint8_t>(av1SpatialId(obu) + 1));
+	}
+	info.spatialLayers = static_cast<uint8_t>(std::min<size_t>(spatialLayers, SVC_MAX_SPATIAL_LAYERS));
+	return info.layered;
+}
+
+// Frames of a VP9 superframe as (offset, size); false if the data is a single frame
+bool vp9SuperframeFrames(const uint8_t *data, size_t size, std::vector<std::pair<size_t, size_t>> &frames,
+                         size_t &sizeBytes)
+{
+	if (size == 0) {
+		return false;
+	}
+	const uint8_t marker = data[size - 1];
+	if ((marker & 0xE0) != 0xC0) {
+		return false;
+	}
+	const size_t count = (marker & 0x07) + 1;
+	sizeBytes = ((marker >> 3) & 0x03) + 1;
+	const size_t indexSize = 2 + sizeBytes * count;
+	if (size < indexSize || data[size - indexSize] != marker) {
+		return false;
+	}
+
+	const uint8_t *index = data + size - indexSize + 1;
+	size_t offset = 0;
+	for (size_t i = 0; i < count; ++i) {
+		size_t frameSize = 0;
+		for (size_t b = 0; b < sizeBytes; ++b) {
+			frameSize |= static_cast<size_t>(*index++) << (8 * b);
+		}
+		if (frameSize == 0 || frameSize > size - indexSize - offset) {
+			return false;
+		}
+		frames.emplace_back(offset, frameSize);
+		offset += frameSize;
+	}
+	return true;
+}
+
+// show_frame from a VP9 uncompressed header; a shown existing frame counts as shown
+bool vp9FrameIsShown(const uint8_t *data, size_t size)
+{
+	if (size == 0 || (data[0] >> 6) != 0x02) {
+		return false;
+	}
+	// Every field up to show_frame fits in the first byte
+	int bit = 2;
+	auto readBit = [&]() { return (data[0] >> (7 - bit++)) & 0x01; };
+	const int profileLow = readBit();
+	const int profileHigh = readBit();
+	if (profileLow && profileHigh) {
+		bit++; // Profile 3 reserved bit
+	}
+	if (readBit()) {
+		return true; // show_existing_frame
+	}
+	bit++; // frame_type
+	return readBit() != 0;
+}
+
+bool parseVp9(const uint8_t *data, size_t size, SvcFrameInfo &info)
+{
+	// Spatial layers travel as one superframe, lowest first and each shown. Superframes
+	// that hide a frame (an alt-ref with the next frame) are a single layer.
+	std::vector<std::pair<size_t, size_t>> frames;
+	size_t sizeBytes = 0;
+	if (!vp9SuperframeFrames(data, size, frames, sizeBytes) || frames.size() < 2) {
+		return false;
+	}
+	for (const auto &frame : frames) {
+		if (!vp9FrameIsShown(data + frame.first, frame.second)) {
+			return false;
+		}
+	}
+	info.layered = true;
+	info.spatialLayers = static_cast<uint8_t>(std::min(frames.size(), SVC_MAX_SPATIAL_LAYERS));
+	return true;
+}
+
+std::vector<uint8_t> keepAv1SpatialLayers(const uint8_t *data, size_t size, size_t spatialLayers)
+{
+	std::vector<uint8_t> out;
+	out.reserve(size);
+	size_t offset = 0;
+	Av1Obu obu;
+	while (nextAv1Obu(data, size, offset, obu)) {
+		if (!obu.hasExtension || av1SpatialId(obu) < spatialLayers) {
+			out.insert(out.end(), data + obu.offset, data + obu.end);
+		}
+	}
+	return out;
+}
+
+std::vector<uint8_t> keepVp9SpatialLayers(const uint8_t *data, size_t size, size_t spatialLayers)
+{
+	std::vector<std::pair<size_t, size_t>> frames;
+	size_t sizeBytes = 0;
+	if (!vp9SuperframeFrames(data, size, frames, sizeBytes) || spatialLayers >= frames.size()) {
+		return std::vector<uint8_t>(data, data + size);
+	}
+	const size_t keep = std::max<size_t>(spatialLayers, 1);
+	std::vector<uint8_t> out(data, data + frames[keep - 1].first + frames[keep - 1].second);
+	if (keep == 1) {
+		return out;
+	}
+
+	// Rebuild the index for the remaining frames
+	const uint8_t marker = static_cast<uint8_t>(0xC0 | ((sizeBytes - 1) << 3) | (keep - 1));
+	out.push_back(marker);
+	for (size_t i = 0; i < keep; ++i) {
+		for (size_t b = 0; b < sizeBytes; ++b) {
+			out.push_back(static_cast<uint8_t>(frames[i].second >> (8 * b)));
+		}
+	}
+	out.push_back(marker);
+	return out;
+}
+
+SvcLayers clampLayers(SvcLayers layers, SvcLayers structure)
+{
+	layers.spatial = std::clamp(layers.spatial, uint8_t{1}, structure.spatial);
+	layers.temporal = std::clamp(layers.temporal, uint8_t{1}, structure.temporal);
+	return layers;
+}
+
+SvcLayers highestLayersWithin(double budget, int streamBitrate, SvcLayers structure)
+{
+	// Ties go to the higher spatial layer: resolution is kept over frame rate
+	SvcLayers best;
+	int bestBitrate = -1;
+	for (uint8_t s = 1; s <= structure.spatial; ++s) {
+		for (uint8_t t = 1; t <= structure.temporal; ++t) {
+			const int bitrate = svcLayerBitrate(streamBitrate, structure, {s, t});
+			if (bitrate <= budget && bitrate >= bestBitrate) {
+				best = {s, t};
+				bestBitrate = bitrate;
+			}
+		}
+	}
+	return best;
+}
+
+} // namespace
+
+bool parseSvcFrame(RtpPayloadFormat format, const uint8_t *data, size_t size, SvcFrameInfo &info)
+{
+	info = SvcFrameInfo{};
+	if (!data || size == 0) {
+		return false;
+	}
+	if (format == RtpPayloadFormat::AV1) {
+		return parseAv1(data, size, info);
+	}
+	if (format == RtpPayloadFormat::VP9) {
+		return parseVp9(data, size, info);
+	}
+	return false;
+}
+
+std::vector<uint8_t> keepSvcSpatialLayers(RtpPayloadFormat format, const uint8_t *data, size_t size,
+                                          size_t spatialLayers)
+{
+	if (!data || size == 0) {
+		return {};
+	}
+	if (format == RtpPayloadFormat::AV1) {
+		return keepAv1SpatialLayers(data, size, spatialLayers);
+	}
+	if (format == RtpPayloadFormat::VP9) {
+		return keepVp9SpatialLayers(data, size, spatialLayers);
+	}
+	return std::vector<uint8_t>(data, data + size);
+}
+
+int svcLayerBitrate(int streamBitrate, SvcLayers structure, SvcLayers layers)
+{
+	structure = clampLayers(structure, {SVC_MAX_SPATIAL_LAYERS, SVC_MAX_TEMPORAL_LAYERS});
+	layers = clampLayers(layers, structure);
+	const double share = kSpatialShare[structure.spatial - 1][layers.spatial - 1] *
+	                     kTemporalShare[structure.temporal - 1][layers.temporal - 1];
+	return static_cast<int>(streamBitrate * share);
+}
+
+bool SvcLayerSelector::onBandwidthEstimate(int bitrate, int streamBitrate, SvcLayers structure)
+{
+	if (bitrate <= 0 || streamBitrate <= 0) {
+		return false;
+	}
+
+	const SvcLayers target = clampLayers(
+	    {targetSpatial_.load(std::memory_order_relaxed), targetTemporal_.load(std::memory_order_relaxed)}, structure);
+	const int targetBitrate = svcLayerBitrate(streamBitrate, structure, target);
+
+	SvcLayers next = target;
+	if (targetBitrate > bitrate * kDownswitchShare) {
+		next = highestLayersWithin(bitrate * kDownswitchShare, streamBitrate, structure);
+	} else {
+		const SvcLayers up = highestLayersWithin(bitrate * kUpswitchShare, streamBitrate, structure);
+		if (svcLayerBitrate(streamBitrate, structure, up) > targetBitrate) {
+			next = up;
+		}
+	}
+	if (next == target) {
+		return false;
+	}
+	targetSpatial_.store(next.spatial, std::memory_order_relaxed);
+	targetTemporal_.store(next.temporal, std::memory_order_relaxed);
+	return true;
+}
+
+size_t SvcLayerSelector::select(const SvcFrameInfo &frame, bool keyframe)
+{
+	if (!frame.layered) {
+		return frame.spatialLayers;
+	}
+
+	// Upper layers only reference lower ones, so they can be dropped at any frame but
+	// are only added where the viewer already has what they reference.
+	uint8_t temporal = currentTemporal_.load(std::memory_order_relaxed);
+	const uint8_t targetTemporal = targetTemporal_.load(std::memory_order_relaxed);
+	if (targetTemporal < temporal || (targetTemporal > temporal && (frame.temporalId == 0 || keyframe))) {
+		temporal = targetTemporal;
+		currentTemporal_.store(temporal, std::memory_order_relaxed);
+	}
+	if (frame.temporalId >= temporal) {
+		droppedFrames_.fetch_add(1, std::memory_order_relaxed);
+		return 0;
+	}
+
+	uint8_t spatial = currentSpatial_.load(std::memory_order_relaxed);
+	const uint8_t targetSpatial = targetSpatial_.load(std::memory_order_relaxed);
+	if (targetSpatial < spatial || (targetSpatial > spatial && keyframe)) {
+		spatial = targetSpatial;
+		currentSpatial_.store(spatial, std::memory_order_relaxed);
+	}
+	if (spatial < frame.spatialLayers) {
+		reducedFrames_.fetch_add(1, std::memory_order_relaxed);
+		return spatial;
+	}
+	return frame.spatialLayers;
+}
+
+SvcStats SvcLayerSelector::stats() const
+{
+	SvcStats stats;
+	stats.target = {targetSpatial_.load(std::memory_order_relaxed), targetTemporal_.load(std::memory_order_relaxed)};
+	stats.current = {currentSpatial_.load(std::memory_order_relaxed),
+	                 currentTemporal_.load(std::memory_order_relaxed)};
+	stats.droppedFrames = droppedFrames_.load(std::memory_order_relaxed);
+	stats.reducedFrames = reducedFrames_.load(std::memory_order_relaxed);
+	return stats;
+}
+
+} // namespace vdoninja
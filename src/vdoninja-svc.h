@@ -0,0 +1,83 @@
+/*
+ * OBS VDO.Ninja Plugin
+ * Scalable video coding (VP9/AV1 SVC) and per-viewer layer selection
+ *
+ * With an encoder that produces spatial or temporal layers, one stream can serve
+ * viewers on very different links: each viewer gets only the layers its bandwidth
+ * estimate allows. Layer ids are read from the bitstream itself (AV1 OBU extension
+ * headers, VP9 superframes), so frames without them pass through untouched.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vdoninja-rtp-packetizer.h"
+
+namespace vdoninja
+{
+
+constexpr size_t SVC_MAX_SPATIAL_LAYERS = 3;
+constexpr size_t SVC_MAX_TEMPORAL_LAYERS = 3;
+
+// Layers of one encoded frame
+struct SvcFrameInfo {
+	uint8_t spatialLayers = 1; // Spatial layers present, lowest first
+	uint8_t temporalId = 0;
+	bool layered = false; // Layer ids were found in the bitstream
+};
+
+// Reads the layer ids of an AV1 temporal unit or VP9 frame. Other formats, and
+// frames without layer ids, report a single layer and return false.
+bool parseSvcFrame(RtpPayloadFormat format, const uint8_t *data, size_t size, SvcFrameInfo &info);
+
+// Copy of the frame with only its lowest `spatialLayers` spatial layers
+std::vector<uint8_t> keepSvcSpatialLayers(RtpPayloadFormat format, const uint8_t *data, size_t size,
+                                          size_t spatialLayers);
+
+// Layer counts to forward; also used for the structure the encoder produces
+struct SvcLayers {
+	uint8_t spatial = 1;
+	uint8_t temporal = 1;
+
+	bool operator==(const SvcLayers &other) const { return spatial == other.spatial && temporal == other.temporal; }
+	bool operator!=(const SvcLayers &other) const { return !(*this == other); }
+};
+
+// Estimated bitrate of the lowest `layers` of a stream with the given structure
+int svcLayerBitrate(int streamBitrate, SvcLayers structure, SvcLayers layers);
+
+struct SvcStats {
+	SvcLayers target;
+	SvcLayers current;
+	uint64_t droppedFrames = 0; // Frames of temporal layers above the viewer's
+	uint64_t reducedFrames = 0; // Frames sent without their upper spatial layers
+};
+
+class SvcLayerSelector
+{
+public:
+	// Retargets from a bandwidth estimate (bps), with the same hysteresis as simulcast.
+	// Returns true if the target changed.
+	bool onBandwidthEstimate(int bitrate, int streamBitrate, SvcLayers structure);
+
+	// Called in frame order for one viewer. Returns the number of spatial layers to send,
+	// 0 to skip the frame. Temporal layers are added at the next base-layer frame and
+	// spatial layers at the next keyframe; both are removed right away.
+	size_t select(const SvcFrameInfo &frame, bool keyframe);
+
+	SvcStats stats() const;
+
+private:
+	std::atomic<uint8_t> targetSpatial_{SVC_MAX_SPATIAL_LAYERS};
+	std::atomic<uint8_t> targetTemporal_{SVC_MAX_TEMPORAL_LAYERS};
+	std::atomic<uint8_t> currentSpatial_{SVC_MAX_SPATIAL_LAYERS};
+	std::atomic<uint8_t> currentTemporal_{SVC_MAX_TEMPORAL_LAYERS};
+	std::atomic<uint64_t> droppedFrames_{0};
+	std::atomic<uint64_t> reducedFrames_{0};
+};
+
+} // namespace vdoninja
@@ -0,0 +1,151 @@
+/*
+ * Microbenchmark: per-frame fan-out cost through the send pool
+ * SPDX-License-Identifier: AGPL-3.0-only
+ *
+ * Compares the former per-viewer path (runtime checks per frame, one lane at a time)
+ * with send paths specialised at setup and batched by send group, for 1, 10 and 50
+ * viewers. The track send is replaced by a checksum so only the plugin's own
+ * per-viewer work is measured. Build with -DBUILD_TESTS=ON -DBUILD_BENCHMARKS=ON in
+ * Release and run bench-fanout [frames].
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vdoninja-rtp-packetizer.h"
+#include "vdoninja-send-queue.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+struct FakeViewer {
+	std::atomic<int> state{1}; // 1 = connected
+	bool publisher = true;
+	bool reported = true;
+	RtpSequencer sequencer;
+	uint32_t srTimestamp = 0;
+	uint64_t checksum = 0;
+	std::atomic<uint64_t> frames{0};
+};
+
+void sendFrame(FakeViewer &viewer, const RtpFrame &frame)
+{
+	for (size_t i = 0; i < frame.packetCount(); ++i) {
+		size_t size = 0;
+		const uint8_t *packet = viewer.sequencer.stamp(frame, i, size);
+		viewer.checksum += size + packet[2] + packet[3];
+	}
+}
+
+// Shape of the send step before specialisation: every flag is re-read for every frame
+void deliverGeneric(FakeViewer &viewer, const OutboundFrame &frame, const RtpPacketizer &packetizer)
+{
+	if (viewer.state.load(std::memory_order_acquire) != 1 || !viewer.publisher) {
+		return;
+	}
+	const RtpFrame &rtp = frame.rtp(
+	    [&](const OutboundFrame &f) { return packetizer.packetize(f.data(), f.size(), f.timestamp, f.keyframe); });
+	if (frame.kind == MediaKind::Video) {
+		if (viewer.reported) {
+			viewer.srTimestamp = rtp.timestamp;
+		}
+	}
+	sendFrame(viewer, rtp);
+	viewer.frames++;
+}
+
+template <bool Reported>
+void deliverSpecialised(FakeViewer &viewer, const OutboundFrame &frame, const RtpPacketizer &packetizer)
+{
+	if (viewer.state.load(std::memory_order_acquire) != 1) {
+		return;
+	}
+	const RtpFrame &rtp = frame.rtp(
+	    [&](const OutboundFrame &f) { return packetizer.packetize(f.data(), f.size(), f.timestamp, f.keyframe); });
+	if constexpr (Reported) {
+		viewer.srTimestamp = rtp.timestamp;
+	}
+	sendFrame(viewer, rtp);
+	viewer.frames++;
+}
+
+double measure(size_t viewerCount, int frameCount, bool specialised)
+{
+	MediaSendPool pool;
+	pool.start();
+	RtpPacketizer packetizer(RtpPayloadFormat::VP8, 0x1234, 96);
+
+	std::vector<std::unique_ptr<FakeViewer>> viewers;
+	for (size_t i = 0; i < viewerCount; ++i) {
+		viewers.push_back(std::make_unique<FakeViewer>());
+		FakeViewer *viewer = viewers.back().get();
+		if (specialised) {
+			pool.addLane(
+			    "viewer" + std::to_string(i),
+			    [viewer, &packetizer](const OutboundFrame &frame) {
+				    deliverSpecialised<true>(*viewer, frame, packetizer);
+			    },
+			    {}, nullptr, 1);
+		} else {
+			pool.addLane("viewer" + std::to_string(i), [viewer, &packetizer](const OutboundFrame &frame) {
+				deliverGeneric(*viewer, frame, packetizer);
+			});
+		}
+	}
+
+	// 30 KB delta frames: about 30 RTP packets each, typical of 1080p at 8 Mbps
+	std::vector<uint8_t> payload(30 * 1024, 0x5A);
+	auto packet = EncodedPacket::copy(payload.data(), payload.size());
+
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < frameCount; ++i) {
+		auto frame = std::make_shared<OutboundFrame>();
+		frame->kind = MediaKind::Video;
+		frame->packet = packet;
+		frame->keyframe = i == 0;
+		frame->timestamp = static_cast<uint32_t>(i * 3000);
+		frame->enqueuedAtUs = MediaSendPool::nowUs();
+		pool.enqueue(std::move(frame));
+		// Stay below the lane capacity so no frame is dropped
+		if (i % 64 == 63) {
+			while (std::any_of(viewers.begin(), viewers.end(), [&](const std::unique_ptr<FakeViewer> &viewer) {
+				return viewer->frames.load() + 32 < static_cast<uint64_t>(i + 1);
+			})) {
+				std::this_thread::yield();
+			}
+		}
+	}
+	for (const auto &viewer : viewers) {
+		while (viewer->frames.load() < static_cast<uint64_t>(frameCount)) {
+			std::this_thread::yield();
+		}
+	}
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	pool.stop();
+	return std::chrono::duration<double, std::micro>(elapsed).count() / frameCount;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const int frames = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+
+	std::printf("%-8s %16s %16s %10s\n", "viewers", "per-viewer us", "batched us", "speedup");
+	for (size_t viewers : {1u, 10u, 50u}) {
+		const double generic = measure(viewers, frames, false);
+		const double batched = measure(viewers, frames, true);
+		std::printf("%-8zu %16.1f %16.1f %9.2fx\n", viewers, generic, batched, generic / batched);
+	}
+	std::printf("(microseconds of wall time per frame fanned out to all viewers)\n");
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Microbenchmark: FlexFEC encode cost and recovery under simulated loss
+ * SPDX-License-Identifier: AGPL-3.0-only
+ *
+ * Measures the cost of building parity packets for one viewer for a 1080p delta
+ * frame and keyframe at several protection ratios, then sends a stream of frames
+ * through random and bursty (Gilbert-Elliott) loss and reports how many lost
+ * media packets FEC rebuilt without a NACK round trip. Ratios follow the adaptive
+ * controller for each loss rate. Build with -DBUILD_TESTS=ON -DBUILD_BENCHMARKS=ON
+ * in Release and run bench-fec [iterations].
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "vdoninja-fec.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+constexpr uint32_t kMediaSsrc = 0x1234;
+
+std::shared_ptr<const RtpFrame> makeFrame(const RtpPacketizer &packetizer, size_t size, bool keyframe,
+                                          uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<uint8_t> payload(size);
+	for (auto &b : payload) {
+		b = static_cast<uint8_t>(rng());
+	}
+	return packetizer.packetize(payload.data(), payload.size(), 0, keyframe, 1);
+}
+
+double measureEncode(const FlexfecEncoder &encoder, const RtpFrame &frame, double ratio, int iterations,
+                     size_t &fecPackets)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		auto repair = encoder.protect(frame, static_cast<uint16_t>(i), ratio);
+		fecPackets = repair ? repair->packetCount() : 0;
+	}
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+// Two-state loss model: isolated losses in the good state, runs of losses in the bad one
+class LossModel
+{
+public:
+	LossModel(double lossRate, bool bursty, uint32_t seed) : rng_(seed)
+	{
+		if (bursty) {
+			// Mean burst of 4 packets; the bad state drops 80% of packets
+			leaveBad_ = 0.25;
+			badLoss_ = 0.8;
+			enterBad_ = leaveBad_ * lossRate / (badLoss_ - lossRate);
+		} else {
+			goodLoss_ = lossRate;
+		}
+	}
+
+	bool drop()
+	{
+		std::uniform_real_distribution<double> uniform(0.0, 1.0);
+		bad_ = bad_ ? uniform(rng_) >= leaveBad_ : uniform(rng_) < enterBad_;
+		return uniform(rng_) < (bad_ ? badLoss_ : goodLoss_);
+	}
+
+private:
+	std::mt19937 rng_;
+	double goodLoss_ = 0.0;
+	double badLoss_ = 0.0;
+	double enterBad_ = 0.0;
+	double leaveBad_ = 1.0;
+	bool bad_ = false;
+};
+
+struct RecoveryResult {
+	size_t lost = 0;
+	size_t recovered = 0;
+	double overhead = 0.0;
+};
+
+RecoveryResult simulate(const FlexfecEncoder &encoder, const std::vector<std::shared_ptr<const RtpFrame>> &frames,
+                        double lossRate, bool bursty)
+{
+	FecController controller;
+	controller.onReceiverReport(static_cast<uint8_t>(std::min(255.0, lossRate * 256.0)));
+	const double ratio = controller.protectionRatio();
+
+	LossModel loss(lossRate, bursty, 7);
+	RecoveryResult result;
+	size_t mediaPackets = 0;
+	size_t parityPackets = 0;
+	uint16_t sequence = 0;
+	for (const auto &frame : frames) {
+		auto repair = encoder.protect(*frame, sequence, ratio);
+		std::map<uint16_t, std::vector<uint8_t>> media;
+		for (size_t i = 0; i < frame->packetCount(); ++i) {
+			const uint16_t seq = static_cast<uint16_t>(sequence + i);
+			if (loss.drop()) {
+				result.lost++;
+				continue;
+			}
+			std::vector<uint8_t> packet(frame->packetData(i), frame->packetData(i) + frame->packetSize(i));
+			packet[2] = static_cast<uint8_t>(seq >> 8);
+			packet[3] = static_cast<uint8_t>(seq);
+			media[seq] = std::move(packet);
+		}
+		std::vector<std::vector<uint8_t>> parity;
+		for (size_t i = 0; repair && i < repair->packetCount(); ++i) {
+			if (!loss.drop()) {
+				parity.emplace_back(repair->packetData(i), repair->packetData(i) + repair->packetSize(i));
+			}
+		}
+		result.recovered += recoverFlexfecPackets(media, parity, kMediaSsrc);
+		mediaPackets += frame->packetCount();
+		parityPackets += repair ? repair->packetCount() : 0;
+		sequence = static_cast<uint16_t>(sequence + frame->packetCount());
+	}
+	result.overhead = mediaPackets > 0 ? static_cast<double>(parityPackets) / mediaPackets : 0.0;
+	return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+
+	RtpPacketizer packetizer(RtpPayloadFormat::VP8, kMediaSsrc, 96);
+	FlexfecEncoder encoder(0x5678, 98, kMediaSsrc);
+
+	// 6 Mbps 1080p30: ~20 KB delta frames and ~250 KB keyframes
+	const auto delta = makeFrame(packetizer, 20000, false, 1);
+	const auto keyframe = makeFrame(packetizer, 250000, true, 2);
+
+	std::printf("encode cost for one viewer\n");
+	std::printf("%-10s %8s %8s %8s %10s\n", "frame", "packets", "ratio", "parity", "us/frame");
+	for (const auto &entry : {std::make_pair("delta", delta), std::make_pair("keyframe", keyframe)}) {
+		for (double ratio : {FEC_MIN_RATIO, 0.3, FEC_MAX_RATIO}) {
+			size_t parity = 0;
+			const double us = measureEncode(encoder, *entry.second, ratio, iterations, parity);
+			std::printf("%-10s %8zu %8.2f %8zu %10.2f\n", entry.first, entry.second->packetCount(), ratio, parity, us);
+		}
+	}
+
+	// Ten seconds of 30 fps video with a keyframe every two seconds
+	std::vector<std::shared_ptr<const RtpFrame>> frames;
+	for (int i = 0; i < 300; ++i) {
+		frames.push_back(i % 60 == 0 ? keyframe : delta);
+	}
+
+	std::printf("\nrecovery without NACK\n");
+	std::printf("%-8s %6s %9s %8s %10s %10s\n", "loss", "model", "overhead", "lost", "recovered", "residual");
+	for (double lossRate : {0.03, 0.05, 0.10}) {
+		for (bool bursty : {false, true}) {
+			const RecoveryResult result = simulate(encoder, frames, lossRate, bursty);
+			const double recoveredShare = result.lost > 0 ? static_cast<double>(result.recovered) / result.lost : 1.0;
+			std::printf("%6.0f%% %7s %8.0f%% %8zu %9.0f%% %9zu\n", lossRate * 100.0, bursty ? "burst" : "random",
+			            result.overhead * 100.0, result.lost, recoveredShare * 100.0, result.lost - result.recovered);
+		}
+	}
+	return 0;
+}
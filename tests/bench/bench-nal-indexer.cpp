@@ -0,0 +1,89 @@
+/*
+ * Microbenchmark: SIMD vs scalar NAL indexing of 4K IDR access units
+ * SPDX-License-Identifier: AGPL-3.0-only
+ *
+ * Build with -DBUILD_TESTS=ON -DBUILD_BENCHMARKS=ON in Release and run
+ * bench-nal-indexer [iterations].
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "vdoninja-nal-indexer.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+// SPS, PPS, SEI and eight IDR slices, roughly the size of a high-bitrate 2160p keyframe.
+// Slice bodies are random bytes with emulation prevention applied, like real CABAC output.
+std::vector<uint8_t> makeIdrAccessUnit(size_t sliceBytes, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<uint8_t> out;
+	auto appendNal = [&](uint8_t header, size_t size) {
+		out.insert(out.end(), {0x00, 0x00, 0x00, 0x01, header});
+		int zeros = 0;
+		for (size_t i = 1; i < size; ++i) {
+			uint8_t b = static_cast<uint8_t>(rng());
+			if (zeros >= 2 && b <= 3) {
+				out.push_back(0x03);
+				zeros = 0;
+			}
+			out.push_back(b);
+			zeros = b == 0 ? zeros + 1 : 0;
+		}
+	};
+	appendNal(0x67, 24);
+	appendNal(0x68, 6);
+	appendNal(0x06, 40);
+	for (int slice = 0; slice < 8; ++slice) {
+		appendNal(0x65, sliceBytes / 8);
+	}
+	return out;
+}
+
+template <typename Index> double measure(const std::vector<uint8_t> &frame, int iterations, Index index, size_t &nals)
+{
+	NalIndex out;
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		index(frame.data(), frame.size(), out);
+	}
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	nals = out.size();
+	return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200;
+
+	std::printf("start-code search: %s\n", nalIndexerBackend());
+	std::printf("%-12s %10s %12s %12s %8s\n", "frame", "bytes", "scalar us", "simd us", "speedup");
+
+	const std::pair<const char *, size_t> sizes[] = {{"4K 1 MB", 1u << 20}, {"4K 4 MB", 4u << 20}};
+	for (const auto &size : sizes) {
+		const std::vector<uint8_t> frame = makeIdrAccessUnit(size.second, 42);
+		size_t scalarNals = 0;
+		size_t simdNals = 0;
+		const double scalarUs = measure(frame, iterations, indexNalUnitsScalar, scalarNals);
+		const double simdUs = measure(
+		    frame, iterations, [](const uint8_t *data, size_t size, NalIndex &out) { indexNalUnits(data, size, out); },
+		    simdNals);
+		if (scalarNals != simdNals) {
+			std::fprintf(stderr, "index mismatch: %zu vs %zu NAL units\n", scalarNals, simdNals);
+			return 1;
+		}
+		std::printf("%-12s %10zu %12.1f %12.1f %7.2fx\n", size.first, frame.size(), scalarUs, simdUs,
+		            scalarUs / simdUs);
+	}
+	return 0;
+}
@@ -0,0 +1,64 @@
+/*
+ * Unit tests for per-viewer bandwidth estimation
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include "vdoninja-bandwidth-estimator.h"
+
+using namespace vdoninja;
+
+TEST(BandwidthEstimatorTest, StartsAtConfiguredBitrate)
+{
+	BandwidthEstimator estimator(4000000);
+	EXPECT_EQ(estimator.bitrate(), 4000000);
+	EXPECT_EQ(estimator.snapshot().rembBitrate, 0);
+}
+
+TEST(BandwidthEstimatorTest, RembCapsTheEstimate)
+{
+	BandwidthEstimator estimator(4000000);
+	estimator.onRemb(1500000, 1000);
+	EXPECT_EQ(estimator.bitrate(), 1500000);
+
+	// A stale REMB no longer applies once newer reports arrive
+	estimator.onReceiverReport(0, 1000 + BandwidthEstimator::REMB_TIMEOUT_MS + 1);
+	EXPECT_GT(estimator.bitrate(), 1500000);
+}
+
+TEST(BandwidthEstimatorTest, HeavyLossBacksOff)
+{
+	BandwidthEstimator estimator(4000000);
+	estimator.onReceiverReport(64, 1000); // 25% loss
+	EXPECT_EQ(estimator.bitrate(), 3500000);
+	EXPECT_DOUBLE_EQ(estimator.snapshot().fractionLost, 0.25);
+}
+
+TEST(BandwidthEstimatorTest, ModerateLossHolds)
+{
+	BandwidthEstimator estimator(4000000);
+	estimator.onReceiverReport(13, 1000); // ~5% loss
+	EXPECT_EQ(estimator.bitrate(), 4000000);
+}
+
+TEST(BandwidthEstimatorTest, LowLossRampsUpWithinRembHeadroom)
+{
+	BandwidthEstimator estimator(1000000);
+	estimator.onRemb(1200000, 0);
+	for (int i = 0; i < 50; ++i) {
+		estimator.onReceiverReport(0, i * 100);
+	}
+	auto snapshot = estimator.snapshot();
+	EXPECT_EQ(snapshot.lossBasedBitrate, 1800000);
+	EXPECT_EQ(snapshot.bitrate, 1200000);
+}
+
+TEST(BandwidthEstimatorTest, ClampsToMinimum)
+{
+	BandwidthEstimator estimator(200000, 150000);
+	for (int i = 0; i < 10; ++i) {
+		estimator.onReceiverReport(255, i);
+	}
+	EXPECT_EQ(estimator.bitrate(), 150000);
+}
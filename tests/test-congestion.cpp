@@ -0,0 +1,81 @@
+/*
+ * Unit tests for the per-viewer congestion policy
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include "vdoninja-congestion.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+CongestionThresholds testThresholds()
+{
+	CongestionThresholds thresholds;
+	thresholds.maxQueueDelayUs = 100000;
+	thresholds.maxBufferedBytes = 1000;
+	return thresholds;
+}
+
+} // namespace
+
+TEST(CongestionGateTest, AdmitsFramesWhileUncongested)
+{
+	CongestionGate gate(testThresholds());
+	EXPECT_TRUE(gate.admitVideo(true, 0, 0));
+	for (int i = 0; i < 10; ++i) {
+		EXPECT_TRUE(gate.admitVideo(false, 50000, 500));
+	}
+	EXPECT_EQ(gate.stats().droppedFrames, 0u);
+	EXPECT_FALSE(gate.stats().dropping);
+}
+
+TEST(CongestionGateTest, DropsDeltasUntilNextKeyframe)
+{
+	CongestionGate gate(testThresholds());
+	EXPECT_TRUE(gate.admitVideo(true, 0, 0));
+	EXPECT_FALSE(gate.admitVideo(false, 150000, 0));
+
+	// The backlog clearing is not enough: the reference chain is already broken
+	EXPECT_FALSE(gate.admitVideo(false, 0, 0));
+	EXPECT_FALSE(gate.admitVideo(false, 0, 0));
+	EXPECT_TRUE(gate.stats().dropping);
+
+	EXPECT_TRUE(gate.admitVideo(true, 0, 0));
+	EXPECT_TRUE(gate.admitVideo(false, 0, 0));
+
+	const CongestionStats stats = gate.stats();
+	EXPECT_EQ(stats.droppedFrames, 3u);
+	EXPECT_EQ(stats.congestionEvents, 1u);
+	EXPECT_FALSE(stats.dropping);
+}
+
+TEST(CongestionGateTest, BufferedBytesTriggerDropping)
+{
+	CongestionGate gate(testThresholds());
+	EXPECT_FALSE(gate.admitVideo(false, 0, 2000));
+	EXPECT_EQ(gate.stats().congestionEvents, 1u);
+}
+
+TEST(CongestionGateTest, KeyframesAreAlwaysSent)
+{
+	CongestionGate gate(testThresholds());
+	EXPECT_TRUE(gate.admitVideo(true, 1000000, 100000));
+	EXPECT_FALSE(gate.admitVideo(false, 1000000, 100000));
+	EXPECT_TRUE(gate.admitVideo(true, 1000000, 100000));
+	EXPECT_EQ(gate.stats().congestionEvents, 1u);
+}
+
+TEST(CongestionGateTest, ExemptFramesBypassThresholds)
+{
+	CongestionGate gate(testThresholds());
+	gate.exempt(3);
+	EXPECT_TRUE(gate.admitVideo(true, 5000000, 0));
+	EXPECT_TRUE(gate.admitVideo(false, 5000000, 0));
+	EXPECT_TRUE(gate.admitVideo(false, 5000000, 0));
+	EXPECT_FALSE(gate.admitVideo(false, 5000000, 0));
+	EXPECT_EQ(gate.stats().droppedFrames, 1u);
+}
@@ -84,6 +84,19 @@ TEST_F(DataChannelTest, ParsesMutedMessage)
 	EXPECT_EQ(msg.type, DataMessageType::Mute);
 }
 
+TEST_F(DataChannelTest, ParsesPauseRequest)
+{
+	DataMessage msg = dataChannel.parseMessage("{\"pauseVideo\":true}");
+
+	EXPECT_EQ(msg.type, DataMessageType::Pause);
+}
+
+TEST_F(DataChannelTest, ParsesVisibilityMessages)
+{
+	EXPECT_EQ(dataChannel.parseMessage("{\"visibility\":false}").type, DataMessageType::Visibility);
+	EXPECT_EQ(dataChannel.parseMessage("{\"obsState\":{\"visibility\":true}}").type, DataMessageType::Visibility);
+}
+
 TEST_F(DataChannelTest, ParsesStatsMessage)
 {
 	std::string raw = "{\"stats\":{\"bitrate\":1000}}";
@@ -190,6 +203,16 @@ TEST_F(DataChannelTest, CreatesMuteMessage)
 	EXPECT_NE(msg.find("\"videoMuted\":false"), std::string::npos);
 }
 
+TEST_F(DataChannelTest, CreatesPauseRequest)
+{
+	PauseRequest request;
+	request.video = true;
+	std::string msg = dataChannel.createPauseRequest(request);
+
+	EXPECT_NE(msg.find("\"pauseVideo\":true"), std::string::npos);
+	EXPECT_EQ(msg.find("pauseAudio"), std::string::npos);
+}
+
 TEST_F(DataChannelTest, CreatesMuteMessageBothMuted)
 {
 	std::string msg = dataChannel.createMuteMessage(true, true);
@@ -233,6 +256,12 @@ protected:
 
 	bool keyframeCalled = false;
 
+	bool pauseCalled = false;
+	PauseRequest lastPause;
+
+	bool visibilityCalled = false;
+	bool lastVisible = true;
+
 	bool customCalled = false;
 	std::string lastCustomData;
 
@@ -258,6 +287,16 @@ protected:
 
 		dataChannel.setOnKeyframeRequest([this](const std::string &) { keyframeCalled = true; });
 
+		dataChannel.setOnPauseRequest([this](const std::string &, const PauseRequest &request) {
+			pauseCalled = true;
+			lastPause = request;
+		});
+
+		dataChannel.setOnVisibilityChange([this](const std::string &, bool visible) {
+			visibilityCalled = true;
+			lastVisible = visible;
+		});
+
 		dataChannel.setOnCustomData([this](const std::string &, const std::string &data) {
 			customCalled = true;
 			lastCustomData = data;
@@ -319,6 +358,38 @@ TEST_F(DataChannelCallbackTest, TriggersOnKeyframeRequest)
 	EXPECT_TRUE(keyframeCalled);
 }
 
+TEST_F(DataChannelCallbackTest, TriggersOnPauseRequest)
+{
+	dataChannel.handleMessage("peer1", "{\"pauseVideo\":true,\"pauseAudio\":false}");
+
+	EXPECT_TRUE(pauseCalled);
+	ASSERT_TRUE(lastPause.video.has_value());
+	EXPECT_TRUE(*lastPause.video);
+	ASSERT_TRUE(lastPause.audio.has_value());
+	EXPECT_FALSE(*lastPause.audio);
+
+	dataChannel.handleMessage("peer1", "{\"pauseVideo\":false}");
+	EXPECT_FALSE(lastPause.audio.has_value());
+}
+
+TEST_F(DataChannelCallbackTest, TriggersOnVisibilityChange)
+{
+	dataChannel.handleMessage("peer1", "{\"obsState\":{\"visibility\":false,\"streaming\":true}}");
+
+	EXPECT_TRUE(visibilityCalled);
+	EXPECT_FALSE(lastVisible);
+
+	dataChannel.handleMessage("peer1", "{\"visibility\":true}");
+	EXPECT_TRUE(lastVisible);
+}
+
+TEST_F(DataChannelCallbackTest, IgnoresObsStateWithoutVisibility)
+{
+	dataChannel.handleMessage("peer1", "{\"obsState\":{\"streaming\":true}}");
+
+	EXPECT_FALSE(visibilityCalled);
+}
+
 TEST_F(DataChannelCallbackTest, TriggersOnCustomData)
 {
 	dataChannel.handleMessage("peer1", "{\"type\":\"custom\",\"data\":\"payload\"}");
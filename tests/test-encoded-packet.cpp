@@ -0,0 +1,79 @@
+/*
+ * Unit tests for the ref-counted encoded packet handle
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "vdoninja-encoded-packet.h"
+#include "vdoninja-gop-cache.h"
+
+using namespace vdoninja;
+
+TEST(EncodedPacketTest, WrapSharesPayloadAndReleasesOnce)
+{
+	std::vector<uint8_t> buffer = {0x00, 0x00, 0x01, 0x65, 0x88};
+	int releases = 0;
+	EncodedPacketInfo info;
+	info.pts = 3003;
+	info.dts = 3000;
+	info.timebaseNum = 1001;
+	info.timebaseDen = 30000;
+	info.keyframe = true;
+	info.trackIndex = 1;
+
+	EncodedPacketRef packet = EncodedPacket::wrap(buffer.data(), buffer.size(), info, [&]() { ++releases; });
+	EXPECT_EQ(packet->data(), buffer.data());
+	EXPECT_EQ(packet->size(), buffer.size());
+	EXPECT_EQ(packet->info().pts, 3003);
+	EXPECT_EQ(packet->info().dts, 3000);
+	EXPECT_EQ(packet->info().timebaseNum, 1001);
+	EXPECT_EQ(packet->info().timebaseDen, 30000);
+	EXPECT_EQ(packet->info().trackIndex, 1u);
+	EXPECT_TRUE(packet->keyframe());
+
+	EncodedPacketRef second = packet;
+	packet.reset();
+	EXPECT_EQ(releases, 0);
+	second.reset();
+	EXPECT_EQ(releases, 1);
+}
+
+TEST(EncodedPacketTest, CopyAndAdoptOwnTheirPayload)
+{
+	std::vector<uint8_t> source = {1, 2, 3};
+	EncodedPacketRef copied = EncodedPacket::copy(source.data(), source.size());
+	source[0] = 9;
+	ASSERT_EQ(copied->size(), 3u);
+	EXPECT_NE(copied->data(), source.data());
+	EXPECT_EQ(copied->data()[0], 1);
+
+	EncodedPacketRef adopted = EncodedPacket::adopt({4, 5});
+	ASSERT_EQ(adopted->size(), 2u);
+	EXPECT_EQ(adopted->data()[1], 5);
+
+	EXPECT_EQ(EncodedPacket::copy(nullptr, 0)->size(), 0u);
+}
+
+TEST(EncodedPacketTest, GopCacheHoldsPacketUntilEvicted)
+{
+	std::vector<uint8_t> buffer(64, 0x42);
+	int releases = 0;
+	GopCache cache;
+	{
+		auto frame = std::make_shared<OutboundFrame>();
+		frame->keyframe = true;
+		frame->packet = EncodedPacket::wrap(buffer.data(), buffer.size(), {}, [&]() { ++releases; });
+		cache.push(frame);
+	}
+	EXPECT_EQ(cache.byteCount(), buffer.size());
+	EXPECT_EQ(releases, 0);
+
+	auto next = std::make_shared<OutboundFrame>();
+	next->keyframe = true;
+	next->packet = EncodedPacket::copy(buffer.data(), 8);
+	cache.push(next);
+	EXPECT_EQ(releases, 1);
+}
@@ -0,0 +1,166 @@
+/*
+ * Unit tests for the low-latency encoder profile
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include "vdoninja-encoder-profile.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+EncoderSettingValues x264Settings(const std::string &preset, const std::string &tune, const std::string &opts = "")
+{
+	EncoderSettingValues values;
+	values.ints["keyint_sec"] = 2;
+	values.ints["bitrate"] = 4000;
+	values.strings["rate_control"] = "CBR";
+	values.strings["preset"] = preset;
+	if (!tune.empty()) {
+		values.strings["tune"] = tune;
+	}
+	if (!opts.empty()) {
+		values.strings["x264opts"] = opts;
+	}
+	return values;
+}
+
+} // namespace
+
+TEST(EncoderProfileTest, ClassifiesEncoderIds)
+{
+	EXPECT_EQ(encoderFamilyFromId("obs_x264"), EncoderFamily::X264);
+	EXPECT_EQ(encoderFamilyFromId("jim_nvenc"), EncoderFamily::Nvenc);
+	EXPECT_EQ(encoderFamilyFromId("obs_nvenc_hevc_tex"), EncoderFamily::Nvenc);
+	EXPECT_EQ(encoderFamilyFromId("obs_qsv11_v2"), EncoderFamily::Qsv);
+	EXPECT_EQ(encoderFamilyFromId("h264_texture_amf"), EncoderFamily::Amf);
+	EXPECT_EQ(encoderFamilyFromId("com.apple.videotoolbox.videoencoder.ave.avc"), EncoderFamily::AppleVT);
+	EXPECT_EQ(encoderFamilyFromId("ffmpeg_svt_av1"), EncoderFamily::Other);
+}
+
+TEST(EncoderProfileTest, FindsH264CounterpartsOfHevcEncoders)
+{
+	using Ids = std::vector<std::string>;
+	EXPECT_EQ(h264EncoderCandidates("obs_nvenc_hevc_tex"), (Ids{"obs_nvenc_h264_tex", "obs_x264"}));
+	EXPECT_EQ(h264EncoderCandidates("h265_texture_amf"), (Ids{"h264_texture_amf", "obs_x264"}));
+	EXPECT_EQ(h264EncoderCandidates("obs_qsv11_hevc").front(), "obs_qsv11_v2");
+	EXPECT_EQ(h264EncoderCandidates("com.apple.videotoolbox.videoencoder.ave.hevc").front(),
+	          "com.apple.videotoolbox.videoencoder.ave.avc");
+	// Software or unknown encoders fall back to x264
+	EXPECT_EQ(h264EncoderCandidates("ffmpeg_x265"), (Ids{"obs_x264"}));
+}
+
+TEST(EncoderProfileTest, ZeroLatencyX264IsClean)
+{
+	const EncoderConfig config = parseEncoderConfig(EncoderFamily::X264, x264Settings("veryfast", "zerolatency"), 30);
+	EXPECT_EQ(config.bFrames, 0);
+	EXPECT_EQ(config.lookaheadFrames, 0);
+
+	const EncoderAssessment assessment = assessEncoderConfig(config);
+	EXPECT_NEAR(assessment.latencyMs, 33.3, 0.1);
+	EXPECT_TRUE(assessment.issues.empty());
+	EXPECT_FALSE(assessment.blocking());
+}
+
+TEST(EncoderProfileTest, DefaultX264AddsHundredsOfMilliseconds)
+{
+	const EncoderConfig config = parseEncoderConfig(EncoderFamily::X264, x264Settings("veryfast", ""), 30);
+	EXPECT_EQ(config.bFrames, 3);
+	EXPECT_EQ(config.lookaheadFrames, 10);
+
+	const EncoderAssessment assessment = assessEncoderConfig(config);
+	EXPECT_GT(assessment.latencyMs, 500.0);
+	EXPECT_TRUE(assessment.blocking());
+}
+
+TEST(EncoderProfileTest, X264OptionsOverrideTheTune)
+{
+	const EncoderConfig config = parseEncoderConfig(
+	    EncoderFamily::X264, x264Settings("veryfast", "zerolatency", "bframes=2:keyint=600 ref=1"), 60);
+	EXPECT_EQ(config.bFrames, 2);
+	EXPECT_EQ(config.keyintSec, 10);
+}
+
+TEST(EncoderProfileTest, LongKeyframeIntervalBlocks)
+{
+	EncoderSettingValues values = x264Settings("veryfast", "zerolatency");
+	values.ints["keyint_sec"] = 20;
+	EXPECT_TRUE(assessEncoderConfig(parseEncoderConfig(EncoderFamily::X264, values, 30)).blocking());
+
+	values.ints["keyint_sec"] = 0;
+	const EncoderAssessment automatic = assessEncoderConfig(parseEncoderConfig(EncoderFamily::X264, values, 30));
+	EXPECT_FALSE(automatic.blocking());
+	EXPECT_EQ(automatic.issues.size(), 1u);
+}
+
+TEST(EncoderProfileTest, OverridesMakeX264LowLatency)
+{
+	EncoderSettingValues values = x264Settings("veryfast", "film", "bframes=3 ref=2 rc-lookahead=20");
+	values.ints["keyint_sec"] = 0;
+	values.strings["rate_control"] = "CRF";
+	const EncoderConfig config = parseEncoderConfig(EncoderFamily::X264, values, 30);
+
+	const EncoderSettingValues overrides = lowLatencyOverrides(EncoderFamily::X264, values, config);
+	EXPECT_EQ(overrides.strings.at("tune"), "zerolatency");
+	EXPECT_EQ(overrides.strings.at("x264opts"), "ref=2");
+	EXPECT_EQ(overrides.strings.at("rate_control"), "CBR");
+	EXPECT_EQ(overrides.ints.at("keyint_sec"), LOW_LATENCY_KEYINT_SEC);
+
+	const EncoderSettingValues merged = mergeEncoderSettings(values, overrides);
+	const EncoderAssessment after = assessEncoderConfig(parseEncoderConfig(EncoderFamily::X264, merged, 30));
+	EXPECT_TRUE(after.issues.empty());
+
+	// Already low-latency: nothing to change
+	EXPECT_TRUE(lowLatencyOverrides(EncoderFamily::X264, merged, parseEncoderConfig(EncoderFamily::X264, merged, 30))
+	                .empty());
+}
+
+TEST(EncoderProfileTest, OverridesHardwareEncoderKeys)
+{
+	EncoderSettingValues nvenc;
+	nvenc.ints["keyint_sec"] = 2;
+	nvenc.ints["bitrate"] = 6000;
+	nvenc.strings["rate_control"] = "CBR";
+	nvenc.ints["bf"] = 2;
+	nvenc.bools["lookahead"] = true;
+	nvenc.strings["tune"] = "hq";
+	EncoderConfig config = parseEncoderConfig(EncoderFamily::Nvenc, nvenc, 60);
+	EXPECT_TRUE(config.bFramesKnown);
+	EXPECT_GT(config.lookaheadFrames, 0);
+
+	EncoderSettingValues overrides = lowLatencyOverrides(EncoderFamily::Nvenc, nvenc, config);
+	EXPECT_EQ(overrides.ints.at("bf"), 0);
+	EXPECT_FALSE(overrides.bools.at("lookahead"));
+	EXPECT_EQ(overrides.strings.at("tune"), "ull");
+	EXPECT_EQ(overrides.ints.count("keyint_sec"), 0u);
+
+	EncoderSettingValues apple;
+	apple.ints["keyint_sec"] = 2;
+	apple.ints["bitrate"] = 6000;
+	apple.strings["rate_control"] = "CRF";
+	apple.bools["bframes"] = true;
+	config = parseEncoderConfig(EncoderFamily::AppleVT, apple, 30);
+	EXPECT_EQ(config.bFrames, 2);
+	overrides = lowLatencyOverrides(EncoderFamily::AppleVT, apple, config);
+	EXPECT_FALSE(overrides.bools.at("bframes"));
+	EXPECT_EQ(overrides.strings.at("rate_control"), "ABR");
+}
+
+TEST(EncoderProfileTest, UnknownEncodersOnlyReportCommonSettings)
+{
+	EncoderSettingValues values;
+	values.ints["keyint_sec"] = 5;
+	values.strings["rate_control"] = "crf";
+	values.ints["bitrate"] = 0;
+	const EncoderConfig config = parseEncoderConfig(EncoderFamily::Other, values, 30);
+	EXPECT_FALSE(config.bFramesKnown);
+	EXPECT_EQ(config.rateControl, "CRF");
+
+	// A quality-only encoder has no bitrate to switch to CBR with
+	const EncoderSettingValues overrides = lowLatencyOverrides(EncoderFamily::Other, values, config);
+	EXPECT_EQ(overrides.strings.count("rate_control"), 0u);
+	EXPECT_EQ(overrides.ints.at("keyint_sec"), LOW_LATENCY_KEYINT_SEC);
+}
@@ -0,0 +1,200 @@
+/*
+ * Unit tests for FlexFEC protection
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <vector>
+
+#include "vdoninja-fec.h"
+#include "vdoninja-rtx.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+constexpr uint32_t kMediaSsrc = 0x1234;
+constexpr uint32_t kFecSsrc = 0x5678;
+
+// VP8 frame with distinct payload bytes, split into packets of at most 100 payload bytes
+std::shared_ptr<const RtpFrame> makeFrame(const RtpPacketizer &packetizer, size_t size, bool keyframe)
+{
+	std::vector<uint8_t> payload(size);
+	for (size_t i = 0; i < size; ++i) {
+		payload[i] = static_cast<uint8_t>(i * 13 + 5);
+	}
+	return packetizer.packetize(payload.data(), payload.size(), 90000, keyframe, 1);
+}
+
+// The frame's packets as the viewer receives them, stamped from firstSequence on
+std::map<uint16_t, std::vector<uint8_t>> received(const RtpFrame &frame, uint16_t firstSequence)
+{
+	std::map<uint16_t, std::vector<uint8_t>> packets;
+	for (size_t i = 0; i < frame.packetCount(); ++i) {
+		std::vector<uint8_t> packet(frame.packetData(i), frame.packetData(i) + frame.packetSize(i));
+		const uint16_t sequence = static_cast<uint16_t>(firstSequence + i);
+		packet[2] = static_cast<uint8_t>(sequence >> 8);
+		packet[3] = static_cast<uint8_t>(sequence);
+		packets[sequence] = std::move(packet);
+	}
+	return packets;
+}
+
+std::vector<std::vector<uint8_t>> fecPackets(const RtpFrame &repair)
+{
+	std::vector<std::vector<uint8_t>> packets;
+	for (size_t i = 0; i < repair.packetCount(); ++i) {
+		packets.emplace_back(repair.packetData(i), repair.packetData(i) + repair.packetSize(i));
+	}
+	return packets;
+}
+
+} // namespace
+
+TEST(FecTest, PacketCountFollowsRatio)
+{
+	EXPECT_EQ(flexfecPacketCount(10, 0.0, true), 0u);
+	EXPECT_EQ(flexfecPacketCount(10, 0.3, false), 3u);
+	EXPECT_EQ(flexfecPacketCount(2, 0.1, false), 0u);
+	EXPECT_EQ(flexfecPacketCount(2, 0.1, true), 1u);
+	EXPECT_EQ(flexfecPacketCount(4, 2.0, false), 4u);
+}
+
+TEST(FecTest, WritesFlexfecHeader)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::VP8, kMediaSsrc, 96, 100);
+	auto frame = makeFrame(packetizer, 950, false); // 10 packets
+	ASSERT_EQ(frame->packetCount(), 10u);
+
+	FlexfecEncoder encoder(kFecSsrc, 98, kMediaSsrc);
+	auto repair = encoder.protect(*frame, 65530, 0.2);
+	ASSERT_NE(repair, nullptr);
+	ASSERT_EQ(repair->packetCount(), 2u);
+
+	const uint8_t *packet = repair->packetData(1);
+	EXPECT_EQ(packet[1] & 0x7F, 98);
+	EXPECT_EQ(readRtpSsrc(packet), kFecSsrc);
+	EXPECT_EQ(readRtpTimestamp(packet), 90000u);
+
+	const uint8_t *header = packet + RTP_HEADER_SIZE;
+	EXPECT_EQ(header[0] & 0xC0, 0);
+	EXPECT_EQ(header[8], 1);
+	EXPECT_EQ((static_cast<uint32_t>(header[12]) << 24) | (header[13] << 16) | (header[14] << 8) | header[15],
+	          kMediaSsrc);
+	// Second group starts at the second packet and wraps the sequence space
+	EXPECT_EQ((header[16] << 8) | header[17], 65531);
+	// Offsets 0, 2, 4, 6 and 8 with the K bit set
+	EXPECT_EQ((header[18] << 8) | header[19], 0x8000 | 0x4000 | 0x1000 | 0x0400 | 0x0100 | 0x0040);
+	EXPECT_EQ(repair->packetSize(1), RTP_HEADER_SIZE + FLEXFEC_HEADER_SIZE_SHORT + (frame->packetSize(1) - 12));
+}
+
+TEST(FecTest, RecoversOneLossPerGroup)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::VP8, kMediaSsrc, 96, 100);
+	auto frame = makeFrame(packetizer, 950, false);
+	FlexfecEncoder encoder(kFecSsrc, 98, kMediaSsrc);
+	auto repair = encoder.protect(*frame, 100, 0.2);
+	ASSERT_NE(repair, nullptr);
+
+	const auto sent = received(*frame, 100);
+	auto media = sent;
+	// A burst of two hits each interleaved group once
+	media.erase(104);
+	media.erase(105);
+	EXPECT_EQ(recoverFlexfecPackets(media, fecPackets(*repair), kMediaSsrc), 2u);
+	EXPECT_EQ(media, sent);
+
+	// Two losses in the same group cannot be rebuilt
+	media.erase(105);
+	media.erase(109);
+	EXPECT_EQ(recoverFlexfecPackets(media, fecPackets(*repair), kMediaSsrc), 0u);
+	EXPECT_EQ(media.count(105) + media.count(109), 0u);
+}
+
+TEST(FecTest, RecoversShortLastPacket)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::VP8, kMediaSsrc, 96, 100);
+	auto frame = makeFrame(packetizer, 950, false);
+	FlexfecEncoder encoder(kFecSsrc, 98, kMediaSsrc);
+	auto repair = encoder.protect(*frame, 0, 0.2);
+
+	const auto sent = received(*frame, 0);
+	auto media = sent;
+	media.erase(9);
+	EXPECT_EQ(recoverFlexfecPackets(media, fecPackets(*repair), kMediaSsrc), 1u);
+	EXPECT_EQ(media.at(9), sent.at(9));
+	EXPECT_TRUE(readRtpMarker(media.at(9).data()));
+}
+
+TEST(FecTest, LargeFramesUseLongMasksPerBlock)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::VP8, kMediaSsrc, 96, 100);
+	auto frame = makeFrame(packetizer, 96 * 100, true); // 100 packets: blocks of 46, 46 and 8
+	ASSERT_EQ(frame->packetCount(), 100u);
+	FlexfecEncoder encoder(kFecSsrc, 98, kMediaSsrc);
+	auto repair = encoder.protect(*frame, 0, 0.1);
+	ASSERT_NE(repair, nullptr);
+	// 5 + 5 parity packets for the full blocks, and the keyframe's short block still gets one
+	EXPECT_EQ(repair->packetCount(), 11u);
+	EXPECT_EQ(repair->packetSize(0), FLEXFEC_HEADER_SIZE_LONG + frame->packetSize(0));
+
+	const auto sent = received(*frame, 0);
+	auto media = sent;
+	for (uint16_t sequence : {0, 1, 2, 3, 4, 46, 95}) {
+		media.erase(sequence);
+	}
+	EXPECT_EQ(recoverFlexfecPackets(media, fecPackets(*repair), kMediaSsrc), 7u);
+	EXPECT_EQ(media, sent);
+}
+
+TEST(FecTest, ControllerFollowsReportedLoss)
+{
+	FecController controller;
+	EXPECT_EQ(controller.protectionRatio(), 0.0);
+
+	// 0.4% loss stays unprotected
+	EXPECT_FALSE(controller.onReceiverReport(1));
+	EXPECT_EQ(controller.protectionRatio(), 0.0);
+
+	// 10% loss switches FEC on at three times the loss
+	EXPECT_TRUE(controller.onReceiverReport(64));
+	FecStats stats = controller.stats();
+	EXPECT_TRUE(stats.active);
+	EXPECT_EQ(stats.activations, 1u);
+	EXPECT_NEAR(controller.protectionRatio(), stats.lossFraction * FEC_RATIO_PER_LOSS, 1e-9);
+
+	// Heavy loss is capped
+	for (int i = 0; i < 10; ++i) {
+		controller.onReceiverReport(128);
+	}
+	EXPECT_EQ(controller.protectionRatio(), FEC_MAX_RATIO);
+
+	// Stays on until the smoothed loss falls below the lower threshold
+	int reports = 0;
+	while (controller.stats().active && reports < 50) {
+		controller.onReceiverReport(0);
+		reports++;
+	}
+	EXPECT_GT(reports, 1);
+	EXPECT_FALSE(controller.stats().active);
+	EXPECT_EQ(controller.protectionRatio(), 0.0);
+
+	controller.countFrame(10, 2);
+	stats = controller.stats();
+	EXPECT_EQ(stats.protectedFrames, 1u);
+	EXPECT_EQ(stats.fecPackets, 2u);
+}
+
+TEST(FecTest, DetectsNegotiatedFlexfec)
+{
+	const std::string sdp = "m=video 9 UDP/TLS/RTP/SAVPF 96 97 98\r\n"
+	                        "a=rtpmap:96 H264/90000\r\n"
+	                        "a=rtpmap:97 rtx/90000\r\n"
+	                        "a=rtpmap:98 flexfec-03/90000\r\n";
+	EXPECT_TRUE(sdpHasPayloadFormat(sdp, 98, "flexfec-03"));
+	EXPECT_FALSE(sdpHasPayloadFormat(sdp, 97, "flexfec-03"));
+	EXPECT_TRUE(sdpHasRtxPayload(sdp, 97));
+}
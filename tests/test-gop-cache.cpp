@@ -0,0 +1,113 @@
+/*
+ * Unit tests for the publisher-side GOP cache
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include "vdoninja-gop-cache.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+std::shared_ptr<OutboundFrame> makeFrame(bool keyframe, uint32_t timestamp, size_t size = 100,
+                                         MediaKind kind = MediaKind::Video)
+{
+	auto frame = std::make_shared<OutboundFrame>();
+	frame->kind = kind;
+	frame->keyframe = keyframe;
+	frame->timestamp = timestamp;
+	frame->packet = EncodedPacket::adopt(std::vector<uint8_t>(size, 0x42));
+	return frame;
+}
+
+} // namespace
+
+TEST(GopCacheTest, IgnoresFramesBeforeFirstKeyframe)
+{
+	GopCache cache;
+	cache.push(makeFrame(false, 1));
+	cache.push(makeFrame(false, 2));
+	EXPECT_FALSE(cache.hasKeyframe());
+	EXPECT_TRUE(cache.snapshot().empty());
+}
+
+TEST(GopCacheTest, KeepsFramesSinceLastKeyframe)
+{
+	GopCache cache;
+	cache.push(makeFrame(true, 0));
+	cache.push(makeFrame(false, 1));
+	cache.push(makeFrame(true, 2));
+	cache.push(makeFrame(false, 3));
+	cache.push(makeFrame(false, 4));
+
+	auto frames = cache.snapshot();
+	ASSERT_EQ(frames.size(), 3u);
+	EXPECT_TRUE(frames[0]->keyframe);
+	EXPECT_EQ(frames[0]->timestamp, 2u);
+	EXPECT_EQ(frames[2]->timestamp, 4u);
+	EXPECT_EQ(cache.byteCount(), 300u);
+}
+
+TEST(GopCacheTest, IgnoresAudioFrames)
+{
+	GopCache cache;
+	cache.push(makeFrame(true, 0));
+	cache.push(makeFrame(false, 1, 100, MediaKind::Audio));
+	EXPECT_EQ(cache.frameCount(), 1u);
+}
+
+TEST(GopCacheTest, OverflowDropsGopUntilNextKeyframe)
+{
+	GopCache cache(1000, 10);
+	cache.push(makeFrame(true, 0, 600));
+	cache.push(makeFrame(false, 1, 600));
+	EXPECT_FALSE(cache.hasKeyframe());
+
+	// A partial GOP would be undecodable, so later delta frames are not cached either
+	cache.push(makeFrame(false, 2, 10));
+	EXPECT_EQ(cache.frameCount(), 0u);
+
+	cache.push(makeFrame(true, 3, 10));
+	cache.push(makeFrame(false, 4, 10));
+	EXPECT_EQ(cache.frameCount(), 2u);
+}
+
+TEST(GopCacheTest, FrameLimitIsEnforced)
+{
+	GopCache cache(1 << 20, 3);
+	cache.push(makeFrame(true, 0));
+	cache.push(makeFrame(false, 1));
+	cache.push(makeFrame(false, 2));
+	EXPECT_EQ(cache.frameCount(), 3u);
+	cache.push(makeFrame(false, 3));
+	EXPECT_EQ(cache.frameCount(), 0u);
+}
+
+TEST(GopCacheTest, DefaultCapKeepsA60FpsTwoSecondGop)
+{
+	// 120 frames: a late joiner still gets the whole GOP up to the next keyframe
+	GopCache cache;
+	for (uint32_t i = 0; i < 120; ++i) {
+		cache.push(makeFrame(i == 0, i));
+	}
+	EXPECT_EQ(cache.frameCount(), 120u);
+	EXPECT_LE(cache.frameCount() * 4 / 3, MediaSendPool::DEFAULT_LANE_CAPACITY);
+}
+
+TEST(GopCacheTest, FrameCapFollowsFrameRateAndKeyframeInterval)
+{
+	const size_t frames = GopCache::framesForInterval(60.0, 4);
+	EXPECT_EQ(frames, 270u);
+	EXPECT_GE(GopCache::laneCapacityFor(frames), frames * 4 / 3);
+	EXPECT_EQ(GopCache::framesForInterval(30.0, 0), GopCache::DEFAULT_MAX_FRAMES);
+	EXPECT_EQ(GopCache::laneCapacityFor(10), MediaSendPool::DEFAULT_LANE_CAPACITY);
+
+	GopCache cache(GopCache::DEFAULT_MAX_BYTES, frames);
+	for (uint32_t i = 0; i < 240; ++i) {
+		cache.push(makeFrame(i == 0, i));
+	}
+	EXPECT_EQ(cache.frameCount(), 240u);
+}
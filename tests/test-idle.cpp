@@ -0,0 +1,117 @@
+/*
+ * Unit tests for zero-viewer idle mode
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include "vdoninja-idle.h"
+
+using namespace vdoninja;
+
+TEST(IdleControllerTest, DisabledControllerAdmitsEverything)
+{
+	IdleController idle(false, 1000, 0);
+	EXPECT_TRUE(idle.admit(0, true, 0, false, 100, 0));
+	EXPECT_TRUE(idle.admit(0, false, 0, false, 100, 60000));
+	EXPECT_EQ(idle.state(60000), IdleState::Active);
+	EXPECT_FALSE(idle.onViewerRequested(60000));
+	EXPECT_EQ(idle.stats(60000).skippedPackets, 0u);
+}
+
+TEST(IdleControllerTest, StartsIdleUntilAViewerRequestsTheStream)
+{
+	IdleController idle(true, 30000, 1000);
+	EXPECT_EQ(idle.state(1000), IdleState::Idle);
+	EXPECT_FALSE(idle.admit(0, true, 0, true, 500, 1500));
+	EXPECT_FALSE(idle.admit(0, false, 0, false, 100, 1600));
+	// Starting idle is not reported as a transition
+	EXPECT_FALSE(idle.takeEnteredIdle());
+
+	EXPECT_TRUE(idle.onViewerRequested(5000));
+	EXPECT_FALSE(idle.onViewerRequested(5100));
+
+	const IdleStats stats = idle.stats(5000);
+	EXPECT_EQ(stats.wakeups, 1u);
+	EXPECT_EQ(stats.idleMs, 4000);
+	EXPECT_EQ(stats.skippedPackets, 2u);
+	EXPECT_EQ(stats.skippedBytes, 600u);
+}
+
+TEST(IdleControllerTest, VideoResumesAtEachLayersNextKeyframe)
+{
+	IdleController idle(true, 30000, 0);
+	idle.onViewerRequested(100);
+
+	// Audio flows right away
+	EXPECT_TRUE(idle.admit(0, false, 0, false, 100, 110));
+	// Delta frames wait for a keyframe, per layer
+	EXPECT_FALSE(idle.admit(0, true, 0, false, 1000, 120));
+	EXPECT_FALSE(idle.admit(0, true, 1, false, 1000, 120));
+	EXPECT_TRUE(idle.admit(0, true, 0, true, 5000, 130));
+	EXPECT_TRUE(idle.admit(0, true, 0, false, 1000, 140));
+	EXPECT_FALSE(idle.admit(0, true, 1, false, 1000, 140));
+	EXPECT_TRUE(idle.admit(0, true, 1, true, 5000, 150));
+	EXPECT_TRUE(idle.admit(1, true, 1, false, 1000, 160));
+}
+
+TEST(IdleControllerTest, GoesIdleAfterTheGracePeriodWithoutViewers)
+{
+	IdleController idle(true, 10000, 0);
+	idle.onViewerRequested(0);
+	EXPECT_TRUE(idle.admit(1, true, 0, true, 100, 1000));
+	EXPECT_EQ(idle.state(1000), IdleState::Active);
+
+	// Last viewer left at 5 s; still sending during the grace period
+	EXPECT_TRUE(idle.admit(0, true, 0, false, 100, 5000));
+	EXPECT_EQ(idle.state(5000), IdleState::Grace);
+	EXPECT_TRUE(idle.admit(0, true, 0, false, 100, 10999));
+	EXPECT_FALSE(idle.takeEnteredIdle());
+
+	// Grace counts from the last packet seen with a viewer
+	EXPECT_FALSE(idle.admit(0, true, 0, false, 100, 11000));
+	EXPECT_TRUE(idle.takeEnteredIdle());
+	EXPECT_FALSE(idle.takeEnteredIdle());
+	EXPECT_EQ(idle.state(11000), IdleState::Idle);
+	EXPECT_EQ(idle.stats(11000).idlePeriods, 2u);
+}
+
+TEST(IdleControllerTest, ViewerThatNeverConnectsLetsTheOutputIdleAgain)
+{
+	IdleController idle(true, 2000, 0);
+	EXPECT_TRUE(idle.onViewerRequested(1000));
+	EXPECT_TRUE(idle.admit(0, false, 0, false, 100, 2500));
+	EXPECT_FALSE(idle.admit(0, false, 0, false, 100, 3000));
+	EXPECT_TRUE(idle.takeEnteredIdle());
+}
+
+TEST(IdleControllerTest, ViewerConnectingAfterReidleWakesTheOutput)
+{
+	// Grace 0: the packet right after the wakeup re-idles before the viewer has connected
+	IdleController idle(true, 0, 0);
+	EXPECT_TRUE(idle.onViewerRequested(1000));
+	EXPECT_FALSE(idle.admit(0, true, 0, true, 100, 1001));
+	EXPECT_TRUE(idle.takeEnteredIdle());
+	EXPECT_FALSE(idle.takeLeftIdle());
+
+	// The viewer finishes connecting without another offer request
+	EXPECT_FALSE(idle.admit(1, true, 0, false, 100, 1500));
+	EXPECT_TRUE(idle.takeLeftIdle());
+	EXPECT_FALSE(idle.takeLeftIdle());
+	EXPECT_EQ(idle.state(1500), IdleState::Active);
+	EXPECT_TRUE(idle.admit(1, false, 0, false, 100, 1510));
+	EXPECT_TRUE(idle.admit(1, true, 0, true, 100, 1520));
+	EXPECT_TRUE(idle.admit(1, true, 0, false, 100, 1530));
+	EXPECT_EQ(idle.stats(1530).wakeups, 2u);
+}
+
+TEST(IdleControllerTest, ResetStartsANewSession)
+{
+	IdleController idle(true, 1000, 0);
+	idle.onViewerRequested(10);
+	idle.reset(false, 1000, 20);
+	EXPECT_FALSE(idle.enabled());
+	EXPECT_EQ(idle.stats(20).wakeups, 0u);
+	EXPECT_TRUE(idle.admit(0, true, 0, false, 100, 50000));
+	EXPECT_STREQ(idleStateName(IdleState::Grace), "grace");
+}
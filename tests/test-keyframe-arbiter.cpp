@@ -0,0 +1,87 @@
+/*
+ * Unit tests for keyframe request coalescing
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include "vdoninja-keyframe-arbiter.h"
+
+using namespace vdoninja;
+
+TEST(KeyframeArbiterTest, CoalescesDeferredRequestsAcrossViewers)
+{
+	KeyframeArbiter arbiter(500, 1000);
+	EXPECT_EQ(arbiter.onRequest("a", KeyframeRequestSource::Pli, 10000, 0), KeyframeDecision::AwaitScheduledKeyframe);
+	EXPECT_EQ(arbiter.onRequest("b", KeyframeRequestSource::Fir, 10100, 0), KeyframeDecision::Coalesced);
+	EXPECT_EQ(arbiter.onRequest("c", KeyframeRequestSource::DataChannel, 10400, 0), KeyframeDecision::Coalesced);
+
+	// Once the window has passed without a keyframe, a new request goes through
+	EXPECT_EQ(arbiter.onRequest("b", KeyframeRequestSource::Pli, 10600, 0), KeyframeDecision::AwaitScheduledKeyframe);
+
+	const KeyframeArbiterStats stats = arbiter.stats();
+	EXPECT_EQ(stats.requests, 4u);
+	EXPECT_EQ(stats.coalesced, 2u);
+	EXPECT_EQ(stats.deferredToKeyframe, 2u);
+}
+
+TEST(KeyframeArbiterTest, ServesFreshCachedKeyframe)
+{
+	KeyframeArbiter arbiter(500, 1000);
+	EXPECT_EQ(arbiter.onRequest("a", KeyframeRequestSource::Pli, 10000, 9500), KeyframeDecision::ServeCached);
+	EXPECT_EQ(arbiter.onRequest("b", KeyframeRequestSource::Pli, 10000, 9500), KeyframeDecision::ServeCached);
+
+	// A stale cached keyframe is not replayed
+	EXPECT_EQ(arbiter.onRequest("c", KeyframeRequestSource::Pli, 10000, 8000),
+	          KeyframeDecision::AwaitScheduledKeyframe);
+	EXPECT_EQ(arbiter.stats().servedFromCache, 2u);
+}
+
+TEST(KeyframeArbiterTest, ViewerWithCachedGopWaitsForNextKeyframe)
+{
+	KeyframeArbiter arbiter(500, 1000);
+	// The viewer already received the fresh cached GOP, so a PLI cannot be served by replaying it
+	EXPECT_EQ(arbiter.onRequest("a", KeyframeRequestSource::Pli, 10000, 9800, true),
+	          KeyframeDecision::AwaitScheduledKeyframe);
+	EXPECT_EQ(arbiter.stats().servedFromCache, 0u);
+
+	// A viewer that never got the GOP is still served from the cache
+	EXPECT_EQ(arbiter.onRequest("b", KeyframeRequestSource::Resume, 10100, 9800, false),
+	          KeyframeDecision::ServeCached);
+	// Another viewer that already has it shares the deferred request
+	EXPECT_EQ(arbiter.onRequest("c", KeyframeRequestSource::Fir, 10200, 9800, true), KeyframeDecision::Coalesced);
+}
+
+TEST(KeyframeArbiterTest, DeduplicatesRepeatedRequestsFromOneViewer)
+{
+	KeyframeArbiter arbiter(500, 1000);
+	EXPECT_EQ(arbiter.onRequest("a", KeyframeRequestSource::Pli, 10000, 9800), KeyframeDecision::ServeCached);
+	EXPECT_EQ(arbiter.onRequest("a", KeyframeRequestSource::DataChannel, 10200, 9800),
+	          KeyframeDecision::Coalesced);
+	EXPECT_EQ(arbiter.onRequest("a", KeyframeRequestSource::Pli, 10600, 9800), KeyframeDecision::ServeCached);
+}
+
+TEST(KeyframeArbiterTest, EncoderKeyframeClearsPendingRequest)
+{
+	KeyframeArbiter arbiter(500, 0);
+	EXPECT_EQ(arbiter.onRequest("a", KeyframeRequestSource::Pli, 10000, 0), KeyframeDecision::AwaitScheduledKeyframe);
+	arbiter.onEncoderKeyframe(10050);
+	EXPECT_EQ(arbiter.onRequest("b", KeyframeRequestSource::Pli, 10100, 0), KeyframeDecision::AwaitScheduledKeyframe);
+}
+
+TEST(KeyframeArbiterTest, RemovedViewerIsNotDeduplicated)
+{
+	KeyframeArbiter arbiter(500, 1000);
+	EXPECT_EQ(arbiter.onRequest("a", KeyframeRequestSource::Pli, 10000, 9900), KeyframeDecision::ServeCached);
+	arbiter.removeViewer("a");
+	EXPECT_EQ(arbiter.onRequest("a", KeyframeRequestSource::Pli, 10100, 9900), KeyframeDecision::ServeCached);
+}
+
+TEST(KeyframeArbiterTest, ZeroWindowDisablesCoalescing)
+{
+	KeyframeArbiter arbiter(500, 0);
+	arbiter.setWindowMs(0);
+	EXPECT_EQ(arbiter.windowMs(), 0);
+	EXPECT_EQ(arbiter.onRequest("a", KeyframeRequestSource::Pli, 10000, 0), KeyframeDecision::AwaitScheduledKeyframe);
+	EXPECT_EQ(arbiter.onRequest("a", KeyframeRequestSource::Pli, 10000, 0), KeyframeDecision::AwaitScheduledKeyframe);
+}
@@ -0,0 +1,97 @@
+/*
+ * Unit tests for the shared A/V media clock
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include "vdoninja-media-clock.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+EncodedPacketInfo packetAt(int64_t pts, int32_t num, int32_t den)
+{
+	EncodedPacketInfo info;
+	info.pts = pts;
+	info.timebaseNum = num;
+	info.timebaseDen = den;
+	return info;
+}
+
+} // namespace
+
+TEST(MediaClockTest, RescalesCommonObsTimebasesExactly)
+{
+	// 30 fps video: one frame is 3000 ticks at 90 kHz
+	EXPECT_EQ(rescaleToClock(1, 1, 30, VIDEO_RTP_CLOCK_RATE), 3000);
+	// 29.97 fps (1001/30000): 3003 ticks per frame, with no accumulated drift after an hour
+	EXPECT_EQ(rescaleToClock(1, 1001, 30000, VIDEO_RTP_CLOCK_RATE), 3003);
+	EXPECT_EQ(rescaleToClock(107892, 1001, 30000, VIDEO_RTP_CLOCK_RATE), 107892LL * 3003);
+	// Audio in samples at 48 kHz maps one to one; 44.1 kHz is resampled to the Opus clock
+	EXPECT_EQ(rescaleToClock(960, 1, 48000, AUDIO_RTP_CLOCK_RATE), 960);
+	EXPECT_EQ(rescaleToClock(44100, 1, 44100, AUDIO_RTP_CLOCK_RATE), 48000);
+	// Millisecond and nanosecond timebases
+	EXPECT_EQ(rescaleToClock(40, 1, 1000, VIDEO_RTP_CLOCK_RATE), 3600);
+	EXPECT_EQ(rescaleToClock(33366667, 1, 1000000000, VIDEO_RTP_CLOCK_RATE), 3003);
+}
+
+TEST(MediaClockTest, RescaleHandlesNegativeAndLargeValues)
+{
+	EXPECT_EQ(rescaleToClock(-1, 1, 30, VIDEO_RTP_CLOCK_RATE), -3000);
+	EXPECT_EQ(rescaleToClock(-1, 1001, 30000, VIDEO_RTP_CLOCK_RATE), -3003);
+	// A week of nanoseconds stays exact
+	const int64_t weekNs = 7LL * 24 * 3600 * 1000000000LL;
+	EXPECT_EQ(rescaleToClock(weekNs, 1, 1000000000, VIDEO_RTP_CLOCK_RATE), 7LL * 24 * 3600 * 90000);
+	EXPECT_EQ(rescaleToClock(5, 0, 30, VIDEO_RTP_CLOCK_RATE), 0);
+	EXPECT_EQ(rescaleToClock(5, 1, 0, VIDEO_RTP_CLOCK_RATE), 0);
+}
+
+TEST(MediaClockTest, TimestampsStartAtStreamOffsets)
+{
+	MediaClock clock;
+	clock.reset(1000, 0xFFFFFF00u);
+	EXPECT_FALSE(clock.anchored());
+	EXPECT_EQ(clock.audioTimestampAt(5000000), 1000u);
+
+	EXPECT_EQ(clock.videoTimestamp(packetAt(0, 1, 30), 5000000), 0xFFFFFF00u);
+	// Wraps modulo 2^32
+	EXPECT_EQ(clock.videoTimestamp(packetAt(1, 1, 30), 5033333), 0xFFFFFF00u + 3000u);
+	EXPECT_EQ(clock.audioTimestamp(packetAt(960, 1, 48000), 5020000), 1960u);
+}
+
+TEST(MediaClockTest, AudioAndVideoShareOneAnchor)
+{
+	MediaClock clock;
+	clock.reset(0, 0);
+
+	// Video arrives first at pts 2 (frames at 30 fps); media time zero is 66.667 ms earlier
+	clock.videoTimestamp(packetAt(2, 1, 30), 10000000);
+	ASSERT_TRUE(clock.anchored());
+	EXPECT_EQ(clock.anchorUs(), 10000000 - 66667);
+
+	// Later packets do not move the anchor, whatever their arrival time
+	clock.audioTimestamp(packetAt(48000, 1, 48000), 99000000);
+	EXPECT_EQ(clock.anchorUs(), 10000000 - 66667);
+
+	// One second after the anchor both report clocks read one second of media
+	const int64_t oneSecondLater = clock.anchorUs() + 1000000;
+	EXPECT_EQ(clock.videoTimestampAt(oneSecondLater), 90000u);
+	EXPECT_EQ(clock.audioTimestampAt(oneSecondLater), 48000u);
+}
+
+TEST(MediaClockTest, ResetStartsANewTimeline)
+{
+	MediaClock clock;
+	clock.reset(0, 0);
+	clock.audioTimestamp(packetAt(0, 1, 48000), 1000);
+	ASSERT_TRUE(clock.anchored());
+
+	clock.reset(7, 9);
+	EXPECT_FALSE(clock.anchored());
+	EXPECT_EQ(clock.audioOffset(), 7u);
+	EXPECT_EQ(clock.videoOffset(), 9u);
+	EXPECT_EQ(clock.videoTimestampAt(123456), 9u);
+}
@@ -0,0 +1,96 @@
+/*
+ * Unit tests for the per-viewer media send gate
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include "vdoninja-media-gate.h"
+
+using namespace vdoninja;
+
+TEST(MediaGateTest, AdmitsEverythingByDefault)
+{
+	ViewerMediaGate gate;
+	EXPECT_TRUE(gate.admitAudio());
+	EXPECT_TRUE(gate.admitVideo(false));
+
+	const MediaGateStats stats = gate.stats();
+	EXPECT_FALSE(stats.audioSuspended);
+	EXPECT_FALSE(stats.videoSuspended);
+	EXPECT_EQ(stats.skippedAudioFrames, 0u);
+	EXPECT_EQ(stats.skippedVideoFrames, 0u);
+}
+
+TEST(MediaGateTest, AudioAndVideoAreHeldIndependently)
+{
+	ViewerMediaGate gate;
+	EXPECT_EQ(gate.setAudioHold(MediaGateReason::Muted, true), MediaGateChange::Suspended);
+	EXPECT_FALSE(gate.admitAudio());
+	EXPECT_TRUE(gate.admitVideo(false));
+
+	EXPECT_EQ(gate.setAudioHold(MediaGateReason::Muted, false), MediaGateChange::Resumed);
+	EXPECT_TRUE(gate.admitAudio());
+	EXPECT_EQ(gate.stats().skippedAudioFrames, 1u);
+	EXPECT_EQ(gate.stats().videoResumes, 0u);
+}
+
+TEST(MediaGateTest, VideoResumesAtNextKeyframe)
+{
+	ViewerMediaGate gate;
+	EXPECT_EQ(gate.setVideoHold(MediaGateReason::Paused, true), MediaGateChange::Suspended);
+	EXPECT_FALSE(gate.admitVideo(true));
+	EXPECT_TRUE(gate.stats().videoSuspended);
+
+	EXPECT_EQ(gate.setVideoHold(MediaGateReason::Paused, false), MediaGateChange::Resumed);
+	EXPECT_FALSE(gate.admitVideo(false));
+	EXPECT_TRUE(gate.admitVideo(true));
+	EXPECT_TRUE(gate.admitVideo(false));
+
+	const MediaGateStats stats = gate.stats();
+	EXPECT_FALSE(stats.videoSuspended);
+	EXPECT_EQ(stats.skippedVideoFrames, 2u);
+	EXPECT_EQ(stats.videoResumes, 1u);
+}
+
+TEST(MediaGateTest, ResumesOnlyWhenEveryReasonClears)
+{
+	ViewerMediaGate gate;
+	EXPECT_EQ(gate.setVideoHold(MediaGateReason::Hidden, true), MediaGateChange::Suspended);
+	EXPECT_EQ(gate.setVideoHold(MediaGateReason::Muted, true), MediaGateChange::None);
+	// Repeating a hold changes nothing
+	EXPECT_EQ(gate.setVideoHold(MediaGateReason::Hidden, true), MediaGateChange::None);
+
+	EXPECT_EQ(gate.setVideoHold(MediaGateReason::Hidden, false), MediaGateChange::None);
+	EXPECT_FALSE(gate.admitVideo(true));
+	EXPECT_EQ(gate.setVideoHold(MediaGateReason::Muted, false), MediaGateChange::Resumed);
+	EXPECT_TRUE(gate.admitVideo(true));
+
+	// Clearing a reason that was never set is not a resume
+	EXPECT_EQ(gate.setVideoHold(MediaGateReason::Paused, false), MediaGateChange::None);
+	EXPECT_EQ(gate.stats().videoResumes, 1u);
+}
+
+TEST(MediaGateTest, TallyOnlyHoldsVideoWhenEnabled)
+{
+	ViewerMediaGate ignoring;
+	EXPECT_FALSE(ignoring.tallyGating());
+	EXPECT_EQ(ignoring.setTally(false, false), MediaGateChange::None);
+	EXPECT_TRUE(ignoring.admitVideo(false));
+
+	ViewerMediaGate gate(true);
+	EXPECT_EQ(gate.setTally(false, false), MediaGateChange::Suspended);
+	EXPECT_FALSE(gate.admitVideo(true));
+	EXPECT_TRUE(gate.admitAudio());
+
+	// Preview counts as in use so the cut to program is instant
+	EXPECT_EQ(gate.setTally(false, true), MediaGateChange::Resumed);
+	EXPECT_EQ(gate.setTally(true, false), MediaGateChange::None);
+	EXPECT_TRUE(gate.admitVideo(true));
+}
+
+TEST(MediaGateTest, NamesReasons)
+{
+	EXPECT_STREQ(mediaGateReasonName(MediaGateReason::Paused), "pause request");
+	EXPECT_STREQ(mediaGateReasonName(MediaGateReason::TallyOff), "tally off");
+}
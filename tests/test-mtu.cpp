@@ -0,0 +1,143 @@
+/*
+ * Unit tests for per-viewer RTP MTU selection
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "vdoninja-mtu.h"
+#include "vdoninja-send-queue.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+IceCandidateInfo candidate(IceCandidateKind kind, const char *address, bool tcp = false)
+{
+	IceCandidateInfo info;
+	info.kind = kind;
+	info.tcp = tcp;
+	if (address) {
+		info.address = address;
+	}
+	return info;
+}
+
+} // namespace
+
+TEST(MtuTest, ClassifiesSelectedCandidatePair)
+{
+	EXPECT_EQ(rtpMtuTierForPath(candidate(IceCandidateKind::Host, "192.168.1.10"),
+	                            candidate(IceCandidateKind::Host, "192.168.1.20")),
+	          RtpMtuTier::Lan);
+	EXPECT_EQ(rtpMtuTierForPath(candidate(IceCandidateKind::Host, "10.0.0.2"),
+	                            candidate(IceCandidateKind::PeerReflexive, "fd12:3456::1")),
+	          RtpMtuTier::Lan);
+	EXPECT_EQ(rtpMtuTierForPath(candidate(IceCandidateKind::Host, "192.168.1.10"),
+	                            candidate(IceCandidateKind::ServerReflexive, "203.0.113.7")),
+	          RtpMtuTier::Default);
+	EXPECT_EQ(rtpMtuTierForPath(candidate(IceCandidateKind::Host, "192.168.1.10"),
+	                            candidate(IceCandidateKind::Host, "8.8.8.8")),
+	          RtpMtuTier::Default);
+	EXPECT_EQ(rtpMtuTierForPath(candidate(IceCandidateKind::Relayed, "198.51.100.1"),
+	                            candidate(IceCandidateKind::Host, "192.168.1.20")),
+	          RtpMtuTier::Relay);
+	EXPECT_EQ(rtpMtuTierForPath(candidate(IceCandidateKind::Host, "192.168.1.10", true),
+	                            candidate(IceCandidateKind::Host, "192.168.1.20")),
+	          RtpMtuTier::Relay);
+	EXPECT_EQ(rtpMtuTierForPath(candidate(IceCandidateKind::Host, nullptr), candidate(IceCandidateKind::Host, nullptr)),
+	          RtpMtuTier::Default);
+}
+
+TEST(MtuTest, RecognizesPrivateAddresses)
+{
+	for (const char *address : {"10.1.2.3", "172.16.0.1", "172.31.255.255", "192.168.0.1", "169.254.1.1",
+	                            "100.64.0.1", "127.0.0.1", "fe80::1", "fd00::1", "::1"}) {
+		EXPECT_TRUE(isPrivateAddress(address)) << address;
+	}
+	for (const char *address : {"172.32.0.1", "8.8.8.8", "100.128.0.1", "2001:db8::1", "not-an-ip", "1.2.3"}) {
+		EXPECT_FALSE(isPrivateAddress(address)) << address;
+	}
+}
+
+TEST(MtuTest, MapsPayloadSizesToTiers)
+{
+	EXPECT_EQ(rtpMtuTierForPayload(0), RtpMtuTier::Default);
+	EXPECT_EQ(rtpMtuTierForPayload(1100), RtpMtuTier::Relay);
+	EXPECT_EQ(rtpMtuTierForPayload(1200), RtpMtuTier::Default);
+	EXPECT_EQ(rtpMtuTierForPayload(1400), RtpMtuTier::Lan);
+	EXPECT_EQ(rtpPayloadForTier(RtpMtuTier::Lan), RTP_PAYLOAD_LAN);
+}
+
+TEST(MtuTest, ProbeKeepsLargerSizeWhenLossStaysLow)
+{
+	MtuController mtu(RtpMtuTier::Relay, true);
+	EXPECT_EQ(mtu.tier(), RtpMtuTier::Default);
+	EXPECT_TRUE(mtu.stats().probing);
+
+	mtu.onPacketsNacked(2);
+	mtu.onPacketsSent(MtuController::PROBE_PACKETS);
+	EXPECT_EQ(mtu.tier(), RtpMtuTier::Lan);
+
+	mtu.onPacketsSent(MtuController::PROBE_PACKETS);
+	EXPECT_EQ(mtu.tier(), RtpMtuTier::Lan);
+	EXPECT_FALSE(mtu.stats().probing);
+	EXPECT_EQ(mtu.stats().probes, 2u);
+	EXPECT_EQ(mtu.stats().probeFailures, 0u);
+}
+
+TEST(MtuTest, ProbeFallsBackWhenLargerPacketsAreLost)
+{
+	MtuController mtu(RtpMtuTier::Default, true);
+	mtu.setPathTier(RtpMtuTier::Relay);
+	EXPECT_EQ(mtu.stats().pathTier, RtpMtuTier::Relay);
+	EXPECT_EQ(mtu.tier(), RtpMtuTier::Default);
+
+	mtu.onPacketsSent(100);
+	mtu.onPacketsNacked(30);
+	EXPECT_EQ(mtu.tier(), RtpMtuTier::Relay);
+	EXPECT_FALSE(mtu.stats().probing);
+	EXPECT_EQ(mtu.stats().probeFailures, 1u);
+
+	// Settled: further traffic does not restart the probe
+	mtu.onPacketsSent(MtuController::PROBE_PACKETS * 2);
+	EXPECT_EQ(mtu.tier(), RtpMtuTier::Relay);
+}
+
+TEST(MtuTest, WithoutProbingFollowsPathOnly)
+{
+	MtuController mtu;
+	EXPECT_EQ(mtu.tier(), RtpMtuTier::Default);
+	mtu.setPathTier(RtpMtuTier::Lan);
+	EXPECT_EQ(mtu.tier(), RtpMtuTier::Lan);
+	mtu.onPacketsNacked(1000);
+	EXPECT_EQ(mtu.tier(), RtpMtuTier::Lan);
+	EXPECT_EQ(mtu.stats().probes, 0u);
+}
+
+TEST(MtuTest, FrameIsPacketizedOncePerTier)
+{
+	std::vector<uint8_t> payload(14000, 0x42);
+	OutboundFrame frame;
+	frame.packet = EncodedPacket::copy(payload.data(), payload.size());
+
+	int calls = 0;
+	auto packetizeFor = [&](RtpMtuTier tier) {
+		return frame.rtp(tier, [&](const OutboundFrame &f) {
+			calls++;
+			RtpPacketizer packetizer(RtpPayloadFormat::VP8, 1, 96, rtpPayloadForTier(tier));
+			return packetizer.packetize(f.data(), f.size(), 0, true, 1);
+		});
+	};
+
+	const size_t lanPackets = packetizeFor(RtpMtuTier::Lan).packetCount();
+	const size_t relayPackets = packetizeFor(RtpMtuTier::Relay).packetCount();
+	packetizeFor(RtpMtuTier::Lan);
+	EXPECT_EQ(calls, 2);
+	EXPECT_LT(lanPackets, relayPackets);
+	EXPECT_EQ(frame.sharedRtp(RtpMtuTier::Lan)->packetCount(), lanPackets);
+	EXPECT_EQ(frame.sharedRtp(RtpMtuTier::Default), nullptr);
+}
@@ -0,0 +1,157 @@
+/*
+ * Unit tests for the single-pass H.264/H.265 NAL indexer
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "vdoninja-nal-indexer.h"
+#include "vdoninja-rtp-packetizer.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+std::vector<uint8_t> makeAccessUnit(const std::vector<std::pair<uint8_t, size_t>> &nals, bool longStartCodes)
+{
+	std::vector<uint8_t> out;
+	for (const auto &nal : nals) {
+		if (longStartCodes) {
+			out.push_back(0x00);
+		}
+		out.insert(out.end(), {0x00, 0x00, 0x01});
+		out.push_back(nal.first);
+		for (size_t i = 1; i < nal.second; ++i) {
+			out.push_back(static_cast<uint8_t>((i % 250) + 2));
+		}
+	}
+	return out;
+}
+
+void expectSameIndex(const NalIndex &a, const NalIndex &b)
+{
+	ASSERT_EQ(a.size(), b.size());
+	for (size_t i = 0; i < a.size(); ++i) {
+		EXPECT_EQ(a[i].type, b[i].type) << "span " << i;
+		EXPECT_EQ(a[i].offset, b[i].offset) << "span " << i;
+		EXPECT_EQ(a[i].length, b[i].length) << "span " << i;
+	}
+}
+
+} // namespace
+
+TEST(NalIndexerTest, IndexesMixedStartCodeLengths)
+{
+	std::vector<uint8_t> au = makeAccessUnit({{0x67, 10}, {0x68, 4}}, true);
+	const std::vector<uint8_t> slice = makeAccessUnit({{0x65, 3000}}, false);
+	au.insert(au.end(), slice.begin(), slice.end());
+
+	NalIndex nals;
+	indexNalUnits(au.data(), au.size(), nals);
+
+	ASSERT_EQ(nals.size(), 3u);
+	EXPECT_EQ(nals[0].type, H264_NAL_SPS);
+	EXPECT_EQ(nals[0].offset, 4u);
+	EXPECT_EQ(nals[0].length, 10u);
+	EXPECT_EQ(nals[1].type, H264_NAL_PPS);
+	EXPECT_EQ(nals[1].offset, 18u);
+	EXPECT_EQ(nals[1].length, 4u);
+	EXPECT_EQ(nals[2].type, H264_NAL_IDR);
+	EXPECT_EQ(nals[2].offset, 25u);
+	EXPECT_EQ(nals[2].length, 3000u);
+	EXPECT_TRUE(nalIndexHasType(nals, H264_NAL_IDR));
+}
+
+TEST(NalIndexerTest, SkipsEmptyUnitsAndInputWithoutStartCodes)
+{
+	const std::vector<uint8_t> empty = {0x00, 0x00, 0x01, 0x00, 0x00, 0x01, 0x41, 0x9A};
+	NalIndex nals;
+	indexNalUnits(empty.data(), empty.size(), nals);
+	ASSERT_EQ(nals.size(), 1u);
+	EXPECT_EQ(nals[0].type, 1);
+	EXPECT_EQ(nals[0].length, 2u);
+	EXPECT_FALSE(nalIndexHasType(nals, H264_NAL_IDR));
+
+	const std::vector<uint8_t> raw(100, 0x42);
+	indexNalUnits(raw.data(), raw.size(), nals);
+	EXPECT_TRUE(nals.empty());
+	indexNalUnits(nullptr, 0, nals);
+	EXPECT_TRUE(nals.empty());
+}
+
+TEST(NalIndexerTest, ReadsH265NalUnitTypes)
+{
+	// VPS, SPS, PPS and a CRA picture; H.265 types sit in bits 1-6 of the first header byte
+	const std::vector<uint8_t> au = makeAccessUnit({{0x40, 8}, {0x42, 12}, {0x44, 5}, {0x2A, 400}}, true);
+	NalIndex nals;
+	indexNalUnits(au.data(), au.size(), nals, NalFormat::H265);
+
+	ASSERT_EQ(nals.size(), 4u);
+	EXPECT_EQ(nals[0].type, H265_NAL_VPS);
+	EXPECT_EQ(nals[1].type, H265_NAL_SPS);
+	EXPECT_EQ(nals[2].type, H265_NAL_PPS);
+	EXPECT_EQ(nals[3].type, 21);
+	EXPECT_TRUE(nalIndexHasKeyframe(nals, NalFormat::H265));
+	EXPECT_FALSE(nalIndexHasKeyframe(nals, NalFormat::H264));
+
+	const std::vector<uint8_t> trail = makeAccessUnit({{0x02, 100}}, false);
+	indexNalUnits(trail.data(), trail.size(), nals, NalFormat::H265);
+	ASSERT_EQ(nals.size(), 1u);
+	EXPECT_EQ(nals[0].type, 1);
+	EXPECT_FALSE(nalIndexHasKeyframe(nals, NalFormat::H265));
+}
+
+TEST(NalIndexerTest, VectorSearchMatchesScalarAtEveryAlignment)
+{
+	// Start codes placed at each offset around the 16- and 32-byte block boundaries
+	for (size_t position = 0; position < 70; ++position) {
+		std::vector<uint8_t> data(80, 0xFF);
+		data[position] = 0x00;
+		data[position + 1] = 0x00;
+		data[position + 2] = 0x01;
+		for (size_t from = 0; from <= position + 1; ++from) {
+			ASSERT_EQ(findStartCode(data.data(), data.size(), from),
+			          findStartCodeScalar(data.data(), data.size(), from))
+			    << "position " << position << " from " << from;
+		}
+	}
+}
+
+TEST(NalIndexerTest, VectorIndexMatchesScalarOnRandomData)
+{
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> byte(0, 3); // Small alphabet produces many start codes
+	for (int round = 0; round < 200; ++round) {
+		std::vector<uint8_t> data(static_cast<size_t>(rng() % 600));
+		for (auto &b : data) {
+			b = static_cast<uint8_t>(byte(rng));
+		}
+		NalIndex fast;
+		NalIndex reference;
+		indexNalUnits(data.data(), data.size(), fast);
+		indexNalUnitsScalar(data.data(), data.size(), reference);
+		expectSameIndex(fast, reference);
+	}
+}
+
+TEST(NalIndexerTest, PacketizerOutputIsIdenticalWithPrecomputedIndex)
+{
+	const std::vector<uint8_t> au = makeAccessUnit({{0x67, 12}, {0x68, 4}, {0x65, 5000}, {0x65, 900}}, true);
+	RtpPacketizer packetizer(RtpPayloadFormat::H264, 0x1234, 96);
+
+	NalIndex nals;
+	indexNalUnits(au.data(), au.size(), nals);
+	auto withIndex = packetizer.packetize(au.data(), au.size(), 9000, true, 0, &nals);
+	auto withoutIndex = packetizer.packetize(au.data(), au.size(), 9000, true);
+
+	ASSERT_EQ(withIndex->packetCount(), withoutIndex->packetCount());
+	for (size_t i = 0; i < withIndex->packetCount(); ++i) {
+		ASSERT_EQ(withIndex->packetSize(i), withoutIndex->packetSize(i));
+		EXPECT_EQ(0, std::memcmp(withIndex->packetData(i), withoutIndex->packetData(i), withIndex->packetSize(i)));
+	}
+}
@@ -0,0 +1,131 @@
+/*
+ * Unit tests for Opus RED audio redundancy
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "vdoninja-opus-red.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+constexpr uint32_t kSsrc = 0xABCD;
+constexpr uint8_t kRedPt = 63;
+constexpr uint8_t kOpusPt = 111;
+
+std::vector<uint8_t> opusFrame(uint8_t fill, size_t size = 80)
+{
+	return std::vector<uint8_t>(size, fill);
+}
+
+std::vector<uint8_t> redPayload(const RtpFrame &frame)
+{
+	EXPECT_EQ(frame.packetCount(), 1u);
+	return std::vector<uint8_t>(frame.packetData(0) + RTP_HEADER_SIZE, frame.packetData(0) + frame.packetSize(0));
+}
+
+} // namespace
+
+TEST(OpusRedTest, FirstFrameCarriesOnlyThePrimaryBlock)
+{
+	OpusRedEncoder encoder(kSsrc, kRedPt, kOpusPt);
+	const auto frame = opusFrame(0x11);
+	const OpusRedPackets packets = encoder.encode(frame.data(), frame.size(), 960);
+	ASSERT_NE(packets[0], nullptr);
+
+	const uint8_t *packet = packets[0]->packetData(0);
+	EXPECT_EQ(packet[1] & 0x7F, kRedPt);
+	EXPECT_EQ(readRtpTimestamp(packet), 960u);
+	EXPECT_EQ(readRtpSsrc(packet), kSsrc);
+
+	const std::vector<uint8_t> payload = redPayload(*packets[0]);
+	ASSERT_EQ(payload.size(), 1 + frame.size());
+	EXPECT_EQ(payload[0], kOpusPt);
+	EXPECT_EQ(payload[1], 0x11);
+}
+
+TEST(OpusRedTest, RepeatsPreviousFramesOldestFirst)
+{
+	OpusRedEncoder encoder(kSsrc, kRedPt, kOpusPt);
+	const auto first = opusFrame(0x11, 70);
+	const auto second = opusFrame(0x22, 90);
+	const auto third = opusFrame(0x33, 80);
+	encoder.encode(first.data(), first.size(), 0);
+	encoder.encode(second.data(), second.size(), 960);
+	const OpusRedPackets packets = encoder.encode(third.data(), third.size(), 1920);
+
+	// Distance 1: one redundant block for the second frame
+	std::vector<uint8_t> payload = redPayload(*packets[0]);
+	ASSERT_EQ(payload.size(), 4 + 1 + second.size() + third.size());
+	EXPECT_EQ(payload[0], 0x80 | kOpusPt);
+	const uint32_t offset = (payload[1] << 6) | (payload[2] >> 2);
+	const size_t length = ((payload[2] & 0x03) << 8) | payload[3];
+	EXPECT_EQ(offset, 960u);
+	EXPECT_EQ(length, second.size());
+	EXPECT_EQ(payload[4], kOpusPt);
+	EXPECT_EQ(payload[5], 0x22);
+	EXPECT_EQ(payload[5 + second.size()], 0x33);
+
+	// Distance 2: both previous frames
+	payload = redPayload(*packets[1]);
+	ASSERT_EQ(payload.size(), 8 + 1 + first.size() + second.size() + third.size());
+	EXPECT_EQ((payload[1] << 6) | (payload[2] >> 2), 1920);
+	EXPECT_EQ((payload[5] << 6) | (payload[6] >> 2), 960);
+	EXPECT_EQ(payload[8], kOpusPt);
+	EXPECT_EQ(payload[9], 0x11);
+	EXPECT_EQ(payload[9 + first.size()], 0x22);
+}
+
+TEST(OpusRedTest, SkipsStaleDtxAndOversizedFrames)
+{
+	OpusRedEncoder encoder(kSsrc, kRedPt, kOpusPt);
+	const auto frame = opusFrame(0x11);
+	const auto dtx = opusFrame(0x01, 1);
+	const auto large = opusFrame(0x22, OPUS_RED_MAX_BLOCK_SIZE + 1);
+
+	// More than 14 bits of timestamp offset cannot be expressed
+	encoder.encode(frame.data(), frame.size(), 0);
+	OpusRedPackets packets = encoder.encode(frame.data(), frame.size(), OPUS_RED_MAX_TIMESTAMP_OFFSET + 1);
+	EXPECT_EQ(packets[0]->packetSize(0), RTP_HEADER_SIZE + 1 + frame.size());
+
+	encoder.reset();
+	encoder.encode(dtx.data(), dtx.size(), 0);
+	encoder.encode(large.data(), large.size(), 960);
+	packets = encoder.encode(frame.data(), frame.size(), 1920);
+	EXPECT_EQ(packets[1]->packetSize(0), RTP_HEADER_SIZE + 1 + frame.size());
+}
+
+TEST(OpusRedTest, ControllerFollowsReportedLoss)
+{
+	OpusRedController controller;
+	EXPECT_EQ(controller.distance(), 0u);
+
+	EXPECT_FALSE(controller.onReceiverReport(0));
+	// 2% loss: one previous frame
+	EXPECT_TRUE(controller.onReceiverReport(13));
+	EXPECT_EQ(controller.distance(), 1u);
+
+	// Sustained 10% loss: two previous frames
+	while (controller.distance() < OPUS_RED_MAX_DISTANCE) {
+		ASSERT_LT(controller.stats().activations, 2u);
+		controller.onReceiverReport(26);
+	}
+	EXPECT_EQ(controller.stats().activations, 1u);
+
+	// Clean reports step down and then switch RED off
+	int reports = 0;
+	while (controller.distance() > 0 && reports < 50) {
+		controller.onReceiverReport(0);
+		reports++;
+	}
+	EXPECT_EQ(controller.distance(), 0u);
+	EXPECT_GT(reports, 2);
+
+	controller.countPacket();
+	EXPECT_EQ(controller.stats().redPackets, 1u);
+}
@@ -0,0 +1,176 @@
+/*
+ * Unit tests for the send-side RTP pacer
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vdoninja-pacer.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+std::shared_ptr<const RtpFrame> makeFrame(const RtpPacketizer &packetizer, size_t size)
+{
+	std::vector<uint8_t> payload(size, 0x42);
+	return packetizer.packetize(payload.data(), payload.size(), 3000, false, 1);
+}
+
+template <typename Predicate> bool waitFor(Predicate predicate)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (std::chrono::steady_clock::now() < deadline) {
+		if (predicate()) {
+			return true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return predicate();
+}
+
+struct SentPacket {
+	MediaKind kind;
+	uint16_t sequence;
+	int64_t sentAtUs;
+};
+
+} // namespace
+
+TEST(LeakyBucketTest, AllowsBurstThenWaitsForRefill)
+{
+	LeakyBucket bucket(8000000, 5000); // 1 MB/s, 5 KB burst
+	const int64_t start = 1000000;
+	EXPECT_TRUE(bucket.canSend(start));
+	bucket.consume(4000);
+	EXPECT_TRUE(bucket.canSend(start));
+	bucket.consume(2000);
+	EXPECT_FALSE(bucket.canSend(start));
+
+	// 1000 bytes of debt drain in 1 ms
+	EXPECT_GE(bucket.nextSendUs(start), start + 1000);
+	EXPECT_LE(bucket.nextSendUs(start), start + 1002);
+	EXPECT_TRUE(bucket.canSend(start + 1002));
+}
+
+TEST(LeakyBucketTest, RefillIsCappedAtBurst)
+{
+	LeakyBucket bucket(8000000, 5000);
+	EXPECT_TRUE(bucket.canSend(1000));
+	EXPECT_TRUE(bucket.canSend(10000000));
+	bucket.consume(5000);
+	EXPECT_FALSE(bucket.canSend(10000000));
+}
+
+TEST(LeakyBucketTest, ZeroRateIsUnpaced)
+{
+	LeakyBucket bucket(0);
+	bucket.consume(1000000);
+	EXPECT_TRUE(bucket.canSend(1));
+	EXPECT_EQ(bucket.nextSendUs(5), 5);
+}
+
+TEST(RtpPacerTest, SpreadsVideoAtConfiguredRate)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::VP8, 0x1234, 96, 1000);
+	auto frame = makeFrame(packetizer, 996 * 20); // 20 packets of 996 bytes after the descriptor
+
+	std::mutex mutex;
+	std::vector<SentPacket> sent;
+	auto stream = std::make_shared<PacedStream>(
+	    [&](MediaKind kind, const uint8_t *data, size_t) {
+		    std::lock_guard<std::mutex> lock(mutex);
+		    sent.push_back({kind, readRtpSequence(data), MediaSendPool::nowUs()});
+	    },
+	    800000); // 100 KB/s
+
+	RtpPacer pacer(1);
+	pacer.start();
+	pacer.addStream(stream);
+	const int64_t start = MediaSendPool::nowUs();
+	stream->push(MediaKind::Video, frame, 65530);
+
+	ASSERT_TRUE(waitFor([&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return sent.size() == 20;
+	}));
+	for (size_t i = 0; i < sent.size(); ++i) {
+		EXPECT_EQ(sent[i].sequence, static_cast<uint16_t>(65530 + i));
+	}
+	// ~19 KB beyond the initial burst at 100 KB/s
+	EXPECT_GE(sent.back().sentAtUs - start, 150000);
+	EXPECT_EQ(stream->queuedPackets(), 0u);
+	EXPECT_EQ(pacer.getStats().sentPackets, 20u);
+	pacer.stop();
+}
+
+TEST(RtpPacerTest, AudioOvertakesQueuedVideo)
+{
+	RtpPacketizer videoPacketizer(RtpPayloadFormat::VP8, 0x1234, 96, 1000);
+	RtpPacketizer audioPacketizer(RtpPayloadFormat::Opus, 0x5678, 111);
+	std::vector<uint8_t> opus(120, 0x11);
+	auto audio = audioPacketizer.packetize(opus.data(), opus.size(), 960, false);
+
+	std::mutex mutex;
+	std::vector<SentPacket> sent;
+	auto stream = std::make_shared<PacedStream>(
+	    [&](MediaKind kind, const uint8_t *data, size_t) {
+		    std::lock_guard<std::mutex> lock(mutex);
+		    sent.push_back({kind, readRtpSequence(data), MediaSendPool::nowUs()});
+	    },
+	    800000);
+
+	RtpPacer pacer(1);
+	pacer.start();
+	pacer.addStream(stream);
+	stream->push(MediaKind::Video, makeFrame(videoPacketizer, 996 * 30), 100);
+	ASSERT_TRUE(waitFor([&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return !sent.empty();
+	}));
+	stream->push(MediaKind::Audio, audio, 7);
+
+	ASSERT_TRUE(waitFor([&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return sent.size() == 31;
+	}));
+	size_t audioIndex = 0;
+	for (size_t i = 0; i < sent.size(); ++i) {
+		if (sent[i].kind == MediaKind::Audio) {
+			audioIndex = i;
+			EXPECT_EQ(sent[i].sequence, 7);
+		}
+	}
+	EXPECT_LT(audioIndex, 20u);
+	pacer.stop();
+}
+
+TEST(RtpPacerTest, DetachedStreamDropsPushes)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::VP8, 0x1234, 96, 1000);
+	std::atomic<int> count{0};
+	auto stream = std::make_shared<PacedStream>([&](MediaKind, const uint8_t *, size_t) { count++; }, 0);
+
+	stream->push(MediaKind::Video, makeFrame(packetizer, 500), 1);
+	EXPECT_EQ(stream->queuedPackets(), 0u);
+
+	RtpPacer pacer(1);
+	pacer.start();
+	pacer.addStream(stream);
+	stream->push(MediaKind::Video, makeFrame(packetizer, 500), 1);
+	ASSERT_TRUE(waitFor([&]() { return count == 1; }));
+
+	pacer.removeStream(stream);
+	stream->push(MediaKind::Video, makeFrame(packetizer, 500), 2);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_EQ(count, 1);
+	EXPECT_EQ(pacer.getStats().streams, 0u);
+	pacer.stop();
+}
@@ -0,0 +1,184 @@
+/*
+ * Unit tests for the H.264/H.265 parameter-set cache
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "vdoninja-parameter-sets.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+const std::vector<uint8_t> kSps0 = {0x67, 0x42, 0xC0, 0x1F, 0xDA, 0x01, 0x40, 0x16};
+const std::vector<uint8_t> kSps1 = {0x67, 0x42, 0xC0, 0x1F, 0x5A, 0x01, 0x40, 0x16}; // seq_parameter_set_id 1
+const std::vector<uint8_t> kPps0 = {0x68, 0xCE, 0x3C, 0x80};
+const std::vector<uint8_t> kIdr = {0x65, 0x88, 0x84, 0x00, 0x33};
+const std::vector<uint8_t> kSlice = {0x41, 0x9A, 0x02};
+
+// H.265 Main profile units; the SPS profile_tier_level carries emulation prevention bytes
+const std::vector<uint8_t> kHevcVps = {0x40, 0x01, 0x0C, 0x01, 0xFF, 0xFF, 0x01, 0x60};
+const std::vector<uint8_t> kHevcSps0 = {0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00,
+                                        0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5D, 0xA0, 0x02, 0x80, 0x80};
+const std::vector<uint8_t> kHevcSps1 = {0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00,
+                                        0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5D, 0x50, 0x02, 0x80, 0x80};
+const std::vector<uint8_t> kHevcPps = {0x44, 0x01, 0xC1, 0x72, 0xB4, 0x62, 0x40};
+const std::vector<uint8_t> kHevcIdr = {0x26, 0x01, 0xAF, 0x06, 0xB8};
+
+std::vector<uint8_t> annexB(const std::vector<std::vector<uint8_t>> &nals)
+{
+	std::vector<uint8_t> out;
+	for (const auto &nal : nals) {
+		out.insert(out.end(), {0x00, 0x00, 0x00, 0x01});
+		out.insert(out.end(), nal.begin(), nal.end());
+	}
+	return out;
+}
+
+NalIndex indexOf(const std::vector<uint8_t> &data, NalFormat format = NalFormat::H264)
+{
+	NalIndex nals;
+	indexNalUnits(data.data(), data.size(), nals, format);
+	return nals;
+}
+
+} // namespace
+
+TEST(ParameterSetCacheTest, StoresInBandParameterSetsById)
+{
+	ParameterSetCache cache;
+	const auto au = annexB({kSps0, kSps1, kPps0, kIdr});
+	EXPECT_TRUE(cache.update(au.data(), au.size(), indexOf(au)));
+	EXPECT_TRUE(cache.complete());
+	EXPECT_EQ(cache.spsCount(), 2u);
+	EXPECT_EQ(cache.ppsCount(), 1u);
+
+	// The same units again change nothing
+	EXPECT_FALSE(cache.update(au.data(), au.size(), indexOf(au)));
+
+	const auto slice = annexB({kSlice});
+	EXPECT_FALSE(cache.update(slice.data(), slice.size(), indexOf(slice)));
+}
+
+TEST(ParameterSetCacheTest, AppendsOnlyMissingParameterSets)
+{
+	ParameterSetCache cache;
+	const auto headers = annexB({kSps0, kPps0});
+	ASSERT_TRUE(cache.updateFromExtraData(headers.data(), headers.size()));
+
+	const auto idrOnly = annexB({kIdr});
+	std::vector<uint8_t> out;
+	NalIndex outNals;
+	const size_t added = cache.appendMissing(indexOf(idrOnly), out, outNals);
+	EXPECT_EQ(added, out.size());
+	EXPECT_EQ(out, headers);
+	ASSERT_EQ(outNals.size(), 2u);
+	EXPECT_EQ(outNals[0].type, H264_NAL_SPS);
+	EXPECT_EQ(outNals[0].offset, 4u);
+	EXPECT_EQ(outNals[1].type, H264_NAL_PPS);
+	EXPECT_EQ(outNals[1].offset, 4u + kSps0.size() + 4u);
+
+	const auto withSps = annexB({kSps0, kIdr});
+	out.clear();
+	outNals.clear();
+	cache.appendMissing(indexOf(withSps), out, outNals);
+	ASSERT_EQ(outNals.size(), 1u);
+	EXPECT_EQ(outNals[0].type, H264_NAL_PPS);
+
+	const auto complete = annexB({kSps0, kPps0, kIdr});
+	out.clear();
+	outNals.clear();
+	EXPECT_EQ(cache.appendMissing(indexOf(complete), out, outNals), 0u);
+	EXPECT_TRUE(outNals.empty());
+}
+
+TEST(ParameterSetCacheTest, ParsesAvcConfigurationRecord)
+{
+	std::vector<uint8_t> avcc = {0x01, 0x42, 0xC0, 0x1F, 0xFF, 0xE1};
+	avcc.push_back(0x00);
+	avcc.push_back(static_cast<uint8_t>(kSps0.size()));
+	avcc.insert(avcc.end(), kSps0.begin(), kSps0.end());
+	avcc.push_back(0x01);
+	avcc.push_back(0x00);
+	avcc.push_back(static_cast<uint8_t>(kPps0.size()));
+	avcc.insert(avcc.end(), kPps0.begin(), kPps0.end());
+
+	ParameterSetCache cache;
+	EXPECT_TRUE(cache.updateFromExtraData(avcc.data(), avcc.size()));
+	EXPECT_EQ(cache.spsCount(), 1u);
+	EXPECT_EQ(cache.ppsCount(), 1u);
+
+	// Truncated records keep what was parsed and never read past the end
+	ParameterSetCache truncated;
+	truncated.updateFromExtraData(avcc.data(), avcc.size() - 2);
+	EXPECT_EQ(truncated.spsCount(), 1u);
+	EXPECT_EQ(truncated.ppsCount(), 0u);
+	EXPECT_FALSE(truncated.complete());
+}
+
+TEST(ParameterSetCacheTest, ReplacesParameterSetWithSameId)
+{
+	ParameterSetCache cache;
+	const auto first = annexB({kSps0, kPps0});
+	cache.updateFromExtraData(first.data(), first.size());
+
+	std::vector<uint8_t> updatedPps = {0x68, 0xCE, 0x38, 0x80};
+	const auto second = annexB({updatedPps, kIdr});
+	EXPECT_TRUE(cache.update(second.data(), second.size(), indexOf(second)));
+	EXPECT_EQ(cache.ppsCount(), 1u);
+
+	const auto idrOnly = annexB({kIdr});
+	std::vector<uint8_t> out;
+	NalIndex outNals;
+	cache.appendMissing(indexOf(idrOnly), out, outNals);
+	ASSERT_EQ(outNals.size(), 2u);
+	EXPECT_EQ(std::vector<uint8_t>(out.begin() + outNals[1].offset, out.end()), updatedPps);
+}
+
+TEST(ParameterSetCacheTest, StoresHevcParameterSetsById)
+{
+	ParameterSetCache cache(NalFormat::H265);
+	const auto au = annexB({kHevcVps, kHevcSps0, kHevcSps1, kHevcPps, kHevcIdr});
+	EXPECT_TRUE(cache.update(au.data(), au.size(), indexOf(au, NalFormat::H265)));
+	EXPECT_TRUE(cache.complete());
+	EXPECT_EQ(cache.vpsCount(), 1u);
+	EXPECT_EQ(cache.spsCount(), 2u);
+	EXPECT_EQ(cache.ppsCount(), 1u);
+
+	// Joiners get VPS, SPS and PPS ahead of the IRAP picture, in decoding order
+	const auto idrOnly = annexB({kHevcIdr});
+	std::vector<uint8_t> out;
+	NalIndex outNals;
+	cache.appendMissing(indexOf(idrOnly, NalFormat::H265), out, outNals);
+	ASSERT_EQ(outNals.size(), 4u);
+	EXPECT_EQ(outNals[0].type, H265_NAL_VPS);
+	EXPECT_EQ(outNals[1].type, H265_NAL_SPS);
+	EXPECT_EQ(outNals[2].type, H265_NAL_SPS);
+	EXPECT_EQ(outNals[3].type, H265_NAL_PPS);
+	EXPECT_EQ(out, annexB({kHevcVps, kHevcSps0, kHevcSps1, kHevcPps}));
+}
+
+TEST(ParameterSetCacheTest, ParsesHevcConfigurationRecord)
+{
+	std::vector<uint8_t> hvcc(22, 0x00);
+	hvcc[0] = 0x01;
+	hvcc.push_back(3);
+	for (const auto *nal : {&kHevcVps, &kHevcSps0, &kHevcPps}) {
+		hvcc.push_back(static_cast<uint8_t>(0x80 | nalUnitType(nal->data(), NalFormat::H265)));
+		hvcc.insert(hvcc.end(), {0x00, 0x01, 0x00, static_cast<uint8_t>(nal->size())});
+		hvcc.insert(hvcc.end(), nal->begin(), nal->end());
+	}
+
+	ParameterSetCache cache(NalFormat::H265);
+	EXPECT_TRUE(cache.updateFromExtraData(hvcc.data(), hvcc.size()));
+	EXPECT_TRUE(cache.complete());
+
+	// H.264 units are not parameter sets in an H.265 cache
+	ParameterSetCache mismatched(NalFormat::H265);
+	const auto h264 = annexB({kSps0, kPps0});
+	EXPECT_FALSE(mismatched.updateFromExtraData(h264.data(), h264.size()));
+}
@@ -0,0 +1,139 @@
+/*
+ * Unit tests for RTCP feedback parsing
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "vdoninja-rtcp.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+void put32(std::vector<uint8_t> &out, uint32_t value)
+{
+	out.push_back(static_cast<uint8_t>(value >> 24));
+	out.push_back(static_cast<uint8_t>(value >> 16));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+// Header for a packet whose total size (including header) is `bytes`
+void putHeader(std::vector<uint8_t> &out, uint8_t count, uint8_t type, size_t bytes)
+{
+	const uint16_t words = static_cast<uint16_t>(bytes / 4 - 1);
+	out.push_back(static_cast<uint8_t>(0x80 | count));
+	out.push_back(type);
+	out.push_back(static_cast<uint8_t>(words >> 8));
+	out.push_back(static_cast<uint8_t>(words));
+}
+
+std::vector<uint8_t> receiverReport(uint32_t mediaSsrc, uint8_t fractionLost)
+{
+	std::vector<uint8_t> out;
+	putHeader(out, 1, 201, 32);
+	put32(out, 0x1111);    // sender
+	put32(out, mediaSsrc); // report block
+	out.push_back(fractionLost);
+	out.insert(out.end(), {0xFF, 0xFF, 0xFE}); // cumulative lost = -2
+	put32(out, 70000);
+	put32(out, 12);
+	put32(out, 0xAABBCCDD);
+	put32(out, 0x100);
+	return out;
+}
+
+std::vector<uint8_t> remb(uint8_t exponent, uint32_t mantissa, uint32_t mediaSsrc)
+{
+	std::vector<uint8_t> out;
+	putHeader(out, 15, 206, 24);
+	put32(out, 0x1111);
+	put32(out, 0);
+	out.insert(out.end(), {'R', 'E', 'M', 'B', 1});
+	out.push_back(static_cast<uint8_t>((exponent << 2) | (mantissa >> 16)));
+	out.push_back(static_cast<uint8_t>(mantissa >> 8));
+	out.push_back(static_cast<uint8_t>(mantissa));
+	put32(out, mediaSsrc);
+	return out;
+}
+
+} // namespace
+
+TEST(RtcpParserTest, ParsesReceiverReportBlocks)
+{
+	auto packet = receiverReport(0x2222, 64);
+	RtcpFeedback feedback;
+	ASSERT_TRUE(parseRtcp(packet.data(), packet.size(), feedback));
+	ASSERT_EQ(feedback.reports.size(), 1u);
+	const auto &report = feedback.reports[0];
+	EXPECT_EQ(report.ssrc, 0x2222u);
+	EXPECT_EQ(report.fractionLost, 64);
+	EXPECT_EQ(report.cumulativeLost, -2);
+	EXPECT_EQ(report.highestSequence, 70000u);
+	EXPECT_EQ(report.jitter, 12u);
+	EXPECT_EQ(report.lastSenderReport, 0xAABBCCDDu);
+}
+
+TEST(RtcpParserTest, ParsesCompoundReportAndRemb)
+{
+	auto packet = receiverReport(0x2222, 0);
+	auto rembPacket = remb(3, 250000, 0x2222);
+	packet.insert(packet.end(), rembPacket.begin(), rembPacket.end());
+
+	RtcpFeedback feedback;
+	ASSERT_TRUE(parseRtcp(packet.data(), packet.size(), feedback));
+	EXPECT_EQ(feedback.reports.size(), 1u);
+	ASSERT_TRUE(feedback.rembBitrate.has_value());
+	EXPECT_EQ(*feedback.rembBitrate, 2000000u);
+	ASSERT_EQ(feedback.rembSsrcs.size(), 1u);
+	EXPECT_EQ(feedback.rembSsrcs[0], 0x2222u);
+}
+
+TEST(RtcpParserTest, ExpandsGenericNackBitmask)
+{
+	std::vector<uint8_t> packet;
+	putHeader(packet, 1, 205, 16);
+	put32(packet, 0x1111);
+	put32(packet, 0x2222);
+	packet.insert(packet.end(), {0xFF, 0xFE, 0x00, 0x05}); // PID 65534, BLP bits 0 and 2
+
+	RtcpFeedback feedback;
+	ASSERT_TRUE(parseRtcp(packet.data(), packet.size(), feedback));
+	ASSERT_EQ(feedback.nacks.size(), 1u);
+	EXPECT_EQ(feedback.nacks[0].mediaSsrc, 0x2222u);
+	EXPECT_EQ(feedback.nacks[0].sequences, (std::vector<uint16_t>{65534, 65535, 1}));
+}
+
+TEST(RtcpParserTest, ParsesKeyframeRequests)
+{
+	std::vector<uint8_t> packet;
+	putHeader(packet, 1, 206, 12); // PLI
+	put32(packet, 0x1111);
+	put32(packet, 0x2222);
+	putHeader(packet, 4, 206, 20); // FIR
+	put32(packet, 0x1111);
+	put32(packet, 0);
+	put32(packet, 0x3333);
+	put32(packet, 0x01000000);
+
+	RtcpFeedback feedback;
+	ASSERT_TRUE(parseRtcp(packet.data(), packet.size(), feedback));
+	EXPECT_EQ(feedback.pliSsrcs, (std::vector<uint32_t>{0x2222}));
+	EXPECT_EQ(feedback.firSsrcs, (std::vector<uint32_t>{0x3333}));
+}
+
+TEST(RtcpParserTest, RejectsMalformedPackets)
+{
+	RtcpFeedback feedback;
+	std::vector<uint8_t> badVersion = {0x40, 201, 0, 0};
+	EXPECT_FALSE(parseRtcp(badVersion.data(), badVersion.size(), feedback));
+
+	auto truncated = receiverReport(1, 0);
+	truncated.resize(20);
+	EXPECT_FALSE(parseRtcp(truncated.data(), truncated.size(), feedback));
+	EXPECT_FALSE(parseRtcp(nullptr, 0, feedback));
+}
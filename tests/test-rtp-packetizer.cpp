@@ -0,0 +1,268 @@
+/*
+ * Unit tests for the shared RTP packetization stage
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "vdoninja-rtp-packetizer.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+std::vector<uint8_t> annexB(const std::vector<std::vector<uint8_t>> &nals)
+{
+	std::vector<uint8_t> out;
+	for (const auto &nal : nals) {
+		out.insert(out.end(), {0x00, 0x00, 0x00, 0x01});
+		out.insert(out.end(), nal.begin(), nal.end());
+	}
+	return out;
+}
+
+std::vector<uint8_t> makeNal(uint8_t header, size_t size)
+{
+	std::vector<uint8_t> nal(size);
+	nal[0] = header;
+	for (size_t i = 1; i < size; ++i) {
+		nal[i] = static_cast<uint8_t>((i % 250) + 1);
+	}
+	return nal;
+}
+
+bool marker(const uint8_t *packet)
+{
+	return (packet[1] & 0x80) != 0;
+}
+
+} // namespace
+
+TEST(RtpPacketizerTest, WritesFixedHeaderFields)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::Opus, 0x11223344, 111);
+	const std::vector<uint8_t> payload = {1, 2, 3, 4};
+	auto frame = packetizer.packetize(payload.data(), payload.size(), 48000, false);
+
+	ASSERT_EQ(frame->packetCount(), 1u);
+	const uint8_t *packet = frame->packetData(0);
+	EXPECT_EQ(frame->packetSize(0), RTP_HEADER_SIZE + payload.size());
+	EXPECT_EQ(packet[0], 0x80);
+	EXPECT_EQ(packet[1], 111);
+	EXPECT_EQ(readRtpTimestamp(packet), 48000u);
+	EXPECT_EQ(readRtpSsrc(packet), 0x11223344u);
+	EXPECT_EQ(packet[RTP_HEADER_SIZE], 1);
+}
+
+TEST(RtpPacketizerTest, SmallNalUnitsUseSingleNalPackets)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::H264, 1, 96);
+	auto data = annexB({makeNal(0x67, 20), makeNal(0x68, 6), makeNal(0x65, 300)});
+	auto frame = packetizer.packetize(data.data(), data.size(), 9000, true);
+
+	ASSERT_EQ(frame->packetCount(), 3u);
+	EXPECT_EQ(frame->packetData(0)[RTP_HEADER_SIZE], 0x67);
+	EXPECT_EQ(frame->packetSize(0), RTP_HEADER_SIZE + 20);
+	EXPECT_EQ(frame->packetData(1)[RTP_HEADER_SIZE], 0x68);
+	EXPECT_EQ(frame->packetSize(2), RTP_HEADER_SIZE + 300);
+	EXPECT_FALSE(marker(frame->packetData(0)));
+	EXPECT_FALSE(marker(frame->packetData(1)));
+	EXPECT_TRUE(marker(frame->packetData(2)));
+	EXPECT_TRUE(frame->keyframe);
+}
+
+TEST(RtpPacketizerTest, AcceptsThreeByteStartCodes)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::H264, 1, 96);
+	std::vector<uint8_t> data = {0x00, 0x00, 0x01, 0x41, 0xAA, 0xBB, 0x00, 0x00, 0x01, 0x41, 0xCC};
+	auto frame = packetizer.packetize(data.data(), data.size(), 0, false);
+
+	ASSERT_EQ(frame->packetCount(), 2u);
+	EXPECT_EQ(frame->packetSize(0), RTP_HEADER_SIZE + 3);
+	EXPECT_EQ(frame->packetSize(1), RTP_HEADER_SIZE + 2);
+}
+
+TEST(RtpPacketizerTest, LargeNalUnitsAreFragmentedAsFuA)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::H264, 1, 96, 1200);
+	auto nal = makeNal(0x65, 3000);
+	auto data = annexB({nal});
+	auto frame = packetizer.packetize(data.data(), data.size(), 0, true);
+
+	ASSERT_EQ(frame->packetCount(), 3u);
+	size_t reassembled = 1;
+	for (size_t i = 0; i < frame->packetCount(); ++i) {
+		const uint8_t *packet = frame->packetData(i);
+		EXPECT_LE(frame->packetSize(i), RTP_HEADER_SIZE + 1200);
+		EXPECT_EQ(packet[RTP_HEADER_SIZE] & 0x1F, 28);
+		EXPECT_EQ(packet[RTP_HEADER_SIZE] & 0x60, 0x60);
+		EXPECT_EQ(packet[RTP_HEADER_SIZE + 1] & 0x1F, 5);
+		EXPECT_EQ((packet[RTP_HEADER_SIZE + 1] & 0x80) != 0, i == 0);
+		EXPECT_EQ((packet[RTP_HEADER_SIZE + 1] & 0x40) != 0, i + 1 == frame->packetCount());
+		EXPECT_EQ(marker(packet), i + 1 == frame->packetCount());
+		reassembled += frame->packetSize(i) - RTP_HEADER_SIZE - 2;
+	}
+	EXPECT_EQ(reassembled, nal.size());
+}
+
+TEST(RtpPacketizerTest, LargeH265NalUnitsAreFragmentedAsFu)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::H265, 1, 96, 1200);
+	auto vps = makeNal(0x40, 24);
+	vps[1] = 0x01;
+	auto idr = makeNal(0x26, 3000); // IDR_W_RADL
+	idr[1] = 0x01;
+	auto data = annexB({vps, idr});
+	auto frame = packetizer.packetize(data.data(), data.size(), 0, true);
+
+	ASSERT_EQ(frame->packetCount(), 4u);
+	EXPECT_EQ(frame->packetSize(0), RTP_HEADER_SIZE + vps.size());
+	EXPECT_FALSE(marker(frame->packetData(0)));
+
+	size_t reassembled = 2;
+	for (size_t i = 1; i < frame->packetCount(); ++i) {
+		const uint8_t *packet = frame->packetData(i);
+		EXPECT_LE(frame->packetSize(i), RTP_HEADER_SIZE + 1200);
+		EXPECT_EQ((packet[RTP_HEADER_SIZE] >> 1) & 0x3F, 49);
+		EXPECT_EQ(packet[RTP_HEADER_SIZE + 1], 0x01);
+		EXPECT_EQ(packet[RTP_HEADER_SIZE + 2] & 0x3F, 19);
+		EXPECT_EQ((packet[RTP_HEADER_SIZE + 2] & 0x80) != 0, i == 1);
+		EXPECT_EQ((packet[RTP_HEADER_SIZE + 2] & 0x40) != 0, i + 1 == frame->packetCount());
+		EXPECT_EQ(marker(packet), i + 1 == frame->packetCount());
+		reassembled += frame->packetSize(i) - RTP_HEADER_SIZE - 3;
+	}
+	EXPECT_EQ(reassembled, idr.size());
+}
+
+TEST(RtpPacketizerTest, EmptyInputProducesNoPackets)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::H264, 1, 96);
+	auto frame = packetizer.packetize(nullptr, 0, 0, false);
+	EXPECT_EQ(frame->packetCount(), 0u);
+}
+
+TEST(RtpPacketizerTest, Vp8FramesAreFragmentedWithPayloadDescriptor)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::VP8, 1, 96, 1000);
+	std::vector<uint8_t> data(2500, 0x5A);
+	auto frame = packetizer.packetize(data.data(), data.size(), 0, true, 0x1234);
+
+	ASSERT_EQ(frame->packetCount(), 3u);
+	size_t reassembled = 0;
+	for (size_t i = 0; i < frame->packetCount(); ++i) {
+		const uint8_t *descriptor = frame->packetData(i) + RTP_HEADER_SIZE;
+		EXPECT_LE(frame->packetSize(i), RTP_HEADER_SIZE + 1000);
+		EXPECT_EQ(descriptor[0], i == 0 ? 0x90 : 0x80);
+		EXPECT_EQ(descriptor[1], 0x80);
+		EXPECT_EQ(descriptor[2], 0x80 | 0x12);
+		EXPECT_EQ(descriptor[3], 0x34);
+		EXPECT_EQ(readRtpMarker(frame->packetData(i)), i + 1 == frame->packetCount());
+		reassembled += frame->packetSize(i) - RTP_HEADER_SIZE - 4;
+	}
+	EXPECT_EQ(reassembled, data.size());
+}
+
+TEST(RtpPacketizerTest, Vp9DescriptorMarksFrameBoundaries)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::VP9, 1, 96, 1000);
+	std::vector<uint8_t> data(2500, 0x5A);
+
+	auto keyframe = packetizer.packetize(data.data(), data.size(), 0, true, 7);
+	ASSERT_EQ(keyframe->packetCount(), 3u);
+	EXPECT_EQ(keyframe->packetData(0)[RTP_HEADER_SIZE], 0x88);
+	EXPECT_EQ(keyframe->packetData(1)[RTP_HEADER_SIZE], 0x80);
+	EXPECT_EQ(keyframe->packetData(2)[RTP_HEADER_SIZE], 0x84);
+	EXPECT_EQ(keyframe->packetData(0)[RTP_HEADER_SIZE + 2], 7);
+	EXPECT_TRUE(readRtpMarker(keyframe->packetData(2)));
+
+	auto delta = packetizer.packetize(data.data(), 100, 3000, false, 8);
+	ASSERT_EQ(delta->packetCount(), 1u);
+	EXPECT_EQ(delta->packetData(0)[RTP_HEADER_SIZE], 0xCC);
+}
+
+TEST(RtpPacketizerTest, Av1ObusAreAggregatedAndFragmented)
+{
+	// Temporal delimiter, sequence header and a large frame OBU, each with a size field
+	std::vector<uint8_t> data = {0x12, 0x00, 0x0A, 0x03, 0xAA, 0xBB, 0xCC};
+	const size_t frameSize = 1500;
+	data.insert(data.end(),
+	            {0x32, static_cast<uint8_t>(0x80 | (frameSize & 0x7F)), static_cast<uint8_t>(frameSize >> 7)});
+	data.insert(data.end(), frameSize, 0x44);
+
+	RtpPacketizer packetizer(RtpPayloadFormat::AV1, 1, 96, 1000);
+	auto frame = packetizer.packetize(data.data(), data.size(), 0, true);
+
+	ASSERT_EQ(frame->packetCount(), 2u);
+	const uint8_t *first = frame->packetData(0) + RTP_HEADER_SIZE;
+	EXPECT_EQ(first[0], 0x48); // Y + N
+	EXPECT_EQ(first[1], 4);    // sequence header element length
+	EXPECT_EQ(first[2], 0x08); // size field cleared
+	EXPECT_EQ(first[6] & 0x7F, (1000 - 6 - 2) & 0x7F);
+	EXPECT_EQ(first[8], 0x30);
+	EXPECT_EQ(frame->packetSize(0), RTP_HEADER_SIZE + 1000);
+	EXPECT_FALSE(readRtpMarker(frame->packetData(0)));
+
+	const uint8_t *second = frame->packetData(1) + RTP_HEADER_SIZE;
+	EXPECT_EQ(second[0], 0x80); // Z
+	EXPECT_TRUE(readRtpMarker(frame->packetData(1)));
+
+	// Both fragments together carry the OBU header and its payload
+	const size_t firstChunk = 1000 - 1 - 5 - 2;
+	const size_t secondChunk = frame->packetSize(1) - RTP_HEADER_SIZE - 1 - 2;
+	EXPECT_EQ(firstChunk + secondChunk, frameSize + 1);
+}
+
+TEST(RtpPacketizerTest, ArenaSlotsAreRecycled)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::H264, 1, 96, 1200);
+	auto data = annexB({makeNal(0x65, 20000)});
+
+	packetizer.packetize(data.data(), data.size(), 0, true);
+	const size_t slots = packetizer.arena().slotCount();
+	EXPECT_EQ(packetizer.arena().freeSlotCount(), slots);
+
+	// Steady state reuses the same slots instead of growing the arena
+	for (int i = 0; i < 50; ++i) {
+		auto frame = packetizer.packetize(data.data(), data.size(), 0, true);
+		EXPECT_EQ(frame->packetCount(), 17u);
+		EXPECT_EQ(packetizer.arena().freeSlotCount(), slots - frame->packetCount());
+	}
+	EXPECT_EQ(packetizer.arena().slotCount(), slots);
+	EXPECT_EQ(packetizer.arena().freeSlotCount(), slots);
+}
+
+TEST(RtpPacketizerTest, FramesOutliveThePacketizer)
+{
+	std::shared_ptr<const RtpFrame> frame;
+	{
+		RtpPacketizer packetizer(RtpPayloadFormat::Opus, 1, 111);
+		const std::vector<uint8_t> payload(OPUS_MAX_PACKET_SIZE, 0x11);
+		frame = packetizer.packetize(payload.data(), payload.size(), 0, false);
+	}
+	ASSERT_EQ(frame->packetCount(), 1u);
+	EXPECT_EQ(frame->packetSize(0), RTP_HEADER_SIZE + OPUS_MAX_PACKET_SIZE);
+	EXPECT_EQ(frame->packetData(0)[RTP_HEADER_SIZE + 100], 0x11);
+}
+
+TEST(RtpSequencerTest, StampsConsecutiveSequenceNumbersPerViewer)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::H264, 1, 96, 1200);
+	auto data = annexB({makeNal(0x65, 2500)});
+	auto frame = packetizer.packetize(data.data(), data.size(), 0, true);
+
+	RtpSequencer first(0xFFFE);
+	RtpSequencer second(100);
+	size_t size = 0;
+
+	EXPECT_EQ(readRtpSequence(first.stamp(*frame, 0, size)), 0xFFFE);
+	EXPECT_EQ(size, frame->packetSize(0));
+	EXPECT_EQ(readRtpSequence(first.stamp(*frame, 1, size)), 0xFFFF);
+	EXPECT_EQ(readRtpSequence(first.stamp(*frame, 2, size)), 0x0000);
+	EXPECT_EQ(readRtpSequence(second.stamp(*frame, 0, size)), 100);
+
+	// The shared frame itself is never modified
+	EXPECT_EQ(readRtpSequence(frame->packetData(0)), 0);
+}
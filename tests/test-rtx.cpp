@@ -0,0 +1,133 @@
+/*
+ * Unit tests for the shared retransmission history and RTX stream
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "vdoninja-rtx.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+// VP8 frame large enough to span several packets
+std::shared_ptr<const RtpFrame> makeFrame(const RtpPacketizer &packetizer, size_t size, uint32_t timestamp)
+{
+	std::vector<uint8_t> payload(size);
+	for (size_t i = 0; i < size; ++i) {
+		payload[i] = static_cast<uint8_t>(i * 7);
+	}
+	return packetizer.packetize(payload.data(), payload.size(), timestamp, false, 1);
+}
+
+} // namespace
+
+TEST(RtpHistoryTest, FindsPacketsBySentSequence)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::VP8, 0x1234, 96, 100);
+	auto frame = makeFrame(packetizer, 350, 9000);
+	ASSERT_EQ(frame->packetCount(), 4u);
+
+	RtpHistory history(16);
+	history.recordFrame(65534, frame); // wraps across 0
+
+	size_t index = 99;
+	EXPECT_EQ(history.find(65535, index), frame);
+	EXPECT_EQ(index, 1u);
+	EXPECT_EQ(history.find(1, index), frame);
+	EXPECT_EQ(index, 3u);
+	EXPECT_EQ(history.find(2, index), nullptr);
+}
+
+TEST(RtpHistoryTest, OldEntriesAreEvictedAndReleased)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::VP8, 0x1234, 96, 100);
+	RtpHistory history(4);
+	EXPECT_EQ(history.capacity(), 4u);
+
+	std::weak_ptr<const RtpFrame> first = [&]() {
+		auto frame = makeFrame(packetizer, 150, 0);
+		history.recordFrame(10, frame);
+		return std::weak_ptr<const RtpFrame>(frame);
+	}();
+	EXPECT_FALSE(first.expired());
+
+	// Four newer packets overwrite both slots of the first frame
+	history.recordFrame(12, makeFrame(packetizer, 350, 3000));
+	size_t index = 0;
+	EXPECT_EQ(history.find(10, index), nullptr);
+	EXPECT_TRUE(first.expired());
+}
+
+TEST(RtpHistoryTest, CapacityRoundsUpToPowerOfTwo)
+{
+	EXPECT_EQ(RtpHistory(4000).capacity(), 4096u);
+	EXPECT_EQ(RtpHistory(0).capacity(), 1u);
+}
+
+TEST(RtxStreamTest, WrapsOriginalPacket)
+{
+	RtpPacketizer packetizer(RtpPayloadFormat::VP8, 0x1234, 96, 100);
+	auto frame = makeFrame(packetizer, 150, 4500);
+	const uint8_t *original = frame->packetData(0);
+	const size_t size = frame->packetSize(0);
+
+	RtxStream rtx(0xABCD, 97, 500);
+	std::vector<uint8_t> packet;
+	ASSERT_TRUE(rtx.wrap(original, size, 4242, packet));
+	ASSERT_EQ(packet.size(), size + 2);
+	EXPECT_EQ(packet[1] & 0x7F, 97);
+	EXPECT_EQ(packet[1] & 0x80, original[1] & 0x80);
+	EXPECT_EQ(readRtpSequence(packet.data()), 500);
+	EXPECT_EQ(readRtpTimestamp(packet.data()), 4500u);
+	EXPECT_EQ(readRtpSsrc(packet.data()), 0xABCDu);
+	EXPECT_EQ(packet[12], 4242 >> 8);
+	EXPECT_EQ(packet[13], 4242 & 0xFF);
+	EXPECT_TRUE(std::equal(original + RTP_HEADER_SIZE, original + size, packet.begin() + 14));
+
+	ASSERT_TRUE(rtx.wrap(original, size, 4243, packet));
+	EXPECT_EQ(readRtpSequence(packet.data()), 501);
+
+	const uint8_t truncated[4] = {0x80, 96, 0, 0};
+	EXPECT_FALSE(rtx.wrap(truncated, sizeof(truncated), 1, packet));
+}
+
+TEST(RtxStreamTest, CountsRequests)
+{
+	RtxStream rtx(1, 97, 0);
+	rtx.countRequest(true);
+	rtx.countRequest(false);
+	rtx.countRequest(true);
+	const RtxStats stats = rtx.stats();
+	EXPECT_EQ(stats.requestedPackets, 3u);
+	EXPECT_EQ(stats.retransmittedPackets, 2u);
+	EXPECT_EQ(stats.missedPackets, 1u);
+}
+
+TEST(RtxSdpTest, DetectsAcceptedRtxPayload)
+{
+	const std::string answer = "v=0\r\n"
+	                           "m=video 9 UDP/TLS/RTP/SAVPF 96 97\r\n"
+	                           "a=rtpmap:96 H264/90000\r\n"
+	                           "a=rtpmap:97 rtx/90000\r\n"
+	                           "a=fmtp:97 apt=96\r\n";
+	EXPECT_TRUE(sdpHasRtxPayload(answer, 97));
+	EXPECT_FALSE(sdpHasRtxPayload(answer, 96));
+	EXPECT_FALSE(sdpHasRtxPayload("a=rtpmap:96 H264/90000\r\n", 97));
+}
+
+TEST(RtpHeaderTest, MeasuresCsrcsAndExtensions)
+{
+	std::vector<uint8_t> packet(40, 0);
+	packet[0] = 0x80;
+	EXPECT_EQ(rtpHeaderLength(packet.data(), packet.size()), 12u);
+	packet[0] = 0x92; // two CSRCs + extension of one word
+	packet[12 + 8 + 3] = 1;
+	EXPECT_EQ(rtpHeaderLength(packet.data(), packet.size()), 12u + 8 + 4 + 4);
+	EXPECT_EQ(rtpHeaderLength(packet.data(), 22), 0u);
+}
@@ -0,0 +1,345 @@
+/*
+ * Unit tests for asynchronous per-viewer send queues
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vdoninja-send-queue.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+std::shared_ptr<OutboundFrame> makeFrame(MediaKind kind, bool keyframe = false, uint32_t timestamp = 0)
+{
+	auto frame = std::make_shared<OutboundFrame>();
+	frame->kind = kind;
+	frame->keyframe = keyframe;
+	frame->timestamp = timestamp;
+	frame->packet = EncodedPacket::adopt({0x00, 0x00, 0x01, 0x65});
+	frame->enqueuedAtUs = MediaSendPool::nowUs();
+	return frame;
+}
+
+template <typename Predicate> bool waitFor(Predicate predicate)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (std::chrono::steady_clock::now() < deadline) {
+		if (predicate()) {
+			return true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return predicate();
+}
+
+// Sink that blocks until released, used to build up a backlog
+class Gate
+{
+public:
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		cv_.wait(lock, [this]() { return open_; });
+	}
+	void open()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			open_ = true;
+		}
+		cv_.notify_all();
+	}
+
+private:
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	bool open_ = false;
+};
+
+} // namespace
+
+TEST(MediaSendPoolTest, DeliversFramesToEveryLaneInOrder)
+{
+	MediaSendPool pool(2);
+	pool.start();
+
+	std::mutex mutex;
+	std::vector<uint32_t> first;
+	std::vector<uint32_t> second;
+	pool.addLane("a", [&](const OutboundFrame &frame) {
+		std::lock_guard<std::mutex> lock(mutex);
+		first.push_back(frame.timestamp);
+	});
+	pool.addLane("b", [&](const OutboundFrame &frame) {
+		std::lock_guard<std::mutex> lock(mutex);
+		second.push_back(frame.timestamp);
+	});
+
+	for (uint32_t i = 0; i < 20; ++i) {
+		pool.enqueue(makeFrame(MediaKind::Video, i == 0, i));
+	}
+
+	ASSERT_TRUE(waitFor([&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return first.size() == 20 && second.size() == 20;
+	}));
+	for (uint32_t i = 0; i < 20; ++i) {
+		EXPECT_EQ(first[i], i);
+		EXPECT_EQ(second[i], i);
+	}
+
+	auto stats = pool.getStats();
+	EXPECT_EQ(stats.lanes, 2u);
+	EXPECT_EQ(stats.enqueuedFrames, 20u);
+	EXPECT_EQ(stats.droppedFrames, 0u);
+	pool.stop();
+}
+
+TEST(MediaSendPoolTest, ShardsLanesAcrossWorkers)
+{
+	MediaSendPool pool(2);
+	pool.start();
+
+	std::mutex mutex;
+	std::vector<std::thread::id> threads;
+	for (const char *key : {"a", "b"}) {
+		pool.addLane(key, [&](const OutboundFrame &) {
+			std::lock_guard<std::mutex> lock(mutex);
+			threads.push_back(std::this_thread::get_id());
+		});
+	}
+
+	pool.enqueue(makeFrame(MediaKind::Audio));
+	ASSERT_TRUE(waitFor([&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return threads.size() == 2;
+	}));
+	EXPECT_NE(threads[0], threads[1]);
+	pool.stop();
+}
+
+TEST(MediaSendPoolTest, SlowViewerDoesNotBlockOtherViewers)
+{
+	MediaSendPool pool(2);
+	pool.start();
+
+	Gate gate;
+	std::atomic<int> fastCount{0};
+	pool.addLane("slow", [&](const OutboundFrame &) { gate.wait(); });
+	pool.addLane("fast", [&](const OutboundFrame &) { fastCount++; });
+
+	for (int i = 0; i < 10; ++i) {
+		pool.enqueue(makeFrame(MediaKind::Audio));
+	}
+
+	EXPECT_TRUE(waitFor([&]() { return fastCount == 10; }));
+	EXPECT_GT(pool.laneDepth("slow"), 0u);
+
+	gate.open();
+	EXPECT_TRUE(waitFor([&]() { return pool.laneDepth("slow") == 0; }));
+	pool.stop();
+}
+
+TEST(MediaSendPoolTest, OverflowFlushesVideoAndResumesAtKeyframe)
+{
+	MediaSendPool pool(1, 4);
+	pool.start();
+
+	Gate gate;
+	std::mutex mutex;
+	std::vector<std::pair<MediaKind, bool>> delivered;
+	std::atomic<bool> blocked{false};
+	pool.addLane("viewer", [&](const OutboundFrame &frame) {
+		if (!blocked.exchange(true)) {
+			gate.wait();
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		delivered.emplace_back(frame.kind, frame.keyframe);
+	});
+
+	// The first frame occupies the worker; the next ones fill the lane.
+	pool.enqueue(makeFrame(MediaKind::Video, true));
+	ASSERT_TRUE(waitFor([&]() { return blocked.load(); }));
+	pool.enqueue(makeFrame(MediaKind::Audio));
+	pool.enqueue(makeFrame(MediaKind::Video));
+	pool.enqueue(makeFrame(MediaKind::Video));
+	pool.enqueue(makeFrame(MediaKind::Video));
+
+	// Overflow: queued video is flushed and delta frames are skipped until a keyframe.
+	pool.enqueue(makeFrame(MediaKind::Video));
+	pool.enqueue(makeFrame(MediaKind::Video));
+	pool.enqueue(makeFrame(MediaKind::Video, true));
+	EXPECT_EQ(pool.laneDepth("viewer"), 2u);
+
+	gate.open();
+	ASSERT_TRUE(waitFor([&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return delivered.size() == 3;
+	}));
+	EXPECT_EQ(delivered[1].first, MediaKind::Audio);
+	EXPECT_EQ(delivered[2].first, MediaKind::Video);
+	EXPECT_TRUE(delivered[2].second);
+	EXPECT_EQ(pool.getStats().droppedFrames, 5u);
+	pool.stop();
+}
+
+TEST(MediaSendPoolTest, PacketizesSharedFrameOnlyOnce)
+{
+	MediaSendPool pool(3);
+	pool.start();
+
+	std::atomic<int> packetizeCalls{0};
+	std::atomic<int> deliveries{0};
+	RtpPacketizer packetizer(RtpPayloadFormat::H264, 1, 96);
+	for (const char *key : {"a", "b", "c", "d"}) {
+		pool.addLane(key, [&](const OutboundFrame &frame) {
+			const RtpFrame &rtp = frame.rtp([&](const OutboundFrame &f) {
+				packetizeCalls++;
+				return packetizer.packetize(f.data(), f.size(), f.timestamp, f.keyframe);
+			});
+			EXPECT_EQ(rtp.packetCount(), 1u);
+			deliveries++;
+		});
+	}
+
+	pool.enqueue(makeFrame(MediaKind::Video, true));
+	ASSERT_TRUE(waitFor([&]() { return deliveries == 4; }));
+	EXPECT_EQ(packetizeCalls, 1);
+	pool.stop();
+}
+
+TEST(MediaSendPoolTest, PrimerFramesAreDeliveredBeforeLiveFrames)
+{
+	MediaSendPool pool(1);
+	pool.start();
+
+	std::mutex mutex;
+	std::vector<uint32_t> delivered;
+	std::vector<std::shared_ptr<const OutboundFrame>> primer = {makeFrame(MediaKind::Video, true, 1),
+	                                                            makeFrame(MediaKind::Video, false, 2)};
+	pool.addLane(
+	    "viewer",
+	    [&](const OutboundFrame &frame) {
+		    std::lock_guard<std::mutex> lock(mutex);
+		    delivered.push_back(frame.timestamp);
+	    },
+	    primer);
+	pool.enqueue(makeFrame(MediaKind::Video, false, 3));
+
+	ASSERT_TRUE(waitFor([&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return delivered.size() == 3;
+	}));
+	EXPECT_EQ(delivered, (std::vector<uint32_t>{1, 2, 3}));
+	pool.stop();
+}
+
+TEST(MediaSendPoolTest, PrimedLaneReplaysFramesAheadWithoutDuplicates)
+{
+	MediaSendPool pool(1);
+	pool.start();
+
+	Gate gate;
+	std::atomic<bool> blocked{false};
+	std::mutex mutex;
+	std::vector<uint32_t> delivered;
+	pool.addLane("viewer", [&](const OutboundFrame &frame) {
+		if (!blocked.exchange(true)) {
+			gate.wait();
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		delivered.push_back(frame.timestamp);
+	});
+
+	pool.enqueue(makeFrame(MediaKind::Video, false, 10));
+	ASSERT_TRUE(waitFor([&]() { return blocked.load(); }));
+	std::shared_ptr<const OutboundFrame> live = makeFrame(MediaKind::Video, false, 11);
+	pool.enqueue(live);
+
+	// The replayed GOP already contains the pending live frame
+	EXPECT_TRUE(pool.primeLane("viewer", {makeFrame(MediaKind::Video, true, 1), live}));
+	EXPECT_FALSE(pool.primeLane("missing", {live}));
+	gate.open();
+
+	ASSERT_TRUE(waitFor([&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return delivered.size() == 3;
+	}));
+	EXPECT_EQ(delivered, (std::vector<uint32_t>{10, 1, 11}));
+	pool.stop();
+}
+
+TEST(MediaSendPoolTest, LanesInSameSendGroupAreServedAsOneBatch)
+{
+	MediaSendPool pool(1);
+	pool.start();
+
+	std::mutex mutex;
+	std::map<std::string, std::vector<uint32_t>> received;
+	auto sinkFor = [&](const std::string &key) {
+		return [&, key](const OutboundFrame &frame) {
+			std::lock_guard<std::mutex> lock(mutex);
+			received[key].push_back(frame.timestamp);
+		};
+	};
+	for (const char *key : {"a", "b", "c"}) {
+		pool.addLane(key, sinkFor(key), {}, nullptr, 7);
+	}
+	pool.addLane("solo", sinkFor("solo"));
+
+	for (uint32_t ts = 1; ts <= 10; ++ts) {
+		pool.enqueue(makeFrame(MediaKind::Video, ts == 1, ts));
+	}
+	ASSERT_TRUE(waitFor([&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return received.size() == 4 && received["a"].size() == 10 && received["b"].size() == 10 &&
+		       received["c"].size() == 10 && received["solo"].size() == 10;
+	}));
+
+	const std::vector<uint32_t> expected = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+	for (const auto &entry : received) {
+		EXPECT_EQ(entry.second, expected) << entry.first;
+	}
+	// Every frame reached the three grouped lanes in a single pass; the ungrouped lane never batches
+	const SendQueueStats stats = pool.getStats();
+	EXPECT_EQ(stats.batches, 10u);
+	pool.stop();
+}
+
+TEST(MediaSendPoolTest, RemovedLaneStopsReceivingFrames)
+{
+	MediaSendPool pool(1);
+	pool.start();
+
+	std::atomic<int> count{0};
+	pool.addLane("viewer", [&](const OutboundFrame &) { count++; });
+	EXPECT_TRUE(pool.hasLane("viewer"));
+	pool.removeLane("viewer");
+	EXPECT_FALSE(pool.hasLane("viewer"));
+
+	pool.enqueue(makeFrame(MediaKind::Audio));
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_EQ(count, 0);
+	pool.stop();
+}
+
+TEST(MediaSendPoolTest, IgnoresFramesWhenStopped)
+{
+	MediaSendPool pool(1);
+	std::atomic<int> count{0};
+	pool.addLane("viewer", [&](const OutboundFrame &) { count++; });
+	pool.enqueue(makeFrame(MediaKind::Audio));
+	EXPECT_EQ(pool.laneDepth("viewer"), 0u);
+	EXPECT_EQ(pool.getStats().enqueuedFrames, 0u);
+}
@@ -0,0 +1,88 @@
+/*
+ * Unit tests for simulcast layers and per-viewer layer selection
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include "vdoninja-simulcast.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+bool offer(SimulcastLayerSelector &selector, uint8_t layer, bool keyframe, MediaKind kind = MediaKind::Video)
+{
+	OutboundFrame frame;
+	frame.kind = kind;
+	frame.layer = layer;
+	frame.keyframe = keyframe;
+	return selector.accept(frame);
+}
+
+} // namespace
+
+TEST(SimulcastLadderTest, BuildsScaledLayers)
+{
+	auto layers = buildSimulcastLadder(1920, 1080, 6000000, 3);
+	ASSERT_EQ(layers.size(), 3u);
+	EXPECT_EQ(layers[0].rid, "f");
+	EXPECT_EQ(layers[0].bitrate, 6000000);
+	EXPECT_EQ(layers[1].width, 960);
+	EXPECT_EQ(layers[1].height, 540);
+	EXPECT_EQ(layers[1].bitrate, 1500000);
+	EXPECT_EQ(layers[2].width, 480);
+	EXPECT_EQ(layers[2].bitrate, 500000);
+}
+
+TEST(SimulcastLadderTest, ClampsLayerCountAndMinimumBitrate)
+{
+	EXPECT_EQ(buildSimulcastLadder(1280, 720, 1000000, 0).size(), 1u);
+	auto layers = buildSimulcastLadder(1280, 720, 1000000, 10);
+	ASSERT_EQ(layers.size(), static_cast<size_t>(MAX_SIMULCAST_LAYERS));
+	EXPECT_EQ(layers[2].bitrate, 150000);
+}
+
+TEST(SimulcastLayerSelectorTest, SwitchesDownAndUpWithHysteresis)
+{
+	SimulcastLayerSelector selector({6000000, 1500000, 500000});
+	EXPECT_EQ(selector.targetLayer(), 0u);
+
+	EXPECT_TRUE(selector.onBandwidthEstimate(2000000));
+	EXPECT_EQ(selector.targetLayer(), 1u);
+
+	// Enough to keep layer 1 but not enough headroom to go back to layer 0
+	EXPECT_FALSE(selector.onBandwidthEstimate(7500000));
+	EXPECT_EQ(selector.targetLayer(), 1u);
+
+	EXPECT_TRUE(selector.onBandwidthEstimate(9000000));
+	EXPECT_EQ(selector.targetLayer(), 0u);
+
+	// Below every layer falls back to the lowest one
+	EXPECT_TRUE(selector.onBandwidthEstimate(100000));
+	EXPECT_EQ(selector.targetLayer(), 2u);
+}
+
+TEST(SimulcastLayerSelectorTest, SwitchesOnlyAtTargetKeyframe)
+{
+	SimulcastLayerSelector selector({6000000, 500000});
+	EXPECT_TRUE(offer(selector, 0, false));
+	EXPECT_FALSE(offer(selector, 1, false));
+
+	selector.setTargetLayer(1);
+	EXPECT_FALSE(offer(selector, 1, false));
+	EXPECT_TRUE(offer(selector, 0, false));
+	EXPECT_TRUE(offer(selector, 1, true));
+	EXPECT_EQ(selector.currentLayer(), 1u);
+	EXPECT_FALSE(offer(selector, 0, true));
+	EXPECT_TRUE(offer(selector, 1, false));
+}
+
+TEST(SimulcastLayerSelectorTest, AudioAlwaysPasses)
+{
+	SimulcastLayerSelector selector({6000000, 500000});
+	selector.setTargetLayer(1);
+	EXPECT_TRUE(offer(selector, 0, false, MediaKind::Audio));
+	EXPECT_TRUE(offer(selector, 1, false, MediaKind::Audio));
+}
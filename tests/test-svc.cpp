@@ -0,0 +1,171 @@
+/*
+ * Unit tests for SVC layer parsing and per-viewer layer selection
+ * SPDX-License-Identifier: AGPL-3.0-only
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "vdoninja-svc.h"
+
+using namespace vdoninja;
+
+namespace
+{
+
+constexpr int kStreamBitrate = 4000000;
+
+// Size-delimited AV1 frame OBU with an extension header carrying the layer ids
+void appendAv1Frame(std::vector<uint8_t> &tu, uint8_t temporalId, uint8_t spatialId, uint8_t fill)
+{
+	tu.push_back((6 << 3) | 0x04 | 0x02);
+	tu.push_back(static_cast<uint8_t>((temporalId << 5) | (spatialId << 3)));
+	tu.push_back(4);
+	tu.insert(tu.end(), 4, fill);
+}
+
+std::vector<uint8_t> av1TemporalUnit(uint8_t temporalId, uint8_t spatialLayers)
+{
+	std::vector<uint8_t> tu = {0x12, 0x00}; // Temporal delimiter
+	for (uint8_t s = 0; s < spatialLayers; ++s) {
+		appendAv1Frame(tu, temporalId, s, static_cast<uint8_t>(0xA0 + s));
+	}
+	return tu;
+}
+
+// VP9 superframe of key frames with the given sizes; show_frame is set unless hidden
+std::vector<uint8_t> vp9Superframe(const std::vector<size_t> &sizes, bool hideFirst = false)
+{
+	std::vector<uint8_t> data;
+	for (size_t i = 0; i < sizes.size(); ++i) {
+		const uint8_t header = hideFirst && i == 0 ? 0x80 : 0x82;
+		data.push_back(header);
+		data.insert(data.end(), sizes[i] - 1, static_cast<uint8_t>(i + 1));
+	}
+	const uint8_t marker = static_cast<uint8_t>(0xC0 | (sizes.size() - 1));
+	data.push_back(marker);
+	for (size_t size : sizes) {
+		data.push_back(static_cast<uint8_t>(size));
+	}
+	data.push_back(marker);
+	return data;
+}
+
+SvcFrameInfo layeredFrame(uint8_t temporalId, uint8_t spatialLayers = 1)
+{
+	SvcFrameInfo info;
+	info.layered = true;
+	info.temporalId = temporalId;
+	info.spatialLayers = spatialLayers;
+	return info;
+}
+
+} // namespace
+
+TEST(SvcTest, ParsesAv1LayerIds)
+{
+	const auto tu = av1TemporalUnit(1, 2);
+	SvcFrameInfo info;
+	ASSERT_TRUE(parseSvcFrame(RtpPayloadFormat::AV1, tu.data(), tu.size(), info));
+	EXPECT_EQ(info.spatialLayers, 2);
+	EXPECT_EQ(info.temporalId, 1);
+
+	// Without extension headers the frame is a single layer
+	const std::vector<uint8_t> plain = {0x12, 0x00, 0x32, 0x02, 0xAA, 0xBB};
+	EXPECT_FALSE(parseSvcFrame(RtpPayloadFormat::AV1, plain.data(), plain.size(), info));
+	EXPECT_EQ(info.spatialLayers, 1);
+	EXPECT_FALSE(parseSvcFrame(RtpPayloadFormat::H264, tu.data(), tu.size(), info));
+}
+
+TEST(SvcTest, KeepsLowerAv1SpatialLayers)
+{
+	const auto tu = av1TemporalUnit(0, 3);
+	const std::vector<uint8_t> reduced = keepSvcSpatialLayers(RtpPayloadFormat::AV1, tu.data(), tu.size(), 1);
+
+	std::vector<uint8_t> expected = {0x12, 0x00};
+	appendAv1Frame(expected, 0, 0, 0xA0);
+	EXPECT_EQ(reduced, expected);
+
+	SvcFrameInfo info;
+	const std::vector<uint8_t> two = keepSvcSpatialLayers(RtpPayloadFormat::AV1, tu.data(), tu.size(), 2);
+	ASSERT_TRUE(parseSvcFrame(RtpPayloadFormat::AV1, two.data(), two.size(), info));
+	EXPECT_EQ(info.spatialLayers, 2);
+}
+
+TEST(SvcTest, ParsesAndTrimsVp9Superframes)
+{
+	const auto superframe = vp9Superframe({5, 7, 9});
+	SvcFrameInfo info;
+	ASSERT_TRUE(parseSvcFrame(RtpPayloadFormat::VP9, superframe.data(), superframe.size(), info));
+	EXPECT_EQ(info.spatialLayers, 3);
+
+	// One layer is the first frame alone, without an index
+	const std::vector<uint8_t> one =
+	    keepSvcSpatialLayers(RtpPayloadFormat::VP9, superframe.data(), superframe.size(), 1);
+	EXPECT_EQ(one, std::vector<uint8_t>(superframe.begin(), superframe.begin() + 5));
+
+	const std::vector<uint8_t> two =
+	    keepSvcSpatialLayers(RtpPayloadFormat::VP9, superframe.data(), superframe.size(), 2);
+	EXPECT_EQ(two, vp9Superframe({5, 7}));
+
+	// An alt-ref superframe hides its first frame and is not spatial layering
+	const auto altRef = vp9Superframe({5, 7}, true);
+	EXPECT_FALSE(parseSvcFrame(RtpPayloadFormat::VP9, altRef.data(), altRef.size(), info));
+	const std::vector<uint8_t> single(6, 0x82);
+	EXPECT_FALSE(parseSvcFrame(RtpPayloadFormat::VP9, single.data(), single.size(), info));
+}
+
+TEST(SvcTest, LayerBitratesFollowTheLadder)
+{
+	EXPECT_EQ(svcLayerBitrate(kStreamBitrate, {3, 3}, {3, 3}), kStreamBitrate);
+	EXPECT_EQ(svcLayerBitrate(kStreamBitrate, {1, 3}, {1, 1}), kStreamBitrate * 4 / 10);
+	EXPECT_EQ(svcLayerBitrate(kStreamBitrate, {2, 1}, {1, 1}), kStreamBitrate / 4);
+	// Requests beyond the structure are clamped to it
+	EXPECT_EQ(svcLayerBitrate(kStreamBitrate, {1, 2}, {3, 3}), kStreamBitrate);
+}
+
+TEST(SvcTest, TemporalLayersFollowTheEstimate)
+{
+	SvcLayerSelector selector;
+	const SvcLayers structure{1, 3};
+
+	ASSERT_TRUE(selector.onBandwidthEstimate(2000000, kStreamBitrate, structure));
+	EXPECT_EQ(selector.stats().target.temporal, 1);
+	// Inside the hysteresis band the target holds
+	EXPECT_FALSE(selector.onBandwidthEstimate(2500000, kStreamBitrate, structure));
+
+	// L1T3 pattern: only base-layer frames pass
+	const uint8_t pattern[] = {0, 2, 1, 2};
+	size_t sent = 0;
+	for (uint8_t tid : pattern) {
+		sent += selector.select(layeredFrame(tid), false) > 0 ? 1 : 0;
+	}
+	EXPECT_EQ(sent, 1u);
+	EXPECT_EQ(selector.stats().droppedFrames, 3u);
+
+	// Upper layers come back at the next base-layer frame
+	ASSERT_TRUE(selector.onBandwidthEstimate(10000000, kStreamBitrate, structure));
+	EXPECT_EQ(selector.select(layeredFrame(2), false), 0u);
+	EXPECT_EQ(selector.select(layeredFrame(0), false), 1u);
+	EXPECT_EQ(selector.select(layeredFrame(2), false), 1u);
+	EXPECT_EQ(selector.stats().current.temporal, 3);
+}
+
+TEST(SvcTest, SpatialLayersReturnAtKeyframes)
+{
+	SvcLayerSelector selector;
+	const SvcLayers structure{2, 1};
+
+	// Frames without layer ids always go out whole
+	EXPECT_EQ(selector.select(SvcFrameInfo{}, false), 1u);
+
+	ASSERT_TRUE(selector.onBandwidthEstimate(2000000, kStreamBitrate, structure));
+	EXPECT_EQ(selector.select(layeredFrame(0, 2), false), 1u);
+	EXPECT_EQ(selector.stats().reducedFrames, 1u);
+
+	ASSERT_TRUE(selector.onBandwidthEstimate(10000000, kStreamBitrate, structure));
+	EXPECT_EQ(selector.select(layeredFrame(0, 2), false), 1u);
+	EXPECT_EQ(selector.select(layeredFrame(0, 2), true), 2u);
+	EXPECT_EQ(selector.select(layeredFrame(0, 2), false), 2u);
+}